@@ -30,6 +30,10 @@ LIST(APPEND REQUIRED_REAL_LIBRARIES "MUMPSD_SEQ_LIBRARY")
 FIND_LIBRARY(MUMPSZ_SEQ_LIBRARY NAMES zmumps_seq zmumps_c PATHS ${MUMPS_LIB_SEARCH_PATH})
 LIST(APPEND REQUIRED_CPLX_LIBRARIES "MUMPSZ_SEQ_LIBRARY")
 
+# Single precision arithmetics (mixed-precision solution) - optional, see HAVE_MUMPS_SINGLE below.
+FIND_LIBRARY(MUMPSS_SEQ_LIBRARY NAMES smumps_seq smumps_c PATHS ${MUMPS_LIB_SEARCH_PATH})
+FIND_LIBRARY(MUMPSC_SEQ_LIBRARY NAMES cmumps_seq cmumps_c PATHS ${MUMPS_LIB_SEARCH_PATH})
+
 LIST(APPEND REQUIRED_REAL_LIBRARIES "MUMPS_MPISEQ_LIBRARY")
 LIST(APPEND REQUIRED_CPLX_LIBRARIES "MUMPS_MPISEQ_LIBRARY")  
 
@@ -89,5 +93,14 @@ FIND_PACKAGE_HANDLE_STANDARD_ARGS(  MUMPS DEFAULT_MSG
     LIST(APPEND MUMPS_CPLX_LIBRARIES ${${_LIB}})
   ENDFOREACH(_LIB ${REQUIRED_CPLX_LIBRARIES})
 
+# Single precision libraries, if both are present, enable the mixed-precision solution (HAVE_MUMPS_SINGLE).
+if(MUMPSS_SEQ_LIBRARY AND MUMPSC_SEQ_LIBRARY)
+  LIST(APPEND MUMPS_REAL_LIBRARIES ${MUMPSS_SEQ_LIBRARY})
+  LIST(APPEND MUMPS_CPLX_LIBRARIES ${MUMPSC_SEQ_LIBRARY})
+  SET(HAVE_MUMPS_SINGLE YES)
+else(MUMPSS_SEQ_LIBRARY AND MUMPSC_SEQ_LIBRARY)
+  MESSAGE(STATUS "MUMPS single precision libraries not found - mixed-precision solution disabled.")
+endif(MUMPSS_SEQ_LIBRARY AND MUMPSC_SEQ_LIBRARY)
+
 # Finally, set MUMPS_INCLUDE_DIR to point to the MUMPS include directory.
 SET(MUMPS_INCLUDE_DIR ${MUMPS_INCLUDE_DIR} ${MUMPS_INCLUDE_PATH})
@@ -0,0 +1,85 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_DWR_ERROR_CALCULATOR_H
+#define __H2D_DWR_ERROR_CALCULATOR_H
+
+#include "error_calculator.h"
+#include "../solver/linear_solver.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Goal-oriented error estimation by the dual weighted residual (DWR) method. \ingroup g_adapt
+    /** The quantity of interest J(v) is given by the vector forms of a weak formulation (the matrix forms are not used).
+    *  The adjoint problem A^T z = j is solved on the reference space(s) with the matrix of the LinearSolver that calculated
+    *  the reference solution. If the underlying linear matrix solver supports it (UMFPACK), its factorization is reused.
+    *  <br>
+    *  The residual of the coarse solution on the reference space is weighted by z and localized to the coarse elements
+    *  through a partition of unity over the reference DOFs. The indicators are stored as errors of the coarse elements,
+    *  so that Adapt uses this class as any other ErrorCalculator.
+    *  Note that the element "errors" are the absolute values of the indicators (not their squares).
+    *  Only linear problems are supported.
+    */
+    template<typename Scalar>
+    class HERMES_API DualWeightedResidualErrorCalculator : public ErrorCalculator < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] goal_wf Weak formulation with vector forms defining the goal functional (quantity of interest).
+      DualWeightedResidualErrorCalculator(WeakFormSharedPtr<Scalar> goal_wf);
+      virtual ~DualWeightedResidualErrorCalculator();
+
+      /// Calculates the element indicators.
+      /// \param[in] fine_solutions Reference solutions, used by Adapt for the refinement selection.
+      /// \param[in] reference_solver The solver that calculated the reference solution, its matrix and rhs must still correspond to it.
+      /// Both are left untouched (the solution vector of the reference_solver as well).
+      /// \param[in] sort_and_store See ErrorCalculator::calculate_errors().
+      void calculate_errors(std::vector<MeshFunctionSharedPtr<Scalar> > coarse_solutions, std::vector<MeshFunctionSharedPtr<Scalar> > fine_solutions, LinearSolver<Scalar>* reference_solver, bool sort_and_store = true);
+
+      /// Calculates the element indicators.
+      /// One component version.
+      void calculate_errors(MeshFunctionSharedPtr<Scalar> coarse_solution, MeshFunctionSharedPtr<Scalar> fine_solution, LinearSolver<Scalar>* reference_solver, bool sort_and_store = true);
+
+      /// The estimate of J(u_ref) - J(u_coarse), i.e. the sum of the (signed) element indicators.
+      Scalar get_goal_error_estimate() const;
+
+      /// The adjoint solution (on the reference space) from the last calculation.
+      MeshFunctionSharedPtr<Scalar> get_adjoint_solution(int component = 0);
+
+    protected:
+      /// State querying helpers.
+      virtual bool isOkay() const;
+      inline std::string getClassName() const { return "DualWeightedResidualErrorCalculator"; }
+
+      /// Solves the adjoint problem into adjoint_vector.
+      /// Reuses the factorization in the linear matrix solver of reference_solver if possible, transposes the matrix otherwise.
+      void solve_adjoint(LinearSolver<Scalar>* reference_solver, Scalar* goal_vector, int ndof);
+
+      /// Goal functional.
+      WeakFormSharedPtr<Scalar> goal_wf;
+
+      /// Adjoint solution.
+      Scalar* adjoint_vector;
+      std::vector<MeshFunctionSharedPtr<Scalar> > adjoint_solutions;
+      std::vector<SpaceSharedPtr<Scalar> > reference_spaces;
+
+      /// Sum of the signed indicators.
+      Scalar goal_error_estimate;
+    };
+  }
+}
+#endif
@@ -20,6 +20,15 @@
 #include "norm_form.h"
 #include "error_thread_calculator.h"
 
+/// Minimum length of the prefix of element references sorted right after the error calculation.
+#define H2D_ERROR_CALCULATOR_SORTED_PREFIX_MIN 1024
+/// The prefix sorted right after the error calculation covers (1 / this) of all elements.
+#define H2D_ERROR_CALCULATOR_SORTED_PREFIX_DIVISOR 16
+/// If the requested prefix covers more than (1 / this) of the unsorted entries, all of them are sorted.
+#define H2D_ERROR_CALCULATOR_FULL_SORT_RATIO 4
+/// Minimum number of unsorted entries for the selection to be done in parallel.
+#define H2D_ERROR_CALCULATOR_PARALLEL_SELECTION_MIN 65536
+
 namespace Hermes
 {
   namespace Hermes2D
@@ -97,6 +106,7 @@ namespace Hermes
       };
 
       /// A queue of elements which should be processes. The queue had to be filled by the method fill_regular_queue().
+      /// Only the sorted prefix (see sort_element_references()) is in a descending order wrt. the error.
       const ElementReference& get_element_reference(unsigned int id) const;
 
       /// Return the error mesh function - for visualization and other postprocessing of the element-wise error.
@@ -121,6 +131,10 @@ namespace Hermes
       /// Called at the end of error_calculation.
       void postprocess_error();
 
+      /// Marks the calculated errors as the ones used for adaptivity (sort_and_store == true), sorts their leading part.
+      /// Called at the end of error_calculation.
+      void store_element_references(bool sort_and_store);
+
       /// Data.
       std::vector<MeshFunctionSharedPtr<Scalar> > coarse_solutions;
       std::vector<MeshFunctionSharedPtr<Scalar> > fine_solutions;
@@ -159,14 +173,25 @@ namespace Hermes
       /// This is for adaptivity, saying that the errors are the correct ones.
       bool elements_stored;
 
-      static int compareElementReference(const void * a, const void * b)
+      /// Number of leading entries of element_references sorted in a descending order wrt. their error.
+      /// No entry behind this prefix carries a larger error than any entry inside it.
+      int sorted_element_references_count;
+
+      /// Makes sure that (at least) the first count entries of element_references are sorted.
+      /// Only the needed prefix is selected from the rest (in parallel for large meshes), the full sort is used
+      /// only if the requested prefix covers a large portion of the unsorted entries.
+      /// Adapt calls this on the fly, as the stopping criterion typically consumes only a few percent of all elements.
+      void sort_element_references(int count);
+
+      /// Ordering of element references - descending wrt. the error, ties broken by component and element id,
+      /// so that the result does not depend on the number of threads.
+      static bool compare_element_references(const ElementReference& a, const ElementReference& b)
       {
-        ElementReference* ref_a = (ElementReference*)(a);
-        ElementReference* ref_b = (ElementReference*)(b);
-        if (*((*ref_a).error) > *((*ref_b).error))
-          return -1;
-        else
-          return 1;
+        if (*a.error != *b.error)
+          return *a.error > *b.error;
+        if (a.comp != b.comp)
+          return a.comp < b.comp;
+        return a.element_id < b.element_id;
       };
 
       friend class Adapt < Scalar > ;
@@ -37,6 +37,11 @@ namespace Hermes
       void free();
       void evaluate_one_state(Traverse::State* current_state);
 
+      /// Redirects the contributions of the following states to per-component accumulators (one value per component),
+      /// instead of the element arrays of the ErrorCalculator. Passing nullptr switches back.
+      /// Used for summing the contributions in a deterministic order.
+      void set_local_storage(double* errors, double* norms);
+
       class DGErrorCalculator
       {
       public:
@@ -85,6 +90,14 @@ namespace Hermes
       Traverse::State* current_state;
 
       ErrorCalculator<Scalar>* errorCalculator;
+
+      /// See set_local_storage().
+      double* local_errors;
+      double* local_norms;
+
+      /// The accumulators the form on the component contributes to.
+      double* get_error_storage(int component);
+      double* get_norm_storage(int component);
     };
   }
 }
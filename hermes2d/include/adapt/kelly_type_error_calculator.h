@@ -0,0 +1,112 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_KELLY_TYPE_ERROR_CALCULATOR_H
+#define __H2D_KELLY_TYPE_ERROR_CALCULATOR_H
+
+#include "error_calculator.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Residual (Kelly-type) error estimation from a single solution. \ingroup g_adapt
+    /** The element indicator is a sum of
+    *  - volumetric and boundary residual terms - NormFormVol / NormFormSurf forms added by add_error_form(),
+    *    evaluated on the solution (use the function type FineSolutions in the forms),
+    *  - interface terms - NormFormDG forms added by add_interface_form(), evaluated on the inner edges
+    *    (DiscontinuousFunc gives the values from both sides), optionally scaled by the element diameter.
+    *  <br>
+    *  Both passes run in parallel. Every inner edge is evaluated only once (by the smaller of the two elements,
+    *  or by the one with the lower id if both are of the same size) and each of the two elements gets half of its value.
+    *  All contributions are summed in a fixed order, so that the indicators do not depend on the number of threads.
+    *  <br>
+    *  Norms (for the relative error types) are given by the volumetric / boundary forms only.
+    */
+    template<typename Scalar>
+    class HERMES_API KellyTypeErrorCalculator : public ErrorCalculator < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] scale_interfaces_by_diameter Multiply the interface terms by the diameter of the element
+      /// (the classical h_K * || [du/dn] ||^2 scaling of the Kelly estimator).
+      KellyTypeErrorCalculator(CalculatedErrorType errorType, bool scale_interfaces_by_diameter = true);
+      virtual ~KellyTypeErrorCalculator();
+
+      /// Adds an interface form. Only forms with i == j are supported, the form is evaluated on the solution i.
+      void add_interface_form(NormFormDG<Scalar>* form);
+
+      /// Calculates the element indicators of the solutions.
+      /// \param[in] sort_and_store See ErrorCalculator::calculate_errors().
+      void calculate_errors(std::vector<MeshFunctionSharedPtr<Scalar> > solutions, bool sort_and_store = true);
+
+      /// Calculates the element indicators of the solution.
+      /// One component version.
+      void calculate_errors(MeshFunctionSharedPtr<Scalar> solution, bool sort_and_store = true);
+
+    protected:
+      /// State querying helpers.
+      virtual bool isOkay() const;
+      inline std::string getClassName() const { return "KellyTypeErrorCalculator"; }
+
+      /// Volumetric and boundary terms, summed per element in the order of the traversal states.
+      void calculate_element_terms();
+
+      /// Interface terms, each inner edge evaluated once.
+      void calculate_interface_terms();
+
+      /// Value of the interface forms of the component on the active segment of the neighbor search.
+      double evaluate_interface(int component, Solution<Scalar>* solution, NeighborSearch<Scalar>& neighbor_search, Element* e, int edge);
+
+      /// Holds interface forms.
+      std::vector<NormFormDG<Scalar> *> interface_forms;
+
+      bool scale_interfaces_by_diameter;
+
+      /// Geometry & integration weights of the interface terms, one set per thread.
+      struct InterfaceIntegrationData
+      {
+        GeomSurf<double> geometry;
+        double jacobian_x_weights[H2D_MAX_INTEGRATION_POINTS_COUNT];
+      };
+    };
+
+    /// Kelly error estimator for the Laplace operator: the norm of the jumps of the normal derivative over the inner edges,
+    /// scaled by the diameter of the element. \ingroup g_adapt
+    template<typename Scalar>
+    class HERMES_API BasicKellyErrorCalculator : public KellyTypeErrorCalculator < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] const_by_laplacian Constant multiplying the Laplacian in the equation (the coefficient of the jumps).
+      /// \param[in] normType Norm of the solution used for the relative error types.
+      BasicKellyErrorCalculator(CalculatedErrorType errorType, int component_count, double const_by_laplacian = 1.0, NormType normType = HERMES_H1_NORM);
+      virtual ~BasicKellyErrorCalculator();
+
+      /// Squared jump of the normal derivative.
+      class HERMES_API NormalDerivativeJumpForm : public NormFormDG < Scalar >
+      {
+      public:
+        NormalDerivativeJumpForm(int i, double const_by_laplacian);
+
+        Scalar value(int n, double *wt, DiscontinuousFunc<Scalar> *u, DiscontinuousFunc<Scalar> *v, GeomSurf<double> *e) const;
+
+      protected:
+        double const_by_laplacian;
+      };
+    };
+  }
+}
+#endif
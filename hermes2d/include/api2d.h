@@ -38,7 +38,11 @@ namespace Hermes
     enum Hermes2DApiParam
     {
       xmlSchemasDirPath,
-      precalculatedFormsDirPath
+      precalculatedFormsDirPath,
+      /// Directory with the files of the precalculated shapeset tables (see PrecalcShapesetAssemblingStorage), empty (default) - no files.
+      precalculatedShapesetTablesDirPath,
+      /// Traverse the base elements along the Hilbert curve through their centroids (1), or in the order of their ids (0, default).
+      spaceFillingCurveOrdering
     };
 
     /// API Class containing settings for the whole Hermes2D.
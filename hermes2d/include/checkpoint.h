@@ -0,0 +1,177 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+/*! \file checkpoint.h
+\brief File containing the Checkpoint class.
+*/
+
+#ifndef __H2D_CHECKPOINT_H
+#define __H2D_CHECKPOINT_H
+
+#include "global.h"
+#include "function/solution.h"
+#include "boundary_conditions/essential_boundary_conditions.h"
+
+/// Version of the checkpoint format, files of a different version are refused.
+#define H2D_CHECKPOINT_VERSION 1
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// \brief Binary checkpoint / restart file holding Meshes, Spaces and Solutions.
+    ///
+    /// The file consists of a header, a sequence of sections (one per object) and a table of contents.
+    /// Each section holds raw arrays (nodes, elements and the refinement tree of a mesh, element orders and
+    /// DOF data of a space, coefficients of a solution), it can be compressed (zlib, Hermes has to be built WITH_ZLIB)
+    /// and it carries a checksum of its stored bytes.
+    ///
+    /// Reading maps the file to memory (the whole file is read on Windows) and parses the table of contents only,
+    /// a section is decoded (and its checksum verified) when the corresponding object is loaded.
+    /// Uncompressed sections are read directly from the mapping.
+    ///
+    /// The file is bound to the byte order and the Scalar type of the writer.
+    template<typename Scalar>
+    class HERMES_API Checkpoint : public Hermes::Mixins::Loggable
+    {
+    public:
+      Checkpoint();
+      ~Checkpoint();
+
+      /// Writes the checkpoint.
+      /// \param[in] meshes All the meshes the spaces and solutions are defined on.
+      /// \param[in] spaces Spaces, their meshes have to be among meshes.
+      /// \param[in] solutions Solutions (instances of Solution, not exact solutions), their meshes have to be among meshes.
+      /// \param[in] compress Compress the sections (zlib).
+      void save(const char* filename, std::vector<MeshSharedPtr> meshes, std::vector<SpaceSharedPtr<Scalar> > spaces = std::vector<SpaceSharedPtr<Scalar> >(),
+        std::vector<MeshFunctionSharedPtr<Scalar> > solutions = std::vector<MeshFunctionSharedPtr<Scalar> >(), bool compress = false);
+
+      /// Opens a checkpoint for reading.
+      /// \param[in] verify_checksums Verify the checksums of the sections when they are loaded.
+      void open(const char* filename, bool verify_checksums = true);
+
+      /// Releases the file (the loaded objects are not affected).
+      void close();
+
+      /// Numbers of objects in the opened checkpoint.
+      int get_mesh_count() const;
+      int get_space_count() const;
+      int get_solution_count() const;
+
+      /// Loads the mesh with the index (position in the meshes passed to save()).
+      /// The mesh is loaded only once, the same instance is returned (and used by spaces and solutions) afterwards.
+      MeshSharedPtr load_mesh(int index);
+
+      /// Loads the space with the index, with its mesh.
+      /// The DOF numbering is reproduced, provided the same essential boundary conditions as in the saved space are used.
+      /// \param[in] essential_bcs Essential boundary conditions of the space.
+      /// \param[in] shapeset Shapeset, the default one of the space type if nullptr.
+      SpaceSharedPtr<Scalar> load_space(int index, EssentialBCs<Scalar>* essential_bcs = nullptr, Shapeset* shapeset = nullptr);
+
+      /// Loads the solution with the index, with its mesh.
+      MeshFunctionSharedPtr<Scalar> load_solution(int index);
+
+    protected:
+      enum SectionType
+      {
+        SectionMesh = 0,
+        SectionSpace = 1,
+        SectionSolution = 2
+      };
+
+      struct FileHeader
+      {
+        char magic[8];
+        unsigned int version;
+        unsigned int byte_order;
+        unsigned int scalar_size;
+        unsigned int section_count;
+        uint64_t toc_offset;
+        uint64_t toc_checksum;
+      };
+
+      struct SectionRecord
+      {
+        unsigned int type;
+        int index;
+        int mesh_index;
+        unsigned int compressed;
+        uint64_t offset;
+        uint64_t stored_size;
+        uint64_t raw_size;
+        uint64_t checksum;
+      };
+
+      /// Raw content of a section being written - pieces of memory, either referenced or owned.
+      class SectionData
+      {
+      public:
+        ~SectionData();
+        /// References the data, they have to live until the section is written.
+        void add_reference(const void* data, size_t size);
+        /// Copies the data.
+        void add_copy(const void* data, size_t size);
+        template<typename T>
+        void add_value(T value) { add_copy(&value, sizeof(T)); }
+        size_t size() const;
+        /// Contiguous copy of the content.
+        void gather(char* target) const;
+
+        std::vector<std::pair<const char*, size_t> > pieces;
+        std::vector<char*> owned;
+      };
+
+      /// Sequential reader of a decoded section.
+      class SectionReader
+      {
+      public:
+        SectionReader(const char* data, size_t size);
+        void read(void* target, size_t size);
+        /// Throws if count items of item_size bytes are not left in the section (before allocating them).
+        void require(int count, size_t item_size) const;
+        template<typename T>
+        T read_value() { T value; read(&value, sizeof(T)); return value; }
+      protected:
+        const char* data;
+        size_t size;
+        size_t position;
+      };
+
+      void write_mesh(SectionData& data, MeshSharedPtr mesh);
+      void write_space(SectionData& data, SpaceSharedPtr<Scalar> space);
+      void write_solution(SectionData& data, Solution<Scalar>* solution);
+      void write_section(FILE* file, uint64_t& position, SectionData& data, SectionType type, int index, int mesh_index, bool compress);
+
+      void read_mesh(SectionReader& reader, MeshSharedPtr mesh);
+
+      /// Finds the section, decodes it (into buffer if it is compressed) and verifies its checksum.
+      const char* get_section(SectionType type, int index, std::vector<char>& buffer, size_t& size, int& mesh_index);
+      int get_section_count(SectionType type) const;
+
+      static uint64_t checksum(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+      static int find_mesh(const std::vector<MeshSharedPtr>& meshes, MeshSharedPtr mesh);
+
+      /// The opened file.
+      char* file_data;
+      size_t file_size;
+      bool file_mapped;
+      bool verify_checksums;
+      std::vector<SectionRecord> sections;
+
+      /// Meshes loaded from the opened file.
+      std::vector<MeshSharedPtr> loaded_meshes;
+    };
+  }
+}
+#endif
@@ -151,6 +151,11 @@ namespace Hermes
       /// Select the right things to assemble
       DiscreteProblemSelectiveAssembler<Scalar> selectiveAssembler;
 
+      /// States of the last assembling, reused while the meshes do not change.
+      Traverse::StatesCache states_cache;
+      /// The states of the current assembling are owned by states_cache (not deleted in deinit_assembling()).
+      bool states_cached;
+
       template<typename T> friend class Solver;
       template<typename T> friend class LinearSolver;
       template<typename T, typename S> friend class AdaptSolver;
@@ -81,6 +81,9 @@ namespace Hermes
       bool form_to_be_assembled(VectorFormDG<Scalar>* form, Traverse::State* current_state);
 
     protected:
+      /// Adds the pairs (row, col) of the DOFs of the two assembly lists (packed by SparseMatrix::pack_ij()), Dirichlet DOFs are skipped.
+      static void add_element_pairs(std::vector<uint64_t>& pairs, const AsmList<Scalar>& rows, const AsmList<Scalar>& cols);
+
       /// Spaces.
       unsigned int spaces_size;
 
@@ -105,6 +105,8 @@ namespace Hermes
       PrecalcShapesetAssembling** pss;
       RefMap** refmaps;
       RefMap* rep_refmap;
+      /// Snapshots of the meshes of the spaces, the reference maps read the vertex coordinates from them.
+      const MeshSnapshot* snapshots[H2D_MAX_COMPONENTS];
       Solution<Scalar>** u_ext;
       std::vector<Transformable *> fns;
 
@@ -0,0 +1,123 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+/*! \file async_output_writer.h
+\brief File containing the AsyncOutputWriter class.
+*/
+
+#ifndef __H2D_ASYNC_OUTPUT_WRITER_H
+#define __H2D_ASYNC_OUTPUT_WRITER_H
+
+#include "solution.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+/// Default upper bound (in bytes) of the memory held by snapshots waiting to be written by AsyncOutputWriter.
+#define H2D_ASYNC_OUTPUT_MAX_PENDING_MEMORY 1073741824
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// \brief Writes Solutions (and their linearized forms) and Meshes on background threads.
+    /// Each save_* call takes a snapshot of the data (the coefficient arrays of the Solution and - only if it changed
+    /// since the last call - a copy of the Mesh), enqueues the job and returns, so that the computation can
+    /// continue while the linearization and the file output run in the background.
+    /// The memory held by snapshots waiting for output is bounded, if the limit would be exceeded, the save_* call
+    /// waits for the background threads to catch up (back-pressure).
+    /// Errors of the background jobs are reported by wait().
+    class HERMES_API AsyncOutputWriter : public Hermes::Mixins::Loggable
+    {
+    public:
+      /// Constructor.
+      /// \param[in] thread_count Number of background threads.
+      /// \param[in] max_pending_memory Bound (in bytes) of the memory held by snapshots not written yet.
+      AsyncOutputWriter(int thread_count = 1, size_t max_pending_memory = H2D_ASYNC_OUTPUT_MAX_PENDING_MEMORY);
+      /// Destructor - waits for all the jobs to finish.
+      ~AsyncOutputWriter();
+
+      /// Solution::save() in the background.
+      template<typename Scalar>
+      void save_solution(MeshFunctionSharedPtr<Scalar> sln, const char* filename);
+#ifdef WITH_BSON
+      /// Solution::save_bson() in the background.
+      template<typename Scalar>
+      void save_solution_bson(MeshFunctionSharedPtr<Scalar> sln, const char* filename);
+#endif
+
+      /// Views::Linearizer::save_solution_vtk() in the background.
+      void save_solution_vtk(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, bool mode_3D = true, int item = H2D_FN_VAL_0);
+      /// Views::Linearizer::save_solution_vtu() in the background.
+      void save_solution_vtu(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, bool mode_3D = true, int item = H2D_FN_VAL_0, bool compress = false);
+      /// Views::Linearizer::save_solution_tecplot_binary() in the background.
+      void save_solution_tecplot_binary(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, int item = H2D_FN_VAL_0);
+
+      /// MeshReaderH2DXML::save() in the background.
+      void save_mesh(MeshSharedPtr mesh, const char* filename);
+
+      /// Waits until all the jobs enqueued so far are written.
+      /// Throws if any of them failed.
+      void wait();
+
+      /// Number of jobs enqueued and not finished yet.
+      int get_pending_count();
+
+      /// Background job.
+      class Job
+      {
+      public:
+        virtual ~Job() {};
+        virtual void run() = 0;
+        /// Memory held by the snapshot(s) of the job.
+        size_t memory_size;
+      };
+
+    protected:
+      /// Enqueues the job, blocks while the pending snapshots would exceed max_pending_memory.
+      void enqueue(Job* job);
+
+      /// Main loop of a background thread.
+      void process_jobs();
+
+      /// Snapshot of the solution on a snapshot of its mesh. Adds the size of the snapshot to memory_size.
+      template<typename Scalar>
+      MeshFunctionSharedPtr<Scalar> snapshot_solution(MeshFunctionSharedPtr<Scalar> sln, size_t& memory_size);
+
+      /// Snapshot of the mesh - reused as long as the mesh does not change. Adds the size of a new snapshot to memory_size.
+      MeshSharedPtr snapshot_mesh(MeshSharedPtr mesh, size_t& memory_size);
+
+      std::vector<std::thread> threads;
+      std::deque<Job*> jobs;
+      std::mutex jobs_mutex;
+      std::condition_variable job_enqueued;
+      std::condition_variable job_finished;
+
+      size_t max_pending_memory;
+      size_t pending_memory;
+      int running_count;
+      bool finishing;
+
+      /// First error in the background jobs since the last wait().
+      std::string error_message;
+
+      /// The last mesh snapshot, identified by the original mesh and its sequence number.
+      const Mesh* last_mesh;
+      unsigned last_mesh_seq;
+      MeshSharedPtr last_mesh_snapshot;
+    };
+  }
+}
+#endif
@@ -88,6 +88,11 @@ namespace Hermes
     /// both components are specified in 'item', e.g., item1 = H2D_FN_DX (which is H2D_FN_DX_0 | H2D_FN_DX_1).
     /// Otherwise it is Scalar-valued.
     ///
+    /// Trees of simple filters are evaluated in one pass: a source that is itself a scalar SimpleFilter
+    /// on the same mesh, used by its value, is not precalculated into its own tables, its filter_fn() is applied
+    /// directly to the values of its sources. The remaining sources of the whole tree are precalculated
+    /// only once each and only the final result is stored.
+    ///
     template<typename Scalar>
     class HERMES_API SimpleFilter : public Filter < Scalar >
     {
@@ -106,6 +111,27 @@ namespace Hermes
 
       void init_components();
       virtual void precalculate(unsigned short order, unsigned short mask);
+
+      /// True if the filter can be evaluated as a part of the tree of its parent filter.
+      /// Derived classes overriding precalculate() have to return false.
+      virtual bool is_fusable() const;
+
+      /// The i-th source, if it is evaluated as a part of this tree, nullptr if it is precalculated.
+      SimpleFilter<Scalar>* get_fused_source(int i) const;
+
+      /// Collects the sources of the tree to be precalculated, with the union of the items needed from each.
+      void collect_fused_sources(std::vector<MeshFunction<Scalar>*>& sources, std::vector<int>& masks) const;
+
+      /// Evaluates the tree in np points, the sources collected by collect_fused_sources() have to be precalculated.
+      void evaluate_fused(int np, int component, Scalar* result);
+
+      /// Buffers of the fused evaluation, kept between the elements.
+      std::vector<MeshFunction<Scalar>*> fused_sources;
+      std::vector<int> fused_masks;
+      /// Tables passed to filter_fn().
+      std::vector<const Scalar*> fused_tables;
+      /// Values of the fused sources, H2D_MAX_INTEGRATION_POINTS_COUNT per source.
+      std::vector<Scalar> fused_values;
     };
 
     /// ComplexFilter is used to transform complex solutions into its real parts.
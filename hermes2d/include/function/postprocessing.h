@@ -89,23 +89,58 @@ namespace Hermes
 
         void process();
 
-        void prepare_min_max_vertex_values(bool quadratic);
-
-        /// Get mean value of the mixed derivative (mixed_derivative_index) on element e, of the "component" - component
-        /// of the solution.
-        double get_centroid_value_multiplied(Element* e, int component, int mixed_derivative_index);
+        /// Reference points the solutions are evaluated at.
+        enum EvaluationPoint
+        {
+          EvaluationPointCentroid = 0,
+          EvaluationPointEdgeMidpoint = 1,
+          EvaluationPointVertex = 1 + H2D_MAX_NUMBER_EDGES,
+          EvaluationPointCount = 1 + H2D_MAX_NUMBER_EDGES + H2D_MAX_NUMBER_VERTICES
+        };
+
+        /// Reference coordinates of the evaluation points.
+        static const double evaluation_points[H2D_NUM_MODES][EvaluationPointCount][2];
+
+        /// Active elements of one component and the data calculated on them.
+        struct LimitedComponent
+        {
+          std::vector<Element*> elements;
+          /// Values at the evaluation points, EvaluationPointCount x mixed_derivatives_count per element.
+          std::vector<double> element_values;
+          /// Evaluation points (element index * EvaluationPointCount + point) bounding the values in the vertices,
+          /// stored by vertex ids (CSR-like, vertex_contribution_starts has max_node_id + 1 entries).
+          std::vector<int> vertex_contribution_starts;
+          std::vector<int> vertex_contributions;
+          /// Bounds in the vertices, mixed_derivatives_count per vertex id.
+          std::vector<double> vertex_min_values;
+          std::vector<double> vertex_max_values;
+        };
+        std::vector<LimitedComponent> limited_components;
+
+        /// Values of the monomials (ordered as in Solution::get_ref_value()) at the evaluation points,
+        /// per element mode and order up to maximum_polynomial_order.
+        std::vector<double> evaluation_matrices;
+        int evaluation_matrix_size;
+        void init_evaluation_matrices();
+
+        /// Gathers the active elements and the vertex - evaluation point incidences.
+        void prepare_elements();
+
+        /// Calculates the values of the derivatives (quadratic: 1, 2, ..., linear: 0) in the evaluation points of all elements.
+        void calculate_element_values(bool quadratic);
+
+        /// Values of the derivatives [derivative_from, derivative_to) of the solution at the evaluation point.
+        /// The solution has to have the element e active.
+        void get_point_values(Solution<double>* sln, Element* e, int point, int derivative_from, int derivative_to, double* values) const;
 
-        double get_edge_midpoint_value_multiplied(Element* e, int component, int mixed_derivative_index, int edge);
-
-        void impose_linear_correction_factor(Element* e, int component);
+        void prepare_min_max_vertex_values(bool quadratic);
 
-        /// Return if there was a need to limit the second derivatives.
-        bool impose_quadratic_correction_factor(Element* e, int component);
+        /// Correction factor of the derivatives [derivative_from, derivative_to] of the element.
+        double get_correction_factor(int component, int element_i, int derivative_from, int derivative_to) const;
 
-        double*** vertex_min_values;
-        double*** vertex_max_values;
-        void allocate_vertex_values();
-        void deallocate_vertex_values();
+        /// Limits the (quadratic / linear) coefficients of the elements.
+        /// \param[in, out] quadratic_correction_done Per element of each component, filled in the quadratic part, used in the linear part.
+        void impose_correction_factors(bool quadratic, std::vector<std::vector<char> >& quadratic_correction_done);
 
         int mixed_derivatives_count;
         std::vector<std::pair<int, double> > correction_factors;
@@ -31,6 +31,13 @@ namespace Hermes
     ///
     class Quad2DCheb;
 
+    class AsyncOutputWriter;
+
+    namespace PostProcessing
+    {
+      class VertexBasedLimiter;
+    }
+
     enum SolutionType {
       HERMES_UNDEF = -1,
       HERMES_SLN = 0,
@@ -93,7 +100,7 @@ namespace Hermes
       void set_dirichlet_lift(SpaceSharedPtr<Scalar> space);
 
       /// Saves the complete solution (i.e., including the internal copy of the mesh and
-      /// element orders) to an XML file.
+      /// element orders) to an XML file, the file is written directly (streamed).
       virtual void save(const char* filename) const;
 #ifdef WITH_BSON
       virtual void save_bson(const char* filename) const;
@@ -101,6 +108,7 @@ namespace Hermes
 
       /// Loads the solution from a file previously created by Solution::save(). This completely
       /// restores the solution in the memory.
+      /// The file is streamed (XMLStreamReader) unless the validation is switched on.
       void load(const char* filename, SpaceSharedPtr<Scalar> space);
 #ifdef WITH_BSON
       void load_bson(const char* filename, SpaceSharedPtr<Scalar> space);
@@ -132,6 +140,19 @@ namespace Hermes
       /// slow. Prefer Solution::get_ref_value if possible.
       virtual Func<Scalar>* get_pt_value(double x, double y, bool use_MeshHashGrid = false, Element* e = nullptr);
 
+      /// Returns solution values (and optionally derivatives) at a batch of physical points, in arrays provided by the caller.
+      /// The points are processed in parallel, in their order along the Hilbert curve through the mesh. Elements are located
+      /// in the hash grid of the mesh (built once per mesh seq), the element of the previous point is tried first.
+      /// A run of points in one element shares the reference mapping, values are evaluated by the Horner's scheme
+      /// from the monomial coefficients. No memory is allocated per point.
+      /// \param[in] count Number of the points.
+      /// \param[in] x, y Physical coordinates of the points.
+      /// \param[out] values count values per component (values[component * count + point]), vector solutions are transformed as in get_pt_value().
+      /// \param[out] dx, dy Optional, derivatives in the same layout (scalar solutions only).
+      /// \param[out] found Optional, 1 for the points in the mesh, 0 for the others (their values are zero).
+      /// \return Number of the points in the mesh.
+      int get_pt_values(int count, const double* x, const double* y, Scalar* values, Scalar* dx = nullptr, Scalar* dy = nullptr, char* found = nullptr);
+
       /// Adds another mesh function on the given space.
       /// See method of parent class.
       virtual void add(MeshFunctionSharedPtr<Scalar>& other_mesh_function, SpaceSharedPtr<Scalar> target_space);
@@ -199,10 +220,17 @@ namespace Hermes
       /// Internal, checks the compliance of the passed space type and owned space type.
       void check_space_type_compliance(const char* space_type_to_check) const;
 
+      /// Internal method loading the solution by the streaming reader, without validation.
+      void load_streamed(const char* filename, SpaceSharedPtr<Scalar> space);
+
       /// Special internal method for loading exact solutions.
       void load_exact_solution(int number_of_components, SpaceSharedPtr<Scalar> space, bool complexness,
         double x_real, double y_real, double x_complex, double y_complex);
 
+      /// Evaluates the points (indices into x, y) lying in the element e, see get_pt_values().
+      void get_pt_values_in_element(Element* e, RefMap* refmap, const int* points, int points_count, int count, const double* x, const double* y,
+        Scalar* values, Scalar* dx, Scalar* dy) const;
+
       /// Utility.
       Scalar x[H2D_MAX_INTEGRATION_POINTS_COUNT], y[H2D_MAX_INTEGRATION_POINTS_COUNT], tx[H2D_MAX_INTEGRATION_POINTS_COUNT];
 
@@ -222,6 +250,9 @@ namespace Hermes
       template<typename T> friend class RefinementSelectors::H1ProjBasedSelector;
       template<typename T> friend class RefinementSelectors::L2ProjBasedSelector;
       template<typename T> friend class RefinementSelectors::HcurlProjBasedSelector;
+      friend class AsyncOutputWriter;
+      friend class PostProcessing::VertexBasedLimiter;
+      template<typename T> friend class Checkpoint;
 #pragma endregion
 
 #pragma region static
@@ -39,6 +39,7 @@
 #include "mesh/mesh_reader_h2d_bson.h"
 #include "mesh/mesh_reader_h1d_xml.h"
 #include "mesh/mesh_reader_exodusii.h"
+#include "mesh/mesh_reader_gmsh.h"
 
 #include "quadrature/quad.h"
 #include "quadrature/quad_all.h"
@@ -65,7 +66,9 @@
 #include "function/mesh_function.h"
 #include "function/filter.h"
 #include "function/postprocessing.h"
+#include "function/async_output_writer.h"
 
+#include "checkpoint.h"
 #include "graph.h"
 
 #include "views/view.h"
@@ -89,6 +92,8 @@
 #include "adapt/adapt_solver.h"
 #include "adapt/error_calculator.h"
 #include "adapt/error_thread_calculator.h"
+#include "adapt/dwr_error_calculator.h"
+#include "adapt/kelly_type_error_calculator.h"
 #include "adapt/kelly_type_adapt.h"
 #include "neighbor_search.h"
 #include "projections/ogprojection.h"
@@ -36,6 +36,11 @@ namespace Hermes
     /// HashTable is a base class for Mesh. It serves as a container for all nodes
     /// of a mesh. Moreover, it has node searching functions based on hash tables.
     ///
+    /// Vertex and edge nodes are found by the ids of their parents in open-addressing tables (Robin Hood hashing
+    /// with linear probing), which store the parent ids along with the node id, so that a search does not touch
+    /// the nodes themselves. The tables grow automatically. Searches (peek_vertex_node(), peek_edge_node()) do not modify
+    /// the tables and can run in parallel, insertions and removals have to be serialized.
+    ///
     class HERMES_API HashTable : public Hermes::Mixins::Loggable
     {
     public:
@@ -45,7 +50,7 @@ namespace Hermes
       /// Returns the maximum node id number plus one.
       int get_max_node_id() const;
 
-      /// 32K entries
+      /// 32K entries - initial size of the tables.
       static const int H2D_DEFAULT_HASH_SIZE = 0x8000;
 
       /// Returns a vertex node with parent id's p1 and p2 if it exists, nullptr otherwise.
@@ -77,7 +82,7 @@ namespace Hermes
       Array<Node> nodes;
 
       /// Initializes the hash table.
-      /// \param size[in] Hash table size; must be a power of two.
+      /// \param size[in] Initial hash table size; must be a power of two.
       void init(int size = H2D_DEFAULT_HASH_SIZE);
 
       /// Copies another hash table contents
@@ -86,6 +91,9 @@ namespace Hermes
       /// Reconstructs the hashtable, after, e.g., the nodes have been loaded from a file.
       void rebuild();
 
+      /// Current size of the vertex node table.
+      int get_hash_size() const;
+
       /// Frees all memory used by the instance.
       void free();
 
@@ -95,24 +103,55 @@ namespace Hermes
       /// Removes an edge node with parent id's p1 and p2.
       void remove_edge_node(int id);
 
+      /// Inserts a node initialized outside of get_vertex_node() / get_edge_node() (with p1 < p2) into the table of its type.
+      void insert_node(const Node* node);
+
+      /// Open-addressing table of node ids keyed by the (sorted) parent ids.
+      class HERMES_API NodeTable
+      {
+      public:
+        NodeTable();
+        ~NodeTable();
+
+        /// \param[in] size Initial size, a power of two.
+        void init(int size);
+        void copy(const NodeTable& other);
+        void free();
+        /// Removes all nodes, keeps the size (initializes the table with the default size if it is not initialized).
+        void clear();
+        int get_size() const { return mask + 1; }
+
+        /// Returns the node id, -1 if there is no such node.
+        int find(int p1, int p2) const;
+        /// Inserts a node, grows the table if necessary.
+        void insert(int p1, int p2, int id);
+        /// Removes the node with the id.
+        void remove(int p1, int p2, int id);
+
+      private:
+        struct Slot
+        {
+          int p1, p2;
+          /// -1 for an empty slot.
+          int id;
+        };
+
+        inline int hash(int p1, int p2) const { return (int)((984120265u * (unsigned int)p1 + 125965121u * (unsigned int)p2) & (unsigned int)mask); }
+        /// Distance of the slot from the position its key hashes to.
+        inline int probe_distance(int position) const { return (position - hash(slots[position].p1, slots[position].p2)) & mask; }
+        void grow();
+
+        Slot* slots;
+        int mask;
+        int count;
+      };
+
       // Internal members
     private:
-
       /// Vertex node hash table
-      Node** v_table;
+      NodeTable v_table;
       /// Edge node hash table
-      Node** e_table;
-
-      int mask;
-
-      inline int hash(int p1, int p2) const { return (984120265 * p1 + 125965121 * p2) & mask; }
-
-      /// Searches a list of hash synonyms given the first list item.
-      /// Returns the node matching the parent ids p1 and p2.
-      Node* search_list(Node* node, int p1, int p2) const;
-
-      /// Creates a copy of a hash synonym list.
-      void copy_list(Node** ptr, Node* node);
+      NodeTable e_table;
 
       friend struct Node;
       friend class MeshUtil;
@@ -123,6 +162,7 @@ namespace Hermes
       template<typename Scalar> friend class L2Space;
       template<typename Scalar> friend class HcurlSpace;
       template<typename Scalar> friend class HdivSpace;
+      template<typename Scalar> friend class Checkpoint;
     };
   }
 }
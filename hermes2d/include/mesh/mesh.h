@@ -17,10 +17,17 @@
 #define __H2D_MESH_H
 
 #include "element.h"
+#include <atomic>
 #include "mesh_util.h"
 #include "hash.h"
 #include "../mixins2d.h"
 
+/// Minimal number of active elements for refine_all_elements() to refine the mesh in parallel.
+#define H2D_PARALLEL_REFINEMENT_MIN_ELEMENTS 4096
+
+/// Minimal number of elements for create_bulk() to set up the mesh in parallel.
+#define H2D_PARALLEL_BULK_CREATION_MIN_ELEMENTS 8192
+
 namespace Hermes
 {
   namespace Hermes2D
@@ -89,6 +96,17 @@ namespace Hermes
       void create(int nv, double2* verts, int nt, int3* tris, std::string* tri_markers,
         int nq, int4* quads, std::string* quad_markers, int nm, int2* mark, std::string* boundary_markers);
 
+      /// Creates a mesh from given vertex and element arrays at once (used by the readers of large meshes).
+      /// The unique edges are found by sorting the edges of the elements by their vertices instead of searching
+      /// the node tables for every edge of every element, the nodes and elements are set up in parallel.
+      /// The mesh has to be empty (free()) with the markers already inserted in element_markers_conversion and boundary_markers_conversion.
+      /// \param[in] elems Vertices of the elements (counter-clockwise), elems[k][3] == -1 for triangles.
+      /// \param[in] elem_markers Internal element markers.
+      /// \param[in] mark Vertices of the marked edges, the boundary edges are determined by the topology.
+      /// \param[in] boundary_markers Internal markers of the marked edges.
+      void create_bulk(int nv, const double2* verts, int ne, const int4* elems, const int* elem_markers,
+        int nm, const int2* mark, const int* boundary_markers);
+
 #pragma region MeshHashGrid
       /// Returns the element pointer located at physical coordinates x, y.
       /// \param[in] x Physical x-coordinate.
@@ -97,9 +115,23 @@ namespace Hermes
       /// \param[in] y_reference Optional parameter, in which the y-coordinate of y in the reference domain will be returned.
       Element* element_on_physical_coordinates(double x, double y);
 
+      /// Returns the hash grid of the mesh, created on the first call and re-created when the mesh has changed (its seq number).
+      /// Searches in the grid do not change it and can run in parallel.
+      MeshHashGrid* get_hash_grid();
+
       MeshHashGrid* meshHashGrid;
 #pragma endregion
 
+#pragma region MeshSnapshot
+      /// Returns the read-optimized snapshot of the mesh (flat coordinate and connectivity arrays, active elements, leaf order).
+      /// The snapshot is created on the first call and re-created when the mesh has changed (its seq number).
+      /// The returned snapshot is valid until the mesh is changed.
+      /// The check of an up-to-date snapshot is lock-free, only its (re-)creation is serialized.
+      const MeshSnapshot* get_snapshot();
+
+      std::atomic<MeshSnapshot*> meshSnapshot;
+#pragma endregion
+
 #pragma region MarkerArea
       double get_marker_area(int marker);
 
@@ -289,6 +321,7 @@ namespace Hermes
         friend class Space < double > ;
         friend class Space < std::complex<double> > ;
         friend class Mesh;
+        template<typename Scalar> friend class Checkpoint;
       };
 
       /// Frees all data associated with the mesh.
@@ -388,6 +421,7 @@ namespace Hermes
       friend class MeshReaderH2DXML;
       friend class MeshReaderH1DXML;
       friend class MeshReaderExodusII;
+      friend class MeshReaderGmsh;
       friend class DiscreteProblem < double > ;
       friend class DiscreteProblem < std::complex<double> > ;
       template<typename Scalar> friend class DiscreteProblemDGAssembler;
@@ -442,6 +476,12 @@ namespace Hermes
       void refine_quad(Element* e, int refinement, Element** sons_out = nullptr);
       void refine_triangle_to_triangles(Element* e, Element** sons = nullptr);
 
+      /// Uniform refinement (refinement 0) of all active elements, in parallel.
+      /// The ids of the new_ nodes and elements are precomputed from the numbers of the edges and elements,
+      /// the edges and the elements are then processed independently.
+      /// \return false if the mesh is left to the serial refinement (curved elements, too few elements, one thread).
+      bool refine_all_elements_parallel();
+
       /// Computing vector length.
       static double vector_length(double a_1, double a_2);
 
@@ -0,0 +1,60 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#ifndef _MESH_READER_GMSH_H_
+#define _MESH_READER_GMSH_H_
+
+#include "mesh_reader.h"
+
+/// Minimal number of nodes / elements in a block for the block to be converted in parallel.
+#define H2D_MESH_READER_GMSH_MIN_PARALLEL_SIZE 4096
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Mesh reader from the Gmsh format (binary MSH 4.1)
+    ///
+    /// Typical usage:
+    /// MeshSharedPtr mesh;
+    /// Hermes::Hermes2D::MeshReaderGmsh mloader;
+    /// try
+    /// {
+    ///&nbsp;mloader.load("mesh.msh", mesh);
+    /// }
+    /// catch(Exceptions::MeshLoadFailureException& e)
+    /// {
+    ///&nbsp;e.print_msg();
+    ///&nbsp;return -1;
+    /// }
+    ///
+    /// The triangles and quadrilaterals of the file make the mesh, the higher-order ones are taken as straight (by their
+    /// corner nodes). The element markers are the physical groups of the surfaces, the line elements give the boundary
+    /// markers - the physical groups of the curves. A physical group is given by its name, or its number if it has no name,
+    /// an entity without a physical group by its tag. Only the nodes of the elements are kept, the z-coordinates are ignored.
+    ///
+    /// The node and element blocks are read at once and converted in parallel, the mesh is created by Mesh::create_bulk().
+    /// Partitioned meshes and the ASCII variant of the format are not supported (Gmsh: Mesh.Binary = 1, Mesh.MshFileVersion = 4.1).
+    class HERMES_API MeshReaderGmsh : public MeshReader
+    {
+    public:
+      MeshReaderGmsh();
+      virtual ~MeshReaderGmsh();
+
+      virtual void load(const char *filename, MeshSharedPtr mesh);
+    };
+  }
+}
+#endif
@@ -51,6 +51,10 @@ namespace Hermes
     /// }
     ///
     /// The format specification is in hermes2d/xml_schemas/mesh_h2d_xml.xsd
+    ///
+    /// Single meshes are read (without validation) and written by the streaming XMLStreamReader / XMLStreamWriter,
+    /// the nodes and elements are created while the file is read. With validation switched on (set_validation()),
+    /// and for the subdomains, the whole file is parsed into the XSD structures first.
     class HERMES_API MeshReaderH2DXML : public MeshReader, public Hermes::Hermes2D::Mixins::XMLParsing
     {
     public:
@@ -58,12 +62,13 @@ namespace Hermes
       virtual ~MeshReaderH2DXML();
 
       /// This method loads a single mesh from a file.
+      /// The file is streamed unless the validation is switched on.
       virtual void load(const char *filename, MeshSharedPtr mesh);
 
       /// This method loads a single mesh from a XML structure.
       virtual void load(std::auto_ptr<XMLMesh::mesh> & parsed_xml_mesh, MeshSharedPtr mesh);
 
-      /// This method saves a single mesh to a file.
+      /// This method saves a single mesh to a file (streamed).
       void save(const char *filename, MeshSharedPtr mesh);
 
       /// This method loads multiple meshes according to subdomains described in the meshfile.
@@ -80,6 +85,9 @@ namespace Hermes
       void save(const char *filename, std::vector<MeshSharedPtr> meshes);
 
     protected:
+      /// Internal method loading a single mesh from the file by the streaming reader, without validation.
+      void load_streamed(const char *filename, MeshSharedPtr mesh);
+
       /// Internal method loading contents of parsed_xml_mesh into mesh.
       void load(std::auto_ptr<XMLMesh::mesh> & parsed_xml_mesh, MeshSharedPtr mesh, std::map<unsigned int, unsigned int>& vertex_is);
 
@@ -92,6 +100,11 @@ namespace Hermes
       template<typename T>
       Nurbs* load_nurbs(MeshSharedPtr mesh, std::auto_ptr<T> & parsed_xml_entity, int id, Node** en, int p1, int p2, bool skip_check = false);
 
+      /// Creates one general NURBS curve from the loaded data.
+      /// \param[in] inner_points The inner control points, (x, y, weight) for each one.
+      /// \param[in] knots The inner knots.
+      Nurbs* create_nurbs(MeshSharedPtr mesh, int id, Node** en, int p1, int p2, int degree, const std::vector<double>& inner_points, const std::vector<double>& knots, bool skip_check);
+
       /// Saves one circular arc.
       void save_arc(MeshSharedPtr mesh, int p1, int p2, Arc* curve, XMLMesh::curves_type & curves);
 
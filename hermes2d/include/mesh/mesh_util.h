@@ -83,6 +83,9 @@ namespace Hermes
       /// Loads one circular arc.
       /// \param[in] skip_check Skip check that the edge exists, in case of subdomains.
       static Arc* load_arc(MeshSharedPtr mesh, int id, Node** en, int p1, int p2, double angle, bool skip_check = false);
+
+      /// Index of the point (x, y) of the grid of size 2^order x 2^order along the Hilbert curve.
+      static uint64_t hilbert_index(unsigned int order, unsigned int x, unsigned int y);
     };
 
     class MeshHashGrid
@@ -123,6 +126,50 @@ namespace Hermes
       int mesh_seq;
     };
 
+    /// Read-optimized copy of the mesh topology and geometry in flat arrays.
+    /// Built by Mesh::get_snapshot(), rebuilt when the mesh seq changes.
+    class HERMES_API MeshSnapshot
+    {
+    public:
+      MeshSnapshot(Mesh* mesh);
+
+      int get_mesh_seq() const;
+
+      /// True if the point lies in the bounding box of the vertices of the element.
+      bool in_bounding_box(int id, double x, double y) const;
+
+      /// Vertex coordinates, indexed by the node id (undefined for other than vertex nodes).
+      std::vector<double> x, y;
+
+      /// Number of vertices of the element (0 for unused element ids), indexed by the element id.
+      std::vector<unsigned char> nvert;
+      /// Curved element flags, indexed by the element id.
+      std::vector<char> curved;
+      /// Vertex node ids, H2D_MAX_NUMBER_VERTICES per element (-1 for the 4th vertex of a triangle).
+      std::vector<int> element_vertices;
+      /// Edge node ids of active elements, H2D_MAX_NUMBER_EDGES per element (-1 for inactive elements).
+      std::vector<int> element_edges;
+      /// Boundary flags of active elements, indexed by the element id - bit i for the edge i, bit H2D_MAX_NUMBER_EDGES + i for the vertex i.
+      std::vector<unsigned char> boundary;
+
+      /// Ids of the active elements, ascending.
+      std::vector<int> active_elements;
+      /// Ids of the active elements in the leaf order - base elements one by one, the sons of each element depth-first.
+      std::vector<int> leaf_order;
+      /// Position of the element in leaf_order (-1 for inactive elements), indexed by the element id.
+      std::vector<int> leaf_index;
+      /// The leaves of the base element i are leaf_order[base_leaf_starts[i]] .. leaf_order[base_leaf_starts[i + 1] - 1].
+      std::vector<int> base_leaf_starts;
+      /// Ids of the base elements ordered along the Hilbert curve through their centroids.
+      std::vector<int> base_element_order;
+
+    private:
+      void add_leaves(Element* e);
+      void calculate_base_element_order(int base_count);
+
+      int mesh_seq;
+    };
+
     /*  node and son numbering on a triangle:
 
     -Triangle to triangles refinement
@@ -55,6 +55,10 @@ namespace Hermes
       /// Must be called prior to using all other functions in the class.
       virtual void set_active_element(Element* e);
 
+      /// Same as set_active_element(Element*), the vertex coordinates of a straight-edged element are read from the snapshot of its mesh.
+      /// Used in the assembly, where the mesh does not change.
+      void set_active_element(Element* e, const MeshSnapshot* snapshot);
+
       /// Returns the triples[x, y, norm] of the tangent to the specified (possibly
       /// curved) edge at the 1D integration points along the edge. The maximum
       /// 1D quadrature rule is used by default, but the user may specify his own
@@ -19,6 +19,9 @@
 #include "hermes_common.h"
 #include "mesh.h"
 
+/// Number of chunks of base elements per thread in the parallel traversal.
+#define H2D_TRAVERSE_CHUNKS_PER_THREAD 8
+
 namespace Hermes
 {
   namespace Hermes2D
@@ -99,6 +102,10 @@ namespace Hermes
       };
 
       /// Returns all states on the passed meshes.
+      /// The base elements are visited in the order of their ids, or along a space-filling curve (see Hermes2DApiParam::spaceFillingCurveOrdering).
+      /// The states (with their element and transformation arrays) are allocated in a single block,
+      /// the field arrays e and sub_idx of consecutive states are consecutive.
+      /// The block has to be released by free_states(), the individual states must not be deleted.
       /// \param[in] meshes Meshes.
       /// \param[out] num Number of states.
       /// \return The states.
@@ -110,7 +117,74 @@ namespace Hermes
       template<typename Scalar>
       State** get_states(std::vector<MeshFunctionSharedPtr<Scalar> > mesh_functions, unsigned int& states_count);
 
+      /// Releases the states returned by get_states() or copy_states().
+      static void free_states(State**& states);
+
+      /// Copies the states (e.g. a selection of the states returned by get_states()) into a new block, to be released by free_states().
+      static State** copy_states(State** states, unsigned int states_count);
+
+      /// \brief States of the last traversal, reused while the meshes do not change.
+      /// The states are returned again as long as the same meshes (the same instances) have the same seq numbers
+      /// and the number of spaces is the same. The meshes are held by the cache, so that the elements referenced by the states stay valid.
+      /// The states are owned by the cache, they must not be deleted by the caller, and they are valid
+      /// until the next call with different meshes, or until free().
+      class HERMES_API StatesCache
+      {
+      public:
+        StatesCache();
+        ~StatesCache();
+
+        /// Returns all states on the passed meshes, traverses the meshes only if they changed since the last call.
+        State** get_states(std::vector<MeshSharedPtr>& meshes, unsigned char spaces_size, unsigned int& states_count);
+
+        /// Releases the states and the meshes.
+        void free();
+
+      private:
+        bool is_up_to_date(std::vector<MeshSharedPtr>& meshes, unsigned char spaces_size) const;
+
+        std::vector<MeshSharedPtr> meshes;
+        std::vector<unsigned int> seqs;
+        unsigned char spaces_size;
+        State** states;
+        unsigned int states_count;
+      };
+
+      /// Releases the union mesh kept by construct_union_mesh().
+      static void free_union_mesh_cache();
+
+      /// Releases the union mesh kept by construct_union_mesh() if it was constructed from a mesh with this seq number.
+      /// Called by Mesh::free().
+      static void free_union_mesh_cache(unsigned int mesh_seq);
+
     private:
+      /// Leaf states of (a part of) a traversal, stored field-wise until they are moved to the block.
+      class StateBuffer
+      {
+      public:
+        void reserve(unsigned int states_count, unsigned short num);
+        void append(const State* s);
+        unsigned int size() const { return (unsigned int)leaves.size(); }
+
+        struct Leaf
+        {
+          bool bnd[H2D_MAX_NUMBER_EDGES];
+          bool isBnd;
+          unsigned short rep_i;
+        };
+        std::vector<Element*> e;
+        std::vector<uint64_t> sub_idx;
+        std::vector<Leaf> leaves;
+      };
+
+      /// Allocates the block for the states: the array of pointers, the states, their element and transformation arrays.
+      static State** allocate_states(unsigned int states_count, unsigned short num);
+      /// Moves the buffered states into a block, in the order of the buffers.
+      static State** allocate_states(StateBuffer* buffers, int buffers_count, unsigned short num, unsigned int& states_count);
+
+      /// Used by get_states - traverses the base elements base_ids[first] .. base_ids[last - 1], appends the leaf states.
+      /// \param[in] base_ids Order of the base elements, nullptr for the order of their ids.
+      void traverse_base_elements(MeshSharedPtr* meshes, const int* base_ids, int first, int last, StateBuffer& states);
       /// Used by get_states.
       void begin(int n);
       /// Used by get_states.
@@ -119,6 +193,8 @@ namespace Hermes
       void init_transforms(State* s, unsigned char i);
 
 #pragma region union-mesh
+      /// Constructs the union mesh of the meshes into unimesh, returns the (per mesh) element and sub-element transformation for each union mesh element.
+      /// The last union mesh is kept (without holding the meshes), if meshes with the same seq numbers are passed again, it is copied instead of constructed.
       static UniData** construct_union_mesh(unsigned char n, MeshSharedPtr* meshes, MeshSharedPtr unimesh);
       void union_recurrent(Rect* cr, Element** e, Rect* er, uint64_t* idx, Element* uni);
       uint64_t init_idx(Rect* cr, Rect* er);
@@ -136,8 +212,10 @@ namespace Hermes
 
       /// Internal.
       State* push_state(int* top_by_ref = nullptr);
-      /// Internal.
+      /// Internal - the boundary flags of the elements are read from snapshots.
       void set_boundary_info(State* s);
+      /// Snapshots of the traversed meshes, set by traverse_base_elements().
+      std::vector<const MeshSnapshot*> snapshots;
       /// Internal.
       void free_state(State* state);
       /// Internal.
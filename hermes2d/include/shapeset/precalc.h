@@ -18,6 +18,7 @@
 
 #include "../function/function.h"
 #include "../shapeset/shapeset.h"
+#include <atomic>
 
 namespace Hermes
 {
@@ -89,7 +90,50 @@ namespace Hermes
       friend class CurvMap;
     };
 
+    /// Number of values in the PrecalcShapesetAssembling tables (value, x- and y-derivative).
+#define H2D_PSS_TABLE_VALUES 3
+    /// Alignment (in doubles) of the point arrays in the PrecalcShapesetAssembling tables.
+#define H2D_PSS_TABLE_ALIGNMENT 8
+    /// Number of orders of the standard quadrature (including the edge orders).
+#define H2D_PSS_TABLE_ORDERS (g_max_quad + 1 + 4 * g_max_quad + 4)
+
+    /// Number of sets of PrecalcShapesetTransformedCache (power of 2).
+#define H2D_PSS_TRANSFORMED_CACHE_SETS 512
+    /// Number of entries in one set of PrecalcShapesetTransformedCache.
+#define H2D_PSS_TRANSFORMED_CACHE_WAYS 4
+
+    /// \brief Bounded cache of the values (and derivatives) of shape functions on sub-elements.
+    /// With a sub-element transformation (multi-mesh assembling), the shape functions are evaluated in the transformed
+    /// points, which depend only on (mode, order, sub_idx) - the same transformations repeat for many elements.
+    /// The cache is set-associative, the least recently used entry of a set is replaced.
+    /// Reading is lock-free (an entry is guarded by a sequence counter, a read overlapping a write is a miss),
+    /// a write into a set that is just being written by another thread is skipped.
+    class HERMES_API PrecalcShapesetTransformedCache
+    {
+    public:
+      PrecalcShapesetTransformedCache();
+      ~PrecalcShapesetTransformedCache();
+
+      /// Copies the cached values, x- and y-derivatives in np points to values[0], values[1], values[2].
+      /// \return false if not cached.
+      bool get(int mode, unsigned short order, unsigned short index, uint64_t sub_idx, unsigned char np, double values[][H2D_MAX_INTEGRATION_POINTS_COUNT]);
+
+      /// Stores the values, x- and y-derivatives in np points from values[0], values[1], values[2].
+      void put(int mode, unsigned short order, unsigned short index, uint64_t sub_idx, unsigned char np, double values[][H2D_MAX_INTEGRATION_POINTS_COUNT]);
+
+    private:
+      struct Entry;
+      struct Set;
+      /// The set of the key.
+      Set& get_set(unsigned int key, uint64_t sub_idx) const;
+      Set* sets;
+    };
+
     /// \brief PrecalcShapesetAssembling common storage.
+    /// All the values (and derivatives) of all the shape functions in all the points of the standard quadrature of all orders,
+    /// built at once in one contiguous buffer, laid out [mode][order][value][index][point]. The point arrays are aligned.
+    /// If the directory Hermes2DApi::precalculatedShapesetTablesDirPath is set, the buffer is mapped from a file in it
+    /// (shared by all the processes on the node), the file is written by the first process that computes the tables.
     class HERMES_API PrecalcShapesetAssemblingStorage
     {
     public:
@@ -99,9 +143,42 @@ namespace Hermes
       unsigned short max_index[2];
       unsigned short ref_count;
 
+      /// Builds (or maps) the tables, if this has not been done yet.
+      /// Only for scalar shapesets, the tables of the vector ones are not built.
+      void build(Shapeset* shapeset);
+
+      inline bool is_built() const { return tables.load(std::memory_order_acquire) != nullptr; }
+
+      /// Values on sub-elements.
+      PrecalcShapesetTransformedCache transformed_cache;
+
+      /// The value (0), x- (1) or y-derivative (2) of the shape function in the points of the standard quadrature of the order.
+      inline const double* get_values(int mode, unsigned short order, int value, int index) const
+      {
+        return tables.load(std::memory_order_acquire) + offsets[mode][order] + (value * (max_index[mode] + 1) + index) * np_aligned[mode][order];
+      }
+
     private:
-      double*** PrecalculatedValues[H2D_NUM_MODES][H2D_NUM_FUNCTION_VALUES];
-      bool** PrecalculatedInfo[H2D_NUM_MODES];
+      /// Offsets & sizes of the tables, returns the size of the whole buffer (in doubles).
+      size_t calculate_layout();
+      /// The computed tables.
+      double* compute_tables(Shapeset* shapeset, size_t size);
+      /// The tables of the file, nullptr if there is no valid file (for other shapeset, quadrature or layout).
+      double* map_file(const char* filename, Shapeset* shapeset, size_t size);
+      /// Some values of the tables recomputed and compared (a file written by a different version of the shapeset).
+      bool check_values(Shapeset* shapeset, const double* checked_tables) const;
+      void save_file(const char* filename, const double* saved_tables, size_t size) const;
+
+      /// The tables, published (release) after they are complete - the lock-free check in build() and is_built() acquires them.
+      std::atomic<double*> tables;
+      /// Start of the tables of [mode][order] in tables.
+      size_t offsets[H2D_NUM_MODES][H2D_PSS_TABLE_ORDERS];
+      /// Number of points of [mode][order], rounded up to H2D_PSS_TABLE_ALIGNMENT.
+      unsigned short np_aligned[H2D_NUM_MODES][H2D_PSS_TABLE_ORDERS];
+      /// Memory holding the tables - allocated, or the mapping of the file.
+      char* memory;
+      size_t memory_size;
+      bool memory_mapped;
       friend class PrecalcShapesetAssembling;
     };
 
@@ -111,7 +188,8 @@ namespace Hermes
     public:
       /// \brief Constructs a standard (master) precalculated shapeset class.
       /// \param shapeset[in] Pointer to the shapeset to be precalculated.
-      PrecalcShapesetAssembling(Shapeset* shapeset);
+      /// \param build_tables[in] Build the tables of the shapeset shared by all the instances (if not built yet).
+      PrecalcShapesetAssembling(Shapeset* shapeset, bool build_tables = true);
 
       /// Copy constructor
       PrecalcShapesetAssembling(const PrecalcShapesetAssembling& other);
@@ -160,6 +238,8 @@ namespace Hermes
 
       bool attempt_to_reuse(unsigned short order) const;
       bool reuse_possible() const;
+      /// The values on the current sub-element can be taken from (and stored to) PrecalcShapesetAssemblingStorage::transformed_cache.
+      bool transformed_cache_possible(unsigned short mask) const;
     };
 
     /// Intentionally not exported - for internal purposes.
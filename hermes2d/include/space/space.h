@@ -23,6 +23,9 @@
 #include "../quadrature/quad_all.h"
 #include "algebra/dense_matrix_operations.h"
 
+/// Minimal number of active elements for assign_dofs() to number the DOFs in parallel.
+#define H2D_PARALLEL_DOF_ASSIGNMENT_MIN_ELEMENTS 4096
+
 using namespace Hermes::Algebra::DenseMatrixOperations;
 
 namespace Hermes
@@ -71,6 +74,7 @@ namespace Hermes
       class OrderView;
     };
     class Shapeset;
+    class XMLStreamReader;
 
     template<typename Scalar> class L2Space;
     template<typename Scalar> class H1Space;
@@ -276,6 +280,7 @@ namespace Hermes
 #endif
 
       /// Loads a space from a file in XML format.
+      /// The file is streamed (XMLStreamReader) unless validate is true.
       static SpaceSharedPtr<Scalar> load(const char *filename, MeshSharedPtr mesh, bool validate = false, EssentialBCs<Scalar>* essential_bcs = nullptr, Shapeset* shapeset = nullptr);
       /// This method is here for rapid re-loading.
       void load(const char *filename);
@@ -457,6 +462,34 @@ namespace Hermes
       virtual void assign_edge_dofs() = 0;
       virtual void assign_bubble_dofs() = 0;
 
+      /// Kinds of the DOFs numbered by assign_element_dofs().
+      enum DofKind
+      {
+        VertexDofs,
+        EdgeDofs,
+        BubbleDofs
+      };
+
+      /// Numbers the DOFs of the kind from next_dof, element by element (assign_element_dofs()), returns their number.
+      /// A node is numbered by the first active element (in the order of ids) with a nonzero order having it.
+      /// Large meshes are numbered in parallel - the active elements are split into chunks, the DOFs of each chunk are counted,
+      /// the first DOF of each chunk is the exclusive prefix sum of the counts, then the chunks are numbered. The numbering
+      /// is the same as the serial one and does not depend on the number of threads.
+      int assign_dofs_by_elements(DofKind kind);
+
+      /// Counts (assign == false) or numbers from first_dof (assign == true) the DOFs of the kind of the element.
+      /// Returns the number of the DOFs. This version handles the bubble DOFs.
+      /// \param[in] position Position of the element among the active elements, for numbers_node().
+      /// \param[in] first_elements For numbers_node().
+      virtual int assign_element_dofs(Element* e, int position, DofKind kind, const std::vector<int>& first_elements, int first_dof, bool assign);
+
+      /// Whether the element at the position numbers the node - it is the first one having it (first_elements[node_id] in the
+      /// parallel numbering), or the node has no DOF yet (serial numbering, first_elements empty).
+      inline bool numbers_node(int node_id, int position, const std::vector<int>& first_elements) const
+      {
+        return first_elements.empty() ? ndata[node_id].dof == H2D_UNASSIGNED_DOF : first_elements[node_id] == position;
+      }
+
       virtual void get_vertex_assembly_list(Element* e, int iv, AsmList<Scalar>* al) const = 0;
       virtual void get_boundary_assembly_list_internal(Element* e, int surf_num, AsmList<Scalar>* al) const = 0;
       virtual void get_bubble_assembly_list(Element* e, AsmList<Scalar>* al) const;
@@ -485,6 +518,16 @@ namespace Hermes
       /// Used in loading.
       static SpaceSharedPtr<Scalar> init_empty_space(SpaceType spaceType, MeshSharedPtr mesh, Shapeset* shapeset);
 
+      /// Internal.
+      /// Creates the space of the type spaceType on the mesh and resizes its tables.
+      /// Used in loading.
+      static SpaceSharedPtr<Scalar> create_for_loading(const char* spaceType, const char *filename, MeshSharedPtr mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset);
+
+      /// Internal.
+      /// Reads the element data following the current (root) element of the reader.
+      /// Used in loading.
+      void load_element_data(XMLStreamReader& reader, const char *filename);
+
       struct EdgeInfo
       {
         Node* node;
@@ -501,6 +544,7 @@ namespace Hermes
       template<typename T> friend class Solution;
       template<typename T> friend class RungeKutta;
       template<typename T> friend class ExactSolution;
+      template<typename T> friend class Checkpoint;
       template<typename T> friend class NeighborSearch;
       template<typename T> friend class ExactSolutionScalar;
       template<typename T> friend class ExactSolutionVector;
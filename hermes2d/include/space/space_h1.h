@@ -61,6 +61,8 @@ namespace Hermes
       virtual void assign_vertex_dofs();
       virtual void assign_edge_dofs();
       virtual void assign_bubble_dofs();
+      /// The vertex and the edge DOFs, the bubble ones are handled by Space.
+      virtual int assign_element_dofs(Element* e, int position, typename Space<Scalar>::DofKind kind, const std::vector<int>& first_elements, int first_dof, bool assign);
 
       virtual void get_vertex_assembly_list(Element* e, int iv, AsmList<Scalar>* al) const;
       virtual void get_boundary_assembly_list_internal(Element* e, int ie, AsmList<Scalar>* al) const;
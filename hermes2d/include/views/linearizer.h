@@ -67,6 +67,28 @@ namespace Hermes
         /// Save multiple MeshFunctions (Solutions, Filters) in Tecplot format.
         void save_solution_tecplot(std::vector<MeshFunctionSharedPtr<double> > slns, std::vector<int> items, const char* filename, std::vector<std::string> quantity_names);
 
+        /// Save multiple MeshFunctions (Solutions, Filters) in the binary VTK XML format (.vtu).
+        /// The data are streamed from the per-thread buffers in chunks as raw appended data.
+        /// \param[in] compress Compress the data (zlib), Hermes has to be built WITH_ZLIB.
+        void save_solution_vtu(std::vector<MeshFunctionSharedPtr<double> > slns, std::vector<int> items, const char* filename, const char* quantity_name, bool mode_3D = true, bool compress = false);
+        /// Save a MeshFunction (Solution, Filter) in the binary VTK XML format (.vtu).
+        void save_solution_vtu(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, bool mode_3D = true, int item = H2D_FN_VAL_0, bool compress = false);
+
+        /// Add a time step of multiple MeshFunctions (Solutions, Filters) to an XDMF time series.
+        /// The heavy data of each time step go to a separate raw binary file next to the XDMF file, the XDMF file itself
+        /// (describing all time steps saved so far) is rewritten on each call.
+        /// Passing a different filename than in the previous call starts a new time series.
+        void save_solution_xdmf(std::vector<MeshFunctionSharedPtr<double> > slns, std::vector<int> items, const char* filename, const char* quantity_name, double time);
+        /// Add a time step of a MeshFunction (Solution, Filter) to an XDMF time series.
+        void save_solution_xdmf(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, double time, int item = H2D_FN_VAL_0);
+        /// Start a new XDMF time series with the next call to save_solution_xdmf().
+        void reset_xdmf_time_series();
+
+        /// Save multiple MeshFunctions (Solutions, Filters) in the binary Tecplot format (.plt).
+        void save_solution_tecplot_binary(std::vector<MeshFunctionSharedPtr<double> > slns, std::vector<int> items, const char* filename, std::vector<std::string> quantity_names);
+        /// Save a MeshFunction (Solution, Filter) in the binary Tecplot format (.plt).
+        void save_solution_tecplot_binary(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, int item = H2D_FN_VAL_0);
+
         /// Sets the criterion to use for the linearization process.
         /// This criterion is used in ThreadLinearizerMultidimensional class instances (see threadLinearizerMultidimensional array).
         /// \param[in] criterion The instance of the criterion - see the class LinearizerCriterion for details (method split_decision() for the adaptive criterion, process_[triangle|quad] for the fixed one).
@@ -194,6 +216,25 @@ namespace Hermes
 
         void find_min_max();
 
+        /// Binary output - writes (converted to float) components [first_component, first_component + component_count)
+        /// of all vertices, padded by zeros to output_component_count components per vertex.
+        /// Streamed in chunks directly from the per-thread buffers.
+        void stream_vertex_components(LinearizerOutputStream& stream, int first_component, int component_count, int output_component_count) const;
+        /// Binary output - writes the (global, zero-based) triangle vertex indices.
+        void stream_triangle_indices(LinearizerOutputStream& stream) const;
+
+        /// One time step of the XDMF time series.
+        struct XdmfTimeStep
+        {
+          double time;
+          std::string data_filename;
+          int vertex_count;
+          int triangle_count;
+        };
+        /// XDMF time series.
+        std::string xdmf_filename;
+        std::vector<XdmfTimeStep> xdmf_time_steps;
+
         friend class ThreadLinearizerMultidimensional < LinearizerDataDimensions > ;
       };
 
@@ -49,6 +49,11 @@ namespace Hermes
       /// Very important constant putting an upper bound on the maximum number of successive element division (when dealing with a higher-order FEM solution).
 #define MAX_LINEARIZER_DIVISION_LEVEL 6
 
+      /// Size (in bytes) of chunks in which the binary file output is converted and written (and of the blocks compressed in the VTU output).
+#ifndef LINEARIZER_OUTPUT_CHUNK_SIZE
+#define LINEARIZER_OUTPUT_CHUNK_SIZE 32768
+#endif
+
       /// Typedefs used throughout the Linearizer functionality.
       template<typename Scalar>
       struct ScalarLinearizerDataDimensions
@@ -113,6 +118,58 @@ namespace Hermes
       template<typename LinearizerDataDimensions>
       class HERMES_API ThreadLinearizerMultidimensional;
 
+      /// \brief Internal - sequential output to a (binary) file, used by the file export of LinearizerMultidimensional.
+      /// Takes care of the arrays in the "appended data" section of the VTK XML formats, which are (if desired) compressed
+      /// block-wise by zlib on the fly.
+      class HERMES_API LinearizerOutputStream
+      {
+      public:
+        /// Constructor - opens the file.
+        /// \param[in] compress Compress the VTK arrays, Hermes has to be built with ZLIB.
+        LinearizerOutputStream(const char* filename, bool compress = false);
+        /// Destructor - closes the file.
+        ~LinearizerOutputStream();
+
+        /// Formatted (text) output.
+        void print(const char* format, ...);
+        /// Binary output - goes through the compression if inside of a compressed VTK array.
+        void write(const void* data, size_t bytes);
+        /// Binary output of a string as a zero-terminated sequence of 32-bit integers (Tecplot binary format).
+        void write_tecplot_string(const char* str);
+
+        /// Starts a VTK appended-data array of the given length (in bytes) - writes its header.
+        void begin_vtk_array(unsigned long long bytes);
+        /// Finishes the current VTK appended-data array.
+        void end_vtk_array();
+
+        /// Number of bytes written so far (the current position in the file).
+        unsigned long long get_bytes_written() const;
+        /// Writes a zero-padded placeholder for an integer, returns its position for patch_integer().
+        unsigned long long write_integer_placeholder();
+        /// Overwrites the placeholder written by write_integer_placeholder().
+        void patch_integer(unsigned long long position, unsigned long long value);
+
+        /// Little / big endian of the platform, as the VTK XML format specifies it.
+        static const char* byte_order();
+
+      private:
+        void write_direct(const void* data, size_t bytes);
+        void seek(unsigned long long position);
+        void flush_block();
+
+        FILE* file;
+        bool compress;
+        unsigned long long bytes_written;
+
+        /// Compressed VTK array being written.
+        bool in_compressed_array;
+        unsigned long long compressed_header_position;
+        std::vector<unsigned long long> compressed_header;
+        unsigned long long compressed_block_count;
+        std::vector<unsigned char> block;
+        std::vector<unsigned char> compressed_block;
+      };
+
       /// \brief Abstract class for criterion according to which the linearizer stops dividing elements at some point
       /// Class is not abstract per say, but works as a base class for the following classes.
       class HERMES_API LinearizerCriterion
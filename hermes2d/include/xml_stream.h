@@ -0,0 +1,127 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+/*! \file xml_stream.h
+\brief Streaming reader and writer of the Hermes2D XML formats (mesh, space, solution).
+*/
+
+#ifndef __H2D_XML_STREAM_H
+#define __H2D_XML_STREAM_H
+
+#include "global.h"
+
+/// Size of the read / write buffer.
+#define H2D_XML_STREAM_BUFFER_SIZE (1 << 20)
+/// Number of values collected before they are converted (in parallel).
+#define H2D_XML_STREAM_BATCH_SIZE 65536
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// \brief Streaming (pull) reader of the XML files written by Hermes2D.
+    ///
+    /// The file is read through a fixed-size buffer and the start tags are reported one by one together with
+    /// their attributes, so the memory does not depend on the size of the file. The namespace prefixes of the names
+    /// are dropped, the text, comments, processing instructions and end tags are skipped - this is enough for the
+    /// attribute-only formats of meshes, spaces and solutions. Nothing is validated against the schemas,
+    /// the classes use the XSD (DOM) parsing if validation is switched on (Mixins::XMLParsing).
+    class HERMES_API XMLStreamReader
+    {
+    public:
+      /// Opens the file, throws IOException if it can not be opened.
+      XMLStreamReader(const char* filename);
+      ~XMLStreamReader();
+
+      /// Moves to the next start tag, returns false at the end of the file.
+      bool next_element();
+
+      /// Name of the current element (without the namespace prefix).
+      const std::string& name() const;
+      /// The current element is called name.
+      bool is(const char* name) const;
+
+      /// Value of the attribute (entities replaced), nullptr if the current element does not have it.
+      const char* attribute(const char* name) const;
+      /// Value of the attribute, throws an exception if the current element does not have it.
+      const char* required_attribute(const char* name) const;
+      int int_attribute(const char* name) const;
+      double double_attribute(const char* name) const;
+      bool bool_attribute(const char* name) const;
+
+      /// Converts count strings to doubles (in parallel for long batches).
+      static void parse_doubles(int count, const std::string* strings, double* values);
+
+    protected:
+      /// Makes at least count bytes from the current position available, returns false at the end of the file.
+      bool ensure(size_t count);
+      /// Position (from the current position) of terminator, the buffer is refilled as needed.
+      size_t find(const char* terminator);
+      /// Parses the start tag beginning at the current position.
+      void parse_start_tag();
+
+      FILE* file;
+      std::string filename;
+      char* buffer;
+      size_t buffer_size;
+      /// Current position and the end of valid data in the buffer.
+      size_t position, end;
+      bool end_of_file;
+
+      std::string element_name;
+      /// Attributes of the current element, only the first attribute_count are valid (the strings are reused).
+      std::vector<std::pair<std::string, std::string> > attributes;
+      unsigned int attribute_count;
+    };
+
+    /// \brief Streaming writer of the Hermes2D XML formats, the elements are written directly to a buffered file.
+    class HERMES_API XMLStreamWriter
+    {
+    public:
+      /// Opens the file and writes the XML declaration, throws IOException if it can not be opened.
+      XMLStreamWriter(const char* filename);
+      /// Closes the open elements and the file.
+      ~XMLStreamWriter();
+
+      /// Starts a new child element of the current one, the attributes follow.
+      void start_element(const char* name);
+      void attribute(const char* name, const char* value);
+      void attribute(const char* name, const std::string& value);
+      void attribute(const char* name, int value);
+      void attribute(const char* name, unsigned int value);
+      /// Written in the decimal notation with 17 significant digits, the value is read back exactly.
+      void attribute(const char* name, double value);
+      void attribute(const char* name, bool value);
+      /// Ends the current element.
+      void end_element();
+
+      /// Ends all the elements and closes the file, throws IOException if writing failed.
+      void close();
+
+    protected:
+      void write(const char* text);
+      void write_escaped(const char* text);
+
+      FILE* file;
+      std::string filename;
+      /// The start tag of the current element is not finished (its attributes may follow).
+      bool start_tag_open;
+      /// Names of the open elements, the current one is the last.
+      std::vector<std::string> open_elements;
+      /// Formatting of the numbers.
+      std::string number_buffer;
+    };
+  }
+}
+#endif
@@ -230,6 +230,7 @@ namespace Hermes
       // Processed error so far.
       double processed_error_squared = 0.0;
       // Maximum error - the first one in the error calculator's array.
+      this->errorCalculator->sort_element_references(1);
       double max_error_squared = *(this->errorCalculator->get_element_reference(0).error);
 
       unsigned int attempted_element_refinements_count = 0;
@@ -238,6 +239,9 @@ namespace Hermes
       // The stopping condition for this loop is the stopping condition for adaptivity.
       for (int element_inspected_i = 0; element_inspected_i < this->errorCalculator->num_act_elems; element_inspected_i++)
       {
+        // Only the prefix consumed by the strategy is sorted.
+        this->errorCalculator->sort_element_references(element_inspected_i + 1);
+
         // Get the element info from the error calculator.
         typename ErrorCalculator<Scalar>::ElementReference element_reference = this->errorCalculator->get_element_reference(element_inspected_i);
 
@@ -459,6 +463,7 @@ namespace Hermes
             }
           }
         }
+        Traverse::free_states(states);
 
         this->meshes.pop_back();
 
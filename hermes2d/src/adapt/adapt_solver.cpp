@@ -362,6 +362,8 @@ namespace Hermes
         }
       }
 
+      Traverse::free_states(states_local);
+
       cpu_time.tick();
       Hermes::Mixins::Loggable::Static::info("\t      No. of DOFs to reassemble: %i / %i total - %2.0f%%.", ref_system_size - reusable_DOFs_count, ref_system_size, ((float)(ref_system_size - reusable_DOFs_count) / (float)ref_system_size) * 100.);
       Hermes::Mixins::Loggable::Static::info("\t      Search for elements to reassemble: %4.3f s", cpu_time.last());
@@ -380,7 +382,7 @@ namespace Hermes
         {
           if (newSpace_elements_to_reassemble[space_i].find(states[state_i]->e[space_i]->id) != newSpace_elements_to_reassemble[space_i].end())
           {
-            new_states[new_num_states++] = Traverse::State::clone(states[state_i]);
+            new_states[new_num_states++] = states[state_i];
 #ifdef DEBUG_VIEWS
             reassembled_0[states[state_i]->e[0]->id] = true;
             reassembled_1[states[state_i]->e[1]->id] = true;
@@ -402,11 +404,10 @@ namespace Hermes
       ::free(reassembled_1);
 #endif
 
-      for (unsigned int i = 0; i < num_states; i++)
-        delete states[i];
-      free_with_check(states);
-      new_states = realloc_with_check<Traverse::State*>(new_states, new_num_states);
-      states = new_states;
+      Traverse::State** selected_states = Traverse::copy_states(new_states, new_num_states);
+      free_with_check(new_states, true);
+      Traverse::free_states(states);
+      states = selected_states;
 
       cpu_time.tick();
       Hermes::Mixins::Loggable::Static::info("\t      No. of states to reassemble: %i / %i total - %2.0f%%.", new_num_states, num_states, ((float)new_num_states / (float)num_states) * 100.);
@@ -0,0 +1,266 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "adapt/dwr_error_calculator.h"
+#include "projections/ogprojection.h"
+#include "discrete_problem/discrete_problem.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    template<typename Scalar>
+    DualWeightedResidualErrorCalculator<Scalar>::DualWeightedResidualErrorCalculator(WeakFormSharedPtr<Scalar> goal_wf) :
+      ErrorCalculator<Scalar>(AbsoluteError),
+      goal_wf(goal_wf),
+      adjoint_vector(nullptr),
+      goal_error_estimate(0.)
+    {
+    }
+
+    template<typename Scalar>
+    DualWeightedResidualErrorCalculator<Scalar>::~DualWeightedResidualErrorCalculator()
+    {
+      free_with_check(this->adjoint_vector);
+    }
+
+    template<typename Scalar>
+    bool DualWeightedResidualErrorCalculator<Scalar>::isOkay() const
+    {
+      if (!this->goal_wf)
+        throw Exceptions::Exception("No goal functional passed to DualWeightedResidualErrorCalculator.");
+
+      Helpers::check_length(this->fine_solutions, this->component_count);
+
+      return true;
+    }
+
+    template<typename Scalar>
+    void DualWeightedResidualErrorCalculator<Scalar>::calculate_errors(MeshFunctionSharedPtr<Scalar> coarse_solution, MeshFunctionSharedPtr<Scalar> fine_solution, LinearSolver<Scalar>* reference_solver, bool sort_and_store)
+    {
+      std::vector<MeshFunctionSharedPtr<Scalar> > coarse_solutions;
+      coarse_solutions.push_back(coarse_solution);
+      std::vector<MeshFunctionSharedPtr<Scalar> > fine_solutions;
+      fine_solutions.push_back(fine_solution);
+      this->calculate_errors(coarse_solutions, fine_solutions, reference_solver, sort_and_store);
+    }
+
+    template<typename Scalar>
+    void DualWeightedResidualErrorCalculator<Scalar>::calculate_errors(std::vector<MeshFunctionSharedPtr<Scalar> > coarse_solutions_, std::vector<MeshFunctionSharedPtr<Scalar> > fine_solutions_, LinearSolver<Scalar>* reference_solver, bool sort_and_store)
+    {
+      this->coarse_solutions = coarse_solutions_;
+      this->fine_solutions = fine_solutions_;
+      this->component_count = this->coarse_solutions.size();
+
+      this->check();
+      this->tick();
+
+      this->reference_spaces = reference_solver->get_spaces();
+      Helpers::check_length(this->reference_spaces, this->component_count);
+      int ndof = Space<Scalar>::get_num_dofs(this->reference_spaces);
+
+      SparseMatrix<Scalar>* matrix = reference_solver->get_jacobian();
+      Vector<Scalar>* rhs = reference_solver->get_residual();
+      if (matrix->get_size() != (unsigned int)ndof || rhs->get_size() != (unsigned int)ndof)
+        throw Exceptions::Exception("The matrix of the reference solver does not correspond to the reference spaces in DualWeightedResidualErrorCalculator.");
+
+      this->init_data_storage();
+
+      // Residual of the coarse solution on the reference space: r = b - A c.
+      Scalar* coarse_coeffs = malloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(ndof, this);
+      OGProjection<Scalar>::project_global(this->reference_spaces, this->coarse_solutions, coarse_coeffs);
+      Scalar* residual = malloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(ndof, this);
+      matrix->multiply_with_vector(coarse_coeffs, residual, true);
+      for (int i = 0; i < ndof; i++)
+        residual[i] = rhs->get(i) - residual[i];
+      free_with_check(coarse_coeffs);
+
+      // Goal functional on the reference space.
+      Vector<Scalar>* goal_rhs = create_vector<Scalar>();
+      DiscreteProblem<Scalar> goal_dp(this->goal_wf, this->reference_spaces, true);
+      goal_dp.set_verbose_output(false);
+      goal_dp.assemble(goal_rhs);
+      Scalar* goal_vector = malloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(ndof, this);
+      goal_rhs->extract(goal_vector);
+      delete goal_rhs;
+
+      this->solve_adjoint(reference_solver, goal_vector, ndof);
+      free_with_check(goal_vector);
+
+      this->tick();
+      this->info("\tDualWeightedResidualErrorCalculator: adjoint problem solved in %s.", this->last_str().c_str());
+
+      // Partition of unity: a reference DOF contributes evenly to all reference elements it is supported on.
+      int* dof_multiplicity = calloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, int>(ndof, this);
+      AsmList<Scalar> al;
+      for (int i = 0; i < this->component_count; i++)
+      {
+        Element* e;
+        for_all_active_elements(e, this->reference_spaces[i]->get_mesh())
+        {
+          this->reference_spaces[i]->get_element_assembly_list(e, &al);
+          for (unsigned short j = 0; j < al.cnt; j++)
+            if (al.dof[j] >= 0)
+              dof_multiplicity[al.dof[j]]++;
+        }
+      }
+
+      this->goal_error_estimate = 0.;
+      for (int i = 0; i < this->component_count; i++)
+      {
+        // The reference mesh is a refinement of the coarse one, so every state has a unique reference element.
+        MeshSharedPtr meshes[2] = { this->coarse_solutions[i]->get_mesh(), this->reference_spaces[i]->get_mesh() };
+        unsigned int num_states;
+        Traverse trav(1);
+        Traverse::State** states = trav.get_states(meshes, 2, num_states);
+
+        Scalar* state_indicators = malloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(num_states, this);
+
+#pragma omp parallel num_threads(this->num_threads_used)
+        {
+          AsmList<Scalar> thread_al;
+#pragma omp for
+          for (int state_i = 0; state_i < (int)num_states; state_i++)
+          {
+            this->reference_spaces[i]->get_element_assembly_list(states[state_i]->e[1], &thread_al);
+            Scalar indicator = 0.;
+            for (unsigned short j = 0; j < thread_al.cnt; j++)
+            {
+              int dof = thread_al.dof[j];
+              if (dof >= 0)
+                indicator += this->adjoint_vector[dof] * residual[dof] / (double)dof_multiplicity[dof];
+            }
+            state_indicators[state_i] = indicator;
+          }
+        }
+
+        // Sum up per coarse element - serially, for the result not to depend on the number of threads.
+        Scalar* element_indicators = calloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(this->coarse_solutions[i]->get_mesh()->get_max_element_id(), this);
+        for (unsigned int state_i = 0; state_i < num_states; state_i++)
+          element_indicators[states[state_i]->e[0]->id] += state_indicators[state_i];
+
+        Element* e;
+        for_all_active_elements(e, this->coarse_solutions[i]->get_mesh())
+        {
+          this->errors[i][e->id] = std::abs(element_indicators[e->id]);
+          this->goal_error_estimate += element_indicators[e->id];
+        }
+
+        free_with_check(element_indicators);
+        free_with_check(state_indicators);
+        Traverse::free_states(states);
+      }
+
+      free_with_check(dof_multiplicity);
+      free_with_check(residual);
+
+      // Adjoint solutions for postprocessing.
+      this->adjoint_solutions.clear();
+      for (int i = 0; i < this->component_count; i++)
+        this->adjoint_solutions.push_back(MeshFunctionSharedPtr<Scalar>(new Solution<Scalar>()));
+      Solution<Scalar>::vector_to_solutions(this->adjoint_vector, this->reference_spaces, this->adjoint_solutions, std::vector<bool>(this->component_count, false));
+
+      // Sums calculation.
+      this->postprocess_error();
+
+      this->store_element_references(sort_and_store);
+
+      this->tick();
+      this->info("\tDualWeightedResidualErrorCalculator: indicators calculated in %s.", this->last_str().c_str());
+    }
+
+    template<typename Scalar>
+    void DualWeightedResidualErrorCalculator<Scalar>::solve_adjoint(LinearSolver<Scalar>* reference_solver, Scalar* goal_vector, int ndof)
+    {
+      Hermes::Solvers::LinearMatrixSolver<Scalar>* linear_matrix_solver = reference_solver->get_linear_matrix_solver();
+      this->adjoint_vector = realloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(this->adjoint_vector, ndof, this);
+
+      if (linear_matrix_solver->supports_transposed_solve())
+      {
+        // Reuse the factorization, keep the primal rhs and solution of the reference solver intact.
+        Vector<Scalar>* rhs = linear_matrix_solver->get_rhs();
+        Scalar* rhs_backup = malloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(ndof, this);
+        rhs->extract(rhs_backup);
+        Scalar* sln_backup = nullptr;
+        if (linear_matrix_solver->get_sln_vector())
+        {
+          sln_backup = malloc_with_check<DualWeightedResidualErrorCalculator<Scalar>, Scalar>(ndof, this);
+          memcpy(sln_backup, linear_matrix_solver->get_sln_vector(), ndof * sizeof(Scalar));
+        }
+        Hermes::Solvers::MatrixStructureReuseScheme reuse_scheme = linear_matrix_solver->get_used_reuse_scheme();
+
+        rhs->set_vector(goal_vector);
+        linear_matrix_solver->set_reuse_scheme(Hermes::Solvers::HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY);
+        linear_matrix_solver->solve_transposed();
+        memcpy(this->adjoint_vector, linear_matrix_solver->get_sln_vector(), ndof * sizeof(Scalar));
+
+        rhs->set_vector(rhs_backup);
+        linear_matrix_solver->set_reuse_scheme(reuse_scheme);
+        if (sln_backup)
+        {
+          memcpy(linear_matrix_solver->get_sln_vector(), sln_backup, ndof * sizeof(Scalar));
+          reference_solver->sln_vector = linear_matrix_solver->get_sln_vector();
+        }
+
+        free_with_check(rhs_backup);
+        free_with_check(sln_backup);
+      }
+      else
+      {
+        // Transpose the matrix and solve anew.
+        CSMatrix<Scalar>* matrix = dynamic_cast<CSMatrix<Scalar>*>(linear_matrix_solver->get_matrix());
+        if (!matrix)
+          throw Exceptions::Exception("The matrix type of the reference solver can not be transposed in DualWeightedResidualErrorCalculator.");
+
+        this->info("\tDualWeightedResidualErrorCalculator: transposed solve not available, factorizing the transposed matrix.");
+
+        CSMatrix<Scalar>* transposed_matrix = static_cast<CSMatrix<Scalar>*>(matrix->duplicate());
+        transposed_matrix->switch_orientation();
+        bool use_direct_solver = (linear_matrix_solver->as_DirectSolver() != nullptr);
+        Vector<Scalar>* adjoint_rhs = create_vector<Scalar>(use_direct_solver);
+        adjoint_rhs->alloc(ndof);
+        adjoint_rhs->set_vector(goal_vector);
+
+        Hermes::Solvers::LinearMatrixSolver<Scalar>* adjoint_solver = Hermes::Solvers::create_linear_solver<Scalar>(transposed_matrix, adjoint_rhs, use_direct_solver);
+        adjoint_solver->set_verbose_output(false);
+        adjoint_solver->solve();
+        memcpy(this->adjoint_vector, adjoint_solver->get_sln_vector(), ndof * sizeof(Scalar));
+
+        delete adjoint_solver;
+        delete transposed_matrix;
+        delete adjoint_rhs;
+      }
+    }
+
+    template<typename Scalar>
+    Scalar DualWeightedResidualErrorCalculator<Scalar>::get_goal_error_estimate() const
+    {
+      if (!this->data_prepared_for_querying())
+        return 0.0;
+      return this->goal_error_estimate;
+    }
+
+    template<typename Scalar>
+    MeshFunctionSharedPtr<Scalar> DualWeightedResidualErrorCalculator<Scalar>::get_adjoint_solution(int component)
+    {
+      if (component >= (int)this->adjoint_solutions.size())
+        throw Exceptions::ValueException("component", component, this->adjoint_solutions.size());
+      return this->adjoint_solutions[component];
+    }
+
+    template HERMES_API class DualWeightedResidualErrorCalculator < double > ;
+    template HERMES_API class DualWeightedResidualErrorCalculator < std::complex<double> > ;
+  }
+}
@@ -26,6 +26,7 @@ namespace Hermes
     ErrorCalculator<Scalar>::ErrorCalculator(CalculatedErrorType errorType) :
       errorType(errorType),
       elements_stored(false),
+      sorted_element_references_count(0),
       element_references(nullptr),
       errors_squared_sum(0.0),
       norms_squared_sum(0.0)
@@ -202,9 +203,7 @@ namespace Hermes
         }
       }
 
-      for (int i = 0; i < num_states; i++)
-        delete states[i];
-      free_with_check(states);
+      Traverse::free_states(states);
 
       // Clean after ourselves.
       for (int i = 0; i < this->component_count; i++)
@@ -222,15 +221,95 @@ namespace Hermes
       // Sums calculation & error postprocessing.
       this->postprocess_error();
 
+      this->store_element_references(sort_and_store);
+    }
+
+    template<typename Scalar>
+    void ErrorCalculator<Scalar>::store_element_references(bool sort_and_store)
+    {
+      this->sorted_element_references_count = 0;
       if (sort_and_store)
       {
-        std::qsort(this->element_references, this->num_act_elems, sizeof(ElementReference), &this->compareElementReference);
+        // Only a (small) prefix is sorted now, the rest on demand.
+        this->sort_element_references(std::max(H2D_ERROR_CALCULATOR_SORTED_PREFIX_MIN, this->num_act_elems / H2D_ERROR_CALCULATOR_SORTED_PREFIX_DIVISOR));
         elements_stored = true;
       }
       else
         elements_stored = false;
     }
 
+    template<typename Scalar>
+    void ErrorCalculator<Scalar>::sort_element_references(int count)
+    {
+      if (count <= this->sorted_element_references_count)
+        return;
+
+      // Grow geometrically, so that consuming the references one by one leads only to a logarithmic number of selections.
+      count = std::min(this->num_act_elems, std::max(count, 2 * this->sorted_element_references_count));
+
+      ElementReference* first = this->element_references + this->sorted_element_references_count;
+      int remaining = this->num_act_elems - this->sorted_element_references_count;
+      int to_select = count - this->sorted_element_references_count;
+
+      // Fall back to the full sort if (almost) everything is needed.
+      if (to_select * H2D_ERROR_CALCULATOR_FULL_SORT_RATIO >= remaining)
+      {
+        std::sort(first, first + remaining, compare_element_references);
+        this->sorted_element_references_count = this->num_act_elems;
+        return;
+      }
+
+      int num_threads = (remaining < H2D_ERROR_CALCULATOR_PARALLEL_SELECTION_MIN) ? 1 : this->num_threads_used;
+      if (num_threads == 1)
+      {
+        std::nth_element(first, first + to_select, first + remaining, compare_element_references);
+        std::sort(first, first + to_select, compare_element_references);
+      }
+      else
+      {
+        // Every thread moves the to_select largest entries of its chunk to the chunk front,
+        // the global largest entries are then selected among these candidates only.
+        std::vector<int> chunk_starts(num_threads + 1);
+        std::vector<int> chunk_selected(num_threads);
+        int candidates_count = 0;
+        for (int thread_i = 0; thread_i < num_threads; thread_i++)
+        {
+          chunk_starts[thread_i] = (remaining / num_threads) * thread_i;
+          chunk_starts[thread_i + 1] = (thread_i == num_threads - 1) ? remaining : (remaining / num_threads) * (thread_i + 1);
+          chunk_selected[thread_i] = std::min(to_select, chunk_starts[thread_i + 1] - chunk_starts[thread_i]);
+          candidates_count += chunk_selected[thread_i];
+        }
+
+        ElementReference* reordered = malloc_with_check<ErrorCalculator<Scalar>, ElementReference>(remaining, this);
+
+#pragma omp parallel num_threads(num_threads)
+        {
+          int thread_number = omp_get_thread_num();
+          ElementReference* chunk = first + chunk_starts[thread_number];
+          int chunk_size = chunk_starts[thread_number + 1] - chunk_starts[thread_number];
+          std::nth_element(chunk, chunk + chunk_selected[thread_number], chunk + chunk_size, compare_element_references);
+
+          // Candidates go to the front of the reordered array, the rest behind them.
+          int candidates_offset = 0, rest_offset = candidates_count;
+          for (int thread_i = 0; thread_i < thread_number; thread_i++)
+          {
+            candidates_offset += chunk_selected[thread_i];
+            rest_offset += (chunk_starts[thread_i + 1] - chunk_starts[thread_i]) - chunk_selected[thread_i];
+          }
+          memcpy(reordered + candidates_offset, chunk, chunk_selected[thread_number] * sizeof(ElementReference));
+          memcpy(reordered + rest_offset, chunk + chunk_selected[thread_number], (chunk_size - chunk_selected[thread_number]) * sizeof(ElementReference));
+        }
+
+        std::nth_element(reordered, reordered + to_select, reordered + candidates_count, compare_element_references);
+        std::sort(reordered, reordered + to_select, compare_element_references);
+
+        memcpy(first, reordered, remaining * sizeof(ElementReference));
+        free_with_check(reordered);
+      }
+
+      this->sorted_element_references_count = count;
+    }
+
     template<typename Scalar>
     void ErrorCalculator<Scalar>::postprocess_error()
     {
@@ -27,7 +27,7 @@ namespace Hermes
   {
     template<typename Scalar>
     ErrorThreadCalculator<Scalar>::ErrorThreadCalculator(ErrorCalculator<Scalar>* errorCalculator) :
-      errorCalculator(errorCalculator)
+      errorCalculator(errorCalculator), local_errors(nullptr), local_norms(nullptr)
     {
       slns = malloc_with_check<ErrorThreadCalculator<Scalar>, Solution<Scalar>*>(this->errorCalculator->component_count, this);
       rslns = malloc_with_check<ErrorThreadCalculator<Scalar>, Solution<Scalar>*>(this->errorCalculator->component_count, this);
@@ -58,6 +58,29 @@ namespace Hermes
       free_with_check(rslns);
     }
 
+    template<typename Scalar>
+    void ErrorThreadCalculator<Scalar>::set_local_storage(double* errors, double* norms)
+    {
+      this->local_errors = errors;
+      this->local_norms = norms;
+    }
+
+    template<typename Scalar>
+    double* ErrorThreadCalculator<Scalar>::get_error_storage(int component)
+    {
+      if (this->local_errors)
+        return &this->local_errors[component];
+      return &this->errorCalculator->errors[component][current_state->e[component]->id];
+    }
+
+    template<typename Scalar>
+    double* ErrorThreadCalculator<Scalar>::get_norm_storage(int component)
+    {
+      if (this->local_norms)
+        return &this->local_norms[component];
+      return &this->errorCalculator->norms[component][current_state->e[component]->id];
+    }
+
     template<typename Scalar>
     void ErrorThreadCalculator<Scalar>::evaluate_one_state(Traverse::State* current_state_)
     {
@@ -276,8 +299,8 @@ namespace Hermes
       {
         NormFormDG<Scalar>* mfs = this->errorThreadCalculator->errorCalculator->mfDG[current_mfDG_i];
 
-        double* error = &this->errorThreadCalculator->errorCalculator->errors[mfs->i][current_state->e[mfs->i]->id];
-        double* norm = &this->errorThreadCalculator->errorCalculator->norms[mfs->i][current_state->e[mfs->i]->id];
+        double* error = this->errorThreadCalculator->get_error_storage(mfs->i);
+        double* norm = this->errorThreadCalculator->get_norm_storage(mfs->i);
 
         DiscontinuousFunc<Scalar>* error_func[2];
         DiscontinuousFunc<Scalar>* norm_func[2];
@@ -382,8 +405,8 @@ namespace Hermes
       for (unsigned short i = 0; i < this->errorCalculator->mfvol.size(); i++)
       {
         NormFormVol<Scalar>* form = this->errorCalculator->mfvol[i];
-        double* error = &this->errorCalculator->errors[form->i][current_state->e[form->i]->id];
-        double* norm = &this->errorCalculator->norms[form->i][current_state->e[form->i]->id];
+        double* error = this->get_error_storage(form->i);
+        double* norm = this->get_norm_storage(form->i);
 
         Func<Scalar>* error_func[2];
         Func<Scalar>* norm_func[2];
@@ -437,8 +460,8 @@ namespace Hermes
         if (!assemble)
           continue;
 
-        double* error = &this->errorCalculator->errors[form->i][current_state->e[form->i]->id];
-        double* norm = &this->errorCalculator->norms[form->i][current_state->e[form->i]->id];
+        double* error = this->get_error_storage(form->i);
+        double* norm = this->get_norm_storage(form->i);
 
         Func<Scalar>* error_func[2];
         Func<Scalar>* norm_func[2];
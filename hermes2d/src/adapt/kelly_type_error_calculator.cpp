@@ -0,0 +1,362 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "adapt/kelly_type_error_calculator.h"
+#include "adapt/error_thread_calculator.h"
+#include "discrete_problem/discrete_problem_helpers.h"
+#include "neighbor_search.h"
+#include "quadrature/limit_order.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    template<typename Scalar>
+    KellyTypeErrorCalculator<Scalar>::KellyTypeErrorCalculator(CalculatedErrorType errorType, bool scale_interfaces_by_diameter) :
+      ErrorCalculator<Scalar>(errorType),
+      scale_interfaces_by_diameter(scale_interfaces_by_diameter)
+    {
+    }
+
+    template<typename Scalar>
+    KellyTypeErrorCalculator<Scalar>::~KellyTypeErrorCalculator()
+    {
+    }
+
+    template<typename Scalar>
+    void KellyTypeErrorCalculator<Scalar>::add_interface_form(NormFormDG<Scalar>* form)
+    {
+      if (form->i != form->j)
+        throw Exceptions::Exception("KellyTypeErrorCalculator supports only interface forms with i == j.");
+      this->interface_forms.push_back(form);
+    }
+
+    template<typename Scalar>
+    bool KellyTypeErrorCalculator<Scalar>::isOkay() const
+    {
+      Helpers::check_length(this->fine_solutions, this->component_count);
+
+      if (this->mfvol.empty() && this->mfsurf.empty() && this->mfDG.empty() && this->interface_forms.empty())
+        throw Exceptions::Exception("No error forms passed to KellyTypeErrorCalculator via add_error_form() / add_interface_form().");
+
+      for (unsigned short i = 0; i < this->interface_forms.size(); i++)
+        if (this->interface_forms[i]->i >= this->component_count)
+          throw Exceptions::ValueException("interface form component", this->interface_forms[i]->i, this->component_count);
+
+      return true;
+    }
+
+    template<typename Scalar>
+    void KellyTypeErrorCalculator<Scalar>::calculate_errors(MeshFunctionSharedPtr<Scalar> solution, bool sort_and_store)
+    {
+      std::vector<MeshFunctionSharedPtr<Scalar> > solutions;
+      solutions.push_back(solution);
+      this->calculate_errors(solutions, sort_and_store);
+    }
+
+    template<typename Scalar>
+    void KellyTypeErrorCalculator<Scalar>::calculate_errors(std::vector<MeshFunctionSharedPtr<Scalar> > solutions, bool sort_and_store)
+    {
+      // The forms of ErrorCalculator are evaluated on the solutions (either the "coarse" or the "fine" ones).
+      this->coarse_solutions = solutions;
+      this->fine_solutions = solutions;
+      this->component_count = solutions.size();
+
+      this->check();
+
+      this->init_data_storage();
+
+      this->calculate_element_terms();
+
+      this->calculate_interface_terms();
+
+      // Sums calculation & error postprocessing.
+      this->postprocess_error();
+
+      this->store_element_references(sort_and_store);
+    }
+
+    template<typename Scalar>
+    void KellyTypeErrorCalculator<Scalar>::calculate_element_terms()
+    {
+      if (this->mfvol.empty() && this->mfsurf.empty() && this->mfDG.empty())
+        return;
+
+      std::vector<MeshSharedPtr> meshes;
+      for (int i = 0; i < this->component_count; i++)
+        meshes.push_back(this->coarse_solutions[i]->get_mesh());
+      for (int i = 0; i < this->component_count; i++)
+        meshes.push_back(this->fine_solutions[i]->get_mesh());
+
+      unsigned int num_states;
+      Traverse trav(this->component_count);
+      Traverse::State** states = trav.get_states(meshes, num_states);
+
+      // Contributions of the states, summed to the elements afterwards in the order of the states.
+      double* state_errors = calloc_with_check<KellyTypeErrorCalculator<Scalar>, double>(num_states * this->component_count, this);
+      double* state_norms = calloc_with_check<KellyTypeErrorCalculator<Scalar>, double>(num_states * this->component_count, this);
+
+#pragma omp parallel num_threads(this->num_threads_used)
+      {
+        int thread_number = omp_get_thread_num();
+        int start = (num_states / this->num_threads_used) * thread_number;
+        int end = (num_states / this->num_threads_used) * (thread_number + 1);
+        if (thread_number == this->num_threads_used - 1)
+          end = num_states;
+
+        try
+        {
+          ErrorThreadCalculator<Scalar> errorThreadCalculator(this);
+
+          for (int state_i = start; state_i < end; state_i++)
+          {
+            errorThreadCalculator.set_local_storage(state_errors + state_i * this->component_count, state_norms + state_i * this->component_count);
+            errorThreadCalculator.evaluate_one_state(states[state_i]);
+          }
+        }
+        catch (Hermes::Exceptions::Exception& e)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          this->exceptionMessageCaughtInParallelBlock = e.info();
+        }
+        catch (std::exception& e)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          this->exceptionMessageCaughtInParallelBlock = e.what();
+        }
+      }
+
+      for (unsigned int state_i = 0; state_i < num_states; state_i++)
+      {
+        for (int i = 0; i < this->component_count; i++)
+        {
+          int element_id = states[state_i]->e[i]->id;
+          this->errors[i][element_id] += state_errors[state_i * this->component_count + i];
+          this->norms[i][element_id] += state_norms[state_i * this->component_count + i];
+        }
+      }
+
+      free_with_check(state_errors);
+      free_with_check(state_norms);
+
+      Traverse::free_states(states);
+
+      // Clean after ourselves.
+      for (int i = 0; i < this->component_count; i++)
+      {
+        Element* e;
+        for_all_active_elements(e, this->coarse_solutions[i]->get_mesh())
+          e->visited = false;
+      }
+
+      if (!this->exceptionMessageCaughtInParallelBlock.empty())
+        throw Hermes::Exceptions::Exception(this->exceptionMessageCaughtInParallelBlock.c_str());
+    }
+
+    template<typename Scalar>
+    void KellyTypeErrorCalculator<Scalar>::calculate_interface_terms()
+    {
+      if (this->interface_forms.empty())
+        return;
+
+      bool component_has_forms[H2D_MAX_COMPONENTS];
+      memset(component_has_forms, 0, sizeof(bool) * H2D_MAX_COMPONENTS);
+      for (unsigned short i = 0; i < this->interface_forms.size(); i++)
+        component_has_forms[this->interface_forms[i]->i] = true;
+
+      // All the elements whose edges are processed, with their components.
+      std::vector<std::pair<int, Element*> > elements;
+      for (int i = 0; i < this->component_count; i++)
+      {
+        if (!component_has_forms[i])
+          continue;
+        Element* e;
+        for_all_active_elements(e, this->fine_solutions[i]->get_mesh())
+          elements.push_back(std::pair<int, Element*>(i, e));
+      }
+      int element_count = elements.size();
+
+      // One slot per element edge - the value of the interface and the element on the other side,
+      // nullptr if the edge is not evaluated from this side.
+      Element** slot_neighbors = calloc_with_check<KellyTypeErrorCalculator<Scalar>, Element*>(element_count * H2D_MAX_NUMBER_EDGES, this);
+      double* slot_values = malloc_with_check<KellyTypeErrorCalculator<Scalar>, double>(element_count * H2D_MAX_NUMBER_EDGES, this);
+
+#pragma omp parallel num_threads(this->num_threads_used)
+      {
+        int thread_number = omp_get_thread_num();
+        int start = (element_count / this->num_threads_used) * thread_number;
+        int end = (element_count / this->num_threads_used) * (thread_number + 1);
+        if (thread_number == this->num_threads_used - 1)
+          end = element_count;
+
+        Solution<Scalar>* solutions[H2D_MAX_COMPONENTS];
+        memset(solutions, 0, sizeof(Solution<Scalar>*) * H2D_MAX_COMPONENTS);
+
+        try
+        {
+          for (int i = 0; i < this->component_count; i++)
+            if (component_has_forms[i])
+              solutions[i] = static_cast<Solution<Scalar>*>(this->fine_solutions[i]->clone());
+
+          for (int element_i = start; element_i < end; element_i++)
+          {
+            int component = elements[element_i].first;
+            Element* e = elements[element_i].second;
+            NeighborSearch<Scalar> neighbor_search(e, solutions[component]->get_mesh());
+
+            for (int edge = 0; edge < e->get_nvert(); edge++)
+            {
+              if (e->en[edge]->bnd)
+                continue;
+
+              // The edge is left to the neighbor with the lower id...
+              Element* same_size_neighbor = e->get_neighbor(edge);
+              if (same_size_neighbor && same_size_neighbor->id < e->id)
+                continue;
+
+              // ... or to the smaller neighbors.
+              neighbor_search.set_active_edge(edge);
+              if (neighbor_search.get_num_neighbors() != 1)
+                continue;
+              neighbor_search.set_active_segment(0);
+
+              slot_values[element_i * H2D_MAX_NUMBER_EDGES + edge] = this->evaluate_interface(component, solutions[component], neighbor_search, e, edge);
+              slot_neighbors[element_i * H2D_MAX_NUMBER_EDGES + edge] = neighbor_search.get_neighb_el();
+            }
+          }
+        }
+        catch (Hermes::Exceptions::Exception& e)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          this->exceptionMessageCaughtInParallelBlock = e.info();
+        }
+        catch (std::exception& e)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          this->exceptionMessageCaughtInParallelBlock = e.what();
+        }
+
+        for (int i = 0; i < this->component_count; i++)
+          delete solutions[i];
+      }
+
+      if (this->exceptionMessageCaughtInParallelBlock.empty())
+      {
+        // Both elements sharing the edge get its value, in the order of the elements.
+        for (int element_i = 0; element_i < element_count; element_i++)
+        {
+          int component = elements[element_i].first;
+          Element* e = elements[element_i].second;
+          for (int edge = 0; edge < e->get_nvert(); edge++)
+          {
+            Element* neighbor = slot_neighbors[element_i * H2D_MAX_NUMBER_EDGES + edge];
+            if (!neighbor)
+              continue;
+
+            // Half of the value of the interface for each of the two elements.
+            double value = 0.5 * slot_values[element_i * H2D_MAX_NUMBER_EDGES + edge];
+            this->errors[component][e->id] += this->scale_interfaces_by_diameter ? value * e->diameter : value;
+            this->errors[component][neighbor->id] += this->scale_interfaces_by_diameter ? value * neighbor->diameter : value;
+          }
+        }
+      }
+
+      free_with_check(slot_neighbors);
+      free_with_check(slot_values);
+
+      if (!this->exceptionMessageCaughtInParallelBlock.empty())
+        throw Hermes::Exceptions::Exception(this->exceptionMessageCaughtInParallelBlock.c_str());
+    }
+
+    template<typename Scalar>
+    double KellyTypeErrorCalculator<Scalar>::evaluate_interface(int component, Solution<Scalar>* solution, NeighborSearch<Scalar>& neighbor_search, Element* e, int edge)
+    {
+      InterfaceIntegrationData data;
+
+      // Integration order - the forms are taken as bilinear in the jump (the order of the function on either side,
+      // raised by one for vector-valued functions), plus the order of the reference mapping.
+      int inc = (solution->get_num_components() == 2) ? 1 : 0;
+      solution->set_active_element(neighbor_search.get_neighb_el());
+      int neighbor_order = solution->get_edge_fn_order(neighbor_search.get_neighbor_edge().local_num_of_edge) + inc;
+      solution->set_active_element(e);
+      int central_order = solution->get_edge_fn_order(edge) + inc;
+
+      int order = solution->get_refmap()->get_inv_ref_order() + 2 * std::max(central_order, neighbor_order);
+      limit_order(order, e->get_mode());
+      neighbor_search.set_quad_order(order);
+      int n_quadrature_points = init_surface_geometry_points_allocated(solution->get_refmap(), order, edge, e->marker, data.geometry, data.jacobian_x_weights);
+
+      DiscontinuousFunc<Scalar>* func = neighbor_search.init_ext_fn(solution);
+
+      double value = 0.;
+      for (unsigned short i = 0; i < this->interface_forms.size(); i++)
+      {
+        NormFormDG<Scalar>* form = this->interface_forms[i];
+        if (form->i == component)
+          value += std::abs(form->value(n_quadrature_points, data.jacobian_x_weights, func, func, &data.geometry));
+      }
+
+      delete func;
+
+      // 1D quadrature has the weights summed to 2.
+      return value * 0.5;
+    }
+
+    template<typename Scalar>
+    BasicKellyErrorCalculator<Scalar>::NormalDerivativeJumpForm::NormalDerivativeJumpForm(int i, double const_by_laplacian) : NormFormDG<Scalar>(i, i), const_by_laplacian(const_by_laplacian)
+    {
+    }
+
+    template<typename Scalar>
+    Scalar BasicKellyErrorCalculator<Scalar>::NormalDerivativeJumpForm::value(int n, double *wt, DiscontinuousFunc<Scalar> *u, DiscontinuousFunc<Scalar> *v, GeomSurf<double> *e) const
+    {
+      Scalar result = Scalar(0);
+      for (int i = 0; i < n; i++)
+      {
+        Scalar jump = e->nx[i] * (u->dx[i] - u->dx_neighbor[i]) + e->ny[i] * (u->dy[i] - u->dy_neighbor[i]);
+        result += wt[i] * jump * conj(jump);
+      }
+
+      // For -K Laplace(u) = f, the jump of K du/dn scaled by 1 / (24 K).
+      return result * this->const_by_laplacian / 24.;
+    }
+
+    template<typename Scalar>
+    BasicKellyErrorCalculator<Scalar>::BasicKellyErrorCalculator(CalculatedErrorType errorType, int component_count, double const_by_laplacian, NormType normType) :
+      KellyTypeErrorCalculator<Scalar>(errorType, true)
+    {
+      for (int i = 0; i < component_count; i++)
+      {
+        // Evaluated on the solution only, these give its norm (and zero error).
+        this->add_error_form(new DefaultNormFormVol<Scalar>(i, i, normType));
+        this->add_interface_form(new NormalDerivativeJumpForm(i, const_by_laplacian));
+      }
+    }
+
+    template<typename Scalar>
+    BasicKellyErrorCalculator<Scalar>::~BasicKellyErrorCalculator()
+    {
+      for (unsigned short i = 0; i < this->mfvol.size(); i++)
+        delete this->mfvol[i];
+      for (unsigned short i = 0; i < this->interface_forms.size(); i++)
+        delete this->interface_forms[i];
+    }
+
+    template HERMES_API class KellyTypeErrorCalculator < double > ;
+    template HERMES_API class KellyTypeErrorCalculator < std::complex<double> > ;
+    template HERMES_API class BasicKellyErrorCalculator < double > ;
+    template HERMES_API class BasicKellyErrorCalculator < std::complex<double> > ;
+  }
+}
@@ -57,8 +57,12 @@ namespace Hermes
         this->text_parameters.insert(std::pair<Hermes2DApiParam, Parameter<std::string>*>(Hermes::Hermes2D::precalculatedFormsDirPath, new Parameter<std::string>(std::string(ss.str()))));
       }
 
+      this->text_parameters.insert(std::pair<Hermes2DApiParam, Parameter<std::string>*>(Hermes::Hermes2D::precalculatedShapesetTablesDirPath, new Parameter<std::string>(std::string())));
+
       XMLPlatformUtils::Terminate();
 
+      this->integral_parameters.insert(std::pair<Hermes2DApiParam, Parameter<int>*>(Hermes::Hermes2D::spaceFillingCurveOrdering, new Parameter<int>(0)));
+
 #ifdef WITH_PJLIB
       pj_init();
       pj_caching_pool_init(&Hermes2DMemoryPoolCache, NULL, 1024 * 1024 * 1024);
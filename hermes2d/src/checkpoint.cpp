@@ -0,0 +1,1141 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "checkpoint.h"
+#include "mesh/curved.h"
+#include "mesh/mesh_util.h"
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifndef _WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    extern unsigned g_space_seq;
+
+    static const char checkpoint_magic[8] = { 'H', '2', 'D', 'C', 'K', 'P', 'T', '\0' };
+    static const unsigned int checkpoint_byte_order = 0x01020304;
+
+    /// Node as stored in a checkpoint, pointers are replaced by ids (-1 for nullptr).
+    struct CheckpointNodeRecord
+    {
+      int id;
+      int ref;
+      /// type | bnd << 1 | used << 2
+      int flags;
+      int p1, p2;
+      int marker;
+      int elem[2];
+      double x, y;
+    };
+
+    /// Element as stored in a checkpoint, pointers are replaced by ids (-1 for nullptr).
+    struct CheckpointElementRecord
+    {
+      int id;
+      int parent;
+      int vn[H2D_MAX_NUMBER_VERTICES];
+      /// Edge nodes of active elements, sons of inactive ones.
+      int en_sons[H2D_MAX_NUMBER_EDGES];
+      int marker;
+      int iro_cache;
+      int nvert;
+      /// active | used << 1 | curved << 2
+      int flags;
+      double area;
+      double diameter;
+    };
+
+    /// CurvMap as stored in a checkpoint, the curves of top-level maps follow.
+    struct CheckpointCurvMapRecord
+    {
+      int element_id;
+      int toplevel;
+      int parent_id;
+      int order;
+      uint64_t sub_idx;
+      /// CurvType, -1 for a straight edge.
+      int curve_types[H2D_MAX_NUMBER_EDGES];
+    };
+
+    struct CheckpointMeshRecord
+    {
+      int max_node_id, max_element_id;
+      int nbase, ntopvert, ninitial, nactive;
+      int hash_size;
+      int curved_count;
+      int refinements_count;
+      unsigned int unused_node_count, unused_element_count;
+      int element_min_marker_unused, boundary_min_marker_unused;
+      int element_markers_count, boundary_markers_count;
+    };
+
+    struct CheckpointSpaceRecord
+    {
+      int type;
+      int element_count;
+      int first_dof;
+      int ndof;
+    };
+
+    struct CheckpointElementDataRecord
+    {
+      int order;
+      int bdof;
+      int n;
+      int changed_in_last_adaptation;
+    };
+
+    struct CheckpointSolutionRecord
+    {
+      int space_type;
+      int num_components;
+      int num_coeffs;
+      int num_elems;
+    };
+
+    /// Throws unless the id read from a record is -1 (nullptr) or below count.
+    static void check_id(int id, int count, const char* what)
+    {
+      if (id < -1 || id >= count)
+        throw Exceptions::Exception("Checkpoint: %s id %i out of range.", what, id);
+    }
+
+    template<typename Scalar>
+    Checkpoint<Scalar>::SectionData::~SectionData()
+    {
+      for (unsigned int i = 0; i < this->owned.size(); i++)
+        delete[] this->owned[i];
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::SectionData::add_reference(const void* data, size_t size)
+    {
+      if (size > 0)
+        this->pieces.push_back(std::pair<const char*, size_t>((const char*)data, size));
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::SectionData::add_copy(const void* data, size_t size)
+    {
+      if (size == 0)
+        return;
+      char* copy = new char[size];
+      memcpy(copy, data, size);
+      this->owned.push_back(copy);
+      this->pieces.push_back(std::pair<const char*, size_t>(copy, size));
+    }
+
+    template<typename Scalar>
+    size_t Checkpoint<Scalar>::SectionData::size() const
+    {
+      size_t size = 0;
+      for (unsigned int i = 0; i < this->pieces.size(); i++)
+        size += this->pieces[i].second;
+      return size;
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::SectionData::gather(char* target) const
+    {
+      for (unsigned int i = 0; i < this->pieces.size(); i++)
+      {
+        memcpy(target, this->pieces[i].first, this->pieces[i].second);
+        target += this->pieces[i].second;
+      }
+    }
+
+    template<typename Scalar>
+    Checkpoint<Scalar>::SectionReader::SectionReader(const char* data, size_t size) : data(data), size(size), position(0)
+    {
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::SectionReader::read(void* target, size_t size)
+    {
+      if (this->position + size > this->size)
+        throw Exceptions::Exception("Checkpoint: truncated section.");
+      memcpy(target, this->data + this->position, size);
+      this->position += size;
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::SectionReader::require(int count, size_t item_size) const
+    {
+      if (count < 0 || (item_size > 0 && (size_t)count > (this->size - this->position) / item_size))
+        throw Exceptions::Exception("Checkpoint: truncated section.");
+    }
+
+    template<typename Scalar>
+    Checkpoint<Scalar>::Checkpoint() : file_data(nullptr), file_size(0), file_mapped(false), verify_checksums(true)
+    {
+    }
+
+    template<typename Scalar>
+    Checkpoint<Scalar>::~Checkpoint()
+    {
+      this->close();
+    }
+
+    template<typename Scalar>
+    uint64_t Checkpoint<Scalar>::checksum(const char* data, size_t size, uint64_t hash)
+    {
+      // FNV-1a
+      for (size_t i = 0; i < size; i++)
+      {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+      }
+      return hash;
+    }
+
+    template<typename Scalar>
+    int Checkpoint<Scalar>::find_mesh(const std::vector<MeshSharedPtr>& meshes, MeshSharedPtr mesh)
+    {
+      for (unsigned int i = 0; i < meshes.size(); i++)
+        if (meshes[i].get() == mesh.get())
+          return i;
+      throw Exceptions::Exception("Checkpoint: the mesh of a space / solution is not among the saved meshes.");
+      return -1;
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::save(const char* filename, std::vector<MeshSharedPtr> meshes, std::vector<SpaceSharedPtr<Scalar> > spaces, std::vector<MeshFunctionSharedPtr<Scalar> > solutions, bool compress)
+    {
+#ifndef WITH_ZLIB
+      if (compress)
+        throw Exceptions::Exception("Checkpoint: compression requires Hermes built with ZLIB.");
+#endif
+
+      // Check everything before touching the file.
+      std::vector<int> space_meshes, solution_meshes;
+      for (unsigned int i = 0; i < spaces.size(); i++)
+      {
+        spaces[i]->check();
+        space_meshes.push_back(find_mesh(meshes, spaces[i]->get_mesh()));
+      }
+      for (unsigned int i = 0; i < solutions.size(); i++)
+      {
+        Solution<Scalar>* solution = dynamic_cast<Solution<Scalar>*>(solutions[i].get());
+        if (solution == nullptr || solution->get_type() != HERMES_SLN)
+          throw Exceptions::Exception("Checkpoint: only instances of Solution (not exact solutions) can be saved.");
+        solution_meshes.push_back(find_mesh(meshes, solution->get_mesh()));
+      }
+
+      FILE* file = fopen(filename, "wb");
+      if (file == nullptr)
+        throw Exceptions::Exception("Checkpoint: could not open %s for writing.", filename);
+
+      this->sections.clear();
+
+      // The header is written again at the end, when the table of contents is known.
+      FileHeader header;
+      memset(&header, 0, sizeof(FileHeader));
+      fwrite(&header, sizeof(FileHeader), 1, file);
+      uint64_t position = sizeof(FileHeader);
+
+      try
+      {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+          SectionData data;
+          this->write_mesh(data, meshes[i]);
+          this->write_section(file, position, data, SectionMesh, i, i, compress);
+        }
+        for (unsigned int i = 0; i < spaces.size(); i++)
+        {
+          SectionData data;
+          this->write_space(data, spaces[i]);
+          this->write_section(file, position, data, SectionSpace, i, space_meshes[i], compress);
+        }
+        for (unsigned int i = 0; i < solutions.size(); i++)
+        {
+          SectionData data;
+          this->write_solution(data, static_cast<Solution<Scalar>*>(solutions[i].get()));
+          this->write_section(file, position, data, SectionSolution, i, solution_meshes[i], compress);
+        }
+      }
+      catch (...)
+      {
+        fclose(file);
+        this->sections.clear();
+        throw;
+      }
+
+      memcpy(header.magic, checkpoint_magic, 8);
+      header.version = H2D_CHECKPOINT_VERSION;
+      header.byte_order = checkpoint_byte_order;
+      header.scalar_size = sizeof(Scalar);
+      header.section_count = this->sections.size();
+      header.toc_offset = position;
+      header.toc_checksum = checksum((const char*)this->sections.data(), this->sections.size() * sizeof(SectionRecord));
+
+      fwrite(this->sections.data(), sizeof(SectionRecord), this->sections.size(), file);
+      fseek(file, 0, SEEK_SET);
+      fwrite(&header, sizeof(FileHeader), 1, file);
+
+      bool failed = ferror(file) != 0;
+      fclose(file);
+      this->sections.clear();
+
+      if (failed)
+        throw Exceptions::Exception("Checkpoint: writing of %s failed.", filename);
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::write_section(FILE* file, uint64_t& position, SectionData& data, SectionType type, int index, int mesh_index, bool compress)
+    {
+      SectionRecord record;
+      record.type = type;
+      record.index = index;
+      record.mesh_index = mesh_index;
+      record.compressed = compress ? 1 : 0;
+      record.offset = position;
+      record.raw_size = data.size();
+
+      if (compress)
+      {
+#ifdef WITH_ZLIB
+        char* raw = new char[record.raw_size];
+        data.gather(raw);
+        uLongf compressed_size = compressBound(record.raw_size);
+        char* compressed = new char[compressed_size];
+        int result = compress2((Bytef*)compressed, &compressed_size, (const Bytef*)raw, record.raw_size, Z_DEFAULT_COMPRESSION);
+        delete[] raw;
+        if (result != Z_OK)
+        {
+          delete[] compressed;
+          throw Exceptions::Exception("Checkpoint: compression failed.");
+        }
+        record.stored_size = compressed_size;
+        record.checksum = checksum(compressed, compressed_size);
+        fwrite(compressed, 1, compressed_size, file);
+        delete[] compressed;
+#endif
+      }
+      else
+      {
+        // Written piece by piece, large arrays are not copied.
+        record.stored_size = record.raw_size;
+        record.checksum = 14695981039346656037ULL;
+        for (unsigned int i = 0; i < data.pieces.size(); i++)
+        {
+          record.checksum = checksum(data.pieces[i].first, data.pieces[i].second, record.checksum);
+          fwrite(data.pieces[i].first, 1, data.pieces[i].second, file);
+        }
+      }
+      position += record.stored_size;
+
+      // Sections start at 8-byte boundaries.
+      static const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+      unsigned int padding_size = (8 - position % 8) % 8;
+      fwrite(padding, 1, padding_size, file);
+      position += padding_size;
+
+      if (ferror(file))
+        throw Exceptions::Exception("Checkpoint: writing failed.");
+
+      this->sections.push_back(record);
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::write_mesh(SectionData& data, MeshSharedPtr mesh)
+    {
+      CheckpointMeshRecord mesh_record;
+      mesh_record.max_node_id = mesh->get_max_node_id();
+      mesh_record.max_element_id = mesh->get_max_element_id();
+      mesh_record.nbase = mesh->nbase;
+      mesh_record.ntopvert = mesh->ntopvert;
+      mesh_record.ninitial = mesh->ninitial;
+      mesh_record.nactive = mesh->nactive;
+      mesh_record.hash_size = mesh->get_hash_size();
+      mesh_record.refinements_count = mesh->refinements.size();
+      mesh_record.element_min_marker_unused = mesh->element_markers_conversion.min_marker_unused;
+      mesh_record.boundary_min_marker_unused = mesh->boundary_markers_conversion.min_marker_unused;
+      mesh_record.element_markers_count = mesh->element_markers_conversion.conversion_table.size();
+      mesh_record.boundary_markers_count = mesh->boundary_markers_conversion.conversion_table.size();
+      const int* unused_nodes = mesh->nodes.get_unused(mesh_record.unused_node_count);
+      const int* unused_elements = mesh->elements.get_unused(mesh_record.unused_element_count);
+
+      // Nodes.
+      CheckpointNodeRecord* node_records = new CheckpointNodeRecord[mesh_record.max_node_id];
+      memset(node_records, 0, mesh_record.max_node_id * sizeof(CheckpointNodeRecord));
+      for (int i = 0; i < mesh_record.max_node_id; i++)
+      {
+        Node* node = mesh->get_node(i);
+        CheckpointNodeRecord& record = node_records[i];
+        record.id = i;
+        if (!node->used)
+          continue;
+        record.ref = node->ref;
+        record.flags = node->type | (node->bnd << 1) | (node->used << 2);
+        record.p1 = node->p1;
+        record.p2 = node->p2;
+        if (node->type == HERMES_TYPE_VERTEX)
+        {
+          record.x = node->x;
+          record.y = node->y;
+        }
+        else
+        {
+          record.marker = node->marker;
+          for (int j = 0; j < 2; j++)
+            record.elem[j] = node->elem[j] ? node->elem[j]->id : -1;
+        }
+      }
+
+      // Elements.
+      CheckpointElementRecord* element_records = new CheckpointElementRecord[mesh_record.max_element_id];
+      memset(element_records, 0, mesh_record.max_element_id * sizeof(CheckpointElementRecord));
+      std::vector<Element*> curved_elements;
+      for (int i = 0; i < mesh_record.max_element_id; i++)
+      {
+        Element* e = mesh->get_element_fast(i);
+        CheckpointElementRecord& record = element_records[i];
+        record.id = i;
+        if (!e->used)
+          continue;
+        record.parent = e->parent ? e->parent->id : -1;
+        for (int j = 0; j < H2D_MAX_NUMBER_VERTICES; j++)
+        {
+          record.vn[j] = (j < e->nvert) ? e->vn[j]->id : -1;
+          if (e->active)
+            record.en_sons[j] = (j < e->nvert && e->en[j]) ? e->en[j]->id : -1;
+          else
+            record.en_sons[j] = e->sons[j] ? e->sons[j]->id : -1;
+        }
+        record.marker = e->marker;
+        record.iro_cache = e->iro_cache;
+        record.nvert = e->nvert;
+        record.flags = (e->active ? 1 : 0) | 2 | (e->cm ? 4 : 0);
+        record.area = e->area;
+        record.diameter = e->diameter;
+        if (e->cm)
+          curved_elements.push_back(e);
+      }
+      mesh_record.curved_count = curved_elements.size();
+
+      data.add_copy(&mesh_record, sizeof(CheckpointMeshRecord));
+      data.add_copy(node_records, mesh_record.max_node_id * sizeof(CheckpointNodeRecord));
+      data.add_copy(unused_nodes, mesh_record.unused_node_count * sizeof(int));
+      data.add_copy(element_records, mesh_record.max_element_id * sizeof(CheckpointElementRecord));
+      data.add_copy(unused_elements, mesh_record.unused_element_count * sizeof(int));
+      delete[] node_records;
+      delete[] element_records;
+
+      // Curved elements, the curves are stored with the top-level maps only.
+      for (unsigned int i = 0; i < curved_elements.size(); i++)
+      {
+        CurvMap* cm = curved_elements[i]->cm;
+        CheckpointCurvMapRecord record;
+        memset(&record, 0, sizeof(CheckpointCurvMapRecord));
+        record.element_id = curved_elements[i]->id;
+        record.toplevel = cm->toplevel ? 1 : 0;
+        record.parent_id = cm->toplevel ? -1 : cm->parent->id;
+        record.order = cm->order;
+        record.sub_idx = cm->sub_idx;
+        for (int j = 0; j < H2D_MAX_NUMBER_EDGES; j++)
+          record.curve_types[j] = (cm->toplevel && cm->curves[j]) ? cm->curves[j]->type : -1;
+        data.add_copy(&record, sizeof(CheckpointCurvMapRecord));
+
+        for (int j = 0; j < H2D_MAX_NUMBER_EDGES; j++)
+        {
+          if (record.curve_types[j] == ArcType)
+          {
+            Arc* arc = (Arc*)cm->curves[j];
+            data.add_value(arc->angle);
+            data.add_copy(arc->kv, Arc::nk * sizeof(double));
+            data.add_copy(arc->pt, Arc::np * sizeof(double3));
+          }
+          else if (record.curve_types[j] == NurbsType)
+          {
+            Nurbs* nurbs = (Nurbs*)cm->curves[j];
+            data.add_value<int>(nurbs->degree);
+            data.add_value<int>(nurbs->np);
+            data.add_value<int>(nurbs->nk);
+            data.add_copy(nurbs->pt, nurbs->np * sizeof(double3));
+            data.add_copy(nurbs->kv, nurbs->nk * sizeof(double));
+          }
+        }
+      }
+
+      // Markers.
+      Mesh::MarkersConversion* conversions[2] = { &mesh->element_markers_conversion, &mesh->boundary_markers_conversion };
+      for (int i = 0; i < 2; i++)
+      {
+        for (std::map<int, std::string>::const_iterator it = conversions[i]->conversion_table.begin(); it != conversions[i]->conversion_table.end(); it++)
+        {
+          data.add_value<int>(it->first);
+          data.add_value<int>(it->second.length());
+          data.add_copy(it->second.c_str(), it->second.length());
+        }
+      }
+
+      // Refinements.
+      for (unsigned int i = 0; i < mesh->refinements.size(); i++)
+      {
+        data.add_value<int>(mesh->refinements[i].first);
+        data.add_value<int>(mesh->refinements[i].second);
+      }
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::write_space(SectionData& data, SpaceSharedPtr<Scalar> space)
+    {
+      CheckpointSpaceRecord space_record;
+      space_record.type = space->get_type();
+      space_record.element_count = space->get_mesh()->get_max_element_id();
+      space_record.first_dof = space->first_dof;
+      space_record.ndof = space->get_num_dofs();
+      data.add_copy(&space_record, sizeof(CheckpointSpaceRecord));
+
+      CheckpointElementDataRecord* records = new CheckpointElementDataRecord[space_record.element_count];
+      for (int i = 0; i < space_record.element_count; i++)
+      {
+        records[i].order = space->edata[i].order;
+        records[i].bdof = space->edata[i].bdof;
+        records[i].n = space->edata[i].n;
+        records[i].changed_in_last_adaptation = space->edata[i].changed_in_last_adaptation ? 1 : 0;
+      }
+      data.add_copy(records, space_record.element_count * sizeof(CheckpointElementDataRecord));
+      delete[] records;
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::write_solution(SectionData& data, Solution<Scalar>* solution)
+    {
+      CheckpointSolutionRecord solution_record;
+      solution_record.space_type = solution->get_space_type();
+      solution_record.num_components = solution->num_components;
+      solution_record.num_coeffs = solution->num_coeffs;
+      solution_record.num_elems = solution->num_elems;
+      data.add_copy(&solution_record, sizeof(CheckpointSolutionRecord));
+
+      // The (possibly huge) arrays are referenced, not copied.
+      data.add_reference(solution->mono_coeffs, solution->num_coeffs * sizeof(Scalar));
+      data.add_reference(solution->elem_orders, solution->num_elems * sizeof(int));
+      for (int i = 0; i < solution->num_components; i++)
+        data.add_reference(solution->elem_coeffs[i], solution->num_elems * sizeof(int));
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::open(const char* filename, bool verify_checksums)
+    {
+      this->close();
+      this->verify_checksums = verify_checksums;
+
+#ifndef _WINDOWS
+      int fd = ::open(filename, O_RDONLY);
+      if (fd < 0)
+        throw Exceptions::Exception("Checkpoint: could not open %s.", filename);
+      struct stat file_stat;
+      if (fstat(fd, &file_stat) != 0)
+      {
+        ::close(fd);
+        throw Exceptions::Exception("Checkpoint: could not open %s.", filename);
+      }
+      this->file_size = file_stat.st_size;
+      void* mapping = this->file_size > 0 ? mmap(nullptr, this->file_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+      ::close(fd);
+      if (mapping == MAP_FAILED)
+        throw Exceptions::Exception("Checkpoint: could not map %s.", filename);
+      this->file_data = (char*)mapping;
+      this->file_mapped = true;
+#else
+      FILE* file = fopen(filename, "rb");
+      if (file == nullptr)
+        throw Exceptions::Exception("Checkpoint: could not open %s.", filename);
+      _fseeki64(file, 0, SEEK_END);
+      this->file_size = _ftelli64(file);
+      rewind(file);
+      char* data = malloc_with_check<char>(this->file_size);
+      size_t read_size = fread(data, 1, this->file_size, file);
+      fclose(file);
+      this->file_data = data;
+      this->file_mapped = false;
+      if (read_size != this->file_size)
+      {
+        this->close();
+        throw Exceptions::Exception("Checkpoint: could not read %s.", filename);
+      }
+#endif
+
+      // Header and table of contents.
+      FileHeader header;
+      if (this->file_size < sizeof(FileHeader))
+      {
+        this->close();
+        throw Exceptions::Exception("Checkpoint: %s is not a checkpoint.", filename);
+      }
+      memcpy(&header, this->file_data, sizeof(FileHeader));
+
+      const char* error = nullptr;
+      if (memcmp(header.magic, checkpoint_magic, 8))
+        error = "not a checkpoint";
+      else if (header.version != H2D_CHECKPOINT_VERSION)
+        error = "unsupported version";
+      else if (header.byte_order != checkpoint_byte_order)
+        error = "written with a different byte order";
+      else if (header.scalar_size != sizeof(Scalar))
+        error = "written with a different Scalar type";
+      else if (header.toc_offset > this->file_size || header.section_count > (this->file_size - header.toc_offset) / sizeof(SectionRecord))
+        error = "truncated";
+      else if (checksum(this->file_data + header.toc_offset, header.section_count * sizeof(SectionRecord)) != header.toc_checksum)
+        error = "corrupted table of contents";
+      if (error)
+      {
+        this->close();
+        throw Exceptions::Exception("Checkpoint: %s - %s.", filename, error);
+      }
+
+      this->sections.resize(header.section_count);
+      memcpy(this->sections.data(), this->file_data + header.toc_offset, header.section_count * sizeof(SectionRecord));
+      for (unsigned int i = 0; i < this->sections.size(); i++)
+      {
+        const SectionRecord& record = this->sections[i];
+        // Uncompressed sections are read in place, zlib does not compress more than 1032:1.
+        if (record.offset < sizeof(FileHeader) || record.offset > header.toc_offset || record.stored_size > header.toc_offset - record.offset
+          || (record.compressed ? record.raw_size / 1032 > record.stored_size : record.raw_size != record.stored_size)
+          || record.type > SectionSolution || (record.type != SectionMesh && (record.mesh_index < 0 || record.mesh_index >= this->get_mesh_count())))
+        {
+          this->close();
+          throw Exceptions::Exception("Checkpoint: %s - corrupted table of contents.", filename);
+        }
+      }
+
+      this->loaded_meshes.resize(this->get_mesh_count());
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::close()
+    {
+      if (this->file_data)
+      {
+#ifndef _WINDOWS
+        if (this->file_mapped)
+          munmap(this->file_data, this->file_size);
+        else
+#endif
+          free_with_check(this->file_data);
+      }
+      this->file_data = nullptr;
+      this->file_size = 0;
+      this->file_mapped = false;
+      this->sections.clear();
+      this->loaded_meshes.clear();
+    }
+
+    template<typename Scalar>
+    int Checkpoint<Scalar>::get_section_count(SectionType type) const
+    {
+      int count = 0;
+      for (unsigned int i = 0; i < this->sections.size(); i++)
+        if (this->sections[i].type == type)
+          count++;
+      return count;
+    }
+
+    template<typename Scalar>
+    int Checkpoint<Scalar>::get_mesh_count() const
+    {
+      return this->get_section_count(SectionMesh);
+    }
+
+    template<typename Scalar>
+    int Checkpoint<Scalar>::get_space_count() const
+    {
+      return this->get_section_count(SectionSpace);
+    }
+
+    template<typename Scalar>
+    int Checkpoint<Scalar>::get_solution_count() const
+    {
+      return this->get_section_count(SectionSolution);
+    }
+
+    template<typename Scalar>
+    const char* Checkpoint<Scalar>::get_section(SectionType type, int index, std::vector<char>& buffer, size_t& size, int& mesh_index)
+    {
+      if (!this->file_data)
+        throw Exceptions::Exception("Checkpoint: no file opened.");
+
+      for (unsigned int i = 0; i < this->sections.size(); i++)
+      {
+        const SectionRecord& record = this->sections[i];
+        if (record.type != type || record.index != index)
+          continue;
+
+        const char* stored = this->file_data + record.offset;
+        if (this->verify_checksums && checksum(stored, record.stored_size) != record.checksum)
+          throw Exceptions::Exception("Checkpoint: checksum mismatch in section %i.", i);
+
+        mesh_index = record.mesh_index;
+        size = record.raw_size;
+        if (!record.compressed)
+          return stored;
+
+#ifdef WITH_ZLIB
+        buffer.resize(record.raw_size);
+        uLongf raw_size = record.raw_size;
+        if (uncompress((Bytef*)buffer.data(), &raw_size, (const Bytef*)stored, record.stored_size) != Z_OK || raw_size != record.raw_size)
+          throw Exceptions::Exception("Checkpoint: decompression of section %i failed.", i);
+        return buffer.data();
+#else
+        throw Exceptions::Exception("Checkpoint: compressed sections require Hermes built with ZLIB.");
+#endif
+      }
+
+      throw Exceptions::Exception("Checkpoint: object %i not found.", index);
+      return nullptr;
+    }
+
+    template<typename Scalar>
+    MeshSharedPtr Checkpoint<Scalar>::load_mesh(int index)
+    {
+      if (index < 0 || index >= (int)this->loaded_meshes.size())
+        throw Exceptions::ValueException("index", index, this->loaded_meshes.size());
+
+      if (!this->loaded_meshes[index])
+      {
+        std::vector<char> buffer;
+        size_t size;
+        int mesh_index;
+        const char* data = this->get_section(SectionMesh, index, buffer, size, mesh_index);
+        SectionReader reader(data, size);
+        MeshSharedPtr mesh(new Mesh);
+        this->read_mesh(reader, mesh);
+        this->loaded_meshes[index] = mesh;
+      }
+
+      return this->loaded_meshes[index];
+    }
+
+    /// Checks the references between the records of a mesh, so that no pointer is set up to a nonexistent item.
+    static void check_mesh_records(const CheckpointMeshRecord& mesh_record, const std::vector<CheckpointNodeRecord>& node_records, const std::vector<int>& unused_nodes,
+      const std::vector<CheckpointElementRecord>& element_records, const std::vector<int>& unused_elements)
+    {
+      int max_node_id = mesh_record.max_node_id, max_element_id = mesh_record.max_element_id;
+
+      for (int i = 0; i < max_node_id; i++)
+      {
+        const CheckpointNodeRecord& record = node_records[i];
+        if (record.id != i)
+          throw Exceptions::Exception("Checkpoint: node record %i out of place.", i);
+        if (!(record.flags & 4))
+          continue;
+        // Negative parent ids mark top-level vertices.
+        check_id(std::max(record.p1, -1), max_node_id, "parent node");
+        check_id(std::max(record.p2, -1), max_node_id, "parent node");
+        if ((record.flags & 1) == HERMES_TYPE_EDGE)
+        {
+          for (int j = 0; j < 2; j++)
+          {
+            check_id(record.elem[j], max_element_id, "edge element");
+            if (record.elem[j] >= 0 && !(element_records[record.elem[j]].flags & 2))
+              throw Exceptions::Exception("Checkpoint: edge node %i refers to the unused element %i.", i, record.elem[j]);
+          }
+        }
+      }
+
+      for (int i = 0; i < max_element_id; i++)
+      {
+        const CheckpointElementRecord& record = element_records[i];
+        if (record.id != i)
+          throw Exceptions::Exception("Checkpoint: element record %i out of place.", i);
+        if (!(record.flags & 2))
+          continue;
+        if (record.nvert != 3 && record.nvert != 4)
+          throw Exceptions::Exception("Checkpoint: element %i has %i vertices.", i, record.nvert);
+        check_id(record.parent, max_element_id, "parent element");
+        if (record.parent >= 0 && (element_records[record.parent].flags & 3) != 2)
+          throw Exceptions::Exception("Checkpoint: the parent of element %i is not an inactive element.", i);
+
+        bool active = (record.flags & 1) != 0;
+        for (int j = 0; j < H2D_MAX_NUMBER_VERTICES; j++)
+        {
+          check_id(record.vn[j], max_node_id, "vertex");
+          if (j < record.nvert && (record.vn[j] < 0 || (node_records[record.vn[j]].flags & 5) != (4 | HERMES_TYPE_VERTEX)))
+            throw Exceptions::Exception("Checkpoint: vertex %i of element %i is not a used vertex node.", j, i);
+          if (active)
+          {
+            check_id(record.en_sons[j], max_node_id, "edge");
+            if (j < record.nvert && (record.en_sons[j] < 0 || (node_records[record.en_sons[j]].flags & 5) != (4 | HERMES_TYPE_EDGE)))
+              throw Exceptions::Exception("Checkpoint: edge %i of element %i is not a used edge node.", j, i);
+          }
+          else
+          {
+            check_id(record.en_sons[j], max_element_id, "son element");
+            if (record.en_sons[j] >= 0 && !(element_records[record.en_sons[j]].flags & 2))
+              throw Exceptions::Exception("Checkpoint: son %i of element %i is not a used element.", j, i);
+          }
+        }
+      }
+
+      // Every unused id is listed at most once and refers to an unused item.
+      std::vector<bool> listed(max_node_id, false);
+      for (unsigned int i = 0; i < unused_nodes.size(); i++)
+      {
+        int id = unused_nodes[i];
+        if (id < 0 || id >= max_node_id || (node_records[id].flags & 4) || listed[id])
+          throw Exceptions::Exception("Checkpoint: invalid unused node id %i.", id);
+        listed[id] = true;
+      }
+      listed.assign(max_element_id, false);
+      for (unsigned int i = 0; i < unused_elements.size(); i++)
+      {
+        int id = unused_elements[i];
+        if (id < 0 || id >= max_element_id || (element_records[id].flags & 2) || listed[id])
+          throw Exceptions::Exception("Checkpoint: invalid unused element id %i.", id);
+        listed[id] = true;
+      }
+    }
+
+    template<typename Scalar>
+    void Checkpoint<Scalar>::read_mesh(SectionReader& reader, MeshSharedPtr mesh)
+    {
+      CheckpointMeshRecord mesh_record = reader.template read_value<CheckpointMeshRecord>();
+
+      if (mesh_record.max_node_id < 0 || mesh_record.max_element_id < 0 || mesh_record.hash_size <= 0 || mesh_record.curved_count < 0 || mesh_record.refinements_count < 0
+        || mesh_record.element_markers_count < 0 || mesh_record.boundary_markers_count < 0
+        || mesh_record.unused_node_count > (unsigned int)mesh_record.max_node_id || mesh_record.unused_element_count > (unsigned int)mesh_record.max_element_id
+        || mesh_record.ntopvert < 0 || mesh_record.ntopvert > mesh_record.max_node_id
+        || mesh_record.nbase < 0 || mesh_record.nbase > mesh_record.max_element_id
+        || mesh_record.ninitial < 0 || mesh_record.ninitial > mesh_record.max_element_id
+        || mesh_record.nactive < 0 || mesh_record.nactive > mesh_record.max_element_id)
+        throw Exceptions::Exception("Checkpoint: corrupted mesh record.");
+
+      mesh->free();
+      mesh->init(mesh_record.hash_size);
+
+      // Nodes, the counts are checked against the section size before anything is allocated.
+      reader.require(mesh_record.max_node_id, sizeof(CheckpointNodeRecord));
+      std::vector<CheckpointNodeRecord> node_records(mesh_record.max_node_id);
+      reader.read(node_records.data(), mesh_record.max_node_id * sizeof(CheckpointNodeRecord));
+      reader.require(mesh_record.unused_node_count, sizeof(int));
+      std::vector<int> unused_nodes(mesh_record.unused_node_count);
+      reader.read(unused_nodes.data(), mesh_record.unused_node_count * sizeof(int));
+
+      // Elements.
+      reader.require(mesh_record.max_element_id, sizeof(CheckpointElementRecord));
+      std::vector<CheckpointElementRecord> element_records(mesh_record.max_element_id);
+      reader.read(element_records.data(), mesh_record.max_element_id * sizeof(CheckpointElementRecord));
+      reader.require(mesh_record.unused_element_count, sizeof(int));
+      std::vector<int> unused_elements(mesh_record.unused_element_count);
+      reader.read(unused_elements.data(), mesh_record.unused_element_count * sizeof(int));
+
+      // All the references between the records are checked before the first pointer is set up.
+      check_mesh_records(mesh_record, node_records, unused_nodes, element_records, unused_elements);
+
+      for (int i = 0; i < mesh_record.max_node_id; i++)
+        memset((void*)mesh->nodes.add(), 0, sizeof(Node));
+      for (int i = 0; i < mesh_record.max_node_id; i++)
+      {
+        const CheckpointNodeRecord& record = node_records[i];
+        Node* node = &mesh->nodes[i];
+        node->id = i;
+        // Unused items not in the list of unused ids are skipped slots.
+        node->used = (record.flags & 4) ? 1 : 0;
+        if (!node->used)
+          continue;
+        node->ref = record.ref;
+        node->type = record.flags & 1;
+        node->bnd = (record.flags >> 1) & 1;
+        node->p1 = record.p1;
+        node->p2 = record.p2;
+        if (node->type == HERMES_TYPE_VERTEX)
+        {
+          node->x = record.x;
+          node->y = record.y;
+        }
+        else
+          node->marker = record.marker;
+      }
+
+      for (int i = 0; i < mesh_record.max_element_id; i++)
+        memset((void*)mesh->elements.add(), 0, sizeof(Element));
+      for (int i = 0; i < mesh_record.max_element_id; i++)
+      {
+        const CheckpointElementRecord& record = element_records[i];
+        Element* e = &mesh->elements[i];
+        e->id = i;
+        e->used = (record.flags & 2) != 0;
+        if (!e->used)
+          continue;
+        e->active = (record.flags & 1) != 0;
+        e->parent = record.parent >= 0 ? &mesh->elements[record.parent] : nullptr;
+        e->nvert = record.nvert;
+        for (int j = 0; j < H2D_MAX_NUMBER_VERTICES; j++)
+        {
+          e->vn[j] = record.vn[j] >= 0 ? &mesh->nodes[record.vn[j]] : nullptr;
+          if (e->active)
+            e->en[j] = record.en_sons[j] >= 0 ? &mesh->nodes[record.en_sons[j]] : nullptr;
+          else
+            e->sons[j] = record.en_sons[j] >= 0 ? &mesh->elements[record.en_sons[j]] : nullptr;
+        }
+        e->marker = record.marker;
+        e->iro_cache = record.iro_cache;
+        e->area = record.area;
+        e->diameter = record.diameter;
+      }
+
+      // Element pointers of edge nodes.
+      for (int i = 0; i < mesh_record.max_node_id; i++)
+      {
+        const CheckpointNodeRecord& record = node_records[i];
+        if ((record.flags & 4) && (record.flags & 1) == HERMES_TYPE_EDGE)
+          for (int j = 0; j < 2; j++)
+            mesh->nodes[i].elem[j] = record.elem[j] >= 0 ? &mesh->elements[record.elem[j]] : nullptr;
+      }
+
+      // Removal in the stored order reproduces the ids of items added later.
+      for (unsigned int i = 0; i < mesh_record.unused_node_count; i++)
+        mesh->nodes.remove(unused_nodes[i]);
+      for (unsigned int i = 0; i < mesh_record.unused_element_count; i++)
+        mesh->elements.remove(unused_elements[i]);
+
+      mesh->rebuild();
+
+      // Curved elements.
+      for (int i = 0; i < mesh_record.curved_count; i++)
+      {
+        CheckpointCurvMapRecord record = reader.template read_value<CheckpointCurvMapRecord>();
+        check_id(record.element_id, mesh_record.max_element_id, "curved element");
+        if (record.element_id < 0 || !(element_records[record.element_id].flags & 4) || mesh->elements[record.element_id].cm)
+          throw Exceptions::Exception("Checkpoint: curved element %i not marked as curved or stored twice.", record.element_id);
+        if (!record.toplevel)
+        {
+          check_id(record.parent_id, mesh_record.max_element_id, "curved map parent");
+          if (record.parent_id < 0 || !mesh->elements[record.parent_id].used)
+            throw Exceptions::Exception("Checkpoint: curved element %i has no parent.", record.element_id);
+        }
+        CurvMap* cm = new CurvMap;
+        cm->toplevel = record.toplevel != 0;
+        cm->parent = cm->toplevel ? nullptr : &mesh->elements[record.parent_id];
+        cm->order = record.order;
+        cm->sub_idx = record.sub_idx;
+        mesh->elements[record.element_id].cm = cm;
+
+        for (int j = 0; j < H2D_MAX_NUMBER_EDGES; j++)
+        {
+          if (record.curve_types[j] == ArcType)
+          {
+            Arc* arc = new Arc();
+            cm->curves[j] = arc;
+            arc->angle = reader.template read_value<double>();
+            reader.read(arc->kv, Arc::nk * sizeof(double));
+            reader.read(arc->pt, Arc::np * sizeof(double3));
+          }
+          else if (record.curve_types[j] == NurbsType)
+          {
+            Nurbs* nurbs = new Nurbs();
+            cm->curves[j] = nurbs;
+            nurbs->degree = reader.template read_value<int>();
+            nurbs->np = reader.template read_value<int>();
+            nurbs->nk = reader.template read_value<int>();
+            if (nurbs->degree < 0 || nurbs->np < 0 || nurbs->nk != nurbs->degree + nurbs->np + 1)
+              throw Exceptions::Exception("Checkpoint: corrupted curve of element %i.", record.element_id);
+            reader.require(nurbs->np, sizeof(double3));
+            nurbs->pt = malloc_with_check<double3>(nurbs->np);
+            reader.read(nurbs->pt, nurbs->np * sizeof(double3));
+            reader.require(nurbs->nk, sizeof(double));
+            nurbs->kv = malloc_with_check<double>(nurbs->nk);
+            reader.read(nurbs->kv, nurbs->nk * sizeof(double));
+          }
+        }
+      }
+
+      // The reference map coefficients are not stored, the curves of all the top-level maps have to be known first.
+      Element* e;
+      for_all_used_elements(e, mesh)
+        if (e->cm)
+          e->cm->update_refmap_coeffs(e);
+
+      // Markers.
+      Mesh::MarkersConversion* conversions[2] = { &mesh->element_markers_conversion, &mesh->boundary_markers_conversion };
+      int counts[2] = { mesh_record.element_markers_count, mesh_record.boundary_markers_count };
+      conversions[0]->min_marker_unused = mesh_record.element_min_marker_unused;
+      conversions[1]->min_marker_unused = mesh_record.boundary_min_marker_unused;
+      for (int i = 0; i < 2; i++)
+      {
+        for (int j = 0; j < counts[i]; j++)
+        {
+          int marker = reader.template read_value<int>();
+          int length = reader.template read_value<int>();
+          reader.require(length, 1);
+          std::string user_marker(length, ' ');
+          if (length > 0)
+            reader.read(&user_marker[0], length);
+          conversions[i]->conversion_table[marker] = user_marker;
+          conversions[i]->conversion_table_inverse[user_marker] = marker;
+        }
+      }
+
+      // Refinements.
+      reader.require(mesh_record.refinements_count, 2 * sizeof(int));
+      for (int i = 0; i < mesh_record.refinements_count; i++)
+      {
+        int id = reader.template read_value<int>();
+        int refinement = reader.template read_value<int>();
+        if (id < 0 || id >= mesh_record.max_element_id)
+          throw Exceptions::Exception("Checkpoint: refined element id %i out of range.", id);
+        mesh->refinements.push_back(std::pair<unsigned int, int>(id, refinement));
+      }
+
+      mesh->nbase = mesh_record.nbase;
+      mesh->ntopvert = mesh_record.ntopvert;
+      mesh->ninitial = mesh_record.ninitial;
+      mesh->nactive = mesh_record.nactive;
+      mesh->seq = g_mesh_seq++;
+    }
+
+    template<typename Scalar>
+    SpaceSharedPtr<Scalar> Checkpoint<Scalar>::load_space(int index, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
+    {
+      std::vector<char> buffer;
+      size_t size;
+      int mesh_index;
+      const char* data = this->get_section(SectionSpace, index, buffer, size, mesh_index);
+      SectionReader reader(data, size);
+      MeshSharedPtr mesh = this->load_mesh(mesh_index);
+
+      CheckpointSpaceRecord space_record = reader.template read_value<CheckpointSpaceRecord>();
+      if (space_record.element_count != mesh->get_max_element_id())
+        throw Exceptions::Exception("Checkpoint: mesh and saved space mixed.");
+      if (space_record.type < HERMES_H1_SPACE || space_record.type > HERMES_L2_MARKERWISE_CONST_SPACE || space_record.first_dof < 0 || space_record.ndof < 0)
+        throw Exceptions::Exception("Checkpoint: corrupted space record.");
+
+      SpaceSharedPtr<Scalar> space = Space<Scalar>::init_empty_space((SpaceType)space_record.type, mesh, shapeset);
+      space->mesh_seq = mesh->get_seq();
+      space->resize_tables();
+
+      // L2 space does not have any (strong) essential BCs.
+      if (essential_bcs != nullptr && space->get_type() != HERMES_L2_SPACE && space->get_type() != HERMES_L2_MARKERWISE_CONST_SPACE)
+      {
+        space->essential_bcs = essential_bcs;
+        const std::vector<std::string>& markers = essential_bcs->get_markers();
+        for (unsigned int i = 0; i < markers.size(); i++)
+          if (markers[i] != HERMES_ANY && mesh->boundary_markers_conversion.conversion_table_inverse.find(markers[i]) == mesh->boundary_markers_conversion.conversion_table_inverse.end())
+            throw Hermes::Exceptions::Exception("A boundary condition defined on a non-existent marker.");
+      }
+
+      reader.require(space_record.element_count, sizeof(CheckpointElementDataRecord));
+      std::vector<CheckpointElementDataRecord> records(space_record.element_count);
+      reader.read(records.data(), space_record.element_count * sizeof(CheckpointElementDataRecord));
+      for (int i = 0; i < space_record.element_count; i++)
+      {
+        space->edata[i].order = records[i].order;
+        space->edata[i].bdof = records[i].bdof;
+        space->edata[i].n = records[i].n;
+        space->edata[i].changed_in_last_adaptation = records[i].changed_in_last_adaptation != 0;
+      }
+
+      // The shapeset tables are indexed by the orders of the active elements.
+      int max_order = space->shapeset->get_max_order();
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        int order = records[e->id].order;
+        if (order < 0 || H2D_GET_H_ORDER(order) > max_order || H2D_GET_V_ORDER(order) > max_order)
+          throw Exceptions::Exception("Checkpoint: invalid order %i of element %i in the saved space.", order, e->id);
+      }
+
+      space->seq = g_space_seq++;
+
+      space->assign_dofs(space_record.first_dof);
+
+      // The DOF numbering has to be the saved one, the total count and the bubble DOFs of every element are compared.
+      bool same_numbering = space->first_dof == space_record.first_dof && space->get_num_dofs() == space_record.ndof;
+      for_all_active_elements(e, mesh)
+        if (space->edata[e->id].bdof != records[e->id].bdof || space->edata[e->id].n != records[e->id].n)
+          same_numbering = false;
+      if (!same_numbering)
+        throw Exceptions::Exception("Checkpoint: the DOF numbering of the saved space can not be reproduced, different essential boundary conditions used?");
+
+      return space;
+    }
+
+    template<typename Scalar>
+    MeshFunctionSharedPtr<Scalar> Checkpoint<Scalar>::load_solution(int index)
+    {
+      std::vector<char> buffer;
+      size_t size;
+      int mesh_index;
+      const char* data = this->get_section(SectionSolution, index, buffer, size, mesh_index);
+      SectionReader reader(data, size);
+      MeshSharedPtr mesh = this->load_mesh(mesh_index);
+
+      CheckpointSolutionRecord solution_record = reader.template read_value<CheckpointSolutionRecord>();
+      if (solution_record.num_elems > mesh->get_max_element_id())
+        throw Exceptions::Exception("Checkpoint: mesh and saved solution mixed.");
+      if (solution_record.space_type < HERMES_H1_SPACE || solution_record.space_type > HERMES_L2_MARKERWISE_CONST_SPACE
+        || solution_record.num_components < 1 || solution_record.num_components > H2D_MAX_SOLUTION_COMPONENTS)
+        throw Exceptions::Exception("Checkpoint: corrupted solution record.");
+      reader.require(solution_record.num_coeffs, sizeof(Scalar));
+      reader.require(solution_record.num_elems, (solution_record.num_components + 1) * sizeof(int));
+
+      Solution<Scalar>* solution = new Solution<Scalar>();
+      MeshFunctionSharedPtr<Scalar> result(solution);
+
+      solution->free();
+      solution->mesh = mesh;
+      solution->space_type = (SpaceType)solution_record.space_type;
+      solution->sln_type = HERMES_SLN;
+      solution->num_components = solution_record.num_components;
+      solution->num_coeffs = solution_record.num_coeffs;
+      solution->num_elems = solution_record.num_elems;
+
+      solution->mono_coeffs = malloc_with_check<Scalar>(solution->num_coeffs);
+      reader.read(solution->mono_coeffs, solution->num_coeffs * sizeof(Scalar));
+      solution->elem_orders = malloc_with_check<int>(solution->num_elems);
+      reader.read(solution->elem_orders, solution->num_elems * sizeof(int));
+      for (int i = 0; i < solution->num_components; i++)
+      {
+        solution->elem_coeffs[i] = malloc_with_check<int>(solution->num_elems);
+        reader.read(solution->elem_coeffs[i], solution->num_elems * sizeof(int));
+      }
+
+      // The monomial coefficients of every active element have to be within mono_coeffs,
+      // the order is limited by the derivative buffer (init_dxdy_buffer()).
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        int order = e->id < solution->num_elems ? solution->elem_orders[e->id] : -1;
+        if (order < 0 || order > 10)
+          throw Exceptions::Exception("Checkpoint: invalid order of element %i in the saved solution.", e->id);
+        int n = e->get_mode() ? sqr(order + 1) : (order + 1) * (order + 2) / 2;
+        for (int i = 0; i < solution->num_components; i++)
+        {
+          int first = solution->elem_coeffs[i][e->id];
+          if (first < 0 || first > solution->num_coeffs - n)
+            throw Exceptions::Exception("Checkpoint: coefficients of element %i out of range in the saved solution.", e->id);
+        }
+      }
+
+      solution->init_dxdy_buffer();
+
+      return result;
+    }
+
+    template class HERMES_API Checkpoint<double>;
+    template class HERMES_API Checkpoint<std::complex<double> >;
+  }
+}
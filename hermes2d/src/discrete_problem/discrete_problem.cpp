@@ -54,6 +54,7 @@ namespace Hermes
     void DiscreteProblem<Scalar>::init(bool to_set, bool dirichlet_lift_accordingly)
     {
       this->reassembled_states_reuse_linear_system = nullptr;
+      this->states_cached = false;
 
       this->spaces_size = this->spaces.size();
 
@@ -271,8 +272,16 @@ namespace Hermes
       for (unsigned char i = 0; i < this->num_threads_used; i++)
         this->threadAssembler[i]->set_weak_formulation(this->wf);
 
-      Traverse trav(this->spaces_size);
-      states = trav.get_states(meshes, num_states);
+      // The states are reused while the meshes are not changed.
+      // Not if they are to be replaced by reassembled_states_reuse_linear_system, which deletes them.
+      this->states_cached = !this->reassembled_states_reuse_linear_system;
+      if (this->states_cached)
+        states = this->states_cache.get_states(meshes, this->spaces_size, num_states);
+      else
+      {
+        Traverse trav(this->spaces_size);
+        states = trav.get_states(meshes, num_states);
+      }
 
       // Init the caught parallel exception message.
       this->exceptionMessageCaughtInParallelBlock.clear();
@@ -410,13 +419,14 @@ namespace Hermes
       if (!this->exceptionMessageCaughtInParallelBlock.empty())
         throw Hermes::Exceptions::Exception(this->exceptionMessageCaughtInParallelBlock.c_str());
 
-      Element* e;
       for (unsigned int space_i = 0; space_i < spaces.size(); space_i++)
       {
-        for_all_active_elements(e, spaces[space_i]->get_mesh())
+        MeshSharedPtr mesh = spaces[space_i]->get_mesh();
+        const std::vector<int>& active_elements = mesh->get_snapshot()->active_elements;
+        for (unsigned int active_i = 0; active_i < active_elements.size(); active_i++)
         {
-          spaces[space_i]->edata[e->id].changed_in_last_adaptation = false;
-          e->visited = false;
+          spaces[space_i]->edata[active_elements[active_i]].changed_in_last_adaptation = false;
+          mesh->get_element_fast(active_elements[active_i])->visited = false;
         }
       }
 
@@ -429,9 +439,8 @@ namespace Hermes
     template<typename Scalar>
     void DiscreteProblem<Scalar>::deinit_assembling(Traverse::State** states, unsigned int num_states)
     {
-      for (unsigned int i = 0; i < num_states; i++)
-        delete states[i];
-      free_with_check(states);
+      if (!this->states_cached)
+        Traverse::free_states(states);
 
       // Very important.
       if (this->add_dirichlet_lift && this->current_rhs)
@@ -61,170 +61,123 @@ namespace Hermes
         mat->free();
         mat->prealloc(ndof);
 
-        AsmList<Scalar>* al = malloc_with_check<AsmList<Scalar> >(spaces_size);
-        int* dofs_m, *dofs_n;
-        unsigned int cnts_m, cnts_n;
         bool **blocks = this->wf->get_blocks(this->force_diagonal_blocks);
+        bool is_DG = this->wf->is_DG() && !this->wf->mfDG.empty();
 
-        // Loop through all elements.
+        // Every thread collects the pairs (row, col) of its range of states, sorted and without duplicities.
         this->tick();
-        for (unsigned int state_i = 0; state_i < num_states; state_i++)
+        std::vector<std::vector<uint64_t> > thread_pairs(this->num_threads_used);
+#pragma omp parallel num_threads(this->num_threads_used)
         {
-          Traverse::State* current_state = states[state_i];
+          int thread_number = omp_get_thread_num();
+          int start = (num_states / this->num_threads_used) * thread_number;
+          int end = (num_states / this->num_threads_used) * (thread_number + 1);
+          if (thread_number == this->num_threads_used - 1)
+            end = num_states;
 
-          // Obtain assembly lists for the element at all spaces.
-          /// \todo do not get the assembly list again if the element was not changed.
-          for (unsigned int i = 0; i < spaces_size; i++)
+          try
           {
-            if (current_state->e[i])
-              spaces[i]->get_element_assembly_list(current_state->e[i], &(al[i]));
-          }
-          if (this->wf->is_DG() && !this->wf->mfDG.empty())
-          {
-            // Number of edges ( =  number of vertices).
-            int num_edges = current_state->e[0]->nvert;
-
-            // Allocation an array of arrays of neighboring elements for every mesh x edge.
-            Element **** neighbor_elems_arrays = new Element ***[spaces_size];
-            for (unsigned int i = 0; i < spaces_size; i++)
-              neighbor_elems_arrays[i] = new Element **[num_edges];
-
-            // The same, only for number of elements
-            int ** neighbor_elems_counts = new int *[spaces_size];
-            for (unsigned int i = 0; i < spaces_size; i++)
-              neighbor_elems_counts[i] = new int[num_edges];
+            std::vector<uint64_t>& pairs = thread_pairs[thread_number];
+            AsmList<Scalar>* al = new AsmList<Scalar>[spaces_size];
+            AsmList<Scalar> an;
 
-            // Get the neighbors.
-            for (unsigned int el = 0; el < spaces_size; el++)
+            for (int state_i = start; state_i < end; state_i++)
             {
-              NeighborSearch<Scalar> ns(current_state->e[el], spaces[el]->get_mesh());
+              // Exception already thrown -> exit the loop.
+              if (!this->exceptionMessageCaughtInParallelBlock.empty())
+                break;
 
-              for (int ed = 0; ed < num_edges; ed++)
-              {
-                if (current_state->e[el]->en[ed]->bnd)
-                  continue;
-
-                ns.set_active_edge(ed);
-                const std::vector<Element *> *neighbors = ns.get_neighbors();
+              Traverse::State* current_state = states[state_i];
 
-                neighbor_elems_counts[el][ed] = ns.get_num_neighbors();
-                neighbor_elems_arrays[el][ed] = new Element *[neighbor_elems_counts[el][ed]];
-                for (int neigh = 0; neigh < neighbor_elems_counts[el][ed]; neigh++)
-                  neighbor_elems_arrays[el][ed][neigh] = (*neighbors)[neigh];
+              // Obtain assembly lists for the element at all spaces.
+              for (unsigned int i = 0; i < spaces_size; i++)
+              {
+                if (current_state->e[i])
+                  spaces[i]->get_element_assembly_list(current_state->e[i], &(al[i]));
               }
-            }
 
-            // Pre-add into the stiffness matrix.
-            for (unsigned int m = 0; m < spaces_size; m++)
-            {
-              for (unsigned int el = 0; el < spaces_size; el++)
+              // Couplings with the neighbors across the inner edges.
+              if (is_DG)
               {
-                for (int ed = 0; ed < num_edges; ed++)
+                for (unsigned int el = 0; el < spaces_size; el++)
                 {
-                  if (current_state->e[el]->en[ed]->bnd)
+                  if (!current_state->e[el])
                     continue;
 
-                  for (int neigh = 0; neigh < neighbor_elems_counts[el][ed]; neigh++)
+                  NeighborSearch<Scalar> ns(current_state->e[el], spaces[el]->get_mesh());
+                  for (int ed = 0; ed < current_state->e[el]->nvert; ed++)
                   {
-                    if ((blocks[m][el] || blocks[el][m]) && current_state->e[m])
-                    {
-                      AsmList<Scalar>*am = &(al[m]);
-                      AsmList<Scalar>*an = new AsmList < Scalar > ;
-                      spaces[el]->get_element_assembly_list(neighbor_elems_arrays[el][ed][neigh], an);
+                    if (current_state->e[el]->en[ed]->bnd)
+                      continue;
 
-                      // pretend assembling of the element stiffness matrix
-                      // register nonzero elements
-                      for (unsigned int i = 0; i < am->cnt; i++)
+                    ns.set_active_edge(ed);
+                    const std::vector<Element *> *neighbors = ns.get_neighbors();
+                    for (int neigh = 0; neigh < ns.get_num_neighbors(); neigh++)
+                    {
+                      spaces[el]->get_element_assembly_list((*neighbors)[neigh], &an);
+                      for (unsigned int m = 0; m < spaces_size; m++)
                       {
-                        if (am->dof[i] >= 0)
-                        {
-                          for (unsigned int j = 0; j < an->cnt; j++)
-                          {
-                            if (an->dof[j] >= 0)
-                            {
-                              if (blocks[m][el]) mat->pre_add_ij(am->dof[i], an->dof[j]);
-                              if (blocks[el][m]) mat->pre_add_ij(an->dof[j], am->dof[i]);
-                            }
-                          }
-                        }
+                        if (!(blocks[m][el] || blocks[el][m]) || !current_state->e[m])
+                          continue;
+                        if (blocks[m][el])
+                          add_element_pairs(pairs, al[m], an);
+                        if (blocks[el][m])
+                          add_element_pairs(pairs, an, al[m]);
                       }
-                      delete an;
                     }
                   }
                 }
               }
-            }
 
-            // Deallocation an array of arrays of neighboring elements
-            // for every mesh x edge.
-            for (unsigned int el = 0; el < spaces_size; el++)
-            {
-              for (int ed = 0; ed < num_edges; ed++)
+              // Go through all equation-blocks of the local stiffness matrix.
+              for (unsigned int m = 0; m < spaces_size; m++)
               {
-                if (!current_state->e[el]->en[ed]->bnd)
-                  delete[] neighbor_elems_arrays[el][ed];
+                for (unsigned int n = 0; n < spaces_size; n++)
+                {
+                  if (blocks[m][n] && current_state->e[m] && current_state->e[n])
+                    add_element_pairs(pairs, al[m], al[n]);
+                }
               }
-              delete[] neighbor_elems_arrays[el];
             }
-            delete[] neighbor_elems_arrays;
 
-            // The same, only for number of elements.
-            for (unsigned int el = 0; el < spaces_size; el++)
-              delete[] neighbor_elems_counts[el];
-            delete[] neighbor_elems_counts;
-          }
+            delete[] al;
 
-          // Go through all equation-blocks of the local stiffness matrix.
-          if (spaces_size == 1)
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+          }
+          catch (Hermes::Exceptions::Exception& e)
           {
-            cnts_m = al[0].cnt;
-            dofs_m = al[0].dof;
-            if (blocks[0][0] && current_state->e[0])
-            {
-              for (unsigned int i = 0; i < cnts_m; i++)
-              {
-                if (dofs_m[i] >= 0)
-                {
-                  for (unsigned int j = 0; j < cnts_m; j++)
-                    if (dofs_m[j] >= 0)
-                      mat->pre_add_ij(dofs_m[i], dofs_m[j]);
-                }
-              }
-            }
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+            this->exceptionMessageCaughtInParallelBlock = e.info();
           }
-          else
+          catch (std::exception& e)
           {
-            for (unsigned int m = 0; m < spaces_size; m++)
-            {
-              cnts_m = al[m].cnt;
-              dofs_m = al[m].dof;
-              for (unsigned int n = 0; n < spaces_size; n++)
-              {
-                if (blocks[m][n] && current_state->e[m] && current_state->e[n])
-                {
-                  cnts_n = al[n].cnt;
-                  dofs_n = al[n].dof;
-
-                  // Pretend assembling of the element stiffness matrix.
-                  for (unsigned int i = 0; i < cnts_m; i++)
-                  {
-                    if (dofs_m[i] >= 0)
-                      for (unsigned int j = 0; j < cnts_n; j++)
-                        if (dofs_n[j] >= 0)
-                          mat->pre_add_ij(dofs_m[i], dofs_n[j]);
-                  }
-                }
-              }
-            }
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+            this->exceptionMessageCaughtInParallelBlock = e.what();
           }
         }
+
+        free_with_check(blocks, true);
+
+        if (!this->exceptionMessageCaughtInParallelBlock.empty())
+        {
+          std::string message = this->exceptionMessageCaughtInParallelBlock;
+          this->exceptionMessageCaughtInParallelBlock.clear();
+          matrix_structure_reusable = false;
+          throw Hermes::Exceptions::Exception(message.c_str());
+        }
+
+        for (int i = 0; i < this->num_threads_used; i++)
+        {
+          if (!thread_pairs[i].empty())
+            mat->pre_add_ij(&thread_pairs[i][0], thread_pairs[i].size());
+          std::vector<uint64_t>().swap(thread_pairs[i]);
+        }
         this->tick();
         this->info("\tDiscreteProblemSelectiveAssembler: Loop: %s.", this->last_str().c_str());
 
         this->tick();
 
-        free_with_check(al);
-        free_with_check(blocks, true);
         mat->alloc();
 
         this->tick();
@@ -244,6 +197,21 @@ namespace Hermes
       return true;
     }
 
+    template<typename Scalar>
+    void DiscreteProblemSelectiveAssembler<Scalar>::add_element_pairs(std::vector<uint64_t>& pairs, const AsmList<Scalar>& rows, const AsmList<Scalar>& cols)
+    {
+      for (unsigned int i = 0; i < rows.cnt; i++)
+      {
+        if (rows.dof[i] < 0)
+          continue;
+        for (unsigned int j = 0; j < cols.cnt; j++)
+        {
+          if (cols.dof[j] >= 0)
+            pairs.push_back(SparseMatrix<Scalar>::pack_ij(rows.dof[i], cols.dof[j]));
+        }
+      }
+    }
+
     template<typename Scalar>
     void DiscreteProblemSelectiveAssembler<Scalar>::set_spaces(std::vector<SpaceSharedPtr<Scalar> > spacesToSet)
     {
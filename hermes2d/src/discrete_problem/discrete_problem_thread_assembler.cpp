@@ -112,6 +112,9 @@ namespace Hermes
       // Basic settings.
       this->add_dirichlet_lift = add_dirichlet_lift_;
 
+      for (unsigned j = 0; j < this->spaces_size; j++)
+        this->snapshots[j] = spaces[j]->get_mesh()->get_snapshot();
+
       // Transformables setup.
       fns.clear();
       // - precalc shapesets.
@@ -347,7 +350,7 @@ namespace Hermes
         if (current_state->e[j])
         {
           spaces[j]->get_element_assembly_list(current_state->e[j], &als[j]);
-          refmaps[j]->set_active_element(current_state->e[j]);
+          refmaps[j]->set_active_element(current_state->e[j], this->snapshots[j]);
           refmaps[j]->force_transform(pss[j]->get_transform(), pss[j]->get_ctm());
           rep_refmap = refmaps[j];
         }
@@ -582,18 +585,30 @@ namespace Hermes
       if (this->rungeKutta)
         u_ext_local += form->u_ext_offset;
 
+      // The rows of the Dirichlet basis functions are read by the Dirichlet lift of the transposed block.
+      bool dirichlet_rows = tra && this->add_dirichlet_lift && this->current_rhs;
+
       // Actual form-specific calculation.
       for (unsigned int i = 0; i < current_als_i->cnt; i++)
       {
-        if (current_als_i->dof[i] < 0 || std::abs(current_als_i->coef[i]) < Hermes::HermesSqrtEpsilon)
-          continue;
+        bool dirichlet_row = current_als_i->dof[i] < 0;
+        if (dirichlet_row)
+        {
+          if (!dirichlet_rows)
+            continue;
+          std::fill(local_stiffness_matrix + i * H2D_MAX_LOCAL_BASIS_SIZE, local_stiffness_matrix + i * H2D_MAX_LOCAL_BASIS_SIZE + current_als_j->cnt, Scalar(0));
+        }
 
-        if ((!tra || surface_form) && current_als_i->dof[i] < 0)
+        if (std::abs(current_als_i->coef[i]) < Hermes::HermesSqrtEpsilon)
           continue;
 
         for (unsigned int j = 0; j < current_als_j->cnt; j++)
         {
-          if (current_als_j->dof[j] >= 0 && this->reusable_DOFs && *this->reusable_DOFs)
+          // A Dirichlet row only contributes to the lift of the free basis functions.
+          if (dirichlet_row && current_als_j->dof[j] < 0)
+            continue;
+
+          if (!dirichlet_row && current_als_j->dof[j] >= 0 && this->reusable_DOFs && *this->reusable_DOFs)
           {
             if ((*this->reusable_DOFs)[current_als_j->dof[j]] && (*this->reusable_DOFs)[current_als_i->dof[i]])
             {
@@ -618,7 +633,7 @@ namespace Hermes
             continue;
 
           // Skip anything that does not contribute to Dirichlet in the case of just rhs assembling.
-          if (current_als_j->dof[j] >= 0 && !this->current_mat)
+          if (current_als_j->dof[j] >= 0 && !this->current_mat && !dirichlet_row)
             continue;
 
           if (std::abs(current_als_j->coef[j]) < Hermes::HermesEpsilon)
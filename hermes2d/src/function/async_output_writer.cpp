@@ -0,0 +1,302 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "function/async_output_writer.h"
+#include "views/linearizer.h"
+#include "mesh/mesh_reader_h2d_xml.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    template<typename Scalar>
+    class SolutionSaveJob : public AsyncOutputWriter::Job
+    {
+    public:
+      SolutionSaveJob(MeshFunctionSharedPtr<Scalar> sln, const char* filename, bool bson) : sln(sln), filename(filename), bson(bson) {}
+
+      void run()
+      {
+        Solution<Scalar>* solution = static_cast<Solution<Scalar>*>(sln.get());
+#ifdef WITH_BSON
+        if (bson)
+        {
+          solution->save_bson(filename.c_str());
+          return;
+        }
+#endif
+        solution->save(filename.c_str());
+      }
+
+    protected:
+      MeshFunctionSharedPtr<Scalar> sln;
+      std::string filename;
+      bool bson;
+    };
+
+    /// Output formats of LinearizerSaveJob.
+    enum LinearizerSaveJobFormat
+    {
+      LinearizerSaveJobVTK,
+      LinearizerSaveJobVTU,
+      LinearizerSaveJobVTUCompressed,
+      LinearizerSaveJobTecplotBinary
+    };
+
+    class LinearizerSaveJob : public AsyncOutputWriter::Job
+    {
+    public:
+      LinearizerSaveJob(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, bool mode_3D, int item, LinearizerSaveJobFormat format) :
+        sln(sln), filename(filename), quantity_name(quantity_name), mode_3D(mode_3D), item(item), format(format) {}
+
+      void run()
+      {
+        Views::Linearizer linearizer(FileExport);
+        switch (format)
+        {
+        case LinearizerSaveJobVTK:
+          linearizer.save_solution_vtk(sln, filename.c_str(), quantity_name.c_str(), mode_3D, item);
+          break;
+        case LinearizerSaveJobVTU:
+        case LinearizerSaveJobVTUCompressed:
+          linearizer.save_solution_vtu(sln, filename.c_str(), quantity_name.c_str(), mode_3D, item, format == LinearizerSaveJobVTUCompressed);
+          break;
+        case LinearizerSaveJobTecplotBinary:
+          linearizer.save_solution_tecplot_binary(sln, filename.c_str(), quantity_name.c_str(), item);
+          break;
+        }
+      }
+
+    protected:
+      MeshFunctionSharedPtr<double> sln;
+      std::string filename;
+      std::string quantity_name;
+      bool mode_3D;
+      int item;
+      LinearizerSaveJobFormat format;
+    };
+
+    class MeshSaveJob : public AsyncOutputWriter::Job
+    {
+    public:
+      MeshSaveJob(MeshSharedPtr mesh, const char* filename) : mesh(mesh), filename(filename) {}
+
+      void run()
+      {
+        MeshReaderH2DXML mesh_writer;
+        mesh_writer.save(filename.c_str(), mesh);
+      }
+
+    protected:
+      MeshSharedPtr mesh;
+      std::string filename;
+    };
+
+    AsyncOutputWriter::AsyncOutputWriter(int thread_count, size_t max_pending_memory) :
+      max_pending_memory(max_pending_memory), pending_memory(0), running_count(0), finishing(false), last_mesh(nullptr), last_mesh_seq(0)
+    {
+      if (thread_count < 1)
+        throw Exceptions::ValueException("thread_count", thread_count, 1);
+
+      for (int i = 0; i < thread_count; i++)
+        this->threads.push_back(std::thread(&AsyncOutputWriter::process_jobs, this));
+    }
+
+    AsyncOutputWriter::~AsyncOutputWriter()
+    {
+      {
+        std::unique_lock<std::mutex> lock(this->jobs_mutex);
+        this->finishing = true;
+      }
+      this->job_enqueued.notify_all();
+      for (unsigned int i = 0; i < this->threads.size(); i++)
+        this->threads[i].join();
+
+      if (!this->error_message.empty())
+        this->warn("AsyncOutputWriter: output failed: %s", this->error_message.c_str());
+    }
+
+    template<typename Scalar>
+    void AsyncOutputWriter::save_solution(MeshFunctionSharedPtr<Scalar> sln, const char* filename)
+    {
+      size_t memory_size = 0;
+      MeshFunctionSharedPtr<Scalar> snapshot = this->snapshot_solution(sln, memory_size);
+      Job* job = new SolutionSaveJob<Scalar>(snapshot, filename, false);
+      job->memory_size = memory_size;
+      this->enqueue(job);
+    }
+
+#ifdef WITH_BSON
+    template<typename Scalar>
+    void AsyncOutputWriter::save_solution_bson(MeshFunctionSharedPtr<Scalar> sln, const char* filename)
+    {
+      size_t memory_size = 0;
+      MeshFunctionSharedPtr<Scalar> snapshot = this->snapshot_solution(sln, memory_size);
+      Job* job = new SolutionSaveJob<Scalar>(snapshot, filename, true);
+      job->memory_size = memory_size;
+      this->enqueue(job);
+    }
+#endif
+
+    void AsyncOutputWriter::save_solution_vtk(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, bool mode_3D, int item)
+    {
+      size_t memory_size = 0;
+      MeshFunctionSharedPtr<double> snapshot = this->snapshot_solution(sln, memory_size);
+      Job* job = new LinearizerSaveJob(snapshot, filename, quantity_name, mode_3D, item, LinearizerSaveJobVTK);
+      job->memory_size = memory_size;
+      this->enqueue(job);
+    }
+
+    void AsyncOutputWriter::save_solution_vtu(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, bool mode_3D, int item, bool compress)
+    {
+      size_t memory_size = 0;
+      MeshFunctionSharedPtr<double> snapshot = this->snapshot_solution(sln, memory_size);
+      Job* job = new LinearizerSaveJob(snapshot, filename, quantity_name, mode_3D, item, compress ? LinearizerSaveJobVTUCompressed : LinearizerSaveJobVTU);
+      job->memory_size = memory_size;
+      this->enqueue(job);
+    }
+
+    void AsyncOutputWriter::save_solution_tecplot_binary(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, int item)
+    {
+      size_t memory_size = 0;
+      MeshFunctionSharedPtr<double> snapshot = this->snapshot_solution(sln, memory_size);
+      Job* job = new LinearizerSaveJob(snapshot, filename, quantity_name, true, item, LinearizerSaveJobTecplotBinary);
+      job->memory_size = memory_size;
+      this->enqueue(job);
+    }
+
+    void AsyncOutputWriter::save_mesh(MeshSharedPtr mesh, const char* filename)
+    {
+      size_t memory_size = 0;
+      MeshSharedPtr snapshot = this->snapshot_mesh(mesh, memory_size);
+      Job* job = new MeshSaveJob(snapshot, filename);
+      job->memory_size = memory_size;
+      this->enqueue(job);
+    }
+
+    void AsyncOutputWriter::wait()
+    {
+      std::unique_lock<std::mutex> lock(this->jobs_mutex);
+      this->job_finished.wait(lock, [this] { return this->jobs.empty() && this->running_count == 0; });
+
+      if (!this->error_message.empty())
+      {
+        std::string message = this->error_message;
+        this->error_message.clear();
+        throw Exceptions::Exception("AsyncOutputWriter: output failed: %s", message.c_str());
+      }
+    }
+
+    int AsyncOutputWriter::get_pending_count()
+    {
+      std::unique_lock<std::mutex> lock(this->jobs_mutex);
+      return this->jobs.size() + this->running_count;
+    }
+
+    void AsyncOutputWriter::enqueue(Job* job)
+    {
+      {
+        std::unique_lock<std::mutex> lock(this->jobs_mutex);
+        // Back-pressure - a single job exceeding the limit is accepted when nothing else is pending.
+        this->job_finished.wait(lock, [this, job] { return this->pending_memory == 0 || this->pending_memory + job->memory_size <= this->max_pending_memory; });
+        this->pending_memory += job->memory_size;
+        this->jobs.push_back(job);
+      }
+      this->job_enqueued.notify_one();
+    }
+
+    void AsyncOutputWriter::process_jobs()
+    {
+      while (true)
+      {
+        Job* job;
+        {
+          std::unique_lock<std::mutex> lock(this->jobs_mutex);
+          this->job_enqueued.wait(lock, [this] { return this->finishing || !this->jobs.empty(); });
+          if (this->jobs.empty())
+            return;
+          job = this->jobs.front();
+          this->jobs.pop_front();
+          this->running_count++;
+        }
+
+        std::string job_error_message;
+        try
+        {
+          job->run();
+        }
+        catch (Hermes::Exceptions::Exception& e)
+        {
+          job_error_message = e.info();
+        }
+        catch (std::exception& e)
+        {
+          job_error_message = e.what();
+        }
+
+        size_t memory_size = job->memory_size;
+        delete job;
+
+        {
+          std::unique_lock<std::mutex> lock(this->jobs_mutex);
+          if (this->error_message.empty())
+            this->error_message = job_error_message;
+          this->pending_memory -= memory_size;
+          this->running_count--;
+        }
+        this->job_finished.notify_all();
+      }
+    }
+
+    template<typename Scalar>
+    MeshFunctionSharedPtr<Scalar> AsyncOutputWriter::snapshot_solution(MeshFunctionSharedPtr<Scalar> sln, size_t& memory_size)
+    {
+      Solution<Scalar>* solution = dynamic_cast<Solution<Scalar>*>(sln.get());
+      if (solution == nullptr)
+        throw Exceptions::Exception("AsyncOutputWriter can only write instances of Solution.");
+
+      // The coefficient arrays are copied, the mesh snapshot is shared among the jobs as long as the mesh does not change.
+      Solution<Scalar>* snapshot = new Solution<Scalar>();
+      snapshot->copy(solution);
+      snapshot->mesh = this->snapshot_mesh(solution->get_mesh(), memory_size);
+
+      memory_size += solution->num_coeffs * sizeof(Scalar) + solution->num_elems * (solution->num_components + 1) * sizeof(int);
+
+      return MeshFunctionSharedPtr<Scalar>(snapshot);
+    }
+
+    MeshSharedPtr AsyncOutputWriter::snapshot_mesh(MeshSharedPtr mesh, size_t& memory_size)
+    {
+      if (this->last_mesh != mesh.get() || this->last_mesh_seq != mesh->get_seq() || !this->last_mesh_snapshot)
+      {
+        this->last_mesh_snapshot = MeshSharedPtr(new Mesh);
+        this->last_mesh_snapshot->copy(mesh);
+        this->last_mesh = mesh.get();
+        this->last_mesh_seq = mesh->get_seq();
+
+        memory_size += mesh->get_max_element_id() * sizeof(Element) + mesh->get_max_node_id() * sizeof(Node);
+      }
+
+      return this->last_mesh_snapshot;
+    }
+
+    template HERMES_API void AsyncOutputWriter::save_solution<double>(MeshFunctionSharedPtr<double> sln, const char* filename);
+    template HERMES_API void AsyncOutputWriter::save_solution<std::complex<double> >(MeshFunctionSharedPtr<std::complex<double> > sln, const char* filename);
+#ifdef WITH_BSON
+    template HERMES_API void AsyncOutputWriter::save_solution_bson<double>(MeshFunctionSharedPtr<double> sln, const char* filename);
+    template HERMES_API void AsyncOutputWriter::save_solution_bson<std::complex<double> >(MeshFunctionSharedPtr<std::complex<double> > sln, const char* filename);
+#endif
+  }
+}
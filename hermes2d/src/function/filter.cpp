@@ -232,28 +232,92 @@ namespace Hermes
       Quad2D* quad = this->quads[this->cur_quad];
       unsigned char np = quad->get_num_points(order, this->element->get_mode());
 
-      // precalculate all solutions
-      for (int i = 0; i < this->solutions.size(); i++)
-        this->solutions[i]->set_quad_order(order, this->items[i]);
-
+      // precalculate all sources of the tree, each one only once
+      this->fused_sources.clear();
+      this->fused_masks.clear();
+      this->collect_fused_sources(this->fused_sources, this->fused_masks);
+      for (unsigned int i = 0; i < this->fused_sources.size(); i++)
+        this->fused_sources[i]->set_quad_order(order, this->fused_masks[i]);
+
+      // apply the filter tree
       for (int j = 0; j < this->num_components; j++)
+        this->evaluate_fused(np, j, this->values[j][0]);
+
+      this->values_valid = true;
+    }
+
+    template<typename Scalar>
+    bool SimpleFilter<Scalar>::is_fusable() const
+    {
+      return true;
+    }
+
+    template<typename Scalar>
+    SimpleFilter<Scalar>* SimpleFilter<Scalar>::get_fused_source(int i) const
+    {
+      // the source has to share the element and the transformations with this filter
+      if (this->unimesh || this->items[i] != H2D_FN_VAL_0)
+        return nullptr;
+
+      SimpleFilter<Scalar>* source = dynamic_cast<SimpleFilter<Scalar>*>(this->solutions[i].get());
+      if (source == nullptr || source->unimesh || source->num_components != 1 || !source->is_fusable())
+        return nullptr;
+
+      return source;
+    }
+
+    template<typename Scalar>
+    void SimpleFilter<Scalar>::collect_fused_sources(std::vector<MeshFunction<Scalar>*>& sources, std::vector<int>& masks) const
+    {
+      for (unsigned int i = 0; i < this->solutions.size(); i++)
       {
-        // obtain corresponding tables
-        std::vector<const Scalar*> tab;
-        for (int i = 0; i < this->solutions.size(); i++)
+        SimpleFilter<Scalar>* fused_source = this->get_fused_source(i);
+        if (fused_source)
         {
-          int a = 0, b = 0, mask = this->items[i];
-          if (mask >= 0x40) { a = 1; mask >>= 6; }
-          while (!(mask & 1)) { mask >>= 1; b++; }
-          tab.push_back(const_cast<Scalar*>(this->solutions[i]->get_values(this->num_components == 1 ? a : j, b)));
-          if (tab[i] == nullptr)
-            throw Hermes::Exceptions::Exception("Value of 'item%d' is incorrect in filter definition.", i + 1);
+          fused_source->collect_fused_sources(sources, masks);
+          continue;
         }
 
-        // apply the filter
-        filter_fn(np, tab, this->values[j][0]);
+        MeshFunction<Scalar>* source = this->solutions[i].get();
+        size_t k = std::find(sources.begin(), sources.end(), source) - sources.begin();
+        if (k == sources.size())
+        {
+          sources.push_back(source);
+          masks.push_back(this->items[i]);
+        }
+        else
+          masks[k] |= this->items[i];
       }
-      this->values_valid = true;
+    }
+
+    template<typename Scalar>
+    void SimpleFilter<Scalar>::evaluate_fused(int np, int component, Scalar* result)
+    {
+      // obtain corresponding tables, evaluate the fused sources into the buffers of this filter
+      this->fused_tables.clear();
+      for (unsigned int i = 0; i < this->solutions.size(); i++)
+      {
+        SimpleFilter<Scalar>* fused_source = this->get_fused_source(i);
+        if (fused_source)
+        {
+          if (this->fused_values.size() < this->solutions.size() * H2D_MAX_INTEGRATION_POINTS_COUNT)
+            this->fused_values.resize(this->solutions.size() * H2D_MAX_INTEGRATION_POINTS_COUNT);
+          Scalar* fused_result = &this->fused_values[i * H2D_MAX_INTEGRATION_POINTS_COUNT];
+          fused_source->evaluate_fused(np, 0, fused_result);
+          this->fused_tables.push_back(fused_result);
+          continue;
+        }
+
+        int a = 0, b = 0, mask = this->items[i];
+        if (mask >= 0x40) { a = 1; mask >>= 6; }
+        while (!(mask & 1)) { mask >>= 1; b++; }
+        this->fused_tables.push_back(this->solutions[i]->get_values(this->num_components == 1 ? a : component, b));
+        if (this->fused_tables[i] == nullptr)
+          throw Hermes::Exceptions::Exception("Value of 'item%d' is incorrect in filter definition.", i + 1);
+      }
+
+      // apply the filter
+      filter_fn(np, this->fused_tables, result);
     }
 
     template<typename Scalar>
@@ -120,6 +120,22 @@ namespace Hermes
         }
       }
 
+      const double VertexBasedLimiter::evaluation_points[H2D_NUM_MODES][VertexBasedLimiter::EvaluationPointCount][2] =
+      {
+        // Triangles - centroid, edge midpoints, vertices.
+        {
+          { CENTROID_TRI_X, CENTROID_TRI_Y },
+          { 0., -1. }, { 0., 0. }, { -1., 0. }, { 0., 0. },
+          { -1., -1. }, { 1., -1. }, { -1., 1. }, { 0., 0. }
+        },
+        // Quads - centroid, edge midpoints, vertices.
+        {
+          { CENTROID_QUAD_X, CENTROID_QUAD_Y },
+          { 0., -1. }, { 1., 0. }, { 0., 1. }, { -1., 0. },
+          { -1., -1. }, { 1., -1. }, { 1., 1. }, { -1., 1. }
+        }
+      };
+
       VertexBasedLimiter::VertexBasedLimiter(SpaceSharedPtr<double> space, double* solution_vector, int maximum_polynomial_order)
         : Limiter<double>(space, solution_vector)
       {
@@ -149,18 +165,45 @@ namespace Hermes
             throw Exceptions::Exception("VertexBasedLimiter designed for L2ShapesetTaylor. Ignore this exception for unforeseen problems.");
         }
 
-        vertex_min_values = nullptr;
-        vertex_max_values = nullptr;
-
         // This is what is the key aspect of the necessity to use L2ShapesetTaylor (or any other one that uses P_{} also for quads).
         this->mixed_derivatives_count = (maximum_polynomial_order)*(maximum_polynomial_order + 1) / 2;
 
         this->print_details = false;
+
+        this->init_evaluation_matrices();
+      }
+
+      void VertexBasedLimiter::init_evaluation_matrices()
+      {
+        this->evaluation_matrix_size = (this->maximum_polynomial_order + 1) * (this->maximum_polynomial_order + 1);
+        this->evaluation_matrices.resize(H2D_NUM_MODES * (this->maximum_polynomial_order + 1) * EvaluationPointCount * this->evaluation_matrix_size);
+
+        for (int mode = 0; mode < H2D_NUM_MODES; mode++)
+        {
+          for (int order = 0; order <= this->maximum_polynomial_order; order++)
+          {
+            for (int point = 0; point < EvaluationPointCount; point++)
+            {
+              double xi1 = evaluation_points[mode][point][0];
+              double xi2 = evaluation_points[mode][point][1];
+              double* matrix = &this->evaluation_matrices[((mode * (this->maximum_polynomial_order + 1) + order) * EvaluationPointCount + point) * this->evaluation_matrix_size];
+
+              // Solution::get_ref_value() evaluates the rows (powers of xi2, starting from the highest one)
+              // by the Horner's scheme in xi1.
+              int k = 0;
+              for (int i = 0; i <= order; i++)
+              {
+                int row_length = mode ? order : i;
+                for (int j = 0; j <= row_length; j++)
+                  matrix[k++] = std::pow(xi1, row_length - j) * std::pow(xi2, order - i);
+              }
+            }
+          }
+        }
       }
 
       VertexBasedLimiter::~VertexBasedLimiter()
       {
-        deallocate_vertex_values();
       }
 
       void VertexBasedLimiter::print_detailed_info(bool print_details_)
@@ -176,270 +219,237 @@ namespace Hermes
       void VertexBasedLimiter::process()
       {
         // 0. Preparation.
-        // Start by creating temporary solutions and states for paralelism.
         Solution<double>::vector_to_solutions(this->solution_vector, this->spaces, this->limited_solutions);
+        this->prepare_elements();
+
+        // Per element, if there was limiting of the second derivatives.
+        std::vector<std::vector<char> > quadratic_correction_done(this->component_count);
 
         // 1. Quadratic
         // Prepare the vertex values for the quadratic part.
-        prepare_min_max_vertex_values(true);
+        this->calculate_element_values(true);
+        this->prepare_min_max_vertex_values(true);
 
         // Use those to incorporate the correction factor.
-        Element* e;
-
-        // Vector to remember if there was limiting of the second derivatives.
-        std::vector<bool> quadratic_correction_done;
-
         if (this->get_verbose_output())
           std::cout << "Quadratic correction" << std::endl;
-
-        for (int component = 0; component < this->component_count; component++)
-        {
-          MeshSharedPtr mesh = this->spaces[component]->get_mesh();
-          if (this->get_verbose_output() && this->component_count > 1)
-            std::cout << "Component: " << component << std::endl;
-          for_all_active_elements(e, mesh)
-          {
-            bool second_order = H2D_GET_H_ORDER(this->spaces[component]->get_element_order(e->id)) >= 2 || H2D_GET_V_ORDER(this->spaces[component]->get_element_order(e->id)) >= 2;
-            if (!second_order)
-            {
-              quadratic_correction_done.push_back(false);
-              continue;
-            }
-
-            if (this->get_verbose_output())
-              std::cout << "Element: " << e->id << std::endl;
-
-            quadratic_correction_done.push_back(this->impose_quadratic_correction_factor(e, component));
-
-            if (this->get_verbose_output())
-              std::cout << std::endl;
-          }
-        }
+        this->impose_correction_factors(true, quadratic_correction_done);
 
         // Adjust the solutions according to the quadratic terms handling.
         Solution<double>::vector_to_solutions(this->solution_vector, this->spaces, this->limited_solutions);
 
         // 2. Linear
         // Prepare the vertex values for the linear part.
-        prepare_min_max_vertex_values(false);
+        this->calculate_element_values(false);
+        this->prepare_min_max_vertex_values(false);
 
         if (this->get_verbose_output())
           std::cout << "Linear correction" << std::endl;
-
-        int running_i = 0;
-        for (int component = 0; component < this->component_count; component++)
-        {
-          MeshSharedPtr mesh = this->spaces[component]->get_mesh();
-          if (this->get_verbose_output() && this->component_count > 1)
-            std::cout << "Component: " << component << std::endl;
-          for_all_active_elements(e, mesh)
-          {
-            if (this->get_verbose_output())
-              std::cout << "Element: " << e->id << std::endl;
-
-            bool second_order = H2D_GET_H_ORDER(this->spaces[component]->get_element_order(e->id)) >= 2 || H2D_GET_V_ORDER(this->spaces[component]->get_element_order(e->id)) >= 2;
-            if (quadratic_correction_done[running_i++] || !second_order)
-              this->impose_linear_correction_factor(e, component);
-
-            if (this->get_verbose_output())
-              std::cout << std::endl;
-          }
-        }
+        this->impose_correction_factors(false, quadratic_correction_done);
 
         // Create the final solutions.
         Solution<double>::vector_to_solutions(this->solution_vector, this->spaces, this->limited_solutions);
       }
 
-      void VertexBasedLimiter::impose_linear_correction_factor(Element* e, int component)
+      void VertexBasedLimiter::prepare_elements()
       {
-        double correction_factor = std::numeric_limits<double>::infinity();
-
-        double centroid_value_multiplied = this->get_centroid_value_multiplied(e, component, 0);
-        if (this->get_verbose_output())
-          std::cout << std::endl << "center-value: " << centroid_value_multiplied << " (" << 0 << ") ";
-
-        Solution<double>* sln = dynamic_cast<Solution<double>*>(this->limited_solutions[component].get());
+        this->limited_components.resize(this->component_count);
 
-        for (int i_vertex = 0; i_vertex < e->get_nvert(); i_vertex++)
+        for (int component = 0; component < this->component_count; component++)
         {
-          if (this->get_verbose_output())
-            std::cout << std::endl << "vertex: " << i_vertex;
-
-          Node* vertex = e->vn[i_vertex];
-          double x, y;
-          RefMap::untransform(e, vertex->x, vertex->y, x, y);
+          LimitedComponent& data = this->limited_components[component];
+          MeshSharedPtr mesh = this->spaces[component]->get_mesh();
+          int vertex_count = mesh->get_max_node_id();
 
-          double vertex_value = sln->get_ref_value_transformed(e, x, y, 0, 0);
+          data.elements.clear();
+          Element* e;
+          for_all_active_elements(e, mesh)
+            data.elements.push_back(e);
+          int element_count = data.elements.size();
 
-          if (this->get_verbose_output())
-            std::cout << "\tvalue: " << vertex_value;
+          data.element_values.resize(element_count * EvaluationPointCount * this->mixed_derivatives_count);
+          data.vertex_min_values.assign(vertex_count * this->mixed_derivatives_count, std::numeric_limits<double>::infinity());
+          data.vertex_max_values.assign(vertex_count * this->mixed_derivatives_count, -std::numeric_limits<double>::infinity());
 
-          double fraction;
-          if (std::abs(vertex_value - centroid_value_multiplied) < Hermes::HermesSqrtEpsilon)
+          // The centroid bounds all the element vertices, the midpoint of a boundary edge (optionally) both its vertices.
+          // Two passes - counting and filling.
+          data.vertex_contribution_starts.assign(vertex_count + 1, 0);
+          for (int pass = 0; pass < 2; pass++)
           {
-            fraction = 1.;
-            if (this->get_verbose_output())
-              std::cout << "\tcenter_value";
-          }
-          else
-            if (vertex_value > centroid_value_multiplied)
+            std::vector<int> positions;
+            if (pass == 1)
             {
-            fraction = std::min(1., (this->vertex_max_values[component][vertex->id][0] - centroid_value_multiplied) / (vertex_value - centroid_value_multiplied));
-            if (this->get_verbose_output())
-              std::cout << "\tmax_value: " << this->vertex_max_values[component][vertex->id][0];
+              for (int vertex_i = 0; vertex_i < vertex_count; vertex_i++)
+                data.vertex_contribution_starts[vertex_i + 1] += data.vertex_contribution_starts[vertex_i];
+              data.vertex_contributions.resize(data.vertex_contribution_starts[vertex_count]);
+              positions.assign(data.vertex_contribution_starts.begin(), data.vertex_contribution_starts.end() - 1);
             }
-            else
-            {
-              fraction = std::min(1., (this->vertex_min_values[component][vertex->id][0] - centroid_value_multiplied) / (vertex_value - centroid_value_multiplied));
-              if (this->get_verbose_output())
-                std::cout << "\tmin_value: " << this->vertex_min_values[component][vertex->id][0];
-            }
-
-          correction_factor = std::min(correction_factor, fraction);
-        }
-        if (this->get_verbose_output())
-          std::cout << std::endl << "correction_factor " << correction_factor << std::endl;
 
-        if (correction_factor < (1 - 1e-3))
-        {
-          AsmList<double> al;
-          this->spaces[component]->get_element_assembly_list(e, &al);
-
-          for (int i_basis_fn = 0; i_basis_fn < al.cnt; i_basis_fn++)
-          {
-            int order = this->spaces[component]->get_shapeset()->get_order(al.idx[i_basis_fn], e->get_mode());
-            if (H2D_GET_H_ORDER(order) == 1 || H2D_GET_V_ORDER(order) == 1)
+            for (int element_i = 0; element_i < element_count; element_i++)
             {
-              if (this->p_coarsening_only)
-                this->solution_vector[al.dof[i_basis_fn]] = 0.;
-              else
-                this->solution_vector[al.dof[i_basis_fn]] *= correction_factor;
+              e = data.elements[element_i];
+              for (int i_vertex = 0; i_vertex < e->get_nvert(); i_vertex++)
+              {
+                int vertex_ids[3] = { e->vn[i_vertex]->id, e->vn[i_vertex]->id, e->vn[e->next_vert(i_vertex)]->id };
+                int points[3] = { EvaluationPointCentroid, EvaluationPointEdgeMidpoint + i_vertex, EvaluationPointEdgeMidpoint + i_vertex };
+                int contribution_count = (e->en[i_vertex]->bnd && this->wider_bounds_on_boundary) ? 3 : 1;
+                for (int i = 0; i < contribution_count; i++)
+                {
+                  if (pass == 0)
+                    data.vertex_contribution_starts[vertex_ids[i] + 1]++;
+                  else
+                    data.vertex_contributions[positions[vertex_ids[i]]++] = element_i * EvaluationPointCount + points[i];
+                }
+              }
             }
           }
-
-          this->changed_element_ids.push_back(e->id);
-          this->correction_factors.push_back(std::pair<int, double>(1, correction_factor));
         }
       }
 
-      bool VertexBasedLimiter::impose_quadratic_correction_factor(Element* e, int component)
+      void VertexBasedLimiter::calculate_element_values(bool quadratic)
       {
-        if (this->get_verbose_output())
-          std::cout << "quadratic: ";
-
-        double correction_factor = std::numeric_limits<double>::infinity();
+        int derivative_from = quadratic ? 1 : 0;
+        int derivative_to = quadratic ? this->mixed_derivatives_count : 1;
+        // Only the first derivatives are limited in the vertices.
+        int vertex_derivative_to = quadratic ? std::min(3, this->mixed_derivatives_count) : 1;
 
-        Solution<double>* sln = dynamic_cast<Solution<double>*>(this->limited_solutions[component].get());
-
-        for (int i_derivative = 1; i_derivative <= 2; i_derivative++)
+        for (int component = 0; component < this->component_count; component++)
         {
-          double centroid_value_multiplied = this->get_centroid_value_multiplied(e, component, i_derivative);
-          if (this->get_verbose_output())
-            std::cout << std::endl << "center-value: " << centroid_value_multiplied << " (" << i_derivative << ") ";
+          LimitedComponent& data = this->limited_components[component];
+          int element_count = data.elements.size();
 
-          for (int i_vertex = 0; i_vertex < e->get_nvert(); i_vertex++)
+#pragma omp parallel num_threads(this->num_threads_used)
           {
-            if (this->get_verbose_output())
-              std::cout << std::endl << "vertex: " << i_vertex;
+            int thread_number = omp_get_thread_num();
+            int start = (element_count / this->num_threads_used) * thread_number;
+            int end = (element_count / this->num_threads_used) * (thread_number + 1);
+            if (thread_number == this->num_threads_used - 1)
+              end = element_count;
+
+            Solution<double>* sln = nullptr;
+            try
+            {
+              // Each thread evaluates its own copy.
+              sln = static_cast<Solution<double>*>(this->limited_solutions[component]->clone());
 
-            Node* vertex = e->vn[i_vertex];
-            double x, y;
-            RefMap::untransform(e, vertex->x, vertex->y, x, y);
+              for (int element_i = start; element_i < end; element_i++)
+              {
+                Element* e = data.elements[element_i];
+                double* values = &data.element_values[element_i * EvaluationPointCount * this->mixed_derivatives_count];
 
-            double vertex_value = sln->get_ref_value_transformed(e, x, y, 0, i_derivative);
+                sln->set_active_element(e);
 
-            if (this->get_verbose_output())
-              std::cout << "\tvalue: " << vertex_value;
+                this->get_point_values(sln, e, EvaluationPointCentroid, derivative_from, derivative_to, values + EvaluationPointCentroid * this->mixed_derivatives_count);
 
-            double fraction;
-            if (std::abs(vertex_value - centroid_value_multiplied) < Hermes::HermesSqrtEpsilon)
-            {
-              if (this->get_verbose_output())
-                std::cout << "\tcenter_value";
+                for (int i_vertex = 0; i_vertex < e->get_nvert(); i_vertex++)
+                {
+                  this->get_point_values(sln, e, EvaluationPointVertex + i_vertex, derivative_from, vertex_derivative_to, values + (EvaluationPointVertex + i_vertex) * this->mixed_derivatives_count);
 
-              fraction = 1.;
-            }
-            else
-              if (vertex_value > centroid_value_multiplied)
-              {
-              fraction = std::min(1., (this->vertex_max_values[component][vertex->id][i_derivative] - centroid_value_multiplied) / (vertex_value - centroid_value_multiplied));
-              if (this->get_verbose_output())
-                std::cout << "\tmax_value: " << this->vertex_max_values[component][vertex->id][i_derivative];
-              }
-              else
-              {
-                fraction = std::min(1., (this->vertex_min_values[component][vertex->id][i_derivative] - centroid_value_multiplied) / (vertex_value - centroid_value_multiplied));
-                if (this->get_verbose_output())
-                  std::cout << "\tmin_value: " << this->vertex_min_values[component][vertex->id][i_derivative];
+                  if (e->en[i_vertex]->bnd && this->wider_bounds_on_boundary)
+                    this->get_point_values(sln, e, EvaluationPointEdgeMidpoint + i_vertex, derivative_from, derivative_to, values + (EvaluationPointEdgeMidpoint + i_vertex) * this->mixed_derivatives_count);
+                }
               }
+            }
+            catch (Hermes::Exceptions::Exception& e)
+            {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+              this->exceptionMessageCaughtInParallelBlock = e.info();
+            }
+            catch (std::exception& e)
+            {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+              this->exceptionMessageCaughtInParallelBlock = e.what();
+            }
 
-            correction_factor = std::min(correction_factor, fraction);
+            delete sln;
           }
+
+          if (!this->exceptionMessageCaughtInParallelBlock.empty())
+            throw Hermes::Exceptions::Exception(this->exceptionMessageCaughtInParallelBlock.c_str());
+        }
+      }
+
+      void VertexBasedLimiter::get_point_values(Solution<double>* sln, Element* e, int point, int derivative_from, int derivative_to, double* values) const
+      {
+        int mode = e->get_mode();
+        double xi1 = evaluation_points[mode][point][0];
+        double xi2 = evaluation_points[mode][point][1];
+        int order = sln->elem_orders[e->id];
+
+        // Orders not covered by the evaluation matrices.
+        if (order > this->maximum_polynomial_order)
+        {
+          for (int derivative = derivative_from; derivative < derivative_to; derivative++)
+            values[derivative] = sln->get_ref_value_transformed(e, xi1, xi2, 0, derivative);
+          return;
         }
 
-        if (this->get_verbose_output())
-          std::cout << std::endl << "correction_factor " << correction_factor << std::endl;
+        const double* matrix = &this->evaluation_matrices[((mode * (this->maximum_polynomial_order + 1) + order) * EvaluationPointCount + point) * this->evaluation_matrix_size];
+        int n = mode ? sqr(order + 1) : (order + 1) * (order + 2) / 2;
 
-        if (correction_factor < (1 - 1e-3))
+        if (derivative_from == 0 && derivative_to > 0)
         {
-          AsmList<double> al;
-          this->spaces[component]->get_element_assembly_list(e, &al);
+          const double* mono = sln->dxdy_coeffs[0][0];
+          double value = 0.;
+          for (int k = 0; k < n; k++)
+            value += mono[k] * matrix[k];
+          values[0] = value;
+        }
 
-          for (int i_basis_fn = 0; i_basis_fn < al.cnt; i_basis_fn++)
+        if (derivative_from <= 2 && derivative_to > 1)
+        {
+          const double* mono_dx = sln->dxdy_coeffs[0][1];
+          const double* mono_dy = sln->dxdy_coeffs[0][2];
+          double dx = 0., dy = 0.;
+          for (int k = 0; k < n; k++)
           {
-            int order = this->spaces[component]->get_shapeset()->get_order(al.idx[i_basis_fn], e->get_mode());
-            if (H2D_GET_H_ORDER(order) == 2 || H2D_GET_V_ORDER(order) == 2)
-            {
-              if (this->p_coarsening_only)
-                this->solution_vector[al.dof[i_basis_fn]] = 0.;
-              else
-                this->solution_vector[al.dof[i_basis_fn]] *= correction_factor;
-            }
+            dx += mono_dx[k] * matrix[k];
+            dy += mono_dy[k] * matrix[k];
           }
 
-          this->changed_element_ids.push_back(e->id);
-          this->correction_factors.push_back(std::pair<int, double>(2, correction_factor));
-          return true;
+          double2x2 m;
+          double xx, yy;
+          sln->get_refmap()->inv_ref_map_at_point(xi1, xi2, xx, yy, m);
+          if (derivative_from <= 1)
+            values[1] = m[0][0] * dx + m[0][1] * dy;
+          if (derivative_to > 2)
+            values[2] = m[1][0] * dx + m[1][1] * dy;
         }
-        else
-          return false;
+
+        for (int derivative = std::max(derivative_from, 3); derivative < derivative_to; derivative++)
+          values[derivative] = sln->get_ref_value_transformed(e, xi1, xi2, 0, derivative);
       }
 
       void VertexBasedLimiter::prepare_min_max_vertex_values(bool quadratic)
       {
-        // Reallocate if calculating quadratic part (first of the two).
-        if (quadratic)
-        {
-          deallocate_vertex_values();
-          allocate_vertex_values();
-        }
+        int derivative_from = quadratic ? 1 : 0;
+        int derivative_to = quadratic ? this->mixed_derivatives_count : 1;
 
-        // Calculate min/max vertex values.
-        Element* e;
+        // Calculate min/max vertex values - each vertex gathers the values bounding it.
         for (int component = 0; component < this->component_count; component++)
         {
-          MeshSharedPtr mesh = this->spaces[component]->get_mesh();
+          LimitedComponent& data = this->limited_components[component];
+          int vertex_count = data.vertex_contribution_starts.size() - 1;
 
-          for_all_active_elements(e, mesh)
+#pragma omp parallel num_threads(this->num_threads_used)
           {
-            for (int i_vertex = 0; i_vertex < e->get_nvert(); i_vertex++)
+            int thread_number = omp_get_thread_num();
+            int start = (vertex_count / this->num_threads_used) * thread_number;
+            int end = (vertex_count / this->num_threads_used) * (thread_number + 1);
+            if (thread_number == this->num_threads_used - 1)
+              end = vertex_count;
+
+            for (int vertex_i = start; vertex_i < end; vertex_i++)
             {
-              Node* vertex = e->vn[i_vertex];
-              for (int i_derivative = (quadratic ? 1 : 0); i_derivative < (quadratic ? this->mixed_derivatives_count : 1); i_derivative++)
+              for (int contribution_i = data.vertex_contribution_starts[vertex_i]; contribution_i < data.vertex_contribution_starts[vertex_i + 1]; contribution_i++)
               {
-                double element_centroid_value_multiplied = this->get_centroid_value_multiplied(e, component, i_derivative);
-                this->vertex_min_values[component][vertex->id][i_derivative] = std::min(this->vertex_min_values[component][vertex->id][i_derivative], element_centroid_value_multiplied);
-                this->vertex_max_values[component][vertex->id][i_derivative] = std::max(this->vertex_max_values[component][vertex->id][i_derivative], element_centroid_value_multiplied);
-                if (e->en[i_vertex]->bnd && this->wider_bounds_on_boundary)
+                const double* values = &data.element_values[data.vertex_contributions[contribution_i] * this->mixed_derivatives_count];
+                for (int i_derivative = derivative_from; i_derivative < derivative_to; i_derivative++)
                 {
-                  double element_mid_edge_value_multiplied = this->get_edge_midpoint_value_multiplied(e, component, i_derivative, i_vertex);
-
-                  this->vertex_min_values[component][vertex->id][i_derivative] = std::min(this->vertex_min_values[component][vertex->id][i_derivative], element_mid_edge_value_multiplied);
-                  this->vertex_max_values[component][vertex->id][i_derivative] = std::max(this->vertex_max_values[component][vertex->id][i_derivative], element_mid_edge_value_multiplied);
-
-                  Node* next_vertex = e->vn[(i_vertex + 1) % e->get_nvert()];
-                  this->vertex_min_values[component][next_vertex->id][i_derivative] = std::min(this->vertex_min_values[component][next_vertex->id][i_derivative], element_mid_edge_value_multiplied);
-                  this->vertex_max_values[component][next_vertex->id][i_derivative] = std::max(this->vertex_max_values[component][next_vertex->id][i_derivative], element_mid_edge_value_multiplied);
+                  double& min_value = data.vertex_min_values[vertex_i * this->mixed_derivatives_count + i_derivative];
+                  double& max_value = data.vertex_max_values[vertex_i * this->mixed_derivatives_count + i_derivative];
+                  min_value = std::min(min_value, values[i_derivative]);
+                  max_value = std::max(max_value, values[i_derivative]);
                 }
               }
             }
@@ -447,132 +457,134 @@ namespace Hermes
         }
       }
 
-      double VertexBasedLimiter::get_centroid_value_multiplied(Element* e, int component, int mixed_derivative_index)
+      double VertexBasedLimiter::get_correction_factor(int component, int element_i, int derivative_from, int derivative_to) const
       {
-        if (mixed_derivative_index > 5)
-        {
-          throw Exceptions::MethodNotImplementedException("VertexBasedLimiter::get_centroid_value_multiplied only works for first and second derivatives.");
-          return 0.;
-        }
+        const LimitedComponent& data = this->limited_components[component];
+        Element* e = data.elements[element_i];
+        const double* values = &data.element_values[element_i * EvaluationPointCount * this->mixed_derivatives_count];
 
-        Solution<double>* sln = dynamic_cast<Solution<double>*>(this->limited_solutions[component].get());
-        double result;
-        if (e->get_mode() == HERMES_MODE_TRIANGLE)
-          result = sln->get_ref_value_transformed(e, CENTROID_TRI_X, CENTROID_TRI_Y, 0, mixed_derivative_index);
-        else
-          result = sln->get_ref_value_transformed(e, CENTROID_QUAD_X, CENTROID_QUAD_Y, 0, mixed_derivative_index);
-
-        return result;
-      }
-
-      double VertexBasedLimiter::get_edge_midpoint_value_multiplied(Element* e, int component, int mixed_derivative_index, int edge)
-      {
-        if (mixed_derivative_index > 5)
+        double correction_factor = std::numeric_limits<double>::infinity();
+        for (int i_derivative = derivative_from; i_derivative <= derivative_to; i_derivative++)
         {
-          throw Exceptions::MethodNotImplementedException("VertexBasedLimiter::get_centroid_value_multiplied only works for first and second derivatives.");
-          return 0.;
-        }
+          double centroid_value_multiplied = values[EvaluationPointCentroid * this->mixed_derivatives_count + i_derivative];
 
-        Solution<double>* sln = dynamic_cast<Solution<double>*>(this->limited_solutions[component].get());
-        double result;
+          for (int i_vertex = 0; i_vertex < e->get_nvert(); i_vertex++)
+          {
+            int vertex_id = e->vn[i_vertex]->id;
+            double vertex_value = values[(EvaluationPointVertex + i_vertex) * this->mixed_derivatives_count + i_derivative];
 
-        double x;
-        double y;
+            double fraction;
+            if (std::abs(vertex_value - centroid_value_multiplied) < Hermes::HermesSqrtEpsilon)
+              fraction = 1.;
+            else
+              if (vertex_value > centroid_value_multiplied)
+                fraction = std::min(1., (data.vertex_max_values[vertex_id * this->mixed_derivatives_count + i_derivative] - centroid_value_multiplied) / (vertex_value - centroid_value_multiplied));
+              else
+                fraction = std::min(1., (data.vertex_min_values[vertex_id * this->mixed_derivatives_count + i_derivative] - centroid_value_multiplied) / (vertex_value - centroid_value_multiplied));
 
-        if (e->get_mode() == HERMES_MODE_TRIANGLE)
-        {
-          if (edge == 0)
-          {
-            x = 0.;
-            y = -1;
-          }
-          else if (edge == 1)
-          {
-            x = 0;
-            y = 0;
-          }
-          else if (edge == 2)
-          {
-            x = -1.;
-            y = 0;
-          }
-          result = sln->get_ref_value_transformed(e, x, y, 0, mixed_derivative_index);
-        }
-        else
-        {
-          if (edge == 0)
-          {
-            x = 0.;
-            y = -1;
-          }
-          else if (edge == 1)
-          {
-            x = 1;
-            y = 0;
-          }
-          else if (edge == 2)
-          {
-            x = 0.;
-            y = 1.;
-          }
-          else if (edge == 3)
-          {
-            x = -1.;
-            y = 0.;
+            correction_factor = std::min(correction_factor, fraction);
           }
-          result = sln->get_ref_value_transformed(e, x, y, 0, mixed_derivative_index);
         }
 
-        return result;
+        return correction_factor;
       }
 
-      void VertexBasedLimiter::allocate_vertex_values()
+      void VertexBasedLimiter::impose_correction_factors(bool quadratic, std::vector<std::vector<char> >& quadratic_correction_done)
       {
-        this->vertex_min_values = new double**[this->component_count];
-        for (int i = 0; i < this->component_count; i++)
+        int limited_order = quadratic ? 2 : 1;
+
+        for (int component = 0; component < this->component_count; component++)
         {
-          this->vertex_min_values[i] = new double*[this->spaces[i]->get_mesh()->get_max_node_id()];
+          LimitedComponent& data = this->limited_components[component];
+          int element_count = data.elements.size();
+          if (quadratic)
+            quadratic_correction_done[component].assign(element_count, 0);
+
+          // Factors of the limited elements, 1 for the others.
+          std::vector<double> element_correction_factors(element_count, 1.);
 
-          for (int j = 0; j < this->spaces[i]->get_mesh()->get_max_node_id(); j++)
+#pragma omp parallel num_threads(this->num_threads_used)
           {
-            this->vertex_min_values[i][j] = new double[this->mixed_derivatives_count];
-            for (int k = 0; k < this->mixed_derivatives_count; k++)
-              this->vertex_min_values[i][j][k] = std::numeric_limits<double>::infinity();
-          }
-        }
+            int thread_number = omp_get_thread_num();
+            int start = (element_count / this->num_threads_used) * thread_number;
+            int end = (element_count / this->num_threads_used) * (thread_number + 1);
+            if (thread_number == this->num_threads_used - 1)
+              end = element_count;
 
-        this->vertex_max_values = new double**[this->component_count];
-        for (int i = 0; i < this->component_count; i++)
-        {
-          this->vertex_max_values[i] = new double*[this->spaces[i]->get_mesh()->get_max_node_id()];
+            try
+            {
+              AsmList<double> al;
+              for (int element_i = start; element_i < end; element_i++)
+              {
+                Element* e = data.elements[element_i];
+                int element_order = this->spaces[component]->get_element_order(e->id);
+                bool second_order = H2D_GET_H_ORDER(element_order) >= 2 || H2D_GET_V_ORDER(element_order) >= 2;
 
-          for (int j = 0; j < this->spaces[i]->get_mesh()->get_max_node_id(); j++)
-          {
-            this->vertex_max_values[i][j] = new double[this->mixed_derivatives_count];
-            for (int k = 0; k < this->mixed_derivatives_count; k++)
-              this->vertex_max_values[i][j][k] = -std::numeric_limits<double>::infinity();
-          }
-        }
-      }
+                double correction_factor;
+                if (quadratic)
+                {
+                  if (!second_order || this->mixed_derivatives_count < 3)
+                    continue;
+                  correction_factor = this->get_correction_factor(component, element_i, 1, 2);
+                }
+                else
+                {
+                  if (second_order && !quadratic_correction_done[component][element_i])
+                    continue;
+                  correction_factor = this->get_correction_factor(component, element_i, 0, 0);
+                }
 
-      void VertexBasedLimiter::deallocate_vertex_values()
-      {
-        if (this->vertex_min_values)
-        {
-          for (int i = 0; i < this->component_count; i++)
-          {
-            for (int j = 0; j < this->spaces[i]->get_mesh()->get_max_node_id(); j++)
+                if (correction_factor >= (1 - 1e-3))
+                  continue;
+
+                element_correction_factors[element_i] = correction_factor;
+                if (quadratic)
+                  quadratic_correction_done[component][element_i] = 1;
+
+                // The (L2) element owns its DOFs, no other thread writes them.
+                this->spaces[component]->get_element_assembly_list(e, &al);
+                for (int i_basis_fn = 0; i_basis_fn < al.cnt; i_basis_fn++)
+                {
+                  int order = this->spaces[component]->get_shapeset()->get_order(al.idx[i_basis_fn], e->get_mode());
+                  if (H2D_GET_H_ORDER(order) == limited_order || H2D_GET_V_ORDER(order) == limited_order)
+                  {
+                    if (this->p_coarsening_only)
+                      this->solution_vector[al.dof[i_basis_fn]] = 0.;
+                    else
+                      this->solution_vector[al.dof[i_basis_fn]] *= correction_factor;
+                  }
+                }
+              }
+            }
+            catch (Hermes::Exceptions::Exception& e)
             {
-              delete[] this->vertex_min_values[i][j];
-              delete[] this->vertex_max_values[i][j];
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+              this->exceptionMessageCaughtInParallelBlock = e.info();
+            }
+            catch (std::exception& e)
+            {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+              this->exceptionMessageCaughtInParallelBlock = e.what();
             }
-
-            delete[] this->vertex_min_values[i];
-            delete[] this->vertex_max_values[i];
           }
 
-          delete[] this->vertex_min_values;
-          delete[] this->vertex_max_values;
+          if (!this->exceptionMessageCaughtInParallelBlock.empty())
+            throw Hermes::Exceptions::Exception(this->exceptionMessageCaughtInParallelBlock.c_str());
+
+          // Record the limited elements in the order of the elements.
+          if (this->get_verbose_output() && this->component_count > 1)
+            std::cout << "Component: " << component << std::endl;
+          for (int element_i = 0; element_i < element_count; element_i++)
+          {
+            if (element_correction_factors[element_i] == 1.)
+              continue;
+
+            if (this->get_verbose_output())
+              std::cout << "Element: " << data.elements[element_i]->id << "\tcorrection_factor " << element_correction_factors[element_i] << std::endl;
+
+            this->changed_element_ids.push_back(data.elements[element_i]->id);
+            this->correction_factors.push_back(std::pair<int, double>(limited_order, element_correction_factors[element_i]));
+          }
         }
       }
 
@@ -802,9 +814,7 @@ namespace Hermes
           delete refmap;
         }
 
-        for (int i = 0; i < num_states; i++)
-          delete states[i];
-        free_with_check(states);
+        Traverse::free_states(states);
 
         return result;
       }
@@ -993,9 +1003,7 @@ namespace Hermes
           delete refmap;
         }
 
-        for (int i = 0; i < num_states; i++)
-          delete states[i];
-        free_with_check(states);
+        Traverse::free_states(states);
 
         return result;
       }
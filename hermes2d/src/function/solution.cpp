@@ -16,6 +16,7 @@
 #include "exact_solution.h"
 #include "forms.h"
 #include "solution_h2d_xml.h"
+#include "xml_stream.h"
 #include "ogprojection.h"
 #include "api2d.h"
 #include "algebra/dense_matrix_operations.h"
@@ -983,97 +984,71 @@ namespace Hermes
       Function<Scalar>::precalculate(order, mask);
     }
 
-    template<>
-    void Solution<double>::save(const char* filename) const
+    static void write_mono_coeff(XMLStreamWriter& writer, double value)
     {
-      // Check.
-      this->check();
-
-      try
-      {
-        // Init XML.
-        // With counts, exactness.
-        XMLSolution::solution xmlsolution(this->num_components, this->num_elems, this->num_coeffs, 0, 0);
-
-        // Space type.
-        xmlsolution.space().set(spaceTypeToString(this->get_space_type()));
-
-        // Coefficients.
-        for (unsigned int coeffs_i = 0; coeffs_i < this->num_coeffs; coeffs_i++)
-          xmlsolution.mono_coeffs().push_back(XMLSolution::mono_coeffs(coeffs_i, mono_coeffs[coeffs_i]));
-
-        // Orders.
-        for (unsigned int elems_i = 0; elems_i < this->num_elems; elems_i++)
-          xmlsolution.elem_orders().push_back(XMLSolution::elem_orders(elems_i, elem_orders[elems_i]));
-
-        // Element offsets for each component.
-        for (unsigned int component_i = 0; component_i < this->num_components; component_i++)
-        {
-          xmlsolution.component().push_back(XMLSolution::component());
-          xmlsolution.component().back().component_number() = component_i;
-          for (unsigned int elems_i = 0; elems_i < this->num_elems; elems_i++)
-            xmlsolution.component().back().elem_coeffs().push_back(XMLSolution::elem_coeffs(elems_i, elem_coeffs[component_i][elems_i]));
-        }
+      writer.attribute("re", value);
+    }
 
-        // Write to disk.
-        ::xml_schema::namespace_infomap namespace_info_map;
-        std::ofstream out(filename);
-        ::xml_schema::flags parsing_flags = ::xml_schema::flags::dont_pretty_print;
-        XMLSolution::solution_(out, xmlsolution, namespace_info_map, "UTF-8", parsing_flags);
-        out.close();
-      }
-      catch (const xml_schema::exception& e)
-      {
-        throw Hermes::Exceptions::SolutionSaveFailureException(e.what());
-      }
+    static void write_mono_coeff(XMLStreamWriter& writer, const std::complex<double>& value)
+    {
+      writer.attribute("re", value.real());
+      writer.attribute("im", value.imag());
     }
 
-    template<>
-    void Solution<std::complex<double> >::save(const char* filename) const
+    template<typename Scalar>
+    void Solution<Scalar>::save(const char* filename) const
     {
       // Check.
       this->check();
 
-      try
-      {
-        // Init XML.
-        // With counts, exactness.
-        XMLSolution::solution xmlsolution(this->num_components, this->num_elems, this->num_coeffs, 0, 0);
+      XMLStreamWriter writer(filename);
+      writer.start_element("solution:solution");
+      writer.attribute("xmlns:solution", "XMLSolution");
 
-        // Space type.
-        xmlsolution.space().set(spaceTypeToString(this->get_space_type()));
+      // With counts, exactness.
+      writer.attribute("ncmp", (int)this->num_components);
+      writer.attribute("nel", this->num_elems);
+      writer.attribute("nc", this->num_coeffs);
+      writer.attribute("exact", 0);
+      writer.attribute("exactC", 0);
 
-        // Coefficients - this is the only difference wrt. the real method.
-        for (unsigned int coeffs_i = 0; coeffs_i < this->num_coeffs; coeffs_i++)
-        {
-          xmlsolution.mono_coeffs().push_back(XMLSolution::mono_coeffs(coeffs_i, mono_coeffs[coeffs_i].real()));
-          xmlsolution.mono_coeffs().back().im() = mono_coeffs[coeffs_i].imag();
-        }
-
-        // Orders.
-        for (unsigned int elems_i = 0; elems_i < this->num_elems; elems_i++)
-          xmlsolution.elem_orders().push_back(XMLSolution::elem_orders(elems_i, elem_orders[elems_i]));
+      // Space type.
+      writer.attribute("space", spaceTypeToString(this->get_space_type()));
 
-        // Element offsets for each component.
-        for (unsigned int component_i = 0; component_i < this->num_components; component_i++)
-        {
-          xmlsolution.component().push_back(XMLSolution::component());
-          xmlsolution.component().back().component_number() = component_i;
-          for (unsigned int elems_i = 0; elems_i < this->num_elems; elems_i++)
-            xmlsolution.component().back().elem_coeffs().push_back(XMLSolution::elem_coeffs(elems_i, elem_coeffs[component_i][elems_i]));
-        }
+      // Coefficients.
+      for (int coeffs_i = 0; coeffs_i < this->num_coeffs; coeffs_i++)
+      {
+        writer.start_element("mono_coeffs");
+        writer.attribute("id", coeffs_i);
+        write_mono_coeff(writer, mono_coeffs[coeffs_i]);
+        writer.end_element();
+      }
 
-        // Write to disk.
-        ::xml_schema::namespace_infomap namespace_info_map;
-        std::ofstream out(filename);
-        ::xml_schema::flags parsing_flags = ::xml_schema::flags::dont_pretty_print;
-        XMLSolution::solution_(out, xmlsolution, namespace_info_map, "UTF-8", parsing_flags);
-        out.close();
+      // Orders.
+      for (int elems_i = 0; elems_i < this->num_elems; elems_i++)
+      {
+        writer.start_element("elem_orders");
+        writer.attribute("id", elems_i);
+        writer.attribute("ord", elem_orders[elems_i]);
+        writer.end_element();
       }
-      catch (const xml_schema::exception& e)
+
+      // Element offsets for each component.
+      for (int component_i = 0; component_i < this->num_components; component_i++)
       {
-        throw Hermes::Exceptions::SolutionSaveFailureException(e.what());
+        writer.start_element("component");
+        writer.attribute("component_number", component_i);
+        for (int elems_i = 0; elems_i < this->num_elems; elems_i++)
+        {
+          writer.start_element("elem_coeffs");
+          writer.attribute("id", elems_i);
+          writer.attribute("c", elem_coeffs[component_i][elems_i]);
+          writer.end_element();
+        }
+        writer.end_element();
       }
+
+      writer.close();
     }
 
 #ifdef WITH_BSON
@@ -1269,6 +1244,119 @@ namespace Hermes
       }
     }
 
+    static void set_mono_coeff(double& coeff, double real, double imag)
+    {
+      coeff = real;
+    }
+
+    static void set_mono_coeff(std::complex<double>& coeff, double real, double imag)
+    {
+      coeff = std::complex<double>(real, imag);
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::load_streamed(const char* filename, SpaceSharedPtr<Scalar> space)
+    {
+      XMLStreamReader reader(filename);
+      if (!reader.next_element() || !reader.is("solution"))
+        throw Hermes::Exceptions::SolutionLoadFailureException("No solution in the file %s.", filename);
+
+      int ncmp = reader.int_attribute("ncmp");
+      sln_type = reader.int_attribute("exact") == 0 ? HERMES_SLN : HERMES_EXACT;
+
+      if (ncmp != space->get_shapeset()->get_num_components())
+        throw Exceptions::Exception("Mismatched space / saved solution.");
+
+      if (sln_type == HERMES_EXACT)
+      {
+        this->load_exact_solution(ncmp, space, reader.int_attribute("exactC") != 0, reader.double_attribute("exactCXR"), reader.double_attribute("exactCYR"), reader.double_attribute("exactCXC"), reader.double_attribute("exactCYC"));
+        init_dxdy_buffer();
+        return;
+      }
+
+      this->check_space_type_compliance(reader.required_attribute("space"));
+
+      this->num_coeffs = reader.int_attribute("nc");
+      this->num_elems = reader.int_attribute("nel");
+      this->num_components = ncmp;
+
+      this->mono_coeffs = malloc_with_check<Solution<Scalar>, Scalar>(num_coeffs, this);
+      memset(this->mono_coeffs, 0, this->num_coeffs*sizeof(Scalar));
+
+      for (unsigned int component_i = 0; component_i < this->num_components; component_i++)
+        elem_coeffs[component_i] = malloc_with_check<Solution<Scalar>, int>(num_elems, this);
+
+      this->elem_orders = malloc_with_check<Solution<Scalar>, int>(num_elems, this);
+
+      // The coefficients are collected in batches, the values of a batch are converted in parallel.
+      std::vector<std::string> values(2 * H2D_XML_STREAM_BATCH_SIZE);
+      std::vector<int> ids(H2D_XML_STREAM_BATCH_SIZE);
+      double* parsed_values = malloc_with_check<Solution<Scalar>, double>(2 * H2D_XML_STREAM_BATCH_SIZE, this);
+      int batch_count = 0;
+      int component_i = -1;
+
+      try
+      {
+        bool reading = true;
+        while (reading)
+        {
+          reading = reader.next_element();
+
+          if (batch_count > 0 && (!reading || !reader.is("mono_coeffs") || batch_count == H2D_XML_STREAM_BATCH_SIZE))
+          {
+            XMLStreamReader::parse_doubles(2 * batch_count, &values[0], parsed_values);
+            for (int batch_i = 0; batch_i < batch_count; batch_i++)
+              set_mono_coeff(this->mono_coeffs[ids[batch_i]], parsed_values[2 * batch_i], parsed_values[2 * batch_i + 1]);
+            batch_count = 0;
+          }
+
+          if (!reading)
+            break;
+
+          if (reader.is("mono_coeffs"))
+          {
+            int id = reader.int_attribute("id");
+            if (id < 0 || id >= this->num_coeffs)
+              throw Hermes::Exceptions::SolutionLoadFailureException("Coefficient %d out of range in the file %s.", id, filename);
+            ids[batch_count] = id;
+            values[2 * batch_count] = reader.required_attribute("re");
+            const char* imag = reader.attribute("im");
+            values[2 * batch_count + 1] = imag ? imag : "0";
+            batch_count++;
+          }
+          else if (reader.is("elem_orders"))
+          {
+            int id = reader.int_attribute("id");
+            if (id < 0 || id >= this->num_elems)
+              throw Hermes::Exceptions::SolutionLoadFailureException("Element %d out of range in the file %s.", id, filename);
+            this->elem_orders[id] = reader.int_attribute("ord");
+          }
+          else if (reader.is("component"))
+          {
+            const char* component_number = reader.attribute("component_number");
+            component_i = component_number ? atoi(component_number) : component_i + 1;
+            if (component_i < 0 || component_i >= this->num_components)
+              throw Hermes::Exceptions::SolutionLoadFailureException("Component %d out of range in the file %s.", component_i, filename);
+          }
+          else if (reader.is("elem_coeffs"))
+          {
+            int id = reader.int_attribute("id");
+            if (component_i == -1 || id < 0 || id >= this->num_elems)
+              throw Hermes::Exceptions::SolutionLoadFailureException("Element coefficients %d out of range in the file %s.", id, filename);
+            this->elem_coeffs[component_i][id] = reader.int_attribute("c");
+          }
+        }
+      }
+      catch (...)
+      {
+        free_with_check(parsed_values);
+        throw;
+      }
+      free_with_check(parsed_values);
+
+      init_dxdy_buffer();
+    }
+
     template<>
     void Solution<double>::load(const char* filename, SpaceSharedPtr<double> space)
     {
@@ -1276,11 +1364,15 @@ namespace Hermes
       this->mesh = space->get_mesh();
       this->space_type = space->get_type();
 
+      if (!this->validate)
+      {
+        this->load_streamed(filename, space);
+        return;
+      }
+
       try
       {
         ::xml_schema::flags parsing_flags = 0;
-        if (!this->validate)
-          parsing_flags = xml_schema::flags::dont_validate;
 
         std::auto_ptr<XMLSolution::solution> parsed_xml_solution(XMLSolution::solution_(filename, parsing_flags));
         sln_type = parsed_xml_solution->exact() == 0 ? HERMES_SLN : HERMES_EXACT;
@@ -1332,11 +1424,15 @@ namespace Hermes
       this->mesh = space->get_mesh();
       this->space_type = space->get_type();
 
+      if (!this->validate)
+      {
+        this->load_streamed(filename, space);
+        return;
+      }
+
       try
       {
         ::xml_schema::flags parsing_flags = 0;
-        if (!this->validate)
-          parsing_flags = xml_schema::flags::dont_validate;
 
         std::auto_ptr<XMLSolution::solution> parsed_xml_solution(XMLSolution::solution_(filename, parsing_flags));
         sln_type = parsed_xml_solution->exact() == 0 ? HERMES_SLN : HERMES_EXACT;
@@ -1927,6 +2023,264 @@ namespace Hermes
       }
     }
 
+    /// Reference coordinates of the physical point (x, y) in the straight-edged quad e and the inverse matrix of the (bilinear)
+    /// reference mapping there, in the layout of RefMap::inv_ref_map_at_point().
+    static void untransform_bilinear(Element* e, double x, double y, double& xi1, double& xi2, double2x2& m)
+    {
+      const double TOL = Hermes::HermesSqrtEpsilon;
+
+      // x(xi) = a + b * xi1 + c * xi2 + d * xi1 * xi2.
+      double2 a, b, c, d;
+      for (int k = 0; k < 2; k++)
+      {
+        double v0 = k ? e->vn[0]->y : e->vn[0]->x, v1 = k ? e->vn[1]->y : e->vn[1]->x;
+        double v2 = k ? e->vn[2]->y : e->vn[2]->x, v3 = k ? e->vn[3]->y : e->vn[3]->x;
+        a[k] = 0.25 * (v0 + v1 + v2 + v3);
+        b[k] = 0.25 * (-v0 + v1 + v2 - v3);
+        c[k] = 0.25 * (-v0 - v1 + v2 + v3);
+        d[k] = 0.25 * (v0 - v1 + v2 - v3);
+      }
+
+      // The inverse is computed once more at the final reference coordinates, the derivatives are transformed by it.
+      xi1 = xi2 = 0.;
+      bool converged = false;
+      for (int it = 0;; it++)
+      {
+        double jac[2][2] = { { b[0] + d[0] * xi2, c[0] + d[0] * xi1 }, { b[1] + d[1] * xi2, c[1] + d[1] * xi1 } };
+        double det = jac[0][0] * jac[1][1] - jac[0][1] * jac[1][0];
+        m[0][0] = jac[1][1] / det;
+        m[0][1] = -jac[1][0] / det;
+        m[1][0] = -jac[0][1] / det;
+        m[1][1] = jac[0][0] / det;
+        if (converged || it > 100)
+          break;
+
+        double rx = a[0] + b[0] * xi1 + c[0] * xi2 + d[0] * xi1 * xi2 - x;
+        double ry = a[1] + b[1] * xi1 + c[1] * xi2 + d[1] * xi1 * xi2 - y;
+        double step1 = m[0][0] * rx + m[1][0] * ry;
+        double step2 = m[0][1] * rx + m[1][1] * ry;
+        xi1 -= step1;
+        xi2 -= step2;
+        converged = fabs(step1) < TOL && fabs(step2) < TOL;
+      }
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::get_pt_values_in_element(Element* e, RefMap* refmap, const int* points, int points_count, int count, const double* x, const double* y,
+      Scalar* values, Scalar* dx, Scalar* dy) const
+    {
+      int o = elem_orders[e->id];
+      bool quad = e->is_quad();
+
+      // Constant reference mapping of straight-edged triangles and parallelograms - one inverse for all the points.
+      bool const_map = !e->is_curved() && (e->is_triangle() || e->is_parallelogram());
+      double2x2 m;
+      if (const_map)
+      {
+        int k = e->is_triangle() ? 2 : 3;
+        double ax = e->vn[1]->x - e->vn[0]->x, ay = e->vn[1]->y - e->vn[0]->y;
+        double bx = e->vn[k]->x - e->vn[0]->x, by = e->vn[k]->y - e->vn[0]->y;
+        double det = ax * by - ay * bx;
+        if (det <= 0.0)
+          throw Hermes::Exceptions::Exception("Element #%d is concave or badly oriented in Solution::get_pt_values().", e->id);
+        m[0][0] = 2. * by / det;
+        m[0][1] = -2. * ay / det;
+        m[1][0] = -2. * bx / det;
+        m[1][1] = 2. * ax / det;
+      }
+      else if (e->is_curved() && refmap->get_active_element() != e)
+        refmap->set_active_element(e);
+
+      for (int point_i = 0; point_i < points_count; point_i++)
+      {
+        int point = points[point_i];
+        double xi1, xi2;
+        if (const_map)
+        {
+          double px = x[point] - e->vn[0]->x, py = y[point] - e->vn[0]->y;
+          xi1 = -1.0 + m[0][0] * px + m[1][0] * py;
+          xi2 = -1.0 + m[0][1] * px + m[1][1] * py;
+        }
+        else if (!e->is_curved())
+          untransform_bilinear(e, x[point], y[point], xi1, xi2, m);
+        else
+        {
+          double xx, yy;
+          RefMap::untransform(e, x[point], y[point], xi1, xi2);
+          refmap->inv_ref_map_at_point(xi1, xi2, xx, yy, m);
+        }
+
+        // Horner's scheme for the value and both reference derivatives at once.
+        Scalar result[H2D_MAX_SOLUTION_COMPONENTS], result_dxi1 = 0.0, result_dxi2 = 0.0;
+        for (int component = 0; component < this->num_components; component++)
+        {
+          const Scalar* mono = mono_coeffs + elem_coeffs[component][e->id];
+          Scalar value = 0.0, d1 = 0.0, d2 = 0.0;
+          int k = 0;
+          for (int i = 0; i <= o; i++)
+          {
+            Scalar row = mono[k++], row_d1 = 0.0;
+            for (int j = 0; j < (quad ? o : i); j++)
+            {
+              row_d1 = row_d1 * xi1 + row;
+              row = row * xi1 + mono[k++];
+            }
+            d2 = d2 * xi2 + value;
+            value = value * xi2 + row;
+            d1 = d1 * xi2 + row_d1;
+          }
+          result[component] = value;
+          if (component == 0)
+          {
+            result_dxi1 = d1;
+            result_dxi2 = d2;
+          }
+        }
+
+        if (this->num_components == 1)
+        {
+          values[point] = result[0];
+          if (dx)
+            dx[point] = m[0][0] * result_dxi1 + m[0][1] * result_dxi2;
+          if (dy)
+            dy[point] = m[1][0] * result_dxi1 + m[1][1] * result_dxi2;
+        }
+        else
+        {
+          values[point] = m[0][0] * result[0] + m[0][1] * result[1];
+          values[count + point] = m[1][0] * result[0] + m[1][1] * result[1];
+        }
+      }
+    }
+
+    template<typename Scalar>
+    int Solution<Scalar>::get_pt_values(int count, const double* x, const double* y, Scalar* values, Scalar* dx, Scalar* dy, char* found)
+    {
+      if (sln_type == HERMES_UNDEF)
+        throw Hermes::Exceptions::Exception("Cannot obtain values -- uninitialized solution. The solution was either "
+        "not calculated yet or you used the assignment operator which destroys "
+        "the solution on its right-hand side.");
+
+      int components = this->num_components;
+      memset(values, 0, components * count * sizeof(Scalar));
+      if (dx)
+        memset(dx, 0, components * count * sizeof(Scalar));
+      if (dy)
+        memset(dy, 0, components * count * sizeof(Scalar));
+      if (found)
+        memset(found, 0, count * sizeof(char));
+
+      if (sln_type == HERMES_EXACT)
+      {
+        for (int point = 0; point < count; point++)
+        {
+          Func<Scalar>* point_value = this->get_pt_value(x[point], y[point]);
+          if (components == 1)
+          {
+            values[point] = point_value->val[0];
+            if (dx)
+              dx[point] = point_value->dx[0];
+            if (dy)
+              dy[point] = point_value->dy[0];
+          }
+          else
+          {
+            values[point] = point_value->val0[0];
+            values[count + point] = point_value->val1[0];
+          }
+          if (found)
+            found[point] = 1;
+          delete point_value;
+        }
+        return count;
+      }
+
+      // Order of the points along the Hilbert curve through the bounding box of the mesh.
+      static const unsigned int order = 16;
+      double x_min, y_min, x_max, y_max;
+      this->mesh->get_bounding_box(x_min, y_min, x_max, y_max);
+      double scale = (1u << order) - 1;
+      double x_scale = x_max > x_min ? scale / (x_max - x_min) : 0.;
+      double y_scale = y_max > y_min ? scale / (y_max - y_min) : 0.;
+      std::vector<std::pair<uint64_t, int> > keys(count);
+      for (int point = 0; point < count; point++)
+      {
+        keys[point].second = point;
+        double point_x = std::max(0., std::min(scale, (x[point] - x_min) * x_scale));
+        double point_y = std::max(0., std::min(scale, (y[point] - y_min) * y_scale));
+        keys[point].first = MeshUtil::hilbert_index(order, (unsigned int)point_x, (unsigned int)point_y);
+      }
+      std::sort(keys.begin(), keys.end());
+      std::vector<int> sorted_points(count);
+      for (int i = 0; i < count; i++)
+        sorted_points[i] = keys[i].second;
+
+      MeshHashGrid* hash_grid = this->mesh->get_hash_grid();
+
+      // Consecutive parts of the sorted points are handled by the threads.
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel() || count < 256 * num_threads)
+        num_threads = 1;
+
+      int found_count = 0;
+      std::string exceptionMessageCaughtInParallelBlock;
+#pragma omp parallel num_threads(num_threads) reduction(+:found_count)
+      {
+        int thread_number = omp_get_thread_num();
+        int start = (int)(((int64_t)count * thread_number) / num_threads);
+        int end = (int)(((int64_t)count * (thread_number + 1)) / num_threads);
+
+        // For curved elements.
+        RefMap refmap;
+
+        try
+        {
+          Element* e = nullptr;
+          int run_start = start;
+          while (run_start < end)
+          {
+            int point = sorted_points[run_start];
+            if (e == nullptr || !RefMap::is_element_on_physical_coordinates(e, x[point], y[point]))
+            {
+              e = hash_grid->getElement(x[point], y[point]);
+              if (e == nullptr)
+                e = RefMap::element_on_physical_coordinates(false, this->mesh, x[point], y[point]);
+            }
+            if (e == nullptr)
+            {
+              run_start++;
+              continue;
+            }
+
+            // The following points in the same element.
+            int run_end = run_start + 1;
+            while (run_end < end && RefMap::is_element_on_physical_coordinates(e, x[sorted_points[run_end]], y[sorted_points[run_end]]))
+              run_end++;
+
+            this->get_pt_values_in_element(e, &refmap, &sorted_points[run_start], run_end - run_start, count, x, y, values, dx, dy);
+            if (found)
+              for (int i = run_start; i < run_end; i++)
+                found[sorted_points[i]] = 1;
+            found_count += run_end - run_start;
+            run_start = run_end;
+          }
+        }
+        catch (std::exception& exception)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          exceptionMessageCaughtInParallelBlock = exception.what();
+        }
+      }
+
+      if (!exceptionMessageCaughtInParallelBlock.empty())
+        throw Hermes::Exceptions::Exception(exceptionMessageCaughtInParallelBlock.c_str());
+
+      if (found_count < count)
+        this->warn("%d of %d points do not lie in any element.", count - found_count, count);
+
+      return found_count;
+    }
+
     template class HERMES_API Solution < double > ;
     template class HERMES_API Solution < std::complex<double> > ;
   }
@@ -21,40 +21,156 @@ namespace Hermes
 {
   namespace Hermes2D
   {
-    HashTable::HashTable()
+    HashTable::NodeTable::NodeTable() : slots(nullptr), mask(-1), count(0)
     {
-      v_table = nullptr; e_table = nullptr;
     }
 
-    HashTable::~HashTable()
+    HashTable::NodeTable::~NodeTable()
     {
       free();
     }
 
-    void HashTable::init(int size)
+    void HashTable::NodeTable::init(int size)
     {
-      v_table = e_table = nullptr;
+      free();
 
       mask = size - 1;
       if (size & mask) throw Hermes::Exceptions::Exception("Parameter 'size' must be a power of two.");
 
-      // allocate and initialize the hash tables
-      v_table = new Node*[size];
-      e_table = new Node*[size];
+      slots = malloc_with_check<Slot>(size);
+      for (int i = 0; i < size; i++)
+        slots[i].id = -1;
+      count = 0;
+    }
+
+    void HashTable::NodeTable::copy(const NodeTable& other)
+    {
+      free();
+      if (!other.slots)
+        return;
+
+      // Node ids are kept in the table, no pointers to fix.
+      mask = other.mask;
+      count = other.count;
+      slots = malloc_with_check<Slot>(mask + 1);
+      memcpy(slots, other.slots, (mask + 1) * sizeof(Slot));
+    }
+
+    void HashTable::NodeTable::free()
+    {
+      free_with_check(slots);
+      mask = -1;
+      count = 0;
+    }
+
+    void HashTable::NodeTable::clear()
+    {
+      if (!slots)
+      {
+        init(H2D_DEFAULT_HASH_SIZE);
+        return;
+      }
+      for (int i = 0; i <= mask; i++)
+        slots[i].id = -1;
+      count = 0;
+    }
+
+    int HashTable::NodeTable::find(int p1, int p2) const
+    {
+      int position = hash(p1, p2);
+      for (int distance = 0;; distance++)
+      {
+        const Slot& slot = slots[position];
+        if (slot.id < 0)
+          return -1;
+        if (slot.p1 == p1 && slot.p2 == p2)
+          return slot.id;
+        // A key from here on would have displaced this slot when it was inserted.
+        if (probe_distance(position) < distance)
+          return -1;
+        position = (position + 1) & mask;
+      }
+    }
+
+    void HashTable::NodeTable::insert(int p1, int p2, int id)
+    {
+      // Keep the load below 3/4.
+      if (4 * (count + 1) > 3 * (mask + 1))
+        grow();
 
-      memset(v_table, 0, size * sizeof(Node*));
-      memset(e_table, 0, size * sizeof(Node*));
+      Slot inserted = { p1, p2, id };
+      int position = hash(p1, p2);
+      for (int distance = 0;; distance++)
+      {
+        Slot& slot = slots[position];
+        if (slot.id < 0)
+        {
+          slot = inserted;
+          count++;
+          return;
+        }
+        // Robin Hood - the key farther from its position takes the slot, the other one continues.
+        int slot_distance = probe_distance(position);
+        if (slot_distance < distance)
+        {
+          std::swap(slot, inserted);
+          distance = slot_distance;
+        }
+        position = (position + 1) & mask;
+      }
     }
 
-    void HashTable::copy_list(Node** ptr, Node* node)
+    void HashTable::NodeTable::remove(int p1, int p2, int id)
     {
-      while (node != nullptr)
+      int position = hash(p1, p2);
+      for (int distance = 0;; distance++)
+      {
+        if (slots[position].id < 0 || probe_distance(position) < distance)
+          return;
+        if (slots[position].id == id)
+          break;
+        position = (position + 1) & mask;
+      }
+
+      // Shift the following keys back, no tombstones are needed.
+      int next = (position + 1) & mask;
+      while (slots[next].id >= 0 && probe_distance(next) > 0)
       {
-        *ptr = &nodes[node->id];
-        ptr = &((*ptr)->next_hash);
-        node = node->next_hash;
+        slots[position] = slots[next];
+        position = next;
+        next = (next + 1) & mask;
       }
-      *ptr = nullptr;
+      slots[position].id = -1;
+      count--;
+    }
+
+    void HashTable::NodeTable::grow()
+    {
+      Slot* old_slots = slots;
+      int old_size = mask + 1;
+
+      slots = nullptr;
+      init(2 * old_size);
+      for (int i = 0; i < old_size; i++)
+        if (old_slots[i].id >= 0)
+          insert(old_slots[i].p1, old_slots[i].p2, old_slots[i].id);
+
+      free_with_check(old_slots);
+    }
+
+    HashTable::HashTable()
+    {
+    }
+
+    HashTable::~HashTable()
+    {
+      free();
+    }
+
+    void HashTable::init(int size)
+    {
+      v_table.init(size);
+      e_table.init(size);
     }
 
     Node* HashTable::get_node(int id) const
@@ -76,76 +192,51 @@ namespace Hermes
     {
       free();
       nodes.copy(ht->nodes);
-      mask = ht->mask;
+      v_table.copy(ht->v_table);
+      e_table.copy(ht->e_table);
+    }
 
-      v_table = new Node*[mask + 1];
-      e_table = new Node*[mask + 1];
-      for (int i = 0; i <= mask; i++)
-      {
-        copy_list(v_table + i, ht->v_table[i]);
-        copy_list(e_table + i, ht->e_table[i]);
-      }
+    int HashTable::get_hash_size() const
+    {
+      return v_table.get_size();
     }
 
     void HashTable::rebuild()
     {
-      memset(v_table, 0, (mask + 1) * sizeof(Node*));
-      memset(e_table, 0, (mask + 1) * sizeof(Node*));
+      v_table.clear();
+      e_table.clear();
 
       Node* node;
       for_all_nodes(node, this)
       {
+        // Top-level vertices (no parents) are not searched for.
+        if (node->p1 < 0 || node->p2 < 0)
+          continue;
+
         int p1 = node->p1, p2 = node->p2;
         if (p1 > p2) std::swap(p1, p2);
-        int idx = hash(p1, p2);
 
         if (node->type == HERMES_TYPE_VERTEX)
-        {
-          node->next_hash = v_table[idx];
-          v_table[idx] = node;
-        }
+          v_table.insert(p1, p2, node->id);
         else
-        {
-          node->next_hash = e_table[idx];
-          e_table[idx] = node;
-        }
+          e_table.insert(p1, p2, node->id);
       }
     }
 
     void HashTable::free()
     {
       nodes.free();
-      if (v_table != nullptr)
-      {
-        delete[] v_table;
-        v_table = nullptr;
-      }
-      if (e_table != nullptr)
-      {
-        delete[] e_table;
-        e_table = nullptr;
-      }
-    }
-
-    inline Node* HashTable::search_list(Node* node, int p1, int p2) const
-    {
-      while (node != nullptr)
-      {
-        if (node->p1 == p1 && node->p2 == p2)
-          return node;
-        node = node->next_hash;
-      }
-      return nullptr;
+      v_table.free();
+      e_table.free();
     }
 
     Node* HashTable::get_vertex_node(int p1, int p2)
     {
       // search for the node in the vertex hashtable
       if (p1 > p2) std::swap(p1, p2);
-      int i = hash(p1, p2);
-      Node* node = search_list(v_table[i], p1, p2);
-      if (node != nullptr)
-        return node;
+      int id = v_table.find(p1, p2);
+      if (id >= 0)
+        return &nodes[id];
 
       // not found - create a new_ one
       Node* newnode = nodes.add();
@@ -161,8 +252,7 @@ namespace Hermes
       newnode->y = (nodes[p1].y + nodes[p2].y) * 0.5;
 
       // insert into hashtable
-      newnode->next_hash = v_table[i];
-      v_table[i] = newnode;
+      v_table.insert(p1, p2, newnode->id);
 
       return newnode;
     }
@@ -171,9 +261,9 @@ namespace Hermes
     {
       // search for the node in the edge hashtable
       if (p1 > p2) std::swap(p1, p2);
-      int i = hash(p1, p2);
-      Node* node = search_list(e_table[i], p1, p2);
-      if (node != nullptr) return node;
+      int id = e_table.find(p1, p2);
+      if (id >= 0)
+        return &nodes[id];
 
       // not found - create a new_ one
       Node* newnode = nodes.add();
@@ -188,8 +278,7 @@ namespace Hermes
       newnode->elem[0] = newnode->elem[1] = nullptr;
 
       // insert into hashtable
-      newnode->next_hash = e_table[i];
-      e_table[i] = newnode;
+      e_table.insert(p1, p2, newnode->id);
 
       return newnode;
     }
@@ -197,31 +286,23 @@ namespace Hermes
     Node* HashTable::peek_vertex_node(int p1, int p2) const
     {
       if (p1 > p2) std::swap(p1, p2);
-      return search_list(v_table[hash(p1, p2)], p1, p2);
+      int id = v_table.find(p1, p2);
+      return id >= 0 ? &nodes[id] : nullptr;
     }
 
     Node* HashTable::peek_edge_node(int p1, int p2) const
     {
       if (p1 > p2) std::swap(p1, p2);
-      return search_list(e_table[hash(p1, p2)], p1, p2);
+      int id = e_table.find(p1, p2);
+      return id >= 0 ? &nodes[id] : nullptr;
     }
 
     void HashTable::remove_vertex_node(int id)
     {
       // remove the node from the hash table
-      int i = hash(nodes[id].p1, nodes[id].p2);
-      Node** ptr = v_table + i;
-      Node* node = *ptr;
-      while (node != nullptr)
-      {
-        if (node->id == id)
-        {
-          *ptr = node->next_hash;
-          break;
-        }
-        ptr = &node->next_hash;
-        node = *ptr;
-      }
+      int p1 = nodes[id].p1, p2 = nodes[id].p2;
+      if (p1 > p2) std::swap(p1, p2);
+      v_table.remove(p1, p2, id);
 
       // remove node from the array
       nodes.remove(id);
@@ -230,22 +311,20 @@ namespace Hermes
     void HashTable::remove_edge_node(int id)
     {
       // remove the node from the hash table
-      int i = hash(nodes[id].p1, nodes[id].p2);
-      Node** ptr = e_table + i;
-      Node* node = *ptr;
-      while (node != nullptr)
-      {
-        if (node->id == id)
-        {
-          *ptr = node->next_hash;
-          break;
-        }
-        ptr = &node->next_hash;
-        node = *ptr;
-      }
+      int p1 = nodes[id].p1, p2 = nodes[id].p2;
+      if (p1 > p2) std::swap(p1, p2);
+      e_table.remove(p1, p2, id);
 
       // remove node from the array
       nodes.remove(id);
     }
+
+    void HashTable::insert_node(const Node* node)
+    {
+      if (node->type == HERMES_TYPE_VERTEX)
+        v_table.insert(node->p1, node->p2, node->id);
+      else
+        e_table.insert(node->p1, node->p2, node->id);
+    }
   }
 }
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include "neighbor_search.h"
 #include "mixins.h"
 #include "forms.h"
+#include "traverse.h"
 
 namespace Hermes
 {
@@ -30,7 +31,7 @@ namespace Hermes
     static const int H2D_DG_INNER_EDGE_INT = -54125631;
     static const std::string H2D_DG_INNER_EDGE = "-54125631";
 
-    Mesh::Mesh() : HashTable(), meshHashGrid(nullptr), nbase(0), nactive(0), ntopvert(0), ninitial(0), seq(g_mesh_seq++),
+    Mesh::Mesh() : HashTable(), meshHashGrid(nullptr), meshSnapshot(nullptr), nbase(0), nactive(0), ntopvert(0), ninitial(0), seq(g_mesh_seq++),
       bounding_box_calculated(0)
     {
     }
@@ -120,7 +121,6 @@ namespace Hermes
         node->type = HERMES_TYPE_VERTEX;
         node->bnd = 0;
         node->p1 = node->p2 = -1;
-        node->next_hash = nullptr;
         node->x = verts[i][0];
         node->y = verts[i][1];
       }
@@ -159,6 +159,196 @@ namespace Hermes
       seq = g_mesh_seq++;
     }
 
+    void Mesh::create_bulk(int nv, const double2* verts, int ne, const int4* elems, const int* elem_markers,
+      int nm, const int2* mark, const int* boundary_markers)
+    {
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel() || ne < H2D_PARALLEL_BULK_CREATION_MIN_ELEMENTS)
+        num_threads = 1;
+
+      // initialize hash table
+      int size = 16;
+      while (size < 2 * nv) size *= 2;
+      init(size);
+
+      // Vertex nodes, ids 0, ..., nv - 1.
+      this->nodes.add_range(nv);
+#pragma omp parallel for num_threads(num_threads)
+      for (int i = 0; i < nv; i++)
+      {
+        Node* node = &this->nodes[i];
+        node->ref = TOP_LEVEL_REF;
+        node->type = HERMES_TYPE_VERTEX;
+        node->bnd = 0;
+        node->p1 = node->p2 = -1;
+        node->x = verts[i][0];
+        node->y = verts[i][1];
+      }
+      ntopvert = nv;
+
+      // Edges of the elements (slot H2D_MAX_NUMBER_EDGES * k + i for the edge i of the element k) bucketed by the lower vertex.
+      std::vector<int> bucket_start(nv + 1, 0);
+      for (int k = 0; k < ne; k++)
+      {
+        int nvert = elems[k][3] < 0 ? 3 : 4;
+        for (int i = 0; i < nvert; i++)
+        {
+          int v0 = elems[k][i], v1 = elems[k][(i + 1) % nvert];
+          if (v0 < 0 || v0 >= nv || v1 < 0 || v1 >= nv)
+            throw Hermes::Exceptions::MeshLoadFailureException("Element #%d refers to a non-existent vertex.", k);
+          bucket_start[std::min(v0, v1) + 1]++;
+        }
+      }
+      for (int i = 0; i < nv; i++)
+        bucket_start[i + 1] += bucket_start[i];
+
+      // Bucket entries (higher vertex, slot).
+      std::vector<std::pair<int, int> > buckets(bucket_start[nv]);
+      {
+        std::vector<int> bucket_position(bucket_start.begin(), bucket_start.end() - 1);
+        for (int k = 0; k < ne; k++)
+        {
+          int nvert = elems[k][3] < 0 ? 3 : 4;
+          for (int i = 0; i < nvert; i++)
+          {
+            int v0 = elems[k][i], v1 = elems[k][(i + 1) % nvert];
+            buckets[bucket_position[std::min(v0, v1)]++] = std::pair<int, int>(std::max(v0, v1), H2D_MAX_NUMBER_EDGES * k + i);
+          }
+        }
+      }
+
+      // Unique edges in every bucket.
+      std::vector<int> edge_start(nv + 1, 0);
+#pragma omp parallel for num_threads(num_threads)
+      for (int i = 0; i < nv; i++)
+      {
+        std::sort(buckets.begin() + bucket_start[i], buckets.begin() + bucket_start[i + 1]);
+        int unique_count = 0;
+        for (int j = bucket_start[i]; j < bucket_start[i + 1]; j++)
+          if (j == bucket_start[i] || buckets[j].first != buckets[j - 1].first)
+            unique_count++;
+        edge_start[i + 1] = unique_count;
+      }
+      for (int i = 0; i < nv; i++)
+        edge_start[i + 1] += edge_start[i];
+
+      // Edge nodes, ids nv, ..., nv + edge count - 1, the ids follow the order of the buckets.
+      int first_edge_id = this->nodes.add_range(edge_start[nv]);
+      int first_element_id = this->elements.add_range(ne);
+
+      std::string exceptionMessageCaughtInParallelBlock;
+
+      // Elements.
+#pragma omp parallel for num_threads(num_threads)
+      for (int k = 0; k < ne; k++)
+      {
+        try
+        {
+          Element* e = &this->elements[first_element_id + k];
+          e->active = 1;
+          e->marker = elem_markers[k];
+          e->nvert = elems[k][3] < 0 ? 3 : 4;
+          e->iro_cache = 0;
+          e->cm = nullptr;
+          e->parent = nullptr;
+          e->visited = false;
+          for (int i = 0; i < e->nvert; i++)
+          {
+            e->vn[i] = &this->nodes[elems[k][i]];
+            for (int j = 0; j < i; j++)
+              if (e->vn[i] == e->vn[j])
+                throw Hermes::Exceptions::MeshLoadFailureException("Some of the vertices of element #%d are identical which is impossible.", e->id);
+          }
+        }
+        catch (std::exception& exception)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          exceptionMessageCaughtInParallelBlock = exception.what();
+        }
+      }
+
+      if (!exceptionMessageCaughtInParallelBlock.empty())
+        throw Hermes::Exceptions::MeshLoadFailureException(exceptionMessageCaughtInParallelBlock.c_str());
+
+      // Edges - every bucket (and so every edge) is processed by one thread only.
+#pragma omp parallel for num_threads(num_threads)
+      for (int i = 0; i < nv; i++)
+      {
+        try
+        {
+          int edge_id = first_edge_id + edge_start[i] - 1;
+          for (int j = bucket_start[i]; j < bucket_start[i + 1]; j++)
+          {
+            if (j == bucket_start[i] || buckets[j].first != buckets[j - 1].first)
+            {
+              Node* en = &this->nodes[++edge_id];
+              en->type = HERMES_TYPE_EDGE;
+              en->ref = 0;
+              en->bnd = 0;
+              en->p1 = i;
+              en->p2 = buckets[j].first;
+              en->marker = 0;
+              en->elem[0] = en->elem[1] = nullptr;
+            }
+
+            Element* e = &this->elements[first_element_id + buckets[j].second / H2D_MAX_NUMBER_EDGES];
+            e->en[buckets[j].second % H2D_MAX_NUMBER_EDGES] = &this->nodes[edge_id];
+            this->nodes[edge_id].ref_element(e);
+          }
+        }
+        catch (std::exception& exception)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          exceptionMessageCaughtInParallelBlock = exception.what();
+        }
+      }
+
+      if (!exceptionMessageCaughtInParallelBlock.empty())
+        throw Hermes::Exceptions::MeshLoadFailureException(exceptionMessageCaughtInParallelBlock.c_str());
+
+      // Vertex references (as in Element::ref_all_nodes()), geometry of the elements.
+#pragma omp parallel for num_threads(num_threads)
+      for (int k = 0; k < ne; k++)
+      {
+        Element* e = &this->elements[first_element_id + k];
+        for (int i = 0; i < e->nvert; i++)
+        {
+#pragma omp atomic
+          e->vn[i]->ref++;
+        }
+        e->calc_area();
+        e->calc_diameter();
+      }
+
+      // Search tables - every edge is inserted once.
+      for (int edge_i = 0; edge_i < edge_start[nv]; edge_i++)
+        this->insert_node(&this->nodes[first_edge_id + edge_i]);
+
+      // Boundary - the edges of one element only.
+#pragma omp parallel for num_threads(num_threads)
+      for (int edge_i = 0; edge_i < edge_start[nv]; edge_i++)
+        if (this->nodes[first_edge_id + edge_i].ref < 2)
+          this->nodes[first_edge_id + edge_i].bnd = 1;
+      for (int edge_i = 0; edge_i < edge_start[nv]; edge_i++)
+      {
+        Node* en = &this->nodes[first_edge_id + edge_i];
+        if (en->bnd)
+          this->nodes[en->p1].bnd = this->nodes[en->p2].bnd = 1;
+      }
+
+      // set boundary markers
+      for (int i = 0; i < nm; i++)
+      {
+        Node* en = peek_edge_node(mark[i][0], mark[i][1]);
+        if (en == nullptr)
+          throw Hermes::Exceptions::MeshLoadFailureException("Boundary data error (edge %d-%d does not exist).", mark[i][0], mark[i][1]);
+        en->marker = boundary_markers[i];
+      }
+
+      nbase = nactive = ninitial = ne;
+      seq = g_mesh_seq++;
+    }
+
     int Mesh::get_num_elements() const
     {
       if (this == nullptr) throw Hermes::Exceptions::Exception("this == nullptr in Mesh::get_num_elements().");
@@ -758,10 +948,13 @@ namespace Hermes
 
       elements.set_append_only(true);
 
-      Element* e;
+      if (refinement != 0 || !this->refine_all_elements_parallel())
+      {
+        Element* e;
 
-      for_all_active_elements(e, this)
-        refine_element(e, refinement);
+        for_all_active_elements(e, this)
+          refine_element(e, refinement);
+      }
 
       elements.set_append_only(false);
 
@@ -769,6 +962,321 @@ namespace Hermes
         ninitial = this->get_max_element_id();
     }
 
+    /// Split of an edge of the active elements in the parallel refinement.
+    struct EdgeSplit
+    {
+      /// The edge before the refinement (the edge node may also be a half of another edge, and as such changed by the refinement).
+      int p1, p2, marker;
+      bool bnd;
+      Element* elements[2];
+      /// Mid-edge vertex node, the halves adjacent to the vertex p1 and p2 of the edge.
+      int mid, half[2];
+      /// The nodes created by the refinement (not present in the mesh before).
+      bool created[3];
+    };
+
+    bool Mesh::refine_all_elements_parallel()
+    {
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel() || num_threads < 2 || this->nactive < H2D_PARALLEL_REFINEMENT_MIN_ELEMENTS)
+        return false;
+
+      // Active elements, the sons of the k-th one get the ids first_son_id + 4k, ..., first_son_id + 4k + 3
+      // (as in the serial refinement).
+      std::vector<Element*> active;
+      active.reserve(this->nactive);
+      std::vector<int> active_index(this->get_max_element_id(), -1);
+      Element* e;
+      for_all_active_elements(e, this)
+      {
+        // Mid-edge points of curved elements come from the curvilinear map, left to the serial refinement.
+        if (e->is_curved())
+          return false;
+        active_index[e->id] = active.size();
+        active.push_back(e);
+      }
+      int active_count = active.size();
+
+      // Unique edges of the active elements.
+      std::vector<int> edge_index(this->get_max_node_id(), -1);
+      std::vector<int> element_edges(H2D_MAX_NUMBER_EDGES * active_count);
+      std::vector<Node*> edges;
+      edges.reserve(2 * active_count);
+      for (int k = 0; k < active_count; k++)
+      {
+        for (int i = 0; i < active[k]->nvert; i++)
+        {
+          Node* en = active[k]->en[i];
+          if (edge_index[en->id] < 0)
+          {
+            edge_index[en->id] = edges.size();
+            edges.push_back(en);
+          }
+          element_edges[H2D_MAX_NUMBER_EDGES * k + i] = edge_index[en->id];
+        }
+      }
+      int edge_count = edges.size();
+
+      // Mid-edge vertex nodes and halves of the edges that are already present (hanging nodes, finer neighbors).
+      std::vector<EdgeSplit> splits(edge_count);
+#pragma omp parallel for num_threads(num_threads)
+      for (int edge_i = 0; edge_i < edge_count; edge_i++)
+      {
+        Node* en = edges[edge_i];
+        EdgeSplit& split = splits[edge_i];
+        split.p1 = en->p1;
+        split.p2 = en->p2;
+        split.marker = en->marker;
+        split.bnd = en->bnd;
+        split.elements[0] = en->elem[0];
+        split.elements[1] = en->elem[1];
+        Node* mid = this->peek_vertex_node(en->p1, en->p2);
+        split.mid = mid ? mid->id : -1;
+        for (int j = 0; j < 2; j++)
+        {
+          Node* half = mid ? this->peek_edge_node(j ? en->p2 : en->p1, mid->id) : nullptr;
+          split.half[j] = half ? half->id : -1;
+        }
+      }
+
+      // Ids of the new_ nodes - first the nodes on the edges, then the interior ones (5 for a quad, 3 for a triangle).
+      int new_node_count = 0;
+      for (int edge_i = 0; edge_i < edge_count; edge_i++)
+        new_node_count += (splits[edge_i].mid < 0) + (splits[edge_i].half[0] < 0) + (splits[edge_i].half[1] < 0);
+      for (int k = 0; k < active_count; k++)
+        new_node_count += active[k]->is_triangle() ? 3 : 5;
+
+      int next_node_id = this->nodes.add_range(new_node_count);
+      for (int edge_i = 0; edge_i < edge_count; edge_i++)
+      {
+        EdgeSplit& split = splits[edge_i];
+        int* ids[3] = { &split.mid, &split.half[0], &split.half[1] };
+        for (int j = 0; j < 3; j++)
+        {
+          split.created[j] = (*ids[j] < 0);
+          if (split.created[j])
+            *ids[j] = next_node_id++;
+        }
+      }
+      std::vector<int> interior_nodes(active_count);
+      for (int k = 0; k < active_count; k++)
+      {
+        interior_nodes[k] = next_node_id;
+        next_node_id += active[k]->is_triangle() ? 3 : 5;
+      }
+
+      int first_son_id = this->elements.add_range(H2D_MAX_ELEMENT_SONS * active_count);
+
+      // The edges are no longer used by the (refined) elements.
+#pragma omp parallel for num_threads(num_threads)
+      for (int edge_i = 0; edge_i < edge_count; edge_i++)
+      {
+        Node* en = edges[edge_i];
+        en->elem[0] = en->elem[1] = nullptr;
+        en->ref -= (splits[edge_i].elements[0] != nullptr) + (splits[edge_i].elements[1] != nullptr);
+      }
+
+      // Nodes derived from the edges - each edge processed by one thread only.
+      std::string exceptionMessageCaughtInParallelBlock;
+#pragma omp parallel for num_threads(num_threads)
+      for (int edge_i = 0; edge_i < edge_count; edge_i++)
+      {
+        try
+        {
+          const EdgeSplit& split = splits[edge_i];
+
+          Node* mid = &this->nodes[split.mid];
+          if (split.created[0])
+          {
+            mid->type = HERMES_TYPE_VERTEX;
+            mid->ref = 0;
+            mid->p1 = std::min(split.p1, split.p2);
+            mid->p2 = std::max(split.p1, split.p2);
+            mid->x = (this->nodes[split.p1].x + this->nodes[split.p2].x) * 0.5;
+            mid->y = (this->nodes[split.p1].y + this->nodes[split.p2].y) * 0.5;
+          }
+          mid->bnd = split.bnd;
+
+          for (int j = 0; j < 2; j++)
+          {
+            Node* half = &this->nodes[split.half[j]];
+            if (split.created[j + 1])
+            {
+              half->type = HERMES_TYPE_EDGE;
+              half->ref = 0;
+              half->p1 = std::min(j ? split.p2 : split.p1, mid->id);
+              half->p2 = std::max(j ? split.p2 : split.p1, mid->id);
+              half->elem[0] = half->elem[1] = nullptr;
+            }
+            half->bnd = split.bnd;
+            half->marker = split.marker;
+          }
+
+          // The elements sharing the edge - sons adjacent to the halves, references to the mid-edge vertex.
+          for (int slot = 0; slot < 2; slot++)
+          {
+            Element* parent = split.elements[slot];
+            if (parent == nullptr)
+              continue;
+
+            int k = active_index[parent->id];
+            int i = 0;
+            while (element_edges[H2D_MAX_NUMBER_EDGES * k + i] != edge_i)
+              i++;
+            int i_next = parent->next_vert(i);
+            Element* son_at_vertex_i = &this->elements[first_son_id + H2D_MAX_ELEMENT_SONS * k + i];
+            Element* son_at_vertex_i_next = &this->elements[first_son_id + H2D_MAX_ELEMENT_SONS * k + i_next];
+            bool vertex_i_is_p1 = (parent->vn[i]->id == split.p1);
+            this->nodes[split.half[vertex_i_is_p1 ? 0 : 1]].ref_element(son_at_vertex_i);
+            this->nodes[split.half[vertex_i_is_p1 ? 1 : 0]].ref_element(son_at_vertex_i_next);
+
+            // Quads: two sons, triangles: two sons and the central one.
+            mid->ref += parent->is_triangle() ? 3 : 2;
+          }
+        }
+        catch (std::exception& exception)
+        {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+          exceptionMessageCaughtInParallelBlock = exception.what();
+        }
+      }
+
+      if (!exceptionMessageCaughtInParallelBlock.empty())
+        throw Hermes::Exceptions::Exception(exceptionMessageCaughtInParallelBlock.c_str());
+
+      // Elements - the sons and the interior nodes are processed by one thread only.
+#pragma omp parallel for num_threads(num_threads)
+      for (int k = 0; k < active_count; k++)
+      {
+        Element* parent = active[k];
+        int nvert = parent->nvert;
+        Element* sons[H2D_MAX_ELEMENT_SONS];
+        for (int s = 0; s < H2D_MAX_ELEMENT_SONS; s++)
+          sons[s] = &this->elements[first_son_id + H2D_MAX_ELEMENT_SONS * k + s];
+
+        // Vertices, mid-edge vertices, halves of the edges adjacent to the vertex i / next_vert(i).
+        Node* v[H2D_MAX_NUMBER_VERTICES], *x[H2D_MAX_NUMBER_EDGES], *h_lo[H2D_MAX_NUMBER_EDGES], *h_hi[H2D_MAX_NUMBER_EDGES];
+        for (int i = 0; i < nvert; i++)
+        {
+          int edge_i = element_edges[H2D_MAX_NUMBER_EDGES * k + i];
+          const EdgeSplit& split = splits[edge_i];
+          bool vertex_i_is_p1 = (parent->vn[i]->id == split.p1);
+          v[i] = parent->vn[i];
+          x[i] = &this->nodes[split.mid];
+          h_lo[i] = &this->nodes[split.half[vertex_i_is_p1 ? 0 : 1]];
+          h_hi[i] = &this->nodes[split.half[vertex_i_is_p1 ? 1 : 0]];
+        }
+
+        // Interior nodes.
+        Node* interior[5];
+        for (int j = 0; j < (parent->is_triangle() ? 3 : 5); j++)
+          interior[j] = &this->nodes[interior_nodes[k] + j];
+
+        Node* son_vn[H2D_MAX_ELEMENT_SONS][H2D_MAX_NUMBER_VERTICES];
+        Node* son_en[H2D_MAX_ELEMENT_SONS][H2D_MAX_NUMBER_EDGES];
+        Node* interior_edges[H2D_MAX_NUMBER_EDGES];
+        if (parent->is_triangle())
+        {
+          // Edges x0-x1, x1-x2, x2-x0.
+          for (int i = 0; i < 3; i++)
+            interior_edges[i] = interior[i];
+          for (int i = 0; i < 3; i++)
+          {
+            int i_next = (i + 1) % 3;
+            interior_edges[i]->p1 = std::min(x[i]->id, x[i_next]->id);
+            interior_edges[i]->p2 = std::max(x[i]->id, x[i_next]->id);
+          }
+
+          // Same sons as in refine_triangle_to_triangles().
+          Node* vn[4][3] = { { v[0], x[0], x[2] }, { x[0], v[1], x[1] }, { x[2], x[1], v[2] }, { x[1], x[2], x[0] } };
+          Node* en[4][3] = { { h_lo[0], interior_edges[2], h_hi[2] }, { h_hi[0], h_lo[1], interior_edges[0] },
+          { interior_edges[1], h_hi[1], h_lo[2] }, { interior_edges[1], interior_edges[2], interior_edges[0] } };
+          // The rows are shorter than those of son_vn / son_en.
+          for (int s = 0; s < 4; s++)
+          {
+            memcpy(son_vn[s], vn[s], sizeof(vn[s]));
+            memcpy(son_en[s], en[s], sizeof(en[s]));
+          }
+        }
+        else
+        {
+          // Mid-element vertex, edges x_i-mid.
+          Node* mid = interior[0];
+          mid->type = HERMES_TYPE_VERTEX;
+          mid->ref = 4;
+          mid->bnd = 0;
+          mid->p1 = std::min(x[0]->id, x[2]->id);
+          mid->p2 = std::max(x[0]->id, x[2]->id);
+          mid->x = (x[0]->x + x[2]->x) * 0.5;
+          mid->y = (x[0]->y + x[2]->y) * 0.5;
+          for (int i = 0; i < 4; i++)
+          {
+            interior_edges[i] = interior[i + 1];
+            interior_edges[i]->p1 = std::min(x[i]->id, mid->id);
+            interior_edges[i]->p2 = std::max(x[i]->id, mid->id);
+          }
+
+          // Same sons as in refine_quad().
+          Node* vn[4][4] = { { v[0], x[0], mid, x[3] }, { x[0], v[1], x[1], mid }, { mid, x[1], v[2], x[2] }, { x[3], mid, x[2], v[3] } };
+          Node* en[4][4] = { { h_lo[0], interior_edges[0], interior_edges[3], h_hi[3] }, { h_hi[0], h_lo[1], interior_edges[1], interior_edges[0] },
+          { interior_edges[1], h_hi[1], h_lo[2], interior_edges[2] }, { interior_edges[3], interior_edges[2], h_hi[2], h_lo[3] } };
+          memcpy(son_vn, vn, sizeof(vn));
+          memcpy(son_en, en, sizeof(en));
+        }
+
+        for (int i = 0; i < (parent->is_triangle() ? 3 : 4); i++)
+        {
+          interior_edges[i]->type = HERMES_TYPE_EDGE;
+          interior_edges[i]->ref = 0;
+          interior_edges[i]->bnd = 0;
+          interior_edges[i]->marker = 0;
+          interior_edges[i]->elem[0] = interior_edges[i]->elem[1] = nullptr;
+        }
+
+        for (int s = 0; s < H2D_MAX_ELEMENT_SONS; s++)
+        {
+          Element* son = sons[s];
+          son->active = 1;
+          son->marker = parent->marker;
+          son->nvert = nvert;
+          son->iro_cache = parent->iro_cache;
+          son->cm = nullptr;
+          son->parent = parent;
+          son->visited = false;
+          for (int i = 0; i < nvert; i++)
+          {
+            son->vn[i] = son_vn[s][i];
+            son->en[i] = son_en[s][i];
+          }
+
+          // References of the shared nodes have been set with the edges.
+          for (int i = 0; i < nvert; i++)
+            for (int j = 0; j < (parent->is_triangle() ? 3 : 4); j++)
+              if (son->en[i] == interior_edges[j])
+                son->en[i]->ref_element(son);
+          son->calc_area();
+          son->calc_diameter();
+        }
+
+        parent->active = 0;
+        memcpy(parent->sons, sons, sizeof(sons));
+      }
+
+      // Search tables, removal of the unused edges (an edge may have been reused as a half of another one).
+      for (int node_i = this->nodes.get_size() - new_node_count; node_i < this->nodes.get_size(); node_i++)
+        this->insert_node(&this->nodes[node_i]);
+      for (int edge_i = 0; edge_i < edge_count; edge_i++)
+        if (edges[edge_i]->ref == 0)
+          this->remove_edge_node(edges[edge_i]->id);
+
+      for (int k = 0; k < active_count; k++)
+        this->refinements.push_back(std::pair<unsigned int, int>(active[k]->id, 0));
+      this->nactive += 3 * active_count;
+      this->seq = g_mesh_seq++;
+
+      return true;
+    }
+
     static int rtb_marker;
     static bool rtb_aniso;
     static char* rtb_vert;
@@ -1262,13 +1770,20 @@ namespace Hermes
       HashTable::free();
 
       if (this->meshHashGrid)
+      {
         delete this->meshHashGrid;
+        this->meshHashGrid = nullptr;
+      }
+      delete this->meshSnapshot.exchange(nullptr);
 
       this->boundary_markers_conversion.conversion_table.clear();
       this->boundary_markers_conversion.conversion_table_inverse.clear();
       this->element_markers_conversion.conversion_table.clear();
       this->element_markers_conversion.conversion_table_inverse.clear();
       this->refinements.clear();
+
+      // The union mesh constructed from this mesh is not needed anymore.
+      Traverse::free_union_mesh_cache(this->seq);
       this->seq = -1;
 
       for (std::map<int, MarkerArea*>::iterator p = marker_areas.begin(); p != marker_areas.end(); p++)
@@ -1278,20 +1793,46 @@ namespace Hermes
 
     Element* Mesh::element_on_physical_coordinates(double x, double y)
     {
-      // If no hash grid exists, create one.
-      if (!this->meshHashGrid)
-        this->meshHashGrid = new MeshHashGrid(this);
-      else
+      return this->get_hash_grid()->getElement(x, y);
+    }
+
+    MeshHashGrid* Mesh::get_hash_grid()
+    {
+#pragma omp critical (mesh_hash_grid)
       {
-        // If no the hash grid exists, but the mesh has been refined afterwards, re-create.
-        if (this->get_seq() != this->meshHashGrid->get_mesh_seq())
+        // If the hash grid exists, but the mesh has been refined afterwards, re-create.
+        if (this->meshHashGrid && this->get_seq() != this->meshHashGrid->get_mesh_seq())
         {
           delete this->meshHashGrid;
+          this->meshHashGrid = nullptr;
+        }
+        if (!this->meshHashGrid)
           this->meshHashGrid = new MeshHashGrid(this);
+      }
+
+      return this->meshHashGrid;
+    }
+
+    const MeshSnapshot* Mesh::get_snapshot()
+    {
+      // Called from the assembling threads - an up-to-date snapshot is returned without locking.
+      MeshSnapshot* snapshot = this->meshSnapshot.load(std::memory_order_acquire);
+      if (snapshot && snapshot->get_mesh_seq() == this->get_seq())
+        return snapshot;
+
+#pragma omp critical (mesh_snapshot)
+      {
+        // Another thread may have re-created it meanwhile.
+        snapshot = this->meshSnapshot.load(std::memory_order_acquire);
+        if (!snapshot || snapshot->get_mesh_seq() != this->get_seq())
+        {
+          delete snapshot;
+          snapshot = new MeshSnapshot(this);
+          this->meshSnapshot.store(snapshot, std::memory_order_release);
         }
       }
 
-      return this->meshHashGrid->getElement(x, y);
+      return snapshot;
     }
 
     double Mesh::get_marker_area(int marker)
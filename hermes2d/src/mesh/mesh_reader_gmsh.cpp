@@ -0,0 +1,583 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#include "mesh_reader_gmsh.h"
+#include "mesh.h"
+#include "refmap.h"
+#include "api2d.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    MeshReaderGmsh::MeshReaderGmsh()
+    {
+    }
+
+    MeshReaderGmsh::~MeshReaderGmsh()
+    {
+    }
+
+    /// Binary MSH file - the section headers are text lines, the data are binary.
+    class GmshFile
+    {
+    public:
+      GmshFile(const char* filename) : filename(filename), data_size(8)
+      {
+        this->file = fopen(filename, "rb");
+        if (!this->file)
+          throw Hermes::Exceptions::MeshLoadFailureException("Mesh file %s not found.", filename);
+      }
+
+      ~GmshFile()
+      {
+        fclose(this->file);
+      }
+
+      /// Reads a text line (without the end of line), returns false at the end of the file.
+      bool line(std::string& text)
+      {
+        text.clear();
+        int c;
+        while ((c = fgetc(this->file)) != EOF && c != '\n')
+          text.push_back((char)c);
+        if (!text.empty() && text[text.size() - 1] == '\r')
+          text.erase(text.size() - 1);
+        return c != EOF || !text.empty();
+      }
+
+      /// Reads the end of the section name (after the binary data, the empty lines are skipped).
+      void section_end(const char* name)
+      {
+        std::string text;
+        do
+        {
+          if (!this->line(text))
+            throw Hermes::Exceptions::MeshLoadFailureException("Unexpected end of the mesh file %s, $End%s missing.", this->filename, name);
+        } while (text.empty());
+        if (text != std::string("$End") + name)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted section $%s in the mesh file %s.", name, this->filename);
+      }
+
+      /// Skips a section of an unknown length.
+      void skip_section(const std::string& name)
+      {
+        std::string end = "$End" + name, text;
+        while (this->line(text))
+          if (text == end)
+            return;
+        throw Hermes::Exceptions::MeshLoadFailureException("Unexpected end of the mesh file %s, %s missing.", this->filename, end.c_str());
+      }
+
+      void read(void* data, size_t size)
+      {
+        if (size > 0 && fread(data, size, 1, this->file) != 1)
+          throw Hermes::Exceptions::MeshLoadFailureException("Unexpected end of the mesh file %s.", this->filename);
+      }
+
+      int read_int()
+      {
+        int value;
+        this->read(&value, sizeof(int));
+        return value;
+      }
+
+      double read_double()
+      {
+        double value;
+        this->read(&value, sizeof(double));
+        return value;
+      }
+
+      /// Reads a size_t value of the writing platform (data-size bytes).
+      size_t read_size()
+      {
+        char data[8];
+        this->read(data, this->data_size);
+        return size_value(data, 0);
+      }
+
+      /// The index-th size_t value of the writing platform in data.
+      size_t size_value(const char* data, size_t index) const
+      {
+        if (this->data_size == 8)
+        {
+          uint64_t value;
+          memcpy(&value, data + 8 * index, 8);
+          return (size_t)value;
+        }
+        else
+        {
+          uint32_t value;
+          memcpy(&value, data + 4 * index, 4);
+          return value;
+        }
+      }
+
+      FILE* file;
+      const char* filename;
+      int data_size;
+    };
+
+    /// Element types of Gmsh (the linear ones, and the higher-order ones that are taken as straight).
+    static bool gmsh_element_type(int type, int& node_count, int& corner_count)
+    {
+      switch (type)
+      {
+      case 1: node_count = 2; corner_count = 2; return true;
+      case 8: node_count = 3; corner_count = 2; return true;
+      case 26: node_count = 4; corner_count = 2; return true;
+      case 27: node_count = 5; corner_count = 2; return true;
+      case 28: node_count = 6; corner_count = 2; return true;
+      case 2: node_count = 3; corner_count = 3; return true;
+      case 9: node_count = 6; corner_count = 3; return true;
+      case 20: node_count = 9; corner_count = 3; return true;
+      case 21: node_count = 10; corner_count = 3; return true;
+      case 3: node_count = 4; corner_count = 4; return true;
+      case 10: node_count = 9; corner_count = 4; return true;
+      case 16: node_count = 8; corner_count = 4; return true;
+      case 36: node_count = 16; corner_count = 4; return true;
+      case 15: node_count = 1; corner_count = 1; return true;
+      default: return false;
+      }
+    }
+
+    /// Lookup of the node indices by the node tags, a direct table for (usual) dense tags, a sorted list otherwise.
+    class GmshNodeIndex
+    {
+    public:
+      void init(size_t min_tag, size_t max_tag, size_t count)
+      {
+        this->min_tag = min_tag;
+        this->dense = (max_tag - min_tag < 4 * count + 1024);
+        if (this->dense)
+          this->table.assign(max_tag - min_tag + 1, -1);
+      }
+
+      /// Can be called in parallel for different tags (dense tables), otherwise the list is sorted in finish().
+      void add(size_t tag, int index)
+      {
+        if (this->dense)
+          this->table[tag - this->min_tag] = index;
+        else
+          this->list[index] = std::pair<size_t, int>(tag, index);
+      }
+
+      void reserve(size_t count)
+      {
+        if (!this->dense)
+          this->list.resize(count);
+      }
+
+      void finish()
+      {
+        if (!this->dense)
+          std::sort(this->list.begin(), this->list.end());
+      }
+
+      /// -1 if there is no such node.
+      int find(size_t tag) const
+      {
+        if (this->dense)
+          return (tag < this->min_tag || tag - this->min_tag >= this->table.size()) ? -1 : this->table[tag - this->min_tag];
+        std::vector<std::pair<size_t, int> >::const_iterator it = std::lower_bound(this->list.begin(), this->list.end(), std::pair<size_t, int>(tag, -1));
+        return (it == this->list.end() || it->first != tag) ? -1 : it->second;
+      }
+
+    protected:
+      size_t min_tag;
+      bool dense;
+      std::vector<int> table;
+      std::vector<std::pair<size_t, int> > list;
+    };
+
+    /// The marker of an entity - its first physical group (name, or number), or its tag.
+    static std::string gmsh_marker(const std::map<int, std::vector<int> >& entity_physicals, const std::map<int, std::string>& physical_names, int entity_tag)
+    {
+      std::ostringstream string_stream;
+      std::map<int, std::vector<int> >::const_iterator entity = entity_physicals.find(entity_tag);
+      if (entity != entity_physicals.end() && !entity->second.empty())
+      {
+        int physical_tag = entity->second.front();
+        std::map<int, std::string>::const_iterator name = physical_names.find(physical_tag);
+        if (name != physical_names.end())
+          return name->second;
+        string_stream << physical_tag;
+      }
+      else
+        string_stream << entity_tag;
+      return string_stream.str();
+    }
+
+    void MeshReaderGmsh::load(const char *filename, MeshSharedPtr mesh)
+    {
+      if (!mesh)
+        throw Exceptions::NullException(1);
+
+      mesh->free();
+
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel())
+        num_threads = 1;
+
+      GmshFile file(filename);
+
+      // Physical groups: names (dimension, tag) -> name, physical tags of the curves and the surfaces.
+      std::map<int, std::string> physical_names[4];
+      std::map<int, std::vector<int> > entity_physicals[4];
+
+      // Nodes (x, y) in the order of the file.
+      std::vector<double> node_coordinates;
+      GmshNodeIndex node_index;
+
+      // Corner nodes (indices of the nodes, four per element, -1 as the fourth for triangles) of the elements, their entities.
+      std::vector<int> elements;
+      std::vector<int> element_entities;
+      // Line elements (two nodes per line) - the edges with boundary markers.
+      std::vector<int> lines;
+      std::vector<int> line_entities;
+
+      bool format_read = false, nodes_read = false, elements_read = false, higher_order_warned = false;
+      std::string text;
+      while (file.line(text))
+      {
+        if (text.empty())
+          continue;
+        if (text[0] != '$')
+          throw Hermes::Exceptions::MeshLoadFailureException("Unexpected text '%s' in the mesh file %s.", text.c_str(), filename);
+        std::string section = text.substr(1);
+
+        if (section == "MeshFormat")
+        {
+          if (!file.line(text))
+            throw Hermes::Exceptions::MeshLoadFailureException("Unexpected end of the mesh file %s.", filename);
+          double version;
+          int file_type, data_size;
+          if (sscanf(text.c_str(), "%lf %d %d", &version, &file_type, &data_size) != 3)
+            throw Hermes::Exceptions::MeshLoadFailureException("Corrupted $MeshFormat in the mesh file %s.", filename);
+          if (version < 4.1 - 1e-10 || version >= 5.)
+            throw Hermes::Exceptions::MeshLoadFailureException("Mesh file %s is in the MSH version %g, only 4.1 is supported.", filename, version);
+          if (file_type != 1)
+            throw Hermes::Exceptions::MeshLoadFailureException("Mesh file %s is in the ASCII format, only the binary MSH format is supported.", filename);
+          if (data_size != 4 && data_size != 8)
+            throw Hermes::Exceptions::MeshLoadFailureException("Unsupported data size %d in the mesh file %s.", data_size, filename);
+          file.data_size = data_size;
+          if (file.read_int() != 1)
+            throw Hermes::Exceptions::MeshLoadFailureException("Mesh file %s was written on a platform of different endianness.", filename);
+          file.section_end("MeshFormat");
+          format_read = true;
+        }
+        else if (!format_read)
+          throw Hermes::Exceptions::MeshLoadFailureException("Mesh file %s does not start with $MeshFormat.", filename);
+        else if (section == "PhysicalNames")
+        {
+          // Text even in the binary files.
+          if (!file.line(text))
+            throw Hermes::Exceptions::MeshLoadFailureException("Unexpected end of the mesh file %s.", filename);
+          int count = atoi(text.c_str());
+          for (int i = 0; i < count; i++)
+          {
+            if (!file.line(text))
+              throw Hermes::Exceptions::MeshLoadFailureException("Unexpected end of the mesh file %s.", filename);
+            int dimension, tag;
+            char name[256];
+            if (sscanf(text.c_str(), "%d %d \"%255[^\"]\"", &dimension, &tag, name) != 3 || dimension < 0 || dimension > 3)
+              throw Hermes::Exceptions::MeshLoadFailureException("Corrupted $PhysicalNames in the mesh file %s.", filename);
+            physical_names[dimension][tag] = name;
+          }
+          file.section_end("PhysicalNames");
+        }
+        else if (section == "Entities")
+        {
+          size_t counts[4];
+          for (int dimension = 0; dimension < 4; dimension++)
+            counts[dimension] = file.read_size();
+          for (int dimension = 0; dimension < 4; dimension++)
+          {
+            for (size_t i = 0; i < counts[dimension]; i++)
+            {
+              int tag = file.read_int();
+              // Point (x, y, z) or the bounding box.
+              for (int j = 0; j < (dimension ? 6 : 3); j++)
+                file.read_double();
+              std::vector<int>& physicals = entity_physicals[dimension][tag];
+              physicals.resize(file.read_size());
+              for (size_t j = 0; j < physicals.size(); j++)
+                physicals[j] = file.read_int();
+              if (dimension)
+              {
+                size_t bounding_count = file.read_size();
+                for (size_t j = 0; j < bounding_count; j++)
+                  file.read_int();
+              }
+            }
+          }
+          file.section_end("Entities");
+        }
+        else if (section == "PartitionedEntities")
+          throw Hermes::Exceptions::MeshLoadFailureException("Mesh file %s is partitioned, partitioned meshes are not supported.", filename);
+        else if (section == "Nodes")
+        {
+          size_t block_count = file.read_size();
+          size_t node_count = file.read_size();
+          size_t min_tag = file.read_size();
+          size_t max_tag = file.read_size();
+          if (node_count > (size_t)INT_MAX)
+            throw Hermes::Exceptions::MeshLoadFailureException("Too many nodes in the mesh file %s.", filename);
+
+          node_coordinates.resize(2 * node_count);
+          node_index.init(min_tag, max_tag, node_count);
+          node_index.reserve(node_count);
+
+          std::vector<char> tags;
+          std::vector<double> coordinates;
+          size_t first = 0;
+          for (size_t block_i = 0; block_i < block_count; block_i++)
+          {
+            int dimension = file.read_int();
+            file.read_int();
+            int parametric = file.read_int();
+            size_t count = file.read_size();
+            if (first + count > node_count)
+              throw Hermes::Exceptions::MeshLoadFailureException("Corrupted $Nodes in the mesh file %s.", filename);
+
+            // The tags, then the coordinates x, y, z (and the parametric ones).
+            int values_per_node = 3 + (parametric ? dimension : 0);
+            tags.resize(count * file.data_size);
+            coordinates.resize(count * values_per_node);
+            file.read(tags.data(), tags.size());
+            file.read(coordinates.data(), coordinates.size() * sizeof(double));
+
+            std::string exceptionMessageCaughtInParallelBlock;
+            int block_num_threads = (count < H2D_MESH_READER_GMSH_MIN_PARALLEL_SIZE) ? 1 : num_threads;
+#pragma omp parallel for num_threads(block_num_threads)
+            for (int i = 0; i < (int)count; i++)
+            {
+              size_t tag = file.size_value(tags.data(), i);
+              if (tag < min_tag || tag > max_tag)
+              {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+                exceptionMessageCaughtInParallelBlock = "Node tag out of the range in $Nodes.";
+                continue;
+              }
+              node_index.add(tag, (int)(first + i));
+              node_coordinates[2 * (first + i)] = coordinates[values_per_node * i];
+              node_coordinates[2 * (first + i) + 1] = coordinates[values_per_node * i + 1];
+            }
+            if (!exceptionMessageCaughtInParallelBlock.empty())
+              throw Hermes::Exceptions::MeshLoadFailureException("%s (mesh file %s)", exceptionMessageCaughtInParallelBlock.c_str(), filename);
+            first += count;
+          }
+          if (first != node_count)
+            throw Hermes::Exceptions::MeshLoadFailureException("Corrupted $Nodes in the mesh file %s.", filename);
+          node_index.finish();
+          file.section_end("Nodes");
+          nodes_read = true;
+        }
+        else if (section == "Elements")
+        {
+          if (!nodes_read)
+            throw Hermes::Exceptions::MeshLoadFailureException("$Elements before $Nodes in the mesh file %s.", filename);
+
+          size_t block_count = file.read_size();
+          file.read_size();
+          file.read_size();
+          file.read_size();
+
+          std::vector<char> data;
+          for (size_t block_i = 0; block_i < block_count; block_i++)
+          {
+            int dimension = file.read_int();
+            int entity_tag = file.read_int();
+            int type = file.read_int();
+            size_t count = file.read_size();
+
+            int node_count, corner_count;
+            if (!gmsh_element_type(type, node_count, corner_count))
+              throw Hermes::Exceptions::MeshLoadFailureException("Unsupported element type %d in the mesh file %s.", type, filename);
+            if (dimension == 3)
+              throw Hermes::Exceptions::MeshLoadFailureException("Mesh file %s contains a 3D mesh.", filename);
+
+            // The tag and the nodes of every element.
+            int values_per_element = 1 + node_count;
+            data.resize(count * values_per_element * file.data_size);
+            file.read(data.data(), data.size());
+
+            if (dimension == 0)
+              continue;
+            if (node_count > corner_count && !higher_order_warned)
+            {
+              this->warn("Higher-order elements in the mesh file %s are taken as straight.", filename);
+              higher_order_warned = true;
+            }
+
+            size_t first;
+            if (dimension == 2)
+            {
+              first = element_entities.size();
+              elements.resize(4 * (first + count));
+              element_entities.resize(first + count, entity_tag);
+            }
+            else
+            {
+              first = line_entities.size();
+              lines.resize(2 * (first + count));
+              line_entities.resize(first + count, entity_tag);
+            }
+
+            std::string exceptionMessageCaughtInParallelBlock;
+            int block_num_threads = (count < H2D_MESH_READER_GMSH_MIN_PARALLEL_SIZE) ? 1 : num_threads;
+#pragma omp parallel for num_threads(block_num_threads)
+            for (int i = 0; i < (int)count; i++)
+            {
+              int corners[4] = { -1, -1, -1, -1 };
+              for (int j = 0; j < corner_count; j++)
+              {
+                corners[j] = node_index.find(file.size_value(data.data(), (size_t)values_per_element * i + 1 + j));
+                if (corners[j] < 0)
+                {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+                  exceptionMessageCaughtInParallelBlock = "Element with a non-existent node in $Elements.";
+                }
+              }
+
+              if (dimension == 2)
+              {
+                // Counter-clockwise orientation.
+                double area = 0.;
+                for (int j = 0; j < corner_count; j++)
+                {
+                  int next = corners[(j + 1) % corner_count];
+                  if (corners[j] >= 0 && next >= 0)
+                    area += node_coordinates[2 * corners[j]] * node_coordinates[2 * next + 1] - node_coordinates[2 * next] * node_coordinates[2 * corners[j] + 1];
+                }
+                if (area < 0.)
+                  std::swap(corners[1], corners[corner_count - 1]);
+                for (int j = 0; j < 4; j++)
+                  elements[4 * (first + i) + j] = corners[j];
+              }
+              else
+              {
+                lines[2 * (first + i)] = corners[0];
+                lines[2 * (first + i) + 1] = corners[1];
+              }
+            }
+            if (!exceptionMessageCaughtInParallelBlock.empty())
+              throw Hermes::Exceptions::MeshLoadFailureException("%s (mesh file %s)", exceptionMessageCaughtInParallelBlock.c_str(), filename);
+          }
+          file.section_end("Elements");
+          elements_read = true;
+        }
+        else
+          file.skip_section(section);
+      }
+
+      if (!elements_read || element_entities.empty())
+        throw Hermes::Exceptions::MeshLoadFailureException("No triangles or quadrilaterals in the mesh file %s.", filename);
+
+      // Only the nodes of the elements are vertices, numbered in the order of the file.
+      int node_count = node_coordinates.size() / 2;
+      std::vector<int> vertex_ids(node_count, 0);
+      for (size_t i = 0; i < elements.size(); i++)
+        if (elements[i] >= 0)
+          vertex_ids[elements[i]] = 1;
+      int vertex_count = 0;
+      for (int i = 0; i < node_count; i++)
+        vertex_ids[i] = vertex_ids[i] ? vertex_count++ : -1;
+
+      double2* vertices = malloc_with_check<double2>(vertex_count);
+#pragma omp parallel for num_threads(node_count < H2D_MESH_READER_GMSH_MIN_PARALLEL_SIZE ? 1 : num_threads)
+      for (int i = 0; i < node_count; i++)
+      {
+        if (vertex_ids[i] >= 0)
+        {
+          vertices[vertex_ids[i]][0] = node_coordinates[2 * i];
+          vertices[vertex_ids[i]][1] = node_coordinates[2 * i + 1];
+        }
+      }
+      std::vector<double>().swap(node_coordinates);
+
+      int element_count = element_entities.size();
+#pragma omp parallel for num_threads(element_count < H2D_MESH_READER_GMSH_MIN_PARALLEL_SIZE ? 1 : num_threads)
+      for (int i = 0; i < 4 * element_count; i++)
+        if (elements[i] >= 0)
+          elements[i] = vertex_ids[elements[i]];
+
+      // Markers - the internal ones are determined once per entity.
+      std::vector<int> element_markers(element_count);
+      std::map<int, int> entity_markers;
+      for (int i = 0; i < element_count; i++)
+      {
+        std::map<int, int>::iterator it = entity_markers.find(element_entities[i]);
+        if (it == entity_markers.end())
+        {
+          int marker = mesh->element_markers_conversion.insert_marker(gmsh_marker(entity_physicals[2], physical_names[2], element_entities[i]));
+          it = entity_markers.insert(std::pair<int, int>(element_entities[i], marker)).first;
+        }
+        element_markers[i] = it->second;
+      }
+
+      // Lines on the edges of the mesh (the lines connecting other nodes are ignored).
+      std::vector<int> marked_edges;
+      std::vector<int> boundary_markers;
+      entity_markers.clear();
+      for (size_t i = 0; i < line_entities.size(); i++)
+      {
+        int v0 = vertex_ids[lines[2 * i]], v1 = vertex_ids[lines[2 * i + 1]];
+        if (v0 < 0 || v1 < 0)
+          continue;
+        std::map<int, int>::iterator it = entity_markers.find(line_entities[i]);
+        if (it == entity_markers.end())
+        {
+          int marker = mesh->boundary_markers_conversion.insert_marker(gmsh_marker(entity_physicals[1], physical_names[1], line_entities[i]));
+          it = entity_markers.insert(std::pair<int, int>(line_entities[i], marker)).first;
+        }
+        marked_edges.push_back(v0);
+        marked_edges.push_back(v1);
+        boundary_markers.push_back(it->second);
+      }
+
+      try
+      {
+        mesh->create_bulk(vertex_count, vertices, element_count, (const int4*)elements.data(), element_markers.data(),
+          boundary_markers.size(), (const int2*)marked_edges.data(), boundary_markers.data());
+      }
+      catch (...)
+      {
+        free_with_check(vertices);
+        throw;
+      }
+      free_with_check(vertices);
+
+      // check that all boundary edges have a marker assigned
+      Node* node;
+      for_all_edge_nodes(node, mesh)
+      {
+        if (node->ref < 2 && node->marker == 0)
+        {
+          this->warn("Boundary edge node does not have a boundary marker.");
+          break;
+        }
+      }
+
+      Element* e;
+      for_all_used_elements(e, mesh)
+        RefMap::set_element_iro_cache(e);
+
+      if (HermesCommonApi.get_integral_param_value(checkMeshesOnLoad))
+        mesh->initial_single_check();
+    }
+  }
+}
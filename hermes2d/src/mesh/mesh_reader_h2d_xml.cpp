@@ -17,6 +17,7 @@
 #include "api2d.h"
 #include "mesh_reader_h2d_xml.h"
 #include "refmap.h"
+#include "xml_stream.h"
 
 using namespace std;
 
@@ -34,6 +35,12 @@ namespace Hermes
 
     void MeshReaderH2DXML::load(const char *filename, MeshSharedPtr mesh)
     {
+      if (!this->validate)
+      {
+        load_streamed(filename, mesh);
+        return;
+      }
+
       try
       {
         ::xml_schema::flags parsing_flags = 0;
@@ -89,65 +96,350 @@ namespace Hermes
       }
     }
 
+    /// Trims the whitespaces around a marker.
+    static void trim_marker(std::string& marker)
+    {
+      size_t begin = marker.find_first_not_of(" \t\n");
+      if (begin == std::string::npos)
+      {
+        marker.clear();
+        return;
+      }
+      size_t end = marker.find_last_not_of(" \t\n");
+      marker.erase(end + 1, marker.length());
+      marker.erase(0, begin);
+    }
+
+    /// Internal number of the vertex with the number vertex_number in the file.
+    static int find_vertex(const std::vector<int>& vertex_is, int vertex_number)
+    {
+      if (vertex_number < 0 || vertex_number >= (int)vertex_is.size() || vertex_is[vertex_number] == -1)
+        throw Hermes::Exceptions::MeshLoadFailureException("Vertex %d does not exist.", vertex_number);
+      return vertex_is[vertex_number];
+    }
+
+    void MeshReaderH2DXML::load_streamed(const char *filename, MeshSharedPtr mesh)
+    {
+      if (!mesh)
+        throw Exceptions::NullException(1);
+
+      mesh->free();
+      mesh->init();
+
+      XMLStreamReader reader(filename);
+
+      std::map<std::string, double> variables;
+
+      // Internal vertex numbers by the numbers in the file, -1 for unused numbers.
+      std::vector<int> vertex_is;
+
+      // Vertices are collected in batches, the coordinates of a batch are converted in parallel.
+      std::vector<std::string> coordinates(2 * H2D_XML_STREAM_BATCH_SIZE);
+      std::vector<int> vertex_numbers(H2D_XML_STREAM_BATCH_SIZE);
+      double* coordinate_values = malloc_with_check<double>(2 * H2D_XML_STREAM_BATCH_SIZE);
+      int batch_count = 0;
+
+      // NURBS being read, its control points and knots follow it.
+      bool nurbs_open = false;
+      int nurbs_p1, nurbs_p2, nurbs_degree;
+      std::vector<double> nurbs_inner_points, nurbs_knots;
+
+      std::vector<std::pair<int, int> > refinements;
+      int vertices_count = 0, element_count = 0, edge_count = 0, arc_count = 0, nurbs_count = 0;
+      std::string marker;
+
+      try
+      {
+        bool reading = true;
+        while (reading)
+        {
+          reading = reader.next_element();
+
+          // Create the collected vertices before anything else uses them.
+          if (batch_count > 0 && (!reading || !reader.is("v") || batch_count == H2D_XML_STREAM_BATCH_SIZE))
+          {
+            XMLStreamReader::parse_doubles(2 * batch_count, &coordinates[0], coordinate_values);
+            for (int batch_i = 0; batch_i < batch_count; batch_i++)
+            {
+              Node* node = mesh->nodes.add();
+              node->ref = TOP_LEVEL_REF;
+              node->type = HERMES_TYPE_VERTEX;
+              node->bnd = 0;
+              node->p1 = node->p2 = -1;
+
+              // variables lookup.
+              std::map<std::string, double>::const_iterator x_variable = variables.find(coordinates[2 * batch_i]);
+              std::map<std::string, double>::const_iterator y_variable = variables.find(coordinates[2 * batch_i + 1]);
+              node->x = x_variable == variables.end() ? coordinate_values[2 * batch_i] : x_variable->second;
+              node->y = y_variable == variables.end() ? coordinate_values[2 * batch_i + 1] : y_variable->second;
+
+              int vertex_number = vertex_numbers[batch_i];
+              if (vertex_number < 0)
+                throw Hermes::Exceptions::MeshLoadFailureException("Negative vertex number %d.", vertex_number);
+              if (vertex_number >= (int)vertex_is.size())
+                vertex_is.resize(std::max(vertex_number + 1, 2 * (int)vertex_is.size()), -1);
+              vertex_is[vertex_number] = node->id;
+            }
+            vertices_count += batch_count;
+            mesh->ntopvert = vertices_count;
+            batch_count = 0;
+          }
+
+          // The control points and knots of a NURBS end with any other element.
+          if (nurbs_open && (!reading || !(reader.is("inner_point") || reader.is("knot"))))
+          {
+            Node* en;
+            Curve* curve = create_nurbs(mesh, nurbs_count++, &en, nurbs_p1, nurbs_p2, nurbs_degree, nurbs_inner_points, nurbs_knots, false);
+            MeshUtil::assign_curve(en, curve, nurbs_p1, nurbs_p2);
+            nurbs_open = false;
+          }
+
+          if (!reading)
+            break;
+
+          if (reader.is("var"))
+            variables.insert(std::pair<std::string, double>(reader.required_attribute("name"), reader.double_attribute("value")));
+          else if (reader.is("v"))
+          {
+            coordinates[2 * batch_count] = reader.required_attribute("x");
+            coordinates[2 * batch_count + 1] = reader.required_attribute("y");
+            vertex_numbers[batch_count++] = reader.int_attribute("i");
+          }
+          else if (reader.is("t") || reader.is("q"))
+          {
+            marker = reader.required_attribute("m");
+            trim_marker(marker);
+            mesh->element_markers_conversion.insert_marker(marker);
+            int element_marker = mesh->element_markers_conversion.get_internal_marker(marker).marker;
+
+            Node* v1 = &mesh->nodes[find_vertex(vertex_is, reader.int_attribute("v1"))];
+            Node* v2 = &mesh->nodes[find_vertex(vertex_is, reader.int_attribute("v2"))];
+            Node* v3 = &mesh->nodes[find_vertex(vertex_is, reader.int_attribute("v3"))];
+            if (reader.is("q"))
+              mesh->create_quad(element_marker, v1, v2, v3, &mesh->nodes[find_vertex(vertex_is, reader.int_attribute("v4"))], nullptr);
+            else
+              mesh->create_triangle(element_marker, v1, v2, v3, nullptr);
+            mesh->nbase = mesh->nactive = mesh->ninitial = ++element_count;
+          }
+          else if (reader.is("ed"))
+          {
+            int v1 = find_vertex(vertex_is, reader.int_attribute("v1"));
+            int v2 = find_vertex(vertex_is, reader.int_attribute("v2"));
+
+            Node* en = mesh->peek_edge_node(v1, v2);
+            if (en == nullptr)
+              throw Hermes::Exceptions::MeshLoadFailureException("Boundary data #%d: edge %d-%d does not exist.", edge_count, v1, v2);
+
+            marker = reader.required_attribute("m");
+            trim_marker(marker);
+            mesh->boundary_markers_conversion.insert_marker(marker);
+            en->marker = mesh->boundary_markers_conversion.get_internal_marker(marker).marker;
+            edge_count++;
+          }
+          else if (reader.is("arc"))
+          {
+            Node* en;
+            int p1 = find_vertex(vertex_is, reader.int_attribute("v1"));
+            int p2 = find_vertex(vertex_is, reader.int_attribute("v2"));
+            Curve* curve = MeshUtil::load_arc(mesh, arc_count++, &en, p1, p2, reader.double_attribute("angle"));
+            MeshUtil::assign_curve(en, curve, p1, p2);
+          }
+          else if (reader.is("NURBS"))
+          {
+            nurbs_p1 = find_vertex(vertex_is, reader.int_attribute("v1"));
+            nurbs_p2 = find_vertex(vertex_is, reader.int_attribute("v2"));
+            nurbs_degree = reader.int_attribute("deg");
+            nurbs_inner_points.clear();
+            nurbs_knots.clear();
+            nurbs_open = true;
+          }
+          else if (reader.is("inner_point") && nurbs_open)
+          {
+            nurbs_inner_points.push_back(reader.double_attribute("x"));
+            nurbs_inner_points.push_back(reader.double_attribute("y"));
+            nurbs_inner_points.push_back(reader.double_attribute("weight"));
+          }
+          else if (reader.is("knot") && nurbs_open)
+            nurbs_knots.push_back(reader.double_attribute("value"));
+          else if (reader.is("ref"))
+            refinements.push_back(std::pair<int, int>(reader.int_attribute("element_id"), reader.int_attribute("refinement_type")));
+        }
+      }
+      catch (...)
+      {
+        free_with_check(coordinate_values);
+        throw;
+      }
+      free_with_check(coordinate_values);
+
+      if (vertices_count == 0 || element_count == 0)
+        throw Hermes::Exceptions::MeshLoadFailureException("No vertices or elements in the mesh file %s.", filename);
+
+      Node* node;
+      for_all_edge_nodes(node, mesh)
+      {
+        if (node->ref < 2)
+        {
+          mesh->nodes[node->p1].bnd = 1;
+          mesh->nodes[node->p2].bnd = 1;
+          node->bnd = 1;
+        }
+      }
+
+      // check that all boundary edges have a marker assigned
+      for_all_edge_nodes(node, mesh)
+        if (node->ref < 2 && node->marker == 0)
+          this->warn("Boundary edge node does not have a boundary marker.");
+
+      // update refmap coeffs of curvilinear elements
+      Element* e;
+      for_all_used_elements(e, mesh)
+      {
+        if (e->cm != nullptr)
+          e->cm->update_refmap_coeffs(e);
+        RefMap::set_element_iro_cache(e);
+      }
+
+      // perform initial refinements
+      for (unsigned int i = 0; i < refinements.size(); i++)
+      {
+        if (refinements[i].second == -1)
+          mesh->unrefine_element_id(refinements[i].first);
+        else
+          mesh->refine_element_id(refinements[i].first, refinements[i].second);
+      }
+
+      if (HermesCommonApi.get_integral_param_value(checkMeshesOnLoad))
+        mesh->initial_single_check();
+    }
+
     void MeshReaderH2DXML::save(const char *filename, MeshSharedPtr mesh)
     {
       // Utility pointer.
       Element* e;
 
+      std::string mesh_schema_location("XMLMesh ");
+      mesh_schema_location.append(Hermes2DApi.get_text_param_value(xmlSchemasDirPath));
+      mesh_schema_location.append("/mesh_h2d_xml.xsd");
+
+      // The elements are global in the schema (qualified), the rest is local.
+      XMLStreamWriter writer(filename);
+      writer.start_element("mesh:mesh");
+      writer.attribute("xmlns:mesh", "XMLMesh");
+      writer.attribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+      writer.attribute("xsi:schemaLocation", mesh_schema_location);
+
       // save vertices
-      XMLMesh::vertices_type vertices;
+      writer.start_element("vertices");
       for (int i = 0; i < mesh->ntopvert; i++)
-        vertices.v().push_back(std::auto_ptr<XMLMesh::v>(new XMLMesh::v(std::to_string((long double)mesh->nodes[i].x), std::to_string((long double)mesh->nodes[i].y), i)));
+      {
+        writer.start_element("v");
+        writer.attribute("x", mesh->nodes[i].x);
+        writer.attribute("y", mesh->nodes[i].y);
+        writer.attribute("i", i);
+        writer.end_element();
+      }
+      writer.end_element();
 
       // save elements
-      XMLMesh::elements_type elements;
+      writer.start_element("elements");
       for (int i = 0; i < mesh->get_num_base_elements(); i++)
       {
         e = mesh->get_element_fast(i);
         if (e->used)
-          if (e->is_triangle())
-            elements.el().push_back(XMLMesh::t_t(e->vn[0]->id, e->vn[1]->id, e->vn[2]->id, mesh->get_element_markers_conversion().get_user_marker(e->marker).marker.c_str()));
-          else
-            elements.el().push_back(XMLMesh::q_t(e->vn[0]->id, e->vn[1]->id, e->vn[2]->id, mesh->get_element_markers_conversion().get_user_marker(e->marker).marker.c_str(), e->vn[3]->id));
+        {
+          writer.start_element(e->is_triangle() ? "mesh:t" : "mesh:q");
+          writer.attribute("v1", e->vn[0]->id);
+          writer.attribute("v2", e->vn[1]->id);
+          writer.attribute("v3", e->vn[2]->id);
+          writer.attribute("m", mesh->get_element_markers_conversion().get_user_marker(e->marker).marker);
+          if (e->is_quad())
+            writer.attribute("v4", e->vn[3]->id);
+          writer.end_element();
+        }
       }
+      writer.end_element();
+
       // save boundary markers
-      XMLMesh::edges_type edges;
+      writer.start_element("edges");
       for_all_base_elements(e, mesh)
+      {
         for (unsigned char i = 0; i < e->get_nvert(); i++)
+        {
           if (MeshUtil::get_base_edge_node(e, i)->marker)
-            edges.ed().push_back(XMLMesh::ed(e->vn[i]->id, e->vn[e->next_vert(i)]->id, mesh->boundary_markers_conversion.get_user_marker(MeshUtil::get_base_edge_node(e, i)->marker).marker.c_str()));
+          {
+            writer.start_element("ed");
+            writer.attribute("v1", e->vn[i]->id);
+            writer.attribute("v2", e->vn[e->next_vert(i)]->id);
+            writer.attribute("m", mesh->boundary_markers_conversion.get_user_marker(MeshUtil::get_base_edge_node(e, i)->marker).marker);
+            writer.end_element();
+          }
+        }
+      }
+      writer.end_element();
 
-      // save curved edges
-      XMLMesh::curves_type curves;
-      for_all_base_elements(e, mesh)
-        if (e->is_curved())
+      // save curved edges, arcs first (the order of the loading)
+      writer.start_element("curves");
+      for (int curve_type = 0; curve_type < 2; curve_type++)
+      {
+        for_all_base_elements(e, mesh)
+        {
+          if (!e->is_curved())
+            continue;
           for (unsigned char i = 0; i < e->get_nvert(); i++)
-            if (e->cm->curves[i] != nullptr)
-              if (e->cm->curves[i]->type == ArcType)
-                save_arc(mesh, e->vn[i]->id, e->vn[e->next_vert(i)]->id, (Arc*)e->cm->curves[i], curves);
-              else
-                save_nurbs(mesh, e->vn[i]->id, e->vn[e->next_vert(i)]->id, (Nurbs*)e->cm->curves[i], curves);
+          {
+            Curve* curve = e->cm->curves[i];
+            if (curve == nullptr || (curve->type == ArcType) != (curve_type == 0))
+              continue;
+
+            if (curve->type == ArcType)
+            {
+              writer.start_element("arc");
+              writer.attribute("v1", e->vn[i]->id);
+              writer.attribute("v2", e->vn[e->next_vert(i)]->id);
+              writer.attribute("angle", ((Arc*)curve)->angle);
+              writer.end_element();
+            }
+            else
+            {
+              Nurbs* nurbs = (Nurbs*)curve;
+              writer.start_element("NURBS");
+              writer.attribute("v1", e->vn[i]->id);
+              writer.attribute("v2", e->vn[e->next_vert(i)]->id);
+              writer.attribute("deg", (int)nurbs->degree);
+              for (int point_i = 1; point_i < nurbs->np - 1; point_i++)
+              {
+                writer.start_element("inner_point");
+                writer.attribute("x", nurbs->pt[point_i][0]);
+                writer.attribute("y", nurbs->pt[point_i][1]);
+                writer.attribute("weight", nurbs->pt[point_i][2]);
+                writer.end_element();
+              }
+              for (int knot_i = nurbs->degree + 1; knot_i < nurbs->nk - (nurbs->degree + 1); knot_i++)
+              {
+                writer.start_element("knot");
+                writer.attribute("value", nurbs->kv[knot_i]);
+                writer.end_element();
+              }
+              writer.end_element();
+            }
+          }
+        }
+      }
+      writer.end_element();
 
       // save refinements
-      XMLMesh::refinements_type refinements;
+      writer.start_element("refinements");
       for (unsigned int refinement_i = 0; refinement_i < mesh->refinements.size(); refinement_i++)
-        refinements.ref().push_back(XMLMesh::ref(mesh->refinements[refinement_i].first, mesh->refinements[refinement_i].second));
-
-      XMLMesh::mesh xmlmesh(vertices, elements, edges);
-      xmlmesh.curves().set(curves);
-      xmlmesh.refinements().set(refinements);
-
-      std::string mesh_schema_location(Hermes2DApi.get_text_param_value(xmlSchemasDirPath));
-      mesh_schema_location.append("/mesh_h2d_xml.xsd");
-      ::xml_schema::namespace_info namespace_info_mesh("XMLMesh", mesh_schema_location);
-
-      ::xml_schema::namespace_infomap namespace_info_map;
-      namespace_info_map.insert(std::pair<std::basic_string<char>, xml_schema::namespace_info>("mesh", namespace_info_mesh));
+      {
+        writer.start_element("ref");
+        writer.attribute("element_id", mesh->refinements[refinement_i].first);
+        writer.attribute("refinement_type", mesh->refinements[refinement_i].second);
+        writer.end_element();
+      }
+      writer.end_element();
 
-      std::ofstream out(filename);
-      ::xml_schema::flags parsing_flags = ::xml_schema::flags::dont_pretty_print;
-      XMLMesh::mesh_(out, xmlmesh, namespace_info_map, "UTF-8", parsing_flags);
-      out.close();
+      writer.close();
     }
 
     void MeshReaderH2DXML::load(const char *filename, std::vector<MeshSharedPtr> meshes)
@@ -303,7 +595,6 @@ namespace Hermes
               node->type = HERMES_TYPE_VERTEX;
               node->bnd = 0;
               node->p1 = node->p2 = -1;
-              node->next_hash = nullptr;
 
               // variables matching.
               std::string x = parsed_xml_domain->vertices().v().at(vertex_number).x();
@@ -774,7 +1065,6 @@ namespace Hermes
           node->type = HERMES_TYPE_VERTEX;
           node->bnd = 0;
           node->p1 = node->p2 = -1;
-          node->next_hash = nullptr;
 
           // variables matching.
           std::string x = parsed_xml_mesh->vertices().v().at(vertex_i).x();
@@ -1001,7 +1291,6 @@ namespace Hermes
           node->type = HERMES_TYPE_VERTEX;
           node->bnd = 0;
           node->p1 = node->p2 = -1;
-          node->next_hash = nullptr;
 
           // variables matching.
           std::string x = parsed_xml_domain->vertices().v().at(vertex_i).x();
@@ -1184,8 +1473,23 @@ namespace Hermes
     template<typename T>
     Nurbs* MeshReaderH2DXML::load_nurbs(MeshSharedPtr mesh, std::auto_ptr<T> & parsed_xml_entity, int id, Node** en, int p1, int p2, bool skip_check)
     {
-      Nurbs* nurbs = new Nurbs;
+      std::vector<double> inner_points;
+      for (unsigned int i = 0; i < parsed_xml_entity->curves()->NURBS().at(id).inner_point().size(); i++)
+      {
+        inner_points.push_back(parsed_xml_entity->curves()->NURBS().at(id).inner_point().at(i).x());
+        inner_points.push_back(parsed_xml_entity->curves()->NURBS().at(id).inner_point().at(i).y());
+        inner_points.push_back(parsed_xml_entity->curves()->NURBS().at(id).inner_point().at(i).weight());
+      }
+
+      std::vector<double> knots;
+      for (unsigned int i = 0; i < parsed_xml_entity->curves()->NURBS().at(id).knot().size(); i++)
+        knots.push_back(parsed_xml_entity->curves()->NURBS().at(id).knot().at(i).value());
+
+      return create_nurbs(mesh, id, en, p1, p2, parsed_xml_entity->curves()->NURBS().at(id).deg(), inner_points, knots, skip_check);
+    }
 
+    Nurbs* MeshReaderH2DXML::create_nurbs(MeshSharedPtr mesh, int id, Node** en, int p1, int p2, int degree, const std::vector<double>& inner_points, const std::vector<double>& knots, bool skip_check)
+    {
       *en = mesh->peek_edge_node(p1, p2);
 
       if (*en == nullptr)
@@ -1196,11 +1500,18 @@ namespace Hermes
           return nullptr;
       }
 
-      // degree of curved edge
-      nurbs->degree = parsed_xml_entity->curves()->NURBS().at(id).deg();
-
       // get the number of control points
-      int inner = parsed_xml_entity->curves()->NURBS().at(id).inner_point().size();
+      int inner = inner_points.size() / 3;
+
+      // the knot vector is completed by the same number of points on both sides
+      int outer = degree + inner + 3 - (int)knots.size();
+      if ((outer & 1) == 1)
+        throw Hermes::Exceptions::MeshLoadFailureException("Curve #%d: incorrect number of knot points.", id);
+
+      Nurbs* nurbs = new Nurbs;
+
+      // degree of curved edge
+      nurbs->degree = degree;
 
       nurbs->np = inner + 2;
 
@@ -1216,17 +1527,14 @@ namespace Hermes
       // read inner control points
       for (int i = 0; i < inner; i++)
       {
-        nurbs->pt[i + 1][0] = parsed_xml_entity->curves()->NURBS().at(id).inner_point().at(i).x();
-        nurbs->pt[i + 1][1] = parsed_xml_entity->curves()->NURBS().at(id).inner_point().at(i).y();
-        nurbs->pt[i + 1][2] = parsed_xml_entity->curves()->NURBS().at(id).inner_point().at(i).weight();
+        nurbs->pt[i + 1][0] = inner_points[3 * i];
+        nurbs->pt[i + 1][1] = inner_points[3 * i + 1];
+        nurbs->pt[i + 1][2] = inner_points[3 * i + 2];
       }
 
       // get the number of knot vector points
-      inner = parsed_xml_entity->curves()->NURBS().at(id).knot().size();
+      inner = knots.size();
       nurbs->nk = nurbs->degree + nurbs->np + 1;
-      int outer = nurbs->nk - inner;
-      if ((outer & 1) == 1)
-        throw Hermes::Exceptions::MeshLoadFailureException("Curve #%d: incorrect number of knot points.", id);
 
       // knot vector is completed by 0.0 on the left and by 1.0 on the right
       nurbs->kv = new double[nurbs->nk];
@@ -1236,7 +1544,7 @@ namespace Hermes
 
       if (inner > 0)
         for (int i = outer / 2; i < inner + outer / 2; i++)
-          nurbs->kv[i] = parsed_xml_entity->curves()->NURBS().at(id).knot().at(i - (outer / 2)).value();
+          nurbs->kv[i] = knots[i - (outer / 2)];
 
       for (int i = outer / 2 + inner; i < nurbs->nk; i++)
         nurbs->kv[i] = 1.0;
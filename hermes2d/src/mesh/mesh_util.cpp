@@ -422,5 +422,167 @@ namespace Hermes
     {
       return this->area;
     }
+
+    MeshSnapshot::MeshSnapshot(Mesh* mesh) : mesh_seq(mesh->get_seq())
+    {
+      // Vertex coordinates.
+      int node_count = mesh->get_max_node_id();
+      x.resize(node_count, 0.);
+      y.resize(node_count, 0.);
+      for (int i = 0; i < node_count; i++)
+      {
+        Node* node = &mesh->get_nodes()[i];
+        if (node->used && node->type == HERMES_TYPE_VERTEX)
+        {
+          x[i] = node->x;
+          y[i] = node->y;
+        }
+      }
+
+      // Connectivity.
+      int element_count = mesh->get_max_element_id();
+      nvert.resize(element_count, 0);
+      curved.resize(element_count, 0);
+      element_vertices.resize(element_count * H2D_MAX_NUMBER_VERTICES, -1);
+      element_edges.resize(element_count * H2D_MAX_NUMBER_EDGES, -1);
+      boundary.resize(element_count, 0);
+      leaf_index.resize(element_count, -1);
+      active_elements.reserve(mesh->get_num_active_elements());
+      for (int id = 0; id < element_count; id++)
+      {
+        Element* e = mesh->get_element_fast(id);
+        if (!e->used)
+          continue;
+
+        nvert[id] = e->get_nvert();
+        curved[id] = e->is_curved();
+        for (int i = 0; i < e->get_nvert(); i++)
+          element_vertices[id * H2D_MAX_NUMBER_VERTICES + i] = e->vn[i]->id;
+
+        if (e->active)
+        {
+          for (int i = 0; i < e->get_nvert(); i++)
+          {
+            element_edges[id * H2D_MAX_NUMBER_EDGES + i] = e->en[i]->id;
+            if (e->en[i]->bnd)
+              boundary[id] |= 1 << i;
+            if (e->vn[i]->bnd)
+              boundary[id] |= 1 << (H2D_MAX_NUMBER_EDGES + i);
+          }
+          active_elements.push_back(id);
+        }
+      }
+
+      // Leaf order.
+      int base_count = mesh->get_num_base_elements();
+      leaf_order.reserve(active_elements.size());
+      base_leaf_starts.resize(base_count + 1);
+      for (int id = 0; id < base_count; id++)
+      {
+        base_leaf_starts[id] = leaf_order.size();
+        Element* e = mesh->get_element_fast(id);
+        if (e->used)
+          add_leaves(e);
+      }
+      base_leaf_starts[base_count] = leaf_order.size();
+
+      calculate_base_element_order(base_count);
+    }
+
+    uint64_t MeshUtil::hilbert_index(unsigned int order, unsigned int x, unsigned int y)
+    {
+      unsigned int n = 1u << order;
+      uint64_t index = 0;
+      for (unsigned int s = n >> 1; s > 0; s >>= 1)
+      {
+        unsigned int rx = (x & s) > 0;
+        unsigned int ry = (y & s) > 0;
+        index += (uint64_t)s * s * ((3 * rx) ^ ry);
+        // Rotate the quadrant.
+        if (ry == 0)
+        {
+          if (rx == 1)
+          {
+            x = n - 1 - x;
+            y = n - 1 - y;
+          }
+          std::swap(x, y);
+        }
+      }
+      return index;
+    }
+
+    void MeshSnapshot::calculate_base_element_order(int base_count)
+    {
+      static const unsigned int order = 16;
+
+      // Centroids of the (used) base elements and their bounding box.
+      std::vector<double2> centroids(base_count);
+      double x_min = std::numeric_limits<double>::max(), x_max = -x_min, y_min = x_min, y_max = -x_min;
+      for (int id = 0; id < base_count; id++)
+      {
+        centroids[id][0] = centroids[id][1] = 0.;
+        for (int i = 0; i < nvert[id]; i++)
+        {
+          centroids[id][0] += this->x[element_vertices[id * H2D_MAX_NUMBER_VERTICES + i]] / nvert[id];
+          centroids[id][1] += this->y[element_vertices[id * H2D_MAX_NUMBER_VERTICES + i]] / nvert[id];
+        }
+        if (nvert[id])
+        {
+          x_min = std::min(x_min, centroids[id][0]);
+          x_max = std::max(x_max, centroids[id][0]);
+          y_min = std::min(y_min, centroids[id][1]);
+          y_max = std::max(y_max, centroids[id][1]);
+        }
+      }
+      double scale = (1u << order) - 1;
+      double x_scale = x_max > x_min ? scale / (x_max - x_min) : 0.;
+      double y_scale = y_max > y_min ? scale / (y_max - y_min) : 0.;
+
+      std::vector<std::pair<uint64_t, int> > keys(base_count);
+      for (int id = 0; id < base_count; id++)
+      {
+        keys[id].second = id;
+        keys[id].first = nvert[id] ? MeshUtil::hilbert_index(order, (unsigned int)((centroids[id][0] - x_min) * x_scale), (unsigned int)((centroids[id][1] - y_min) * y_scale)) : 0;
+      }
+      // Stable, so that elements with the same key keep the order of their ids.
+      std::stable_sort(keys.begin(), keys.end());
+
+      base_element_order.resize(base_count);
+      for (int i = 0; i < base_count; i++)
+        base_element_order[i] = keys[i].second;
+    }
+
+    void MeshSnapshot::add_leaves(Element* e)
+    {
+      if (e->active)
+      {
+        leaf_index[e->id] = leaf_order.size();
+        leaf_order.push_back(e->id);
+        return;
+      }
+      for (int son = 0; son < H2D_MAX_ELEMENT_SONS; son++)
+        if (e->sons[son] != nullptr)
+          add_leaves(e->sons[son]);
+    }
+
+    int MeshSnapshot::get_mesh_seq() const
+    {
+      return this->mesh_seq;
+    }
+
+    bool MeshSnapshot::in_bounding_box(int id, double x, double y) const
+    {
+      const int* vertices = &element_vertices[id * H2D_MAX_NUMBER_VERTICES];
+      double x_min = this->x[vertices[0]], x_max = x_min, y_min = this->y[vertices[0]], y_max = y_min;
+      for (int i = 1; i < nvert[id]; i++)
+      {
+        x_min = std::min(x_min, this->x[vertices[i]]);
+        x_max = std::max(x_max, this->x[vertices[i]]);
+        y_min = std::min(y_min, this->y[vertices[i]]);
+        y_max = std::max(y_max, this->y[vertices[i]]);
+      }
+      return x >= x_min && x <= x_max && y >= y_min && y <= y_max;
+    }
   }
 }
\ No newline at end of file
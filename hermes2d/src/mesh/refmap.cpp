@@ -68,6 +68,11 @@ namespace Hermes
     }
 
     void RefMap::set_active_element(Element* e)
+    {
+      this->set_active_element(e, nullptr);
+    }
+
+    void RefMap::set_active_element(Element* e, const MeshSnapshot* snapshot)
     {
       this->reinit_storage();
 
@@ -84,10 +89,22 @@ namespace Hermes
       // straight-edged element
       if (e->cm == nullptr)
       {
-        for (unsigned char i = 0; i < e->get_nvert(); i++)
+        if (snapshot)
+        {
+          const int* vertices = &snapshot->element_vertices[e->id * H2D_MAX_NUMBER_VERTICES];
+          for (unsigned char i = 0; i < e->get_nvert(); i++)
+          {
+            lin_coeffs[i][0] = snapshot->x[vertices[i]];
+            lin_coeffs[i][1] = snapshot->y[vertices[i]];
+          }
+        }
+        else
         {
-          lin_coeffs[i][0] = e->vn[i]->x;
-          lin_coeffs[i][1] = e->vn[i]->y;
+          for (unsigned char i = 0; i < e->get_nvert(); i++)
+          {
+            lin_coeffs[i][0] = e->vn[i]->x;
+            lin_coeffs[i][1] = e->vn[i]->y;
+          }
         }
         coeffs = lin_coeffs;
         nc = e->get_nvert();
@@ -792,8 +809,15 @@ namespace Hermes
       std::vector<Element*> improbable_curved_elements;
 
       // main loop over all active elements.
-      for_all_active_elements(e, mesh)
+      // Straight elements that do not contain the point in their bounding box are skipped using the mesh snapshot only.
+      const MeshSnapshot* snapshot = mesh->get_snapshot();
+      for (unsigned int active_i = 0; active_i < snapshot->active_elements.size(); active_i++)
       {
+        int id = snapshot->active_elements[active_i];
+        if (!snapshot->curved[id] && !snapshot->in_bounding_box(id, x, y))
+          continue;
+        e = mesh->get_element_fast(id);
+
         bool is_triangle = e->is_triangle();
         bool is_curved = e->is_curved();
 
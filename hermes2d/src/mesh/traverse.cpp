@@ -16,13 +16,14 @@
 #include "mesh.h"
 #include "traverse.h"
 #include "mesh_function.h"
+#include "api2d.h"
 
 namespace Hermes
 {
   namespace Hermes2D
   {
     static const Rect H2D_UNITY = { 0, 0, ONE, ONE };
-    Traverse::Traverse(int spaces_size) : spaces_size(spaces_size)
+    Traverse::Traverse(int spaces_size) : unidata(nullptr), udsize(0), num(0), stack(nullptr), top(0), size(0), spaces_size(spaces_size)
     {
     }
 
@@ -246,22 +247,25 @@ namespace Hermes
     void Traverse::set_boundary_info(State* s)
     {
       Element* e = nullptr;
-      for (int i = 0; i < num; i++)
+      int i;
+      for (i = 0; i < num; i++)
         if ((e = s->e[i]) != nullptr) break;
 
+      // Bits of the edges, then of the vertices.
+      unsigned char boundary = snapshots[i]->boundary[e->id];
       if (e->is_triangle())
       {
-        for (int i = 0; i < 3; i++)
-          (s->bnd[i] = (s->bnd[i] && e->en[i]->bnd));
-        s->isBnd = s->bnd[0] || s->bnd[1] || s->bnd[2] || e->vn[0]->bnd || e->vn[1]->bnd || e->vn[2]->bnd;
+        for (int j = 0; j < 3; j++)
+          (s->bnd[j] = (s->bnd[j] && (boundary & (1 << j))));
+        s->isBnd = s->bnd[0] || s->bnd[1] || s->bnd[2] || (boundary >> H2D_MAX_NUMBER_EDGES);
       }
       else
       {
-        s->bnd[0] = s->bnd[0] && (s->cr.b == 0) && e->en[0]->bnd;
-        s->bnd[1] = s->bnd[1] && (s->cr.r == ONE) && e->en[1]->bnd;
-        s->bnd[2] = s->bnd[2] && (s->cr.t == ONE) && e->en[2]->bnd;
-        s->bnd[3] = s->bnd[3] && (s->cr.l == 0) && e->en[3]->bnd;
-        s->isBnd = s->bnd[0] || s->bnd[1] || s->bnd[2] || s->bnd[3] || e->vn[0]->bnd || e->vn[1]->bnd || e->vn[2]->bnd || e->vn[3]->bnd;
+        s->bnd[0] = s->bnd[0] && (s->cr.b == 0) && (boundary & 1);
+        s->bnd[1] = s->bnd[1] && (s->cr.r == ONE) && (boundary & 2);
+        s->bnd[2] = s->bnd[2] && (s->cr.t == ONE) && (boundary & 4);
+        s->bnd[3] = s->bnd[3] && (s->cr.l == 0) && (boundary & 8);
+        s->isBnd = s->bnd[0] || s->bnd[1] || s->bnd[2] || s->bnd[3] || (boundary >> H2D_MAX_NUMBER_EDGES);
       }
     }
 
@@ -296,17 +300,210 @@ namespace Hermes
 
     Traverse::State** Traverse::get_states(MeshSharedPtr* meshes, unsigned short meshes_count, unsigned int& states_count)
     {
-      // This will be returned.
-      int count = 0, predictedCount = 0;
       this->num = meshes_count;
-      for (int i = 0; i < meshes_count; i++)
-        if (meshes[i]->get_num_active_elements() > predictedCount)
-          predictedCount = meshes[i]->get_num_active_elements();
-      State** states = malloc_with_check<State*>(predictedCount);
+      int base_elements_count = meshes[0]->get_num_base_elements();
+
+      // Base elements are traversed independently, in chunks of consecutive positions in the traversal order (of similar numbers of leaves).
+      // Chunks are distributed among the threads round-robin (several chunks per thread, the refinement is usually not uniform),
+      // and the states of the chunks are concatenated in the order of the chunks, i.e. in the same order as the serial traversal gives.
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel() || base_elements_count < 2 * num_threads)
+        num_threads = 1;
+      int chunk_count = std::min(num_threads * H2D_TRAVERSE_CHUNKS_PER_THREAD, base_elements_count);
+
+      // Optional ordering of the base elements along the space-filling curve.
+      // The leaves of each base element are still visited in the order of the refinement tree (depth-first).
+      const int* base_ids = nullptr;
+      if (base_elements_count > 0 && Hermes2DApi.get_integral_param_value(spaceFillingCurveOrdering))
+        base_ids = meshes[0]->get_snapshot()->base_element_order.data();
+
+      if (num_threads == 1)
+      {
+        StateBuffer buffer;
+        int predicted_count = 0;
+        for (int i = 0; i < meshes_count; i++)
+          predicted_count = std::max(predicted_count, meshes[i]->get_num_active_elements());
+        buffer.reserve(predicted_count, meshes_count);
+        this->traverse_base_elements(meshes, base_ids, 0, base_elements_count, buffer);
+        return allocate_states(&buffer, 1, meshes_count, states_count);
+      }
 
+      // Chunk boundaries - (approximately) the same number of leaves of the finest mesh in each chunk.
+      MeshSharedPtr finest_mesh = meshes[0];
+      for (int i = 1; i < meshes_count; i++)
+        if (meshes[i]->get_num_active_elements() > finest_mesh->get_num_active_elements())
+          finest_mesh = meshes[i];
+      const std::vector<int>& base_leaf_starts = finest_mesh->get_snapshot()->base_leaf_starts;
+      // Number of leaves before the position in the traversal order of the base elements.
+      std::vector<int> leaves_before(base_elements_count + 1);
+      leaves_before[0] = 0;
+      for (int position = 0; position < base_elements_count; position++)
+      {
+        int base_id = base_ids ? base_ids[position] : position;
+        leaves_before[position + 1] = leaves_before[position] + base_leaf_starts[base_id + 1] - base_leaf_starts[base_id];
+      }
+      std::vector<int> chunk_starts(chunk_count + 1);
+      chunk_starts[0] = 0;
+      chunk_starts[chunk_count] = base_elements_count;
+      for (int chunk_i = 1; chunk_i < chunk_count; chunk_i++)
+      {
+        int leaves_before_chunk = (int)(((int64_t)leaves_before[base_elements_count] * chunk_i) / chunk_count);
+        chunk_starts[chunk_i] = std::lower_bound(leaves_before.begin(), leaves_before.begin() + base_elements_count, leaves_before_chunk) - leaves_before.begin();
+      }
+
+      std::vector<StateBuffer> chunk_states(chunk_count);
+      std::string exceptionMessageCaughtInParallelBlock;
+#pragma omp parallel num_threads(num_threads)
+      {
+        int thread_number = omp_get_thread_num();
+        // Each thread has its own stack of states.
+        Traverse thread_traverse(this->spaces_size);
+        thread_traverse.num = meshes_count;
+        for (int chunk_i = thread_number; chunk_i < chunk_count; chunk_i += num_threads)
+        {
+          try
+          {
+            thread_traverse.traverse_base_elements(meshes, base_ids, chunk_starts[chunk_i], chunk_starts[chunk_i + 1], chunk_states[chunk_i]);
+          }
+          catch (std::exception& exception)
+          {
+            thread_traverse.finish();
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+            exceptionMessageCaughtInParallelBlock = exception.what();
+          }
+        }
+      }
+
+      if (!exceptionMessageCaughtInParallelBlock.empty())
+        throw Hermes::Exceptions::Exception(exceptionMessageCaughtInParallelBlock.c_str());
+
+      return allocate_states(&chunk_states[0], chunk_count, meshes_count, states_count);
+    }
+
+    void Traverse::StateBuffer::reserve(unsigned int states_count, unsigned short num)
+    {
+      this->e.reserve(states_count * num);
+      this->sub_idx.reserve(states_count * num);
+      this->leaves.reserve(states_count);
+    }
+
+    void Traverse::StateBuffer::append(const State* s)
+    {
+      this->e.insert(this->e.end(), s->e, s->e + s->num);
+      this->sub_idx.insert(this->sub_idx.end(), s->sub_idx, s->sub_idx + s->num);
+      Leaf leaf;
+      memcpy(leaf.bnd, s->bnd, sizeof(leaf.bnd));
+      leaf.isBnd = s->isBnd;
+      leaf.rep_i = s->rep_i;
+      this->leaves.push_back(leaf);
+    }
+
+    /// Offset rounded up to a multiple of 16 bytes.
+    static size_t align_offset(size_t offset)
+    {
+      return (offset + 15) & ~((size_t)15);
+    }
+
+    Traverse::State** Traverse::allocate_states(unsigned int states_count, unsigned short num)
+    {
+      if (states_count == 0)
+        return nullptr;
+
+      // Layout: pointers to the states | states | elements of all states | transformations of all states.
+      size_t states_offset = align_offset(states_count * sizeof(State*));
+      size_t e_offset = align_offset(states_offset + states_count * sizeof(State));
+      size_t sub_idx_offset = align_offset(e_offset + (size_t)states_count * num * sizeof(Element*));
+      size_t block_size = sub_idx_offset + (size_t)states_count * num * sizeof(uint64_t);
+
+      char* block = malloc_with_check<char>(block_size, true);
+      State** states = (State**)block;
+      State* state_storage = (State*)(block + states_offset);
+      Element** e_storage = (Element**)(block + e_offset);
+      uint64_t* sub_idx_storage = (uint64_t*)(block + sub_idx_offset);
+
+      for (unsigned int i = 0; i < states_count; i++)
+      {
+        // The states in the block are never destructed, their arrays are a part of the block.
+        State* state = new (state_storage + i) State();
+        state->num = num;
+        state->e = e_storage + (size_t)i * num;
+        state->sub_idx = sub_idx_storage + (size_t)i * num;
+        states[i] = state;
+      }
+
+      return states;
+    }
+
+    Traverse::State** Traverse::allocate_states(StateBuffer* buffers, int buffers_count, unsigned short num, unsigned int& states_count)
+    {
+      states_count = 0;
+      for (int buffer_i = 0; buffer_i < buffers_count; buffer_i++)
+        states_count += buffers[buffer_i].size();
+
+      State** states = allocate_states(states_count, num);
+      if (!states)
+        return nullptr;
+
+      // Element and transformation arrays of all states are contiguous - copy them buffer by buffer.
+      unsigned int state_i = 0;
+      for (int buffer_i = 0; buffer_i < buffers_count; buffer_i++)
+      {
+        StateBuffer& buffer = buffers[buffer_i];
+        if (!buffer.size())
+          continue;
+
+        memcpy(states[state_i]->e, &buffer.e[0], buffer.e.size() * sizeof(Element*));
+        memcpy(states[state_i]->sub_idx, &buffer.sub_idx[0], buffer.sub_idx.size() * sizeof(uint64_t));
+        for (unsigned int i = 0; i < buffer.size(); i++, state_i++)
+        {
+          State* state = states[state_i];
+          memcpy(state->bnd, buffer.leaves[i].bnd, sizeof(state->bnd));
+          state->isBnd = buffer.leaves[i].isBnd;
+          state->rep_i = buffer.leaves[i].rep_i;
+          state->rep = state->e[state->rep_i];
+        }
+      }
+
+      return states;
+    }
+
+    Traverse::State** Traverse::copy_states(State** states, unsigned int states_count)
+    {
+      if (states_count == 0)
+        return nullptr;
+
+      State** copies = allocate_states(states_count, states[0]->num);
+      for (unsigned int i = 0; i < states_count; i++)
+      {
+        State* copy = copies[i];
+        memcpy(copy->e, states[i]->e, copy->num * sizeof(Element*));
+        memcpy(copy->sub_idx, states[i]->sub_idx, copy->num * sizeof(uint64_t));
+        memcpy(copy->bnd, states[i]->bnd, sizeof(copy->bnd));
+        copy->isBnd = states[i]->isBnd;
+        copy->isurf = states[i]->isurf;
+        copy->rep = states[i]->rep;
+        copy->rep_i = states[i]->rep_i;
+      }
+      return copies;
+    }
+
+    void Traverse::free_states(State**& states)
+    {
+      char* block = (char*)states;
+      free_with_check(block, true);
+      states = nullptr;
+    }
+
+    void Traverse::traverse_base_elements(MeshSharedPtr* meshes, const int* base_ids, int first, int last, StateBuffer& states)
+    {
       this->begin(num);
 
-      int id = 0;
+      snapshots.resize(num);
+      for (int i = 0; i < num; i++)
+        snapshots[i] = meshes[i]->get_snapshot();
+
+      // Position in base_ids (the base element id itself if there is no ordering).
+      int id = first;
 
       while (1)
       {
@@ -329,21 +526,20 @@ namespace Hermes
           s->cr = H2D_UNITY;
           while (1)
           {
-            // No more base elements? we're finished.
-            // Id is set to zero at the beginning by the function trav.begin(..).
-            if (id >= meshes[0]->get_num_base_elements())
+            // No more base elements in the range? we're finished.
+            if (id >= last)
             {
               this->finish();
-              states_count = count;
-              return states;
+              return;
             }
 
             int nused = 0;
+            int base_id = base_ids ? base_ids[id] : id;
             // The variable num is the number of meshes in the stage
             for (i = 0; i < num; i++)
             {
               // Retrieve the Element with this id on the i-th mesh.
-              s->e[i] = meshes[i]->get_element(id);
+              s->e[i] = meshes[i]->get_element(base_id);
               if (!s->e[i]->used)
               {
                 s->e[i] = nullptr;
@@ -397,12 +593,6 @@ namespace Hermes
         // if yes, set boundary flags and return the state
         if (leaf)
         {
-          if (count > predictedCount - 1)
-          {
-            predictedCount *= 1.5;
-            states = realloc_with_check<State*>(states, predictedCount);
-          }
-
           set_boundary_info(s);
           s->rep = nullptr;
           // EXTREMELY IMPORTANT.
@@ -417,7 +607,7 @@ namespace Hermes
             s->rep_i = j;
             }
           if (s->rep)
-            states[count++] = State::clone(s);
+            states.append(s);
           continue;
         }
 
@@ -585,6 +775,54 @@ namespace Hermes
       this->finish();
     }
 
+    Traverse::StatesCache::StatesCache() : spaces_size(0), states(nullptr), states_count(0)
+    {
+    }
+
+    Traverse::StatesCache::~StatesCache()
+    {
+      this->free();
+    }
+
+    void Traverse::StatesCache::free()
+    {
+      Traverse::free_states(this->states);
+      this->states_count = 0;
+      this->meshes.clear();
+      this->seqs.clear();
+    }
+
+    bool Traverse::StatesCache::is_up_to_date(std::vector<MeshSharedPtr>& meshes, unsigned char spaces_size) const
+    {
+      if (this->meshes.empty() || this->spaces_size != spaces_size || this->meshes.size() != meshes.size())
+        return false;
+
+      for (unsigned short i = 0; i < meshes.size(); i++)
+        if (this->meshes[i] != meshes[i] || this->seqs[i] != meshes[i]->get_seq())
+          return false;
+
+      return true;
+    }
+
+    Traverse::State** Traverse::StatesCache::get_states(std::vector<MeshSharedPtr>& meshes, unsigned char spaces_size, unsigned int& states_count)
+    {
+      if (!this->is_up_to_date(meshes, spaces_size))
+      {
+        this->free();
+
+        Traverse trav(spaces_size);
+        this->states = trav.get_states(meshes, this->states_count);
+
+        this->meshes = meshes;
+        for (unsigned short i = 0; i < meshes.size(); i++)
+          this->seqs.push_back(meshes[i]->get_seq());
+        this->spaces_size = spaces_size;
+      }
+
+      states_count = this->states_count;
+      return this->states;
+    }
+
     static void testMeshesCompliance(int n, MeshSharedPtr* meshes)
     {
       // Test whether all master meshes have the same number of elements.
@@ -853,11 +1091,112 @@ namespace Hermes
       delete[] idx_new;
     }
 
+    /// The last union mesh constructed by Traverse::construct_union_mesh(), with the seq numbers of the meshes it was constructed from.
+    /// The meshes are not held - a seq number identifies the state of a mesh (a copy of a mesh has the same seq, any change gives a new one).
+    /// Meshes (also the kept union mesh) must not be freed inside the critical section (union_mesh_cache) - Mesh::free() enters it.
+    struct UnionMeshCache
+    {
+      UnionMeshCache() : unidata(nullptr), udsize(0) {}
+
+      ~UnionMeshCache()
+      {
+        MeshSharedPtr released = release();
+      }
+
+      bool is_up_to_date(unsigned char n, MeshSharedPtr* meshes) const
+      {
+        if (!unimesh || this->seqs.size() != n)
+          return false;
+        for (unsigned char i = 0; i < n; i++)
+          if (this->seqs[i] != meshes[i]->get_seq())
+            return false;
+        return true;
+      }
+
+      bool contains(unsigned int seq) const
+      {
+        return std::find(seqs.begin(), seqs.end(), seq) != seqs.end();
+      }
+
+      /// Empties the cache, the union mesh is returned to be released by the caller (outside of the critical section).
+      MeshSharedPtr release()
+      {
+        if (unidata)
+        {
+          for (unsigned char i = 0; i < seqs.size(); i++)
+            ::free(unidata[i]);
+          delete[] unidata;
+          unidata = nullptr;
+        }
+        udsize = 0;
+        seqs.clear();
+        MeshSharedPtr released = unimesh;
+        unimesh = MeshSharedPtr();
+        return released;
+      }
+
+      std::vector<unsigned int> seqs;
+      MeshSharedPtr unimesh;
+      UniData** unidata;
+      int udsize;
+    };
+    static UnionMeshCache union_mesh_cache;
+
+    /// Copy of the union mesh data, allocated in the same way as by Traverse::union_recurrent().
+    static UniData** copy_unidata(unsigned char n, UniData** unidata, int udsize)
+    {
+      UniData** copy = new UniData*[n];
+      for (unsigned char i = 0; i < n; i++)
+      {
+        copy[i] = nullptr;
+        if (udsize)
+        {
+          copy[i] = (UniData*)malloc(udsize * sizeof(UniData));
+          memcpy(copy[i], unidata[i], udsize * sizeof(UniData));
+        }
+      }
+      return copy;
+    }
+
+    void Traverse::free_union_mesh_cache()
+    {
+      MeshSharedPtr released;
+#pragma omp critical (union_mesh_cache)
+      released = union_mesh_cache.release();
+    }
+
+    void Traverse::free_union_mesh_cache(unsigned int mesh_seq)
+    {
+      MeshSharedPtr released;
+#pragma omp critical (union_mesh_cache)
+      {
+        if (union_mesh_cache.contains(mesh_seq))
+          released = union_mesh_cache.release();
+      }
+    }
+
     UniData** Traverse::construct_union_mesh(unsigned char n, MeshSharedPtr* meshes, MeshSharedPtr unimesh)
     {
       // Initial check.
       testMeshesCompliance(n, meshes);
 
+      // The same meshes as the last time - copy the last union mesh.
+      UniData** cached_unidata = nullptr;
+      MeshSharedPtr cached_unimesh;
+#pragma omp critical (union_mesh_cache)
+      {
+        if (union_mesh_cache.is_up_to_date(n, meshes))
+        {
+          cached_unimesh = union_mesh_cache.unimesh;
+          cached_unidata = copy_unidata(n, union_mesh_cache.unidata, union_mesh_cache.udsize);
+        }
+      }
+      if (cached_unidata)
+      {
+        unimesh->copy(cached_unimesh);
+        return cached_unidata;
+      }
+
       Traverse traverse(n);
 
       // Initialization.
@@ -898,6 +1237,22 @@ namespace Hermes
       delete[] idx;
 
       traverse.finish();
+
+      // Keep the union mesh for the next call, the previous one is released.
+      MeshSharedPtr kept_unimesh(new Mesh);
+      kept_unimesh->copy(unimesh);
+      UniData** kept_unidata = copy_unidata(n, traverse.unidata, traverse.udsize);
+      MeshSharedPtr released;
+#pragma omp critical (union_mesh_cache)
+      {
+        released = union_mesh_cache.release();
+        for (unsigned char i = 0; i < n; i++)
+          union_mesh_cache.seqs.push_back(meshes[i]->get_seq());
+        union_mesh_cache.unimesh = kept_unimesh;
+        union_mesh_cache.unidata = kept_unidata;
+        union_mesh_cache.udsize = traverse.udsize;
+      }
+
       return traverse.unidata;
     }
 
@@ -21,6 +21,14 @@
 #include "shapeset/shapeset_l2_all.h"
 #include "shapeset/shapeset_hc_all.h"
 #include "shapeset/shapeset_hd_all.h"
+#include "api2d.h"
+#include <atomic>
+#ifndef _WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace Hermes
 {
@@ -162,7 +170,7 @@ namespace Hermes
     static PrecalcShapesetAssemblingInternal temp[H2D_NUM_SHAPESETS] = { PrecalcShapesetAssemblingInternal(new HcurlShapesetGradLeg), PrecalcShapesetAssemblingInternal(new HdivShapesetLegendre), PrecalcShapesetAssemblingInternal(new L2ShapesetLegendre), PrecalcShapesetAssemblingInternal(new L2ShapesetTaylor), PrecalcShapesetAssemblingInternal(new H1ShapesetJacobi) };
 #endif
 
-    PrecalcShapesetAssemblingInternal::PrecalcShapesetAssemblingInternal(Shapeset* shapeset) : PrecalcShapesetAssembling(shapeset)
+    PrecalcShapesetAssemblingInternal::PrecalcShapesetAssemblingInternal(Shapeset* shapeset) : PrecalcShapesetAssembling(shapeset, false)
     {
     }
 
@@ -172,7 +180,7 @@ namespace Hermes
       delete this->shapeset;
     }
 
-    PrecalcShapesetAssembling::PrecalcShapesetAssembling(Shapeset* shapeset) : PrecalcShapeset(shapeset), storage(nullptr)
+    PrecalcShapesetAssembling::PrecalcShapesetAssembling(Shapeset* shapeset, bool build_tables) : PrecalcShapeset(shapeset), storage(nullptr)
     {
       if (PrecalcShapesetAssemblingTables[(int)shapeset->get_id()])
       {
@@ -188,6 +196,9 @@ namespace Hermes
           PrecalcShapesetAssemblingTables[(int)shapeset->get_id()] = storage;
         }
       }
+
+      if (build_tables)
+        this->storage->build(this->shapeset);
     }
 
     PrecalcShapesetAssembling::PrecalcShapesetAssembling(const PrecalcShapesetAssembling& other) : PrecalcShapeset(other.shapeset)
@@ -203,7 +214,7 @@ namespace Hermes
     const double* PrecalcShapesetAssembling::get_fn_values(int component) const
     {
       if (this->attempt_to_reuse(this->order))
-        return this->storage->PrecalculatedValues[this->element->get_mode()][0][this->order][this->index];
+        return this->storage->get_values(this->element->get_mode(), this->order, 0, this->index);
       assert(this->values_valid);
       return &values[component][0][0];
     }
@@ -211,7 +222,7 @@ namespace Hermes
     const double* PrecalcShapesetAssembling::get_dx_values(int component) const
     {
       if (this->attempt_to_reuse(this->order))
-        return this->storage->PrecalculatedValues[this->element->get_mode()][1][this->order][this->index];
+        return this->storage->get_values(this->element->get_mode(), this->order, 1, this->index);
       assert(this->values_valid);
       return &values[component][1][0];
     }
@@ -219,7 +230,7 @@ namespace Hermes
     const double* PrecalcShapesetAssembling::get_dy_values(int component) const
     {
       if (this->attempt_to_reuse(this->order))
-        return this->storage->PrecalculatedValues[this->element->get_mode()][2][this->order][this->index];
+        return this->storage->get_values(this->element->get_mode(), this->order, 2, this->index);
       assert(this->values_valid);
       return &values[component][2][0];
     }
@@ -246,7 +257,7 @@ namespace Hermes
 
     bool PrecalcShapesetAssembling::attempt_to_reuse(unsigned short order_) const
     {
-      return (this->reuse_possible() && this->storage->PrecalculatedInfo[this->element->get_mode()][order_][this->index]);
+      return (this->reuse_possible() && this->storage->is_built());
     }
 
     bool PrecalcShapesetAssembling::reuse_possible() const
@@ -266,200 +277,465 @@ namespace Hermes
         return Function<double>::get_values(component, item);
     }
 
+    bool PrecalcShapesetAssembling::transformed_cache_possible(unsigned short mask) const
+    {
+      return (this->index >= 0 && this->get_quad_2d()->get_id() == 1 && this->sub_idx != 0 && this->num_components == 1 && !(mask & ~H2D_FN_DEFAULT));
+    }
+
     void PrecalcShapesetAssembling::precalculate(unsigned short order_, unsigned short mask)
     {
       if (this->attempt_to_reuse(order_))
         return;
+      else if (this->transformed_cache_possible(mask))
+      {
+        ElementMode2D mode = this->element->get_mode();
+        unsigned char np = this->get_quad_2d()->get_num_points(order_, mode);
+        if (this->storage->transformed_cache.get(mode, order_, this->index, this->sub_idx, np, this->values[0]))
+          Function<double>::precalculate(order_, mask);
+        else
+        {
+          // All three are stored, whatever the mask.
+          PrecalcShapeset::precalculate(order_, H2D_FN_DEFAULT);
+          this->storage->transformed_cache.put(mode, order_, this->index, this->sub_idx, np, this->values[0]);
+        }
+      }
       else
+        PrecalcShapeset::precalculate(order_, mask);
+    }
+
+    /// Header of the file with the precalculated shapeset tables, padded to the alignment of the tables.
+    struct PrecalcShapesetTablesFileHeader
+    {
+      char magic[8];
+      unsigned int version;
+      unsigned int shapeset_id;
+      unsigned int max_index[H2D_NUM_MODES];
+      uint64_t size;
+      /// Hash of the quadrature points & weights the tables were computed in.
+      uint64_t quadrature_hash;
+      char reserved[24];
+    };
+
+    static const char* PrecalcShapesetTablesFileMagic = "H2DPSST";
+    static const unsigned int PrecalcShapesetTablesFileVersion = 2;
+
+    /// Hash (FNV-1a) of the points & weights of the standard quadrature of all the orders in the tables.
+    static uint64_t pss_quadrature_hash()
+    {
+      uint64_t hash = 14695981039346656037ULL;
+      for (int mode = 0; mode < H2D_NUM_MODES; mode++)
       {
-        Function<double>::precalculate(order_, mask);
+        unsigned short order_count = g_quad_2d_std.get_num_tables((ElementMode2D)mode);
+        for (unsigned short order = 0; order < order_count && order < H2D_PSS_TABLE_ORDERS; order++)
+        {
+          unsigned char np = g_quad_2d_std.get_num_points(order, (ElementMode2D)mode);
+          hash = (hash ^ np) * 1099511628211ULL;
+          if (np == 0)
+            continue;
+          const unsigned char* bytes = (const unsigned char*)g_quad_2d_std.get_points(order, (ElementMode2D)mode);
+          for (size_t i = 0; i < np * sizeof(double3); i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+      }
+      return hash;
+    }
 
-        unsigned char np = this->quads[cur_quad]->get_num_points(order_, this->element->get_mode());
-        double3* pt = this->quads[cur_quad]->get_points(order_, this->element->get_mode());
+    PrecalcShapesetAssemblingStorage::PrecalcShapesetAssemblingStorage(Shapeset* shapeset) : shapeset_id(shapeset->get_id()), ref_count(0), tables(nullptr), memory(nullptr), memory_size(0), memory_mapped(false)
+    {
+      this->max_index[0] = shapeset->get_max_index(HERMES_MODE_TRIANGLE);
+      this->max_index[1] = shapeset->get_max_index(HERMES_MODE_QUAD);
+    }
 
-        unsigned short j, k;
+    PrecalcShapesetAssemblingStorage::~PrecalcShapesetAssemblingStorage()
+    {
+#ifndef _WINDOWS
+      if (this->memory_mapped)
+        munmap(this->memory, this->memory_size);
+      else
+#endif
+        free_with_check(this->memory);
+    }
 
-        ElementMode2D mode = element->get_mode();
+    void PrecalcShapesetAssemblingStorage::build(Shapeset* shapeset)
+    {
+      if (this->tables.load(std::memory_order_acquire) || shapeset->get_num_components() > 1)
+        return;
 
-        if (this->num_components == 1)
+#pragma omp critical (pss_table_building)
+      {
+        if (!this->tables.load(std::memory_order_relaxed))
         {
-          if (this->reuse_possible())
+          size_t size = this->calculate_layout();
+
+          std::string directory = Hermes2DApi.get_text_param_value(precalculatedShapesetTablesDirPath);
+          std::stringstream filename;
+          if (!directory.empty())
           {
-#pragma omp critical (precalculatingPSS)
-                    {
-                      double* valuePointer;
-                      if (mode == HERMES_MODE_TRIANGLE)
-                      {
-                        valuePointer = this->storage->PrecalculatedValues[HERMES_MODE_TRIANGLE][0][order_][index];
-                        for (short i = 0; i < np; i++)
-                          valuePointer[i] = shapeset->get_fn_value_0_tri(index, pt[i][0], pt[i][1]);
-
-                        valuePointer = this->storage->PrecalculatedValues[HERMES_MODE_TRIANGLE][1][order_][index];
-                        for (short i = 0; i < np; i++)
-                          valuePointer[i] = shapeset->get_dx_value_0_tri(index, pt[i][0], pt[i][1]);
-
-                        valuePointer = this->storage->PrecalculatedValues[HERMES_MODE_TRIANGLE][2][order_][index];
-                        for (short i = 0; i < np; i++)
-                          valuePointer[i] = shapeset->get_dy_value_0_tri(index, pt[i][0], pt[i][1]);
-
-                        this->storage->PrecalculatedInfo[HERMES_MODE_TRIANGLE][order_][index] = true;
-                      }
-                      else
-                      {
-                        valuePointer = this->storage->PrecalculatedValues[HERMES_MODE_QUAD][0][order_][index];
-                        for (short i = 0; i < np; i++)
-                          valuePointer[i] = shapeset->get_fn_value_0_quad(index, pt[i][0], pt[i][1]);
-
-                        valuePointer = this->storage->PrecalculatedValues[HERMES_MODE_QUAD][1][order_][index];
-                        for (short i = 0; i < np; i++)
-                          valuePointer[i] = shapeset->get_dx_value_0_quad(index, pt[i][0], pt[i][1]);
-
-                        valuePointer = this->storage->PrecalculatedValues[HERMES_MODE_QUAD][2][order_][index];
-                        for (short i = 0; i < np; i++)
-                          valuePointer[i] = shapeset->get_dy_value_0_quad(index, pt[i][0], pt[i][1]);
-
-                        this->storage->PrecalculatedInfo[HERMES_MODE_QUAD][order_][index] = true;
-                      }
-                    }
+            filename << directory;
+            if (directory.at(directory.length() - 1) != '/' && directory.at(directory.length() - 1) != '\\')
+              filename << '/';
+            filename << "shapeset_" << (int)this->shapeset_id << ".h2dtables";
           }
-          else
+
+          double* built_tables = directory.empty() ? nullptr : this->map_file(filename.str().c_str(), shapeset, size);
+          if (!built_tables)
           {
-            // Correction of points for sub-element mappings.
-            if (this->sub_idx != 0)
-            {
-              for (short i = 0; i < np; i++)
-              {
-                ref_points[i][0] = ctm->m[0] * pt[i][0] + ctm->t[0];
-                ref_points[i][1] = ctm->m[1] * pt[i][1] + ctm->t[1];
-              }
+            built_tables = this->compute_tables(shapeset, size);
+            if (!directory.empty())
+              this->save_file(filename.str().c_str(), built_tables, size);
+          }
 
-              for (k = 0; k < H2D_NUM_FUNCTION_VALUES; k++)
-                if (mask & idx2mask[k][0])
-                  for (short i = 0; i < np; i++)
-                    this->values[0][k][i] = shapeset->get_value(k, index, ref_points[i][0], ref_points[i][1], 0, mode);
-            }
-            else if (mode == HERMES_MODE_TRIANGLE)
+          // Complete tables only - other threads read them without entering the critical section.
+          this->tables.store(built_tables, std::memory_order_release);
+        }
+      }
+    }
+
+    size_t PrecalcShapesetAssemblingStorage::calculate_layout()
+    {
+      size_t size = 0;
+      for (int mode = 0; mode < H2D_NUM_MODES; mode++)
+      {
+        unsigned short order_count = g_quad_2d_std.get_num_tables((ElementMode2D)mode);
+        for (unsigned short order = 0; order < H2D_PSS_TABLE_ORDERS; order++)
+        {
+          this->offsets[mode][order] = size;
+          this->np_aligned[mode][order] = 0;
+          if (order >= order_count)
+            continue;
+
+          unsigned short np = g_quad_2d_std.get_num_points(order, (ElementMode2D)mode);
+          this->np_aligned[mode][order] = (np + H2D_PSS_TABLE_ALIGNMENT - 1) / H2D_PSS_TABLE_ALIGNMENT * H2D_PSS_TABLE_ALIGNMENT;
+          size += H2D_PSS_TABLE_VALUES * (this->max_index[mode] + 1) * this->np_aligned[mode][order];
+        }
+      }
+      return size;
+    }
+
+    double* PrecalcShapesetAssemblingStorage::compute_tables(Shapeset* shapeset, size_t size)
+    {
+      // Aligned buffer, the padding is zeroed (the saved files are then reproducible).
+      this->memory_size = (size + H2D_PSS_TABLE_ALIGNMENT) * sizeof(double);
+      this->memory = calloc_with_check<char>(this->memory_size);
+      double* aligned_tables = (double*)(((uintptr_t)this->memory + H2D_PSS_TABLE_ALIGNMENT * sizeof(double) - 1) & ~(uintptr_t)(H2D_PSS_TABLE_ALIGNMENT * sizeof(double) - 1));
+
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel())
+        num_threads = 1;
+
+      // All (mode, order) pairs, independent of each other.
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+      for (int mode_order = 0; mode_order < H2D_NUM_MODES * H2D_PSS_TABLE_ORDERS; mode_order++)
+      {
+        ElementMode2D mode = (ElementMode2D)(mode_order / H2D_PSS_TABLE_ORDERS);
+        unsigned short order = mode_order % H2D_PSS_TABLE_ORDERS;
+        unsigned short np_aligned = this->np_aligned[mode][order];
+        if (np_aligned == 0)
+          continue;
+
+        unsigned char np = g_quad_2d_std.get_num_points(order, mode);
+        double3* pt = g_quad_2d_std.get_points(order, mode);
+        unsigned short index_count = this->max_index[mode] + 1;
+
+        for (unsigned short index = 0; index < index_count; index++)
+        {
+          double* fn = aligned_tables + this->offsets[mode][order] + index * np_aligned;
+          double* dx = fn + index_count * np_aligned;
+          double* dy = dx + index_count * np_aligned;
+          if (mode == HERMES_MODE_TRIANGLE)
+          {
+            for (unsigned char i = 0; i < np; i++)
             {
-              if (mask & idx2mask[0][0])
-                for (short i = 0; i < np; i++)
-                  this->values[0][0][i] = shapeset->get_fn_value_0_tri(index, pt[i][0], pt[i][1]);
-              if (mask & idx2mask[1][0])
-                for (short i = 0; i < np; i++)
-                  this->values[0][1][i] = shapeset->get_dx_value_0_tri(index, pt[i][0], pt[i][1]);
-              if (mask & idx2mask[2][0])
-                for (short i = 0; i < np; i++)
-                  this->values[0][2][i] = shapeset->get_dy_value_0_tri(index, pt[i][0], pt[i][1]);
+              fn[i] = shapeset->get_fn_value_0_tri(index, pt[i][0], pt[i][1]);
+              dx[i] = shapeset->get_dx_value_0_tri(index, pt[i][0], pt[i][1]);
+              dy[i] = shapeset->get_dy_value_0_tri(index, pt[i][0], pt[i][1]);
             }
-            else
+          }
+          else
+          {
+            for (unsigned char i = 0; i < np; i++)
             {
-              if (mask & idx2mask[0][0])
-                for (short i = 0; i < np; i++)
-                  this->values[0][0][i] = shapeset->get_fn_value_0_quad(index, pt[i][0], pt[i][1]);
-              if (mask & idx2mask[1][0])
-                for (short i = 0; i < np; i++)
-                  this->values[0][1][i] = shapeset->get_dx_value_0_quad(index, pt[i][0], pt[i][1]);
-              if (mask & idx2mask[2][0])
-                for (short i = 0; i < np; i++)
-                  this->values[0][2][i] = shapeset->get_dy_value_0_quad(index, pt[i][0], pt[i][1]);
+              fn[i] = shapeset->get_fn_value_0_quad(index, pt[i][0], pt[i][1]);
+              dx[i] = shapeset->get_dx_value_0_quad(index, pt[i][0], pt[i][1]);
+              dy[i] = shapeset->get_dy_value_0_quad(index, pt[i][0], pt[i][1]);
             }
           }
         }
-        else
+      }
+
+      return aligned_tables;
+    }
+
+    bool PrecalcShapesetAssemblingStorage::check_values(Shapeset* shapeset, const double* checked_tables) const
+    {
+      // The first, middle and last shape function in the first and last point of every fifth order.
+      for (int mode = 0; mode < H2D_NUM_MODES; mode++)
+      {
+        unsigned short index_count = this->max_index[mode] + 1;
+        unsigned short indices[3] = { 0, (unsigned short)(this->max_index[mode] / 2), this->max_index[mode] };
+        for (unsigned short order = 0; order < H2D_PSS_TABLE_ORDERS; order += 5)
         {
-          // Correction of points for sub-element mappings.
-          if (this->sub_idx != 0)
+          unsigned short np_aligned = this->np_aligned[mode][order];
+          if (np_aligned == 0)
+            continue;
+
+          unsigned char np = g_quad_2d_std.get_num_points(order, (ElementMode2D)mode);
+          double3* pt = g_quad_2d_std.get_points(order, (ElementMode2D)mode);
+          unsigned char points[2] = { 0, (unsigned char)(np - 1) };
+          for (int index_i = 0; index_i < 3; index_i++)
           {
-            for (short i = 0; i < np; i++)
+            for (int point_i = 0; point_i < 2; point_i++)
             {
-              ref_points[i][0] = ctm->m[0] * pt[i][0] + ctm->t[0];
-              ref_points[i][1] = ctm->m[1] * pt[i][1] + ctm->t[1];
+              unsigned short index = indices[index_i];
+              double x = pt[points[point_i]][0], y = pt[points[point_i]][1];
+              double values[H2D_PSS_TABLE_VALUES];
+              if (mode == HERMES_MODE_TRIANGLE)
+              {
+                values[0] = shapeset->get_fn_value_0_tri(index, x, y);
+                values[1] = shapeset->get_dx_value_0_tri(index, x, y);
+                values[2] = shapeset->get_dy_value_0_tri(index, x, y);
+              }
+              else
+              {
+                values[0] = shapeset->get_fn_value_0_quad(index, x, y);
+                values[1] = shapeset->get_dx_value_0_quad(index, x, y);
+                values[2] = shapeset->get_dy_value_0_quad(index, x, y);
+              }
+              for (int value = 0; value < H2D_PSS_TABLE_VALUES; value++)
+                if (checked_tables[this->offsets[mode][order] + (value * index_count + index) * np_aligned + points[point_i]] != values[value])
+                  return false;
             }
-
-            for (j = 0; j < num_components; j++)
-              for (k = 0; k < H2D_NUM_FUNCTION_VALUES; k++)
-                if (mask & idx2mask[k][j])
-                  for (short i = 0; i < np; i++)
-                    this->values[j][k][i] = shapeset->get_value(k, index, ref_points[i][0], ref_points[i][1], j, mode);
-          }
-          else
-          {
-            for (j = 0; j < num_components; j++)
-              for (k = 0; k < H2D_NUM_FUNCTION_VALUES; k++)
-                if (mask & idx2mask[k][j])
-                  for (short i = 0; i < np; i++)
-                    this->values[j][k][i] = shapeset->get_value(k, index, pt[i][0], pt[i][1], j, mode);
           }
         }
       }
+      return true;
     }
 
-    PrecalcShapesetAssemblingStorage::PrecalcShapesetAssemblingStorage(Shapeset* shapeset) : shapeset_id(shapeset->get_id()), ref_count(0)
+    double* PrecalcShapesetAssemblingStorage::map_file(const char* filename, Shapeset* shapeset, size_t size)
     {
-      this->max_index[0] = shapeset->get_max_index(HERMES_MODE_TRIANGLE);
-      this->max_index[1] = shapeset->get_max_index(HERMES_MODE_QUAD);
+      size_t file_size = sizeof(PrecalcShapesetTablesFileHeader) + size * sizeof(double);
+      PrecalcShapesetTablesFileHeader header;
+
+#ifndef _WINDOWS
+      int fd = ::open(filename, O_RDONLY);
+      if (fd < 0)
+        return nullptr;
+      struct stat file_stat;
+      if (fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size != file_size)
+      {
+        ::close(fd);
+        return nullptr;
+      }
+      void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (mapping == MAP_FAILED)
+        return nullptr;
+      memcpy(&header, mapping, sizeof(PrecalcShapesetTablesFileHeader));
+#else
+      FILE* file = fopen(filename, "rb");
+      if (file == nullptr)
+        return nullptr;
+      if (fread(&header, sizeof(PrecalcShapesetTablesFileHeader), 1, file) != 1)
+      {
+        fclose(file);
+        return nullptr;
+      }
+#endif
 
-      for (int i = 0; i < H2D_NUM_MODES; i++)
+      // The file has to come from the same version of the shapeset & quadrature.
+      bool valid = !strncmp(header.magic, PrecalcShapesetTablesFileMagic, 8) && header.version == PrecalcShapesetTablesFileVersion
+        && header.shapeset_id == this->shapeset_id && header.size == size && header.quadrature_hash == pss_quadrature_hash();
+      for (int mode = 0; mode < H2D_NUM_MODES; mode++)
+        valid = valid && header.max_index[mode] == this->max_index[mode];
+
+#ifndef _WINDOWS
+      double* mapped_tables = (double*)((char*)mapping + sizeof(PrecalcShapesetTablesFileHeader));
+      if (!valid || !this->check_values(shapeset, mapped_tables))
       {
-        unsigned short g_max, np;
-        if (i == HERMES_MODE_TRIANGLE)
-        {
-          g_max = g_max_tri + 1 + 3 * g_max_tri + 3;
-          np = H2D_MAX_INTEGRATION_POINTS_COUNT_TRI;
-        }
+        munmap(mapping, file_size);
+        return nullptr;
+      }
+      this->memory = (char*)mapping;
+      this->memory_size = file_size;
+      this->memory_mapped = true;
+      return mapped_tables;
+#else
+      double* read_tables = nullptr;
+      if (valid)
+      {
+        this->memory_size = (size + H2D_PSS_TABLE_ALIGNMENT) * sizeof(double);
+        this->memory = malloc_with_check<char>(this->memory_size);
+        double* aligned_tables = (double*)(((uintptr_t)this->memory + H2D_PSS_TABLE_ALIGNMENT * sizeof(double) - 1) & ~(uintptr_t)(H2D_PSS_TABLE_ALIGNMENT * sizeof(double) - 1));
+        if (fread(aligned_tables, sizeof(double), size, file) == size && this->check_values(shapeset, aligned_tables))
+          read_tables = aligned_tables;
         else
-        {
-          g_max = g_max_quad + 1 + 4 * g_max_quad + 4;
-          np = H2D_MAX_INTEGRATION_POINTS_COUNT_QUAD;
-        }
+          free_with_check(this->memory);
+      }
+      fclose(file);
+      return read_tables;
+#endif
+    }
 
-        unsigned short local_base_size = this->max_index[i] + 1;
+    void PrecalcShapesetAssemblingStorage::save_file(const char* filename, const double* saved_tables, size_t size) const
+    {
+      PrecalcShapesetTablesFileHeader header;
+      memset(&header, 0, sizeof(PrecalcShapesetTablesFileHeader));
+      strncpy(header.magic, PrecalcShapesetTablesFileMagic, 8);
+      header.version = PrecalcShapesetTablesFileVersion;
+      header.shapeset_id = this->shapeset_id;
+      for (int mode = 0; mode < H2D_NUM_MODES; mode++)
+        header.max_index[mode] = this->max_index[mode];
+      header.size = size;
+      header.quadrature_hash = pss_quadrature_hash();
+
+      // Written under a temporary name and renamed - other processes never map an incomplete file.
+      std::stringstream temp_filename;
+      temp_filename << filename << ".tmp";
+#ifndef _WINDOWS
+      temp_filename << "." << getpid();
+#endif
+      FILE* file = fopen(temp_filename.str().c_str(), "wb");
+      if (file == nullptr)
+      {
+        Hermes::Mixins::Loggable::Static::warn("PrecalcShapesetAssemblingStorage: could not write %s.", temp_filename.str().c_str());
+        return;
+      }
+      bool written = fwrite(&header, sizeof(PrecalcShapesetTablesFileHeader), 1, file) == 1
+        && fwrite(saved_tables, sizeof(double), size, file) == size;
+      written = (fclose(file) == 0) && written;
 
-        this->PrecalculatedInfo[i] = malloc_with_check<bool*>(g_max);
+      if (!written || rename(temp_filename.str().c_str(), filename) != 0)
+        remove(temp_filename.str().c_str());
+    }
 
-        for (int j = 0; j < H2D_NUM_FUNCTION_VALUES; j++)
-        {
-          this->PrecalculatedValues[i][j] = malloc_with_check<double**>(g_max);
+    struct PrecalcShapesetTransformedCache::Entry
+    {
+      /// Odd while the entry is being written.
+      std::atomic<unsigned int> sequence;
+      /// (mode, order, index) of the entry, 0 for an empty entry.
+      std::atomic<unsigned int> key;
+      std::atomic<uint64_t> sub_idx;
+      /// Value of Set::clock at the last use.
+      std::atomic<unsigned int> last_use;
+      /// Values, x- and y-derivatives (H2D_MAX_INTEGRATION_POINTS_COUNT each), allocated with the first write to the entry.
+      std::atomic<double*> values;
+    };
 
-          for (int k = 0; k < g_max; k++)
-          {
-            this->PrecalculatedValues[i][j][k] = malloc_with_check<double*>(local_base_size);
-            if (j == 0)
-              this->PrecalculatedInfo[i][k] = calloc_with_check<bool>(local_base_size);
+    struct PrecalcShapesetTransformedCache::Set
+    {
+      /// A thread is writing into this set.
+      std::atomic<bool> writing;
+      std::atomic<unsigned int> clock;
+      Entry entries[H2D_PSS_TRANSFORMED_CACHE_WAYS];
+    };
 
-            for (int l = 0; l < local_base_size; l++)
-              this->PrecalculatedValues[i][j][k][l] = malloc_with_check<double>(np);
-          }
+    static inline unsigned int transformed_cache_key(int mode, unsigned short order, unsigned short index)
+    {
+      return (1u << 31) | ((unsigned int)mode << 30) | ((unsigned int)order << 16) | index;
+    }
+
+    PrecalcShapesetTransformedCache::PrecalcShapesetTransformedCache()
+    {
+      // Value-initialization zeroes all the atomics - empty entries.
+      this->sets = new Set[H2D_PSS_TRANSFORMED_CACHE_SETS]();
+    }
+
+    PrecalcShapesetTransformedCache::~PrecalcShapesetTransformedCache()
+    {
+      for (int i = 0; i < H2D_PSS_TRANSFORMED_CACHE_SETS; i++)
+      {
+        for (int way = 0; way < H2D_PSS_TRANSFORMED_CACHE_WAYS; way++)
+        {
+          double* values = this->sets[i].entries[way].values.load();
+          free_with_check(values);
         }
       }
+      delete[] this->sets;
     }
 
-    PrecalcShapesetAssemblingStorage::~PrecalcShapesetAssemblingStorage()
+    PrecalcShapesetTransformedCache::Set& PrecalcShapesetTransformedCache::get_set(unsigned int key, uint64_t sub_idx) const
+    {
+      uint64_t hash = (sub_idx ^ ((uint64_t)key << 21)) * 0x9E3779B97F4A7C15ULL;
+      return this->sets[(hash >> 32) & (H2D_PSS_TRANSFORMED_CACHE_SETS - 1)];
+    }
+
+    bool PrecalcShapesetTransformedCache::get(int mode, unsigned short order, unsigned short index, uint64_t sub_idx, unsigned char np, double values[][H2D_MAX_INTEGRATION_POINTS_COUNT])
     {
-      for (int i = 0; i < H2D_NUM_MODES; i++)
+      unsigned int key = transformed_cache_key(mode, order, index);
+      Set& set = this->get_set(key, sub_idx);
+      for (int way = 0; way < H2D_PSS_TRANSFORMED_CACHE_WAYS; way++)
       {
-        unsigned short g_max;
-        if (i == HERMES_MODE_TRIANGLE)
-          g_max = g_max_tri + 1 + 3 * g_max_tri + 3;
-        else
-          g_max = g_max_quad + 1 + 4 * g_max_quad + 4;
+        Entry& entry = set.entries[way];
+        unsigned int sequence = entry.sequence.load(std::memory_order_acquire);
+        if (sequence & 1)
+          continue;
+        if (entry.key.load(std::memory_order_relaxed) != key || entry.sub_idx.load(std::memory_order_relaxed) != sub_idx)
+          continue;
+
+        double* stored = entry.values.load(std::memory_order_relaxed);
+        for (int k = 0; k < 3; k++)
+          memcpy(values[k], stored + k * H2D_MAX_INTEGRATION_POINTS_COUNT, np * sizeof(double));
+
+        // Overwritten during the copy - a miss.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != sequence)
+          return false;
+
+        entry.last_use.store(set.clock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+      }
+      return false;
+    }
 
-        unsigned short local_base_size = this->max_index[i] + 1;
+    void PrecalcShapesetTransformedCache::put(int mode, unsigned short order, unsigned short index, uint64_t sub_idx, unsigned char np, double values[][H2D_MAX_INTEGRATION_POINTS_COUNT])
+    {
+      unsigned int key = transformed_cache_key(mode, order, index);
+      Set& set = this->get_set(key, sub_idx);
 
-        for (int j = 0; j < H2D_NUM_FUNCTION_VALUES; j++)
-        {
-          for (int k = 0; k < g_max; k++)
-          {
-            for (int l = 0; l < local_base_size; l++)
-              free_with_check(this->PrecalculatedValues[i][j][k][l]);
-            free_with_check(this->PrecalculatedValues[i][j][k]);
-            if (j == 0)
-              free_with_check(this->PrecalculatedInfo[i][k]);
-          }
+      // Another thread is writing into the set, this entry is left out.
+      if (set.writing.exchange(true, std::memory_order_acquire))
+        return;
 
-          free_with_check(this->PrecalculatedValues[i][j]);
-          free_with_check(this->PrecalculatedInfo[i][j]);
+      // The least recently used (or empty) entry is replaced, nothing is done if the values are already there.
+      unsigned int clock = set.clock.load(std::memory_order_relaxed);
+      Entry* victim = nullptr;
+      unsigned int victim_age = 0;
+      for (int way = 0; way < H2D_PSS_TRANSFORMED_CACHE_WAYS; way++)
+      {
+        Entry& entry = set.entries[way];
+        unsigned int entry_key = entry.key.load(std::memory_order_relaxed);
+        if (entry_key == key && entry.sub_idx.load(std::memory_order_relaxed) == sub_idx)
+        {
+          set.writing.store(false, std::memory_order_release);
+          return;
+        }
+        unsigned int age = (entry_key == 0) ? UINT_MAX : clock - entry.last_use.load(std::memory_order_relaxed);
+        if (!victim || age > victim_age)
+        {
+          victim = &entry;
+          victim_age = age;
         }
       }
+
+      double* stored = victim->values.load(std::memory_order_relaxed);
+      if (!stored)
+      {
+        stored = malloc_with_check<double>(3 * H2D_MAX_INTEGRATION_POINTS_COUNT);
+        victim->values.store(stored, std::memory_order_relaxed);
+      }
+
+      unsigned int sequence = victim->sequence.load(std::memory_order_relaxed);
+      victim->sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      victim->key.store(key, std::memory_order_relaxed);
+      victim->sub_idx.store(sub_idx, std::memory_order_relaxed);
+      for (int k = 0; k < 3; k++)
+        memcpy(stored + k * H2D_MAX_INTEGRATION_POINTS_COUNT, values[k], np * sizeof(double));
+      victim->last_use.store(set.clock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+      victim->sequence.store(sequence + 2, std::memory_order_release);
+      set.writing.store(false, std::memory_order_release);
     }
   }
 }
@@ -22,7 +22,9 @@
 #include "space_hcurl.h"
 #include "space_hdiv.h"
 #include "space_h2d_xml.h"
+#include "xml_stream.h"
 #include "api2d.h"
+#include <atomic>
 
 namespace Hermes
 {
@@ -604,9 +606,24 @@ namespace Hermes
     template<typename Scalar>
     void Space<Scalar>::ReferenceSpaceCreator::handle_orders(SpaceSharedPtr<Scalar> ref_space)
     {
-      Element* e;
-      for_all_active_elements(e, coarse_space->get_mesh())
+      // The coarse elements are handled in parallel, update_orders_recurrent() only touches the (disjoint) subtrees of the elements.
+      std::vector<Element*> coarse_elements;
+      coarse_elements.reserve(coarse_space->get_mesh()->get_num_active_elements());
+      Element* coarse_element;
+      for_all_active_elements(coarse_element, coarse_space->get_mesh())
+        coarse_elements.push_back(coarse_element);
+      int coarse_elements_count = coarse_elements.size();
+
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel())
+        num_threads = 1;
+
+      int uninitialized_order_element_id = -1;
+#pragma omp parallel for num_threads(num_threads)
+      for (int coarse_element_i = 0; coarse_element_i < coarse_elements_count; coarse_element_i++)
       {
+        Element* e = coarse_elements[coarse_element_i];
+
         // This is the element id on the COARSE mesh. One can use it in the logic of increasing polynomial order (selectively).
         int coarse_element_id = e->id;
 
@@ -614,7 +631,11 @@ namespace Hermes
         int current_order = coarse_space->get_element_order(coarse_element_id);
         // Sanity check.
         if (current_order < 0)
-          throw Hermes::Exceptions::Exception("Source space has an uninitialized order (element id = %d)", coarse_element_id);
+        {
+#pragma omp critical (uninitialized_order_element_id)
+          uninitialized_order_element_id = coarse_element_id;
+          continue;
+        }
 
         // new_ order calculation.
         int new_order;
@@ -644,6 +665,9 @@ namespace Hermes
         // And now call this method that does the magic for us (sets the new_order to .
         ref_space->update_orders_recurrent(ref_space->mesh->get_element(coarse_element_id), new_order);
       }
+
+      if (uninitialized_order_element_id != -1)
+        throw Hermes::Exceptions::Exception("Source space has an uninitialized order (element id = %d)", uninitialized_order_element_id);
     }
 
     template<typename Scalar>
@@ -730,9 +754,21 @@ namespace Hermes
     {
       ref_space->seq = g_space_seq++;
 
-      Element *e;
-      for_all_active_elements(e, coarse_space->get_mesh())
+      std::vector<Element*> coarse_elements;
+      coarse_elements.reserve(coarse_space->get_mesh()->get_num_active_elements());
+      Element* coarse_element;
+      for_all_active_elements(coarse_element, coarse_space->get_mesh())
+        coarse_elements.push_back(coarse_element);
+      int coarse_elements_count = coarse_elements.size();
+
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel())
+        num_threads = 1;
+
+#pragma omp parallel for num_threads(num_threads)
+      for (int coarse_element_i = 0; coarse_element_i < coarse_elements_count; coarse_element_i++)
       {
+        Element* e = coarse_elements[coarse_element_i];
         bool to_set = this->coarse_space->edata[e->id].changed_in_last_adaptation;
         {
           if (ref_space->mesh->get_element(e->id)->active)
@@ -936,6 +972,101 @@ namespace Hermes
       }
     }
 
+    template<typename Scalar>
+    int Space<Scalar>::assign_dofs_by_elements(DofKind kind)
+    {
+      int first_dof = this->next_dof;
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel() || num_threads < 2 || this->mesh->get_num_active_elements() < H2D_PARALLEL_DOF_ASSIGNMENT_MIN_ELEMENTS)
+      {
+        std::vector<int> first_elements;
+        Element* e;
+        for_all_active_elements(e, this->mesh)
+          this->next_dof += this->assign_element_dofs(e, -1, kind, first_elements, this->next_dof, true);
+        return this->next_dof - first_dof;
+      }
+
+      const std::vector<int>& active_elements = this->mesh->get_snapshot()->active_elements;
+      int active_count = active_elements.size();
+
+      // Position of the first element with a nonzero order having the node (the node is numbered by this element).
+      std::vector<int> first_elements;
+      if (kind != BubbleDofs)
+      {
+        int node_count = this->mesh->get_max_node_id();
+        std::atomic<int>* first = new std::atomic<int>[node_count];
+#pragma omp parallel for num_threads(num_threads)
+        for (int id = 0; id < node_count; id++)
+          first[id].store(active_count, std::memory_order_relaxed);
+
+#pragma omp parallel for num_threads(num_threads)
+        for (int position = 0; position < active_count; position++)
+        {
+          Element* e = this->mesh->get_element_fast(active_elements[position]);
+          if (this->get_element_order(e->id) <= 0)
+            continue;
+          for (unsigned char i = 0; i < e->get_nvert(); i++)
+          {
+            std::atomic<int>& node_first = first[kind == VertexDofs ? e->vn[i]->id : e->en[i]->id];
+            int current = node_first.load(std::memory_order_relaxed);
+            while (position < current && !node_first.compare_exchange_weak(current, position, std::memory_order_relaxed));
+          }
+        }
+
+        first_elements.resize(node_count);
+#pragma omp parallel for num_threads(num_threads)
+        for (int id = 0; id < node_count; id++)
+          first_elements[id] = first[id].load(std::memory_order_relaxed);
+        delete[] first;
+      }
+
+      // Chunk i holds the active elements at the positions chunk_starts[i] .. chunk_starts[i + 1] - 1.
+      std::vector<int> chunk_starts(num_threads + 1);
+      for (int chunk = 0; chunk <= num_threads; chunk++)
+        chunk_starts[chunk] = (int)(((long long)active_count * chunk) / num_threads);
+
+      // DOF counts of the chunks, then their first DOFs (exclusive prefix sum).
+      std::vector<int> chunk_first_dofs(num_threads + 1, 0);
+#pragma omp parallel for num_threads(num_threads)
+      for (int chunk = 0; chunk < num_threads; chunk++)
+      {
+        int count = 0;
+        for (int position = chunk_starts[chunk]; position < chunk_starts[chunk + 1]; position++)
+          count += this->assign_element_dofs(this->mesh->get_element_fast(active_elements[position]), position, kind, first_elements, 0, false);
+        chunk_first_dofs[chunk + 1] = count;
+      }
+      chunk_first_dofs[0] = first_dof;
+      for (int chunk = 0; chunk < num_threads; chunk++)
+        chunk_first_dofs[chunk + 1] += chunk_first_dofs[chunk];
+
+#pragma omp parallel for num_threads(num_threads)
+      for (int chunk = 0; chunk < num_threads; chunk++)
+      {
+        int dof = chunk_first_dofs[chunk];
+        for (int position = chunk_starts[chunk]; position < chunk_starts[chunk + 1]; position++)
+          dof += this->assign_element_dofs(this->mesh->get_element_fast(active_elements[position]), position, kind, first_elements, dof, true);
+      }
+
+      this->next_dof = chunk_first_dofs[num_threads];
+      return this->next_dof - first_dof;
+    }
+
+    template<typename Scalar>
+    int Space<Scalar>::assign_element_dofs(Element* e, int position, DofKind kind, const std::vector<int>& first_elements, int first_dof, bool assign)
+    {
+      if (kind != BubbleDofs)
+        throw Hermes::Exceptions::Exception("Space<Scalar>::assign_element_dofs() only handles the bubble DOFs.");
+
+      typename Space<Scalar>::ElementData* ed = &this->edata[e->id];
+      int dofs = this->shapeset->get_num_bubbles(ed->order, e->get_mode());
+      if (assign)
+      {
+        ed->bdof = first_dof;
+        ed->n = dofs;
+      }
+      return dofs;
+    }
+
     template<typename Scalar>
     int Space<Scalar>::get_vertex_functions_count()
     {
@@ -1097,20 +1228,26 @@ namespace Hermes
     void Space<Scalar>::save(const char *filename) const
     {
       this->check();
-      XMLSpace::space xmlspace;
 
-      xmlspace.spaceType().set(spaceTypeToString(this->get_type()));
+      XMLStreamWriter writer(filename);
+      writer.start_element("space:space");
+      writer.attribute("xmlns:space", "XMLSpace");
+      writer.attribute("spaceType", spaceTypeToString(this->get_type()));
 
       // Utility pointer.
       Element *e;
       for_all_used_elements(e, this->get_mesh())
-        xmlspace.element_data().push_back(XMLSpace::space::element_data_type(e->id, this->edata[e->id].order, this->edata[e->id].bdof, this->edata[e->id].n, this->edata[e->id].changed_in_last_adaptation));
+      {
+        writer.start_element("element_data");
+        writer.attribute("e_id", e->id);
+        writer.attribute("ord", this->edata[e->id].order);
+        writer.attribute("bd", this->edata[e->id].bdof);
+        writer.attribute("n", this->edata[e->id].n);
+        writer.attribute("chgd", this->edata[e->id].changed_in_last_adaptation);
+        writer.end_element();
+      }
 
-      ::xml_schema::namespace_infomap namespace_info_map;
-      std::ofstream out(filename);
-      ::xml_schema::flags parsing_flags = ::xml_schema::flags::dont_pretty_print;
-      XMLSpace::space_(out, xmlspace, namespace_info_map, "UTF-8", parsing_flags);
-      out.close();
+      writer.close();
     }
 
 #ifdef WITH_BSON
@@ -1247,6 +1384,7 @@ namespace Hermes
           space->shapeset = new L2Shapeset;
           space->own_shapeset = true;
         }
+        else
         {
           if (shapeset->get_space_type() != HERMES_L2_SPACE)
             throw Hermes::Exceptions::SpaceLoadFailureException("Wrong shapeset / Wrong spaceType in Space loading subroutine.");
@@ -1272,47 +1410,89 @@ namespace Hermes
       return space;
     }
 
+    template<typename Scalar>
+    SpaceSharedPtr<Scalar> Space<Scalar>::create_for_loading(const char* spaceType, const char *filename, MeshSharedPtr mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
+    {
+      SpaceSharedPtr<Scalar> space(nullptr);
+
+      if (spaceTypeFromString(spaceType) == HERMES_H1_SPACE)
+        space = new H1Space<Scalar>();
+      else if (spaceTypeFromString(spaceType) == HERMES_HCURL_SPACE)
+        space = new HcurlSpace<Scalar>();
+      else if (spaceTypeFromString(spaceType) == HERMES_HDIV_SPACE)
+        space = new HdivSpace<Scalar>();
+      else if (spaceTypeFromString(spaceType) == HERMES_L2_SPACE)
+        space = new L2Space<Scalar>();
+      else if (spaceTypeFromString(spaceType) == HERMES_L2_MARKERWISE_CONST_SPACE)
+        space = new L2MarkerWiseConstSpace<Scalar>(mesh);
+      else
+        throw Hermes::Exceptions::IOException(Exceptions::IOException::Read, filename);
+
+      space->mesh = mesh;
+      space->mesh_seq = space->mesh->get_seq();
+      space->init(shapeset, 1, false);
+
+      if (essential_bcs != nullptr && spaceTypeFromString(spaceType) != HERMES_L2_SPACE && spaceTypeFromString(spaceType) != HERMES_L2_MARKERWISE_CONST_SPACE)
+      {
+        space->essential_bcs = essential_bcs;
+        for (typename std::vector<EssentialBoundaryCondition<Scalar>*>::const_iterator it = essential_bcs->begin(); it != essential_bcs->end(); it++)
+          for (unsigned int i = 0; i < (*it)->markers.size(); i++)
+            if (space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.find((*it)->markers.at(i)) == space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.end())
+              throw Hermes::Exceptions::Exception("A boundary condition defined on a non-existent marker.");
+      }
+
+      space->resize_tables();
+
+      return space;
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::load_element_data(XMLStreamReader& reader, const char *filename)
+    {
+      while (reader.next_element())
+      {
+        if (!reader.is("element_data"))
+          continue;
+
+        int e_id = reader.int_attribute("e_id");
+        if (e_id < 0 || e_id >= this->mesh->get_max_element_id())
+          throw Hermes::Exceptions::SpaceLoadFailureException("Element %d out of range in the file %s.", e_id, filename);
+
+        this->edata[e_id].order = reader.int_attribute("ord");
+        this->edata[e_id].bdof = reader.int_attribute("bd");
+        this->edata[e_id].n = reader.int_attribute("n");
+        this->edata[e_id].changed_in_last_adaptation = reader.bool_attribute("chgd");
+      }
+    }
+
     template<typename Scalar>
     SpaceSharedPtr<Scalar> Space<Scalar>::load(const char *filename, MeshSharedPtr mesh, bool validate, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
     {
-      try
+      if (!validate)
       {
-        SpaceSharedPtr<Scalar> space(nullptr);
+        XMLStreamReader reader(filename);
+        if (!reader.next_element() || !reader.is("space"))
+          throw Hermes::Exceptions::SpaceLoadFailureException("No space in the file %s.", filename);
 
-        ::xml_schema::flags parsing_flags = 0;
+        SpaceSharedPtr<Scalar> space = create_for_loading(reader.required_attribute("spaceType"), filename, mesh, essential_bcs, shapeset);
 
-        if (!validate)
-          parsing_flags = xml_schema::flags::dont_validate;
+        // Element data //
+        space->load_element_data(reader, filename);
 
-        std::auto_ptr<XMLSpace::space> parsed_xml_space(XMLSpace::space_(filename, parsing_flags));
+        space->seq = g_space_seq++;
 
-        if (spaceTypeFromString(parsed_xml_space->spaceType().get().c_str()) == HERMES_H1_SPACE)
-          space = new H1Space<Scalar>();
-        else if (spaceTypeFromString(parsed_xml_space->spaceType().get().c_str()) == HERMES_HCURL_SPACE)
-          space = new HcurlSpace<Scalar>();
-        else if (spaceTypeFromString(parsed_xml_space->spaceType().get().c_str()) == HERMES_HDIV_SPACE)
-          space = new HdivSpace<Scalar>();
-        else if (spaceTypeFromString(parsed_xml_space->spaceType().get().c_str()) == HERMES_L2_SPACE)
-          space = new L2Space<Scalar>();
-        else if (spaceTypeFromString(parsed_xml_space->spaceType().get().c_str()) == HERMES_L2_MARKERWISE_CONST_SPACE)
-          space = new L2MarkerWiseConstSpace<Scalar>(mesh);
-        else
-          throw Hermes::Exceptions::IOException(Exceptions::IOException::Read, filename);
+        space->assign_dofs();
 
-        space->mesh = mesh;
-        space->mesh_seq = space->mesh->get_seq();
-        space->init(shapeset, 1, false);
+        return space;
+      }
 
-        if (essential_bcs != nullptr && spaceTypeFromString(parsed_xml_space->spaceType().get().c_str()) != HERMES_L2_SPACE && spaceTypeFromString(parsed_xml_space->spaceType().get().c_str()) != HERMES_L2_MARKERWISE_CONST_SPACE)
-        {
-          space->essential_bcs = essential_bcs;
-          for (typename std::vector<EssentialBoundaryCondition<Scalar>*>::const_iterator it = essential_bcs->begin(); it != essential_bcs->end(); it++)
-            for (unsigned int i = 0; i < (*it)->markers.size(); i++)
-              if (space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.find((*it)->markers.at(i)) == space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.end())
-                throw Hermes::Exceptions::Exception("A boundary condition defined on a non-existent marker.");
-        }
+      try
+      {
+        ::xml_schema::flags parsing_flags = 0;
+
+        std::auto_ptr<XMLSpace::space> parsed_xml_space(XMLSpace::space_(filename, parsing_flags));
 
-        space->resize_tables();
+        SpaceSharedPtr<Scalar> space = create_for_loading(parsed_xml_space->spaceType().get().c_str(), filename, mesh, essential_bcs, shapeset);
 
         // Element data //
         unsigned int elem_data_count = parsed_xml_space->element_data().size();
@@ -1339,13 +1519,30 @@ namespace Hermes
     template<typename Scalar>
     void Space<Scalar>::load(const char *filename)
     {
+      if (!this->validate)
+      {
+        XMLStreamReader reader(filename);
+        if (!reader.next_element() || !reader.is("space"))
+          throw Hermes::Exceptions::SpaceLoadFailureException("No space in the file %s.", filename);
+
+        if (strcmp(reader.required_attribute("spaceType"), spaceTypeToString(this->get_type())))
+          throw Exceptions::Exception("Saved Space is not of the same type as the current one in loading.");
+
+        this->resize_tables();
+
+        // Element data //
+        this->load_element_data(reader, filename);
+
+        this->seq = g_space_seq++;
+
+        this->assign_dofs();
+        return;
+      }
+
       try
       {
         ::xml_schema::flags parsing_flags = 0;
 
-        if (!this->validate)
-          parsing_flags = xml_schema::flags::dont_validate;
-
         std::auto_ptr<XMLSpace::space> parsed_xml_space(XMLSpace::space_(filename, parsing_flags));
 
         if (strcmp(parsed_xml_space->spaceType().get().c_str(), spaceTypeToString(this->get_type())))
@@ -109,106 +109,84 @@ namespace Hermes
       // all elements in the mesh.
 
       // Vertex dofs.
-      Element* e;
-      this->vertex_functions_count = 0;
-      for_all_active_elements(e, this->mesh)
+      this->vertex_functions_count = this->assign_dofs_by_elements(Space<Scalar>::VertexDofs);
+    }
+
+    template<typename Scalar>
+    void H1Space<Scalar>::assign_edge_dofs()
+    {
+      // Edge dofs.
+      this->edge_functions_count = this->assign_dofs_by_elements(Space<Scalar>::EdgeDofs);
+    }
+
+    template<typename Scalar>
+    void H1Space<Scalar>::assign_bubble_dofs()
+    {
+      // Bubble dofs.
+      this->bubble_functions_count = this->assign_dofs_by_elements(Space<Scalar>::BubbleDofs);
+    }
+
+    template<typename Scalar>
+    int H1Space<Scalar>::assign_element_dofs(Element* e, int position, typename Space<Scalar>::DofKind kind, const std::vector<int>& first_elements, int first_dof, bool assign)
+    {
+      if (kind == Space<Scalar>::BubbleDofs)
+        return Space<Scalar>::assign_element_dofs(e, position, kind, first_elements, first_dof, assign);
+
+      if (this->get_element_order(e->id) <= 0)
+        return 0;
+
+      int dofs = 0;
+      for (unsigned char i = 0; i < e->get_nvert(); i++)
       {
-        int order = this->get_element_order(e->id);
-        if (order > 0)
+        if (kind == Space<Scalar>::VertexDofs)
         {
-          for (unsigned char i = 0; i < e->get_nvert(); i++)
+          Node* vn = e->vn[i];
+          typename Space<Scalar>::NodeData* nd = this->ndata + vn->id;
+          if (!vn->is_constrained_vertex() && this->numbers_node(vn->id, position, first_elements))
           {
-            Node* vn = e->vn[i];
-            typename Space<Scalar>::NodeData* nd = this->ndata + vn->id;
-            if (!vn->is_constrained_vertex() && nd->dof == this->H2D_UNASSIGNED_DOF)
+            // Essential BC (see reset_dof_assignment()).
+            if (nd->n == 0)
             {
-              if (nd->n == 0)
-              {
+              if (assign)
                 nd->dof = this->H2D_CONSTRAINED_DOF;
-              }
-              else
-              {
-                nd->dof = this->next_dof;
-                this->next_dof++;
-                this->vertex_functions_count++;
-              }
-              nd->n = 1;
             }
+            else
+            {
+              if (assign)
+                nd->dof = first_dof + dofs;
+              dofs++;
+            }
+            if (assign)
+              nd->n = 1;
           }
         }
-      }
-    }
-
-    template<typename Scalar>
-    void H1Space<Scalar>::assign_edge_dofs()
-    {
-      // Edge dofs.
-      Element* e;
-      this->edge_functions_count = 0;
-      for_all_active_elements(e, this->mesh)
-      {
-        int order = this->get_element_order(e->id);
-        if (order > 0)
+        else
         {
-          for (unsigned char i = 0; i < e->get_nvert(); i++)
+          Node* en = e->en[i];
+          typename Space<Scalar>::NodeData* nd = this->ndata + en->id;
+          if (this->numbers_node(en->id, position, first_elements))
           {
-            Node* vn = e->vn[i];
-            typename Space<Scalar>::NodeData* nd = this->ndata + vn->id;
-            Node* en = e->en[i];
-            nd = this->ndata + en->id;
-            if (nd->dof == this->H2D_UNASSIGNED_DOF)
+            // If the edge node is not constrained, assign it dofs.
+            if (en->ref > 1 || en->bnd || this->mesh->peek_vertex_node(en->p1, en->p2) != nullptr)
             {
-              // If the edge node is not constrained, assign it dofs.
-              if (en->ref > 1 || en->bnd || this->mesh->peek_vertex_node(en->p1, en->p2) != nullptr)
+              int ndofs = this->get_edge_order_internal(en) - 1;
+              bool essential = en->bnd && this->essential_bcs != nullptr
+                && this->essential_bcs->get_boundary_condition(this->mesh->boundary_markers_conversion.get_user_marker(en->marker).marker) != nullptr;
+              if (assign)
               {
-                int ndofs = this->get_edge_order_internal(en) - 1;
                 nd->n = ndofs;
-
-                if (en->bnd)
-                  if (this->essential_bcs != nullptr)
-                    if (this->essential_bcs->get_boundary_condition(this->mesh->boundary_markers_conversion.get_user_marker(e->en[i]->marker).marker) != nullptr)
-                      nd->dof = this->H2D_CONSTRAINED_DOF;
-                    else
-                    {
-                      nd->dof = this->next_dof;
-                      this->next_dof += ndofs;
-                      this->edge_functions_count += ndofs;
-                    }
-                  else
-                  {
-                    nd->dof = this->next_dof;
-                    this->next_dof += ndofs;
-                    this->edge_functions_count += ndofs;
-                  }
-                else
-                {
-                  nd->dof = this->next_dof;
-                  this->next_dof += ndofs;
-                  this->edge_functions_count += ndofs;
-                }
+                nd->dof = essential ? this->H2D_CONSTRAINED_DOF : first_dof + dofs;
               }
-              else // Constrained edge node.
-                nd->n = -1;
+              if (!essential)
+                dofs += ndofs;
             }
+            // Constrained edge node.
+            else if (assign)
+              nd->n = -1;
           }
         }
       }
-    }
-
-    template<typename Scalar>
-    void H1Space<Scalar>::assign_bubble_dofs()
-    {
-      // Bubble dofs.
-      Element* e;
-      this->bubble_functions_count = 0;
-      for_all_active_elements(e, this->mesh)
-      {
-        typename Space<Scalar>::ElementData* ed = &this->edata[e->id];
-        ed->bdof = this->next_dof;
-        ed->n = this->shapeset->get_num_bubbles(ed->order, e->get_mode());
-        this->next_dof += ed->n;
-        this->bubble_functions_count += ed->n;
-      }
+      return dofs;
     }
 
     template<typename Scalar>
@@ -145,16 +145,7 @@ namespace Hermes
     template<typename Scalar>
     void HcurlSpace<Scalar>::assign_bubble_dofs()
     {
-      Element* e;
-      this->bubble_functions_count = 0;
-      for_all_active_elements(e, this->mesh)
-      {
-        typename Space<Scalar>::ElementData* ed = &this->edata[e->id];
-        ed->bdof = this->next_dof;
-        ed->n = this->shapeset->get_num_bubbles(ed->order, e->get_mode());
-        this->next_dof += ed->n;
-        this->bubble_functions_count += ed->n;
-      }
+      this->bubble_functions_count = this->assign_dofs_by_elements(Space<Scalar>::BubbleDofs);
     }
 
     template<typename Scalar>
@@ -94,17 +94,8 @@ namespace Hermes
     template<typename Scalar>
     void L2Space<Scalar>::assign_bubble_dofs()
     {
-      Element* e;
-      this->bubble_functions_count = 0;
-      for_all_active_elements(e, this->mesh)
-      {
-        typename Space<Scalar>::ElementData* ed = &this->edata[e->id];
-        ed->bdof = this->next_dof;
-        //FIXME: this function might return invalid value because retrieved bubble functions for non-uniform orders might be invalid for the given order.
-        ed->n = this->shapeset->get_num_bubbles(ed->order, e->get_mode());
-        this->next_dof += ed->n;
-        this->bubble_functions_count += ed->n;
-      }
+      //FIXME: get_num_bubbles() might return invalid value because retrieved bubble functions for non-uniform orders might be invalid for the given order.
+      this->bubble_functions_count = this->assign_dofs_by_elements(Space<Scalar>::BubbleDofs);
     }
 
     template<typename Scalar>
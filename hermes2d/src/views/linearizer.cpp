@@ -18,6 +18,10 @@
 #include "traverse.h"
 #include "exact_solution.h"
 #include "api2d.h"
+#include <cstdarg>
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
 
 namespace Hermes
 {
@@ -39,6 +43,161 @@ namespace Hermes
         this->refinement_level = refinement_level;
       }
 
+      LinearizerOutputStream::LinearizerOutputStream(const char* filename, bool compress) : compress(compress), bytes_written(0), in_compressed_array(false)
+      {
+#ifndef WITH_ZLIB
+        if (compress)
+          throw Exceptions::Exception("Compressed output requested, but Hermes was built without ZLIB.");
+#endif
+        this->file = fopen(filename, "wb");
+        if (this->file == nullptr)
+          throw Hermes::Exceptions::Exception("Could not open %s for writing.", filename);
+      }
+
+      LinearizerOutputStream::~LinearizerOutputStream()
+      {
+        fclose(this->file);
+      }
+
+      void LinearizerOutputStream::print(const char* format, ...)
+      {
+        char text[2048];
+        va_list arglist;
+        va_start(arglist, format);
+        int length = vsnprintf(text, 2048, format, arglist);
+        va_end(arglist);
+        if (length < 0 || length >= 2048)
+          throw Exceptions::Exception("LinearizerOutputStream: too long text output.");
+        this->write_direct(text, length);
+      }
+
+      void LinearizerOutputStream::write(const void* data, size_t bytes)
+      {
+        if (!this->in_compressed_array)
+        {
+          this->write_direct(data, bytes);
+          return;
+        }
+
+        const unsigned char* data_bytes = (const unsigned char*)data;
+        while (bytes > 0)
+        {
+          size_t to_copy = std::min(bytes, (size_t)LINEARIZER_OUTPUT_CHUNK_SIZE - this->block.size());
+          this->block.insert(this->block.end(), data_bytes, data_bytes + to_copy);
+          data_bytes += to_copy;
+          bytes -= to_copy;
+          if (this->block.size() == LINEARIZER_OUTPUT_CHUNK_SIZE)
+            this->flush_block();
+        }
+      }
+
+      void LinearizerOutputStream::write_tecplot_string(const char* str)
+      {
+        do
+        {
+          int character = *str;
+          this->write(&character, sizeof(int));
+        } while (*str++);
+      }
+
+      void LinearizerOutputStream::begin_vtk_array(unsigned long long bytes)
+      {
+        if (!this->compress)
+        {
+          this->write_direct(&bytes, sizeof(unsigned long long));
+          return;
+        }
+
+        // Header: number of blocks, block size, size of the last partial block (0 if none), compressed sizes of the blocks.
+        // Written now as a placeholder, completed in end_vtk_array().
+        unsigned long long block_count = (bytes + LINEARIZER_OUTPUT_CHUNK_SIZE - 1) / LINEARIZER_OUTPUT_CHUNK_SIZE;
+        this->compressed_header.clear();
+        this->compressed_header.push_back(block_count);
+        this->compressed_header.push_back(LINEARIZER_OUTPUT_CHUNK_SIZE);
+        this->compressed_header.push_back(bytes % LINEARIZER_OUTPUT_CHUNK_SIZE);
+        this->compressed_header.resize(3 + block_count, 0);
+        this->compressed_header_position = this->bytes_written;
+        this->write_direct(&this->compressed_header[0], this->compressed_header.size() * sizeof(unsigned long long));
+
+        this->compressed_block_count = 0;
+        this->block.clear();
+        this->block.reserve(LINEARIZER_OUTPUT_CHUNK_SIZE);
+        this->in_compressed_array = true;
+      }
+
+      void LinearizerOutputStream::end_vtk_array()
+      {
+        if (!this->in_compressed_array)
+          return;
+
+        if (!this->block.empty())
+          this->flush_block();
+        this->in_compressed_array = false;
+
+        unsigned long long end_position = this->bytes_written;
+        this->seek(this->compressed_header_position);
+        fwrite(&this->compressed_header[0], sizeof(unsigned long long), this->compressed_header.size(), this->file);
+        this->seek(end_position);
+      }
+
+      void LinearizerOutputStream::flush_block()
+      {
+#ifdef WITH_ZLIB
+        uLongf compressed_size = compressBound(this->block.size());
+        this->compressed_block.resize(compressed_size);
+        if (compress2(&this->compressed_block[0], &compressed_size, &this->block[0], this->block.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+          throw Exceptions::Exception("LinearizerOutputStream: zlib compression failed.");
+        this->write_direct(&this->compressed_block[0], compressed_size);
+
+        this->compressed_header[3 + this->compressed_block_count++] = compressed_size;
+#endif
+        this->block.clear();
+      }
+
+      unsigned long long LinearizerOutputStream::get_bytes_written() const
+      {
+        return this->bytes_written;
+      }
+
+      unsigned long long LinearizerOutputStream::write_integer_placeholder()
+      {
+        unsigned long long position = this->bytes_written;
+        this->print("%020llu", 0ULL);
+        return position;
+      }
+
+      void LinearizerOutputStream::patch_integer(unsigned long long position, unsigned long long value)
+      {
+        char text[21];
+        sprintf(text, "%020llu", value);
+        unsigned long long end_position = this->bytes_written;
+        this->seek(position);
+        fwrite(text, 1, 20, this->file);
+        this->seek(end_position);
+      }
+
+      const char* LinearizerOutputStream::byte_order()
+      {
+        const unsigned short test = 1;
+        return (*(const unsigned char*)&test == 1) ? "LittleEndian" : "BigEndian";
+      }
+
+      void LinearizerOutputStream::write_direct(const void* data, size_t bytes)
+      {
+        if (fwrite(data, 1, bytes, this->file) != bytes)
+          throw Exceptions::Exception("LinearizerOutputStream: writing to the file failed.");
+        this->bytes_written += bytes;
+      }
+
+      void LinearizerOutputStream::seek(unsigned long long position)
+      {
+#ifdef _MSC_VER
+        _fseeki64(this->file, position, SEEK_SET);
+#else
+        fseeko(this->file, position, SEEK_SET);
+#endif
+      }
+
       template<typename LinearizerDataDimensions>
       LinearizerMultidimensional<LinearizerDataDimensions>::LinearizerMultidimensional(LinearizerOutputType linearizerOutputType) :
         states(nullptr), num_states(0), dmult(1.0), curvature_epsilon(1e-5), linearizerOutputType(linearizerOutputType), criterion(LinearizerCriterionFixed(1))
@@ -216,11 +375,7 @@ namespace Hermes
         // Free states.
         if (this->states)
         {
-          for (int i = 0; i < this->num_states; i++)
-            delete states[i];
-
-          free_with_check(this->states);
-          this->states = nullptr;
+          Traverse::free_states(this->states);
           this->num_states = 0;
         }
 
@@ -507,6 +662,322 @@ namespace Hermes
         LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_tecplot(slns, items, filename, quantity_names);
       }
 
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_vtu(std::vector<MeshFunctionSharedPtr<double> > slns, std::vector<int> items, const char* filename, const char* quantity_name, bool mode_3D, bool compress)
+      {
+        if (this->linearizerOutputType != FileExport)
+          throw Exceptions::Exception("This LinearizerMultidimensional is not meant to be used for file export, create a new one with appropriate linearizerOutputType.");
+
+        process_solution(&slns[0], &items[0]);
+
+        LinearizerOutputStream stream(filename, compress);
+
+        int vertex_count = this->get_vertex_count();
+        int triangle_count = this->get_triangle_count();
+        // Vectors are padded to 3 components.
+        int value_component_count = LinearizerDataDimensions::dimension == 1 ? 1 : 3;
+        // In the 3D mode, the value of a scalar quantity is the z-coordinate.
+        int coordinate_count = (mode_3D && LinearizerDataDimensions::dimension == 1) ? 3 : 2;
+
+        // Header, the offsets of the arrays in the appended data are filled in as they are written.
+        unsigned long long offset_positions[5];
+        stream.print("<?xml version=\"1.0\"?>\n");
+        stream.print("<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n", LinearizerOutputStream::byte_order(), compress ? " compressor=\"vtkZLibDataCompressor\"" : "");
+        stream.print("  <UnstructuredGrid>\n");
+        stream.print("    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n", vertex_count, triangle_count);
+        stream.print("      <PointData %s=\"%s\">\n", LinearizerDataDimensions::dimension == 1 ? "Scalars" : "Vectors", quantity_name);
+        stream.print("        <DataArray type=\"Float32\" Name=\"%s\" NumberOfComponents=\"%d\" format=\"appended\" offset=\"", quantity_name, value_component_count);
+        offset_positions[0] = stream.write_integer_placeholder();
+        stream.print("\"/>\n");
+        stream.print("      </PointData>\n");
+        stream.print("      <Points>\n");
+        stream.print("        <DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"appended\" offset=\"");
+        offset_positions[1] = stream.write_integer_placeholder();
+        stream.print("\"/>\n");
+        stream.print("      </Points>\n");
+        stream.print("      <Cells>\n");
+        stream.print("        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\" offset=\"");
+        offset_positions[2] = stream.write_integer_placeholder();
+        stream.print("\"/>\n");
+        stream.print("        <DataArray type=\"Int32\" Name=\"offsets\" format=\"appended\" offset=\"");
+        offset_positions[3] = stream.write_integer_placeholder();
+        stream.print("\"/>\n");
+        stream.print("        <DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"");
+        offset_positions[4] = stream.write_integer_placeholder();
+        stream.print("\"/>\n");
+        stream.print("      </Cells>\n");
+        stream.print("    </Piece>\n");
+        stream.print("  </UnstructuredGrid>\n");
+        stream.print("  <AppendedData encoding=\"raw\">\n   _");
+        unsigned long long appended_data_start = stream.get_bytes_written();
+
+        // Values.
+        stream.patch_integer(offset_positions[0], stream.get_bytes_written() - appended_data_start);
+        stream.begin_vtk_array((unsigned long long)vertex_count * value_component_count * sizeof(float));
+        this->stream_vertex_components(stream, 2, LinearizerDataDimensions::dimension, value_component_count);
+        stream.end_vtk_array();
+
+        // Points.
+        stream.patch_integer(offset_positions[1], stream.get_bytes_written() - appended_data_start);
+        stream.begin_vtk_array((unsigned long long)vertex_count * 3 * sizeof(float));
+        this->stream_vertex_components(stream, 0, coordinate_count, 3);
+        stream.end_vtk_array();
+
+        // Connectivity.
+        stream.patch_integer(offset_positions[2], stream.get_bytes_written() - appended_data_start);
+        stream.begin_vtk_array((unsigned long long)triangle_count * 3 * sizeof(int));
+        this->stream_triangle_indices(stream);
+        stream.end_vtk_array();
+
+        // Offsets & cell types (the "5" means triangle in VTK).
+        const int chunk_length = LINEARIZER_OUTPUT_CHUNK_SIZE / sizeof(int);
+        int* offsets_chunk = malloc_with_check<int>(chunk_length);
+        stream.patch_integer(offset_positions[3], stream.get_bytes_written() - appended_data_start);
+        stream.begin_vtk_array((unsigned long long)triangle_count * sizeof(int));
+        for (int chunk_start = 0; chunk_start < triangle_count; chunk_start += chunk_length)
+        {
+          int chunk_end = std::min(triangle_count, chunk_start + chunk_length);
+          for (int i = chunk_start; i < chunk_end; i++)
+            offsets_chunk[i - chunk_start] = 3 * (i + 1);
+          stream.write(offsets_chunk, (chunk_end - chunk_start) * sizeof(int));
+        }
+        stream.end_vtk_array();
+        free_with_check(offsets_chunk);
+
+        std::vector<unsigned char> types_chunk(LINEARIZER_OUTPUT_CHUNK_SIZE, 5);
+        stream.patch_integer(offset_positions[4], stream.get_bytes_written() - appended_data_start);
+        stream.begin_vtk_array((unsigned long long)triangle_count);
+        for (int chunk_start = 0; chunk_start < triangle_count; chunk_start += LINEARIZER_OUTPUT_CHUNK_SIZE)
+          stream.write(&types_chunk[0], std::min(triangle_count - chunk_start, LINEARIZER_OUTPUT_CHUNK_SIZE));
+        stream.end_vtk_array();
+
+        stream.print("\n  </AppendedData>\n");
+        stream.print("</VTKFile>\n");
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_vtu(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, bool mode_3D, int item, bool compress)
+      {
+        std::vector<MeshFunctionSharedPtr<double> > slns;
+        std::vector<int> items;
+        slns.push_back(sln);
+        items.push_back(item);
+        LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_vtu(slns, items, filename, quantity_name, mode_3D, compress);
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_xdmf(std::vector<MeshFunctionSharedPtr<double> > slns, std::vector<int> items, const char* filename, const char* quantity_name, double time)
+      {
+        if (this->linearizerOutputType != FileExport)
+          throw Exceptions::Exception("This LinearizerMultidimensional is not meant to be used for file export, create a new one with appropriate linearizerOutputType.");
+
+        process_solution(&slns[0], &items[0]);
+
+        if (this->xdmf_filename != filename)
+        {
+          this->reset_xdmf_time_series();
+          this->xdmf_filename = filename;
+        }
+
+        // Heavy data: <filename without extension>_<time step>.bin, referenced relatively to the XDMF file.
+        std::string path(filename);
+        size_t slash_position = path.find_last_of("/\\");
+        size_t dot_position = path.find_last_of('.');
+        if (dot_position != std::string::npos && (slash_position == std::string::npos || dot_position > slash_position))
+          path = path.substr(0, dot_position);
+        std::stringstream ss;
+        ss << path << "_" << this->xdmf_time_steps.size() << ".bin";
+
+        XdmfTimeStep time_step;
+        time_step.time = time;
+        time_step.data_filename = (slash_position == std::string::npos) ? ss.str() : ss.str().substr(slash_position + 1);
+        time_step.vertex_count = this->get_vertex_count();
+        time_step.triangle_count = this->get_triangle_count();
+
+        // Vectors are padded to 3 components.
+        int value_component_count = LinearizerDataDimensions::dimension == 1 ? 1 : 3;
+        {
+          LinearizerOutputStream data_stream(ss.str().c_str());
+          this->stream_vertex_components(data_stream, 0, 2, 2);
+          this->stream_triangle_indices(data_stream);
+          this->stream_vertex_components(data_stream, 2, LinearizerDataDimensions::dimension, value_component_count);
+        }
+        this->xdmf_time_steps.push_back(time_step);
+
+        // Light data: the whole time series.
+        LinearizerOutputStream stream(filename);
+        stream.print("<?xml version=\"1.0\" ?>\n");
+        stream.print("<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n");
+        stream.print("<Xdmf Version=\"2.0\">\n");
+        stream.print("  <Domain>\n");
+        stream.print("    <Grid Name=\"TimeSeries\" GridType=\"Collection\" CollectionType=\"Temporal\">\n");
+        for (unsigned int i = 0; i < this->xdmf_time_steps.size(); i++)
+        {
+          XdmfTimeStep& step = this->xdmf_time_steps[i];
+          unsigned long long topology_seek = (unsigned long long)step.vertex_count * 2 * sizeof(float);
+          unsigned long long attribute_seek = topology_seek + (unsigned long long)step.triangle_count * 3 * sizeof(int);
+
+          stream.print("      <Grid Name=\"%s_%u\" GridType=\"Uniform\">\n", quantity_name, i);
+          stream.print("        <Time Value=\"%.17g\"/>\n", step.time);
+          stream.print("        <Topology TopologyType=\"Triangle\" NumberOfElements=\"%d\">\n", step.triangle_count);
+          stream.print("          <DataItem Dimensions=\"%d 3\" NumberType=\"Int\" Precision=\"4\" Format=\"Binary\" Endian=\"Native\" Seek=\"%llu\">%s</DataItem>\n", step.triangle_count, topology_seek, step.data_filename.c_str());
+          stream.print("        </Topology>\n");
+          stream.print("        <Geometry GeometryType=\"XY\">\n");
+          stream.print("          <DataItem Dimensions=\"%d 2\" NumberType=\"Float\" Precision=\"4\" Format=\"Binary\" Endian=\"Native\" Seek=\"0\">%s</DataItem>\n", step.vertex_count, step.data_filename.c_str());
+          stream.print("        </Geometry>\n");
+          stream.print("        <Attribute Name=\"%s\" AttributeType=\"%s\" Center=\"Node\">\n", quantity_name, LinearizerDataDimensions::dimension == 1 ? "Scalar" : "Vector");
+          stream.print("          <DataItem Dimensions=\"%d %d\" NumberType=\"Float\" Precision=\"4\" Format=\"Binary\" Endian=\"Native\" Seek=\"%llu\">%s</DataItem>\n", step.vertex_count, value_component_count, attribute_seek, step.data_filename.c_str());
+          stream.print("        </Attribute>\n");
+          stream.print("      </Grid>\n");
+        }
+        stream.print("    </Grid>\n");
+        stream.print("  </Domain>\n");
+        stream.print("</Xdmf>\n");
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_xdmf(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, double time, int item)
+      {
+        std::vector<MeshFunctionSharedPtr<double> > slns;
+        std::vector<int> items;
+        slns.push_back(sln);
+        items.push_back(item);
+        LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_xdmf(slns, items, filename, quantity_name, time);
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::reset_xdmf_time_series()
+      {
+        this->xdmf_filename.clear();
+        this->xdmf_time_steps.clear();
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_tecplot_binary(std::vector<MeshFunctionSharedPtr<double> > slns, std::vector<int> items, const char* filename, std::vector<std::string> quantity_names)
+      {
+        if (this->linearizerOutputType != FileExport)
+          throw Exceptions::Exception("This LinearizerMultidimensional is not meant to be used for file export, create a new one with appropriate linearizerOutputType.");
+        if (quantity_names.size() < LinearizerDataDimensions::dimension)
+          throw Exceptions::ValueException("quantity_names", quantity_names.size(), LinearizerDataDimensions::dimension);
+
+        process_solution(&slns[0], &items[0]);
+
+        const int variable_count = 2 + LinearizerDataDimensions::dimension;
+
+        // Minima & maxima of all variables are part of the format.
+        double min_max[2 * variable_count];
+        for (int k = 0; k < variable_count; k++)
+        {
+          min_max[2 * k] = std::numeric_limits<double>::max();
+          min_max[2 * k + 1] = -std::numeric_limits<double>::max();
+        }
+        for (Iterator<typename LinearizerDataDimensions::vertex_t> it = this->vertices_begin(); !it.end; ++it)
+        {
+          typename LinearizerDataDimensions::vertex_t& vertex = it.get();
+          for (int k = 0; k < variable_count; k++)
+          {
+            min_max[2 * k] = std::min(min_max[2 * k], (double)vertex[k]);
+            min_max[2 * k + 1] = std::max(min_max[2 * k + 1], (double)vertex[k]);
+          }
+        }
+
+        LinearizerOutputStream stream(filename);
+
+        // Header section (version 112): magic number, byte order, file type (full), title, variables.
+        stream.write("#!TDV112", 8);
+        int header_start[2] = { 1, 0 };
+        stream.write(header_start, sizeof(header_start));
+        std::stringstream title;
+        title << filename << " created by Hermes.";
+        stream.write_tecplot_string(title.str().c_str());
+        stream.write(&variable_count, sizeof(int));
+        stream.write_tecplot_string("X");
+        stream.write_tecplot_string("Y");
+        for (int k = 0; k < LinearizerDataDimensions::dimension; k++)
+          stream.write_tecplot_string(quantity_names[k].c_str());
+
+        // Zone header: marker, name, parent zone, strand id, solution time, (unused), FETRIANGLE, no variable location,
+        // no face neighbors, node count, element count, cell dimensions (unused), no auxiliary data, end of header.
+        float zone_marker = 299.f;
+        stream.write(&zone_marker, sizeof(float));
+        stream.write_tecplot_string("ZONE 001");
+        int zone_ids[2] = { -1, -1 };
+        stream.write(zone_ids, sizeof(zone_ids));
+        double solution_time = 0.;
+        stream.write(&solution_time, sizeof(double));
+        int zone_header[10] = { -1, 2, 0, 0, 0, this->get_vertex_count(), this->get_triangle_count(), 0, 0, 0 };
+        stream.write(zone_header, sizeof(zone_header));
+        int no_auxiliary_data = 0;
+        stream.write(&no_auxiliary_data, sizeof(int));
+        float end_of_header_marker = 357.f;
+        stream.write(&end_of_header_marker, sizeof(float));
+
+        // Data section: marker, variable formats (float), no passive variables, no sharing, no connectivity sharing, minima & maxima.
+        stream.write(&zone_marker, sizeof(float));
+        std::vector<int> variable_formats(variable_count, 1);
+        stream.write(&variable_formats[0], variable_count * sizeof(int));
+        int sharing[3] = { 0, 0, -1 };
+        stream.write(sharing, sizeof(sharing));
+        stream.write(min_max, sizeof(min_max));
+
+        // Block data packing - one variable after another, then the (zero-based) connectivity.
+        for (int k = 0; k < variable_count; k++)
+          this->stream_vertex_components(stream, k, 1, 1);
+        this->stream_triangle_indices(stream);
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_tecplot_binary(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, int item)
+      {
+        std::vector<MeshFunctionSharedPtr<double> > slns;
+        std::vector<int> items;
+        slns.push_back(sln);
+        items.push_back(item);
+        std::vector<std::string> quantity_names;
+        quantity_names.push_back(quantity_name);
+        LinearizerMultidimensional<LinearizerDataDimensions>::save_solution_tecplot_binary(slns, items, filename, quantity_names);
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::stream_vertex_components(LinearizerOutputStream& stream, int first_component, int component_count, int output_component_count) const
+      {
+        const int chunk_vertex_count = std::max(1, (int)(LINEARIZER_OUTPUT_CHUNK_SIZE / (output_component_count * sizeof(float))));
+        float* chunk = malloc_with_check<float>(chunk_vertex_count * output_component_count);
+
+        for (int thread_i = 0; thread_i < this->num_threads_used; thread_i++)
+        {
+          ThreadLinearizerMultidimensional<LinearizerDataDimensions>* thread_linearizer = this->threadLinearizerMultidimensional[thread_i];
+          for (int chunk_start = 0; chunk_start < thread_linearizer->vertex_count; chunk_start += chunk_vertex_count)
+          {
+            int chunk_end = std::min(thread_linearizer->vertex_count, chunk_start + chunk_vertex_count);
+            float* chunk_data = chunk;
+            for (int i = chunk_start; i < chunk_end; i++)
+            {
+              typename LinearizerDataDimensions::vertex_t& vertex = thread_linearizer->vertices[i];
+              for (int k = 0; k < component_count; k++)
+                *chunk_data++ = (float)vertex[first_component + k];
+              for (int k = component_count; k < output_component_count; k++)
+                *chunk_data++ = 0.f;
+            }
+            stream.write(chunk, (chunk_data - chunk) * sizeof(float));
+          }
+        }
+
+        free_with_check(chunk);
+      }
+
+      template<typename LinearizerDataDimensions>
+      void LinearizerMultidimensional<LinearizerDataDimensions>::stream_triangle_indices(LinearizerOutputStream& stream) const
+      {
+        // Indices are already global - see finish().
+        for (int thread_i = 0; thread_i < this->num_threads_used; thread_i++)
+        {
+          ThreadLinearizerMultidimensional<LinearizerDataDimensions>* thread_linearizer = this->threadLinearizerMultidimensional[thread_i];
+          if (thread_linearizer->triangle_count > 0)
+            stream.write(thread_linearizer->triangle_indices, thread_linearizer->triangle_count * sizeof(triangle_indices_t));
+        }
+      }
+
       template<typename LinearizerDataDimensions>
       void LinearizerMultidimensional<LinearizerDataDimensions>::calc_vertices_aabb(double* min_x, double* max_x, double* min_y, double* max_y) const
       {
@@ -0,0 +1,443 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "xml_stream.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    static bool is_xml_whitespace(char c)
+    {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    /// Appends the attribute value [begin, end) to value, the entities are replaced.
+    static void decode_attribute_value(const char* begin, const char* end, std::string& value)
+    {
+      value.clear();
+      while (begin < end)
+      {
+        const char* ampersand = (const char*)memchr(begin, '&', end - begin);
+        if (!ampersand)
+        {
+          value.append(begin, end);
+          return;
+        }
+        value.append(begin, ampersand);
+        const char* semicolon = (const char*)memchr(ampersand, ';', end - ampersand);
+        if (!semicolon)
+          throw Exceptions::Exception("Unterminated entity in an XML attribute value.");
+        std::string entity(ampersand + 1, semicolon);
+        if (entity == "amp")
+          value.push_back('&');
+        else if (entity == "lt")
+          value.push_back('<');
+        else if (entity == "gt")
+          value.push_back('>');
+        else if (entity == "quot")
+          value.push_back('"');
+        else if (entity == "apos")
+          value.push_back('\'');
+        else if (entity.size() > 1 && entity[0] == '#')
+        {
+          long code = entity[1] == 'x' ? strtol(entity.c_str() + 2, nullptr, 16) : strtol(entity.c_str() + 1, nullptr, 10);
+          if (code < 0 || code > 127)
+            throw Exceptions::Exception("Non-ASCII character reference &%s; in an XML attribute value.", entity.c_str());
+          value.push_back((char)code);
+        }
+        else
+          throw Exceptions::Exception("Unknown entity &%s; in an XML attribute value.", entity.c_str());
+        begin = semicolon + 1;
+      }
+    }
+
+    XMLStreamReader::XMLStreamReader(const char* filename) : filename(filename), buffer_size(H2D_XML_STREAM_BUFFER_SIZE), position(0), end(0), end_of_file(false), attribute_count(0)
+    {
+      this->file = fopen(filename, "rb");
+      if (!this->file)
+        throw Exceptions::IOException(Exceptions::IOException::Read, filename);
+      this->buffer = malloc_with_check<char>(this->buffer_size);
+    }
+
+    XMLStreamReader::~XMLStreamReader()
+    {
+      fclose(this->file);
+      free_with_check(this->buffer);
+    }
+
+    bool XMLStreamReader::ensure(size_t count)
+    {
+      while (this->end - this->position < count)
+      {
+        if (this->end_of_file)
+          return false;
+
+        // Move the unread data to the beginning, grow the buffer only if one construct does not fit in it.
+        if (this->position > 0)
+        {
+          memmove(this->buffer, this->buffer + this->position, this->end - this->position);
+          this->end -= this->position;
+          this->position = 0;
+        }
+        if (this->end == this->buffer_size)
+        {
+          this->buffer_size *= 2;
+          realloc_with_check<char>(this->buffer, this->buffer_size);
+        }
+
+        size_t read = fread(this->buffer + this->end, 1, this->buffer_size - this->end, this->file);
+        this->end += read;
+        if (read == 0)
+        {
+          if (ferror(this->file))
+            throw Exceptions::IOException(Exceptions::IOException::Read, this->filename.c_str());
+          this->end_of_file = true;
+        }
+      }
+      return true;
+    }
+
+    size_t XMLStreamReader::find(const char* terminator)
+    {
+      size_t length = strlen(terminator);
+      for (size_t offset = 0;; offset++)
+      {
+        if (!ensure(offset + length))
+          throw Exceptions::Exception("Unexpected end of the XML file %s, '%s' expected.", this->filename.c_str(), terminator);
+        if (!memcmp(this->buffer + this->position + offset, terminator, length))
+          return offset;
+      }
+    }
+
+    bool XMLStreamReader::next_element()
+    {
+      while (true)
+      {
+        // Skip the text up to the next tag.
+        while (true)
+        {
+          const char* less_than = (const char*)memchr(this->buffer + this->position, '<', this->end - this->position);
+          if (less_than)
+          {
+            this->position = less_than - this->buffer;
+            break;
+          }
+          this->position = this->end;
+          if (!ensure(1))
+            return false;
+        }
+
+        if (!ensure(2))
+          throw Exceptions::Exception("Unexpected end of the XML file %s.", this->filename.c_str());
+
+        size_t skip;
+        switch (this->buffer[this->position + 1])
+        {
+        case '?':
+          skip = find("?>") + 2;
+          break;
+        case '!':
+          if (ensure(4) && !memcmp(this->buffer + this->position, "<!--", 4))
+            skip = find("-->") + 3;
+          else if (ensure(9) && !memcmp(this->buffer + this->position, "<![CDATA[", 9))
+            skip = find("]]>") + 3;
+          else
+            skip = find(">") + 1;
+          break;
+        case '/':
+          skip = find(">") + 1;
+          break;
+        default:
+          parse_start_tag();
+          return true;
+        }
+        this->position += skip;
+      }
+    }
+
+    void XMLStreamReader::parse_start_tag()
+    {
+      // Find the end of the tag, '>' may appear in the attribute values.
+      size_t length = 1;
+      char quote = 0;
+      while (true)
+      {
+        if (!ensure(length + 1))
+          throw Exceptions::Exception("Unexpected end of the XML file %s in a start tag.", this->filename.c_str());
+        char c = this->buffer[this->position + length];
+        if (quote)
+        {
+          if (c == quote)
+            quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+          quote = c;
+        else if (c == '>')
+          break;
+        length++;
+      }
+
+      const char* current = this->buffer + this->position + 1;
+      const char* tag_end = this->buffer + this->position + length;
+      if (tag_end[-1] == '/')
+        tag_end--;
+
+      // Name without the namespace prefix.
+      const char* name_begin = current;
+      while (current < tag_end && !is_xml_whitespace(*current))
+      {
+        if (*current == ':')
+          name_begin = current + 1;
+        current++;
+      }
+      this->element_name.assign(name_begin, current);
+
+      // Attributes.
+      this->attribute_count = 0;
+      while (true)
+      {
+        while (current < tag_end && is_xml_whitespace(*current))
+          current++;
+        if (current == tag_end)
+          break;
+
+        const char* attribute_name_begin = current;
+        while (current < tag_end && *current != '=' && !is_xml_whitespace(*current))
+          current++;
+        const char* attribute_name_end = current;
+        while (current < tag_end && is_xml_whitespace(*current))
+          current++;
+        if (current == tag_end || *current != '=')
+          throw Exceptions::Exception("Malformed attribute in the element %s of the XML file %s.", this->element_name.c_str(), this->filename.c_str());
+        current++;
+        while (current < tag_end && is_xml_whitespace(*current))
+          current++;
+        if (current == tag_end || (*current != '"' && *current != '\''))
+          throw Exceptions::Exception("Malformed attribute in the element %s of the XML file %s.", this->element_name.c_str(), this->filename.c_str());
+        char value_quote = *current++;
+        const char* value_begin = current;
+        while (current < tag_end && *current != value_quote)
+          current++;
+        if (current == tag_end)
+          throw Exceptions::Exception("Malformed attribute in the element %s of the XML file %s.", this->element_name.c_str(), this->filename.c_str());
+
+        if (this->attribute_count == this->attributes.size())
+          this->attributes.push_back(std::pair<std::string, std::string>());
+        std::pair<std::string, std::string>& attribute = this->attributes[this->attribute_count++];
+        attribute.first.assign(attribute_name_begin, attribute_name_end);
+        decode_attribute_value(value_begin, current, attribute.second);
+        current++;
+      }
+
+      this->position += length + 1;
+    }
+
+    const std::string& XMLStreamReader::name() const
+    {
+      return this->element_name;
+    }
+
+    bool XMLStreamReader::is(const char* name) const
+    {
+      return this->element_name == name;
+    }
+
+    const char* XMLStreamReader::attribute(const char* name) const
+    {
+      for (unsigned int i = 0; i < this->attribute_count; i++)
+        if (this->attributes[i].first == name)
+          return this->attributes[i].second.c_str();
+      return nullptr;
+    }
+
+    const char* XMLStreamReader::required_attribute(const char* name) const
+    {
+      const char* value = this->attribute(name);
+      if (!value)
+        throw Exceptions::Exception("Attribute %s of the element %s missing in the XML file %s.", name, this->element_name.c_str(), this->filename.c_str());
+      return value;
+    }
+
+    int XMLStreamReader::int_attribute(const char* name) const
+    {
+      return (int)strtol(this->required_attribute(name), nullptr, 10);
+    }
+
+    double XMLStreamReader::double_attribute(const char* name) const
+    {
+      return std::strtod(this->required_attribute(name), nullptr);
+    }
+
+    bool XMLStreamReader::bool_attribute(const char* name) const
+    {
+      const char* value = this->required_attribute(name);
+      return !strcmp(value, "true") || !strcmp(value, "1");
+    }
+
+    void XMLStreamReader::parse_doubles(int count, const std::string* strings, double* values)
+    {
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel() || count < 1024)
+        num_threads = 1;
+
+#pragma omp parallel for num_threads(num_threads)
+      for (int i = 0; i < count; i++)
+        values[i] = std::strtod(strings[i].c_str(), nullptr);
+    }
+
+    XMLStreamWriter::XMLStreamWriter(const char* filename) : filename(filename), start_tag_open(false)
+    {
+      this->file = fopen(filename, "w");
+      if (!this->file)
+        throw Exceptions::IOException(Exceptions::IOException::Write, filename);
+      setvbuf(this->file, nullptr, _IOFBF, H2D_XML_STREAM_BUFFER_SIZE);
+      write("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
+    }
+
+    XMLStreamWriter::~XMLStreamWriter()
+    {
+      if (this->file)
+      {
+        while (!this->open_elements.empty())
+          end_element();
+        fclose(this->file);
+      }
+    }
+
+    void XMLStreamWriter::write(const char* text)
+    {
+      fputs(text, this->file);
+    }
+
+    void XMLStreamWriter::write_escaped(const char* text)
+    {
+      for (; *text; text++)
+      {
+        switch (*text)
+        {
+        case '&':
+          write("&amp;");
+          break;
+        case '<':
+          write("&lt;");
+          break;
+        case '>':
+          write("&gt;");
+          break;
+        case '"':
+          write("&quot;");
+          break;
+        default:
+          fputc(*text, this->file);
+        }
+      }
+    }
+
+    void XMLStreamWriter::start_element(const char* name)
+    {
+      if (this->start_tag_open)
+        write(">\n");
+      write("<");
+      write(name);
+      this->open_elements.push_back(name);
+      this->start_tag_open = true;
+    }
+
+    void XMLStreamWriter::attribute(const char* name, const char* value)
+    {
+      write(" ");
+      write(name);
+      write("=\"");
+      write_escaped(value);
+      write("\"");
+    }
+
+    void XMLStreamWriter::attribute(const char* name, const std::string& value)
+    {
+      this->attribute(name, value.c_str());
+    }
+
+    void XMLStreamWriter::attribute(const char* name, int value)
+    {
+      fprintf(this->file, " %s=\"%d\"", name, value);
+    }
+
+    void XMLStreamWriter::attribute(const char* name, unsigned int value)
+    {
+      fprintf(this->file, " %s=\"%u\"", name, value);
+    }
+
+    void XMLStreamWriter::attribute(const char* name, double value)
+    {
+      // The schemas use xs:decimal (no exponent), the number of decimal places is chosen from the exponent
+      // so that 17 significant digits are kept.
+      if (!std::isfinite(value))
+      {
+        fprintf(this->file, " %s=\"%g\"", name, value);
+        return;
+      }
+      char exponent_form[32];
+      sprintf(exponent_form, "%.16e", value);
+      int exponent = atoi(strchr(exponent_form, 'e') + 1);
+      int decimal_places = std::max(0, 16 - exponent);
+
+      std::string& text = this->number_buffer;
+      text.resize(decimal_places + 340);
+      int length = sprintf(&text[0], "%.*f", decimal_places, value);
+
+      // Trailing zeros.
+      if (decimal_places > 0)
+      {
+        while (text[length - 1] == '0')
+          length--;
+        if (text[length - 1] == '.')
+          length--;
+      }
+      text.resize(length);
+      fprintf(this->file, " %s=\"%s\"", name, text.c_str());
+    }
+
+    void XMLStreamWriter::attribute(const char* name, bool value)
+    {
+      fprintf(this->file, " %s=\"%s\"", name, value ? "true" : "false");
+    }
+
+    void XMLStreamWriter::end_element()
+    {
+      if (this->start_tag_open)
+        write("/>\n");
+      else
+      {
+        write("</");
+        write(this->open_elements.back().c_str());
+        write(">\n");
+      }
+      this->open_elements.pop_back();
+      this->start_tag_open = false;
+    }
+
+    void XMLStreamWriter::close()
+    {
+      while (!this->open_elements.empty())
+        end_element();
+      bool failed = ferror(this->file) != 0;
+      failed = (fclose(this->file) != 0) || failed;
+      this->file = nullptr;
+      if (failed)
+        throw Exceptions::IOException(Exceptions::IOException::Write, this->filename.c_str());
+    }
+  }
+}
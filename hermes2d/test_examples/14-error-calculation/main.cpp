@@ -2,6 +2,59 @@
 
 #define CUSTOM_DEBUG
 
+// Number of synthetic element references of the lazy sorting check, large enough for the parallel selection.
+const int SORTED_REFERENCES_COUNT = 3 * H2D_ERROR_CALCULATOR_PARALLEL_SELECTION_MIN;
+
+// Access to the lazy sorting of element references.
+class TestedErrorCalculator : public ErrorCalculator<double>
+{
+public:
+  TestedErrorCalculator() : ErrorCalculator<double>(AbsoluteError)
+  {
+    this->component_count = 0;
+  }
+
+  /// Fills the references with synthetic errors (with many ties), sorts them on demand the way Adapt consumes them
+  /// and returns the number of positions where the result differs from the full sort.
+  int check_lazy_sort(int count, int num_threads)
+  {
+    std::vector<double> synthetic_errors(count);
+    for (int i = 0; i < count; i++)
+      synthetic_errors[i] = (double)((i * 7919) % 1000);
+
+    free_with_check(this->element_references);
+    this->element_references = malloc_with_check<ErrorCalculator<double>, ElementReference>(count, this);
+    for (int i = 0; i < count; i++)
+      this->element_references[i] = ElementReference(i % 2, i / 2, &synthetic_errors[i], &synthetic_errors[i]);
+    this->num_act_elems = count;
+    this->num_threads_used = num_threads;
+
+    std::vector<ElementReference> fully_sorted(this->element_references, this->element_references + count);
+    std::sort(fully_sorted.begin(), fully_sorted.end(), compare_element_references);
+
+    // The initial prefix, then the references one by one.
+    this->store_element_references(true);
+    int differences = 0, checked_count = 0;
+    for (int i = 0; i <= count; i++)
+    {
+      for (; checked_count < this->sorted_element_references_count; checked_count++)
+      {
+        const ElementReference& reference = this->get_element_reference(checked_count);
+        if (reference.comp != fully_sorted[checked_count].comp || reference.element_id != fully_sorted[checked_count].element_id)
+          differences++;
+      }
+      if (i < count)
+        this->sort_element_references(i + 1);
+    }
+    if (checked_count != count)
+      differences++;
+
+    free_with_check(this->element_references);
+    this->num_act_elems = 0;
+    return differences;
+  }
+};
+
 int main(int argc, char* argv[])
 {
   // Load the mesh.
@@ -64,6 +117,21 @@ int main(int argc, char* argv[])
     return -1;
   }
 
+  // The lazily sorted prefixes of element references must be the same as the fully sorted ones.
+  TestedErrorCalculator testedErrorCalculator;
+  int serial_differences = testedErrorCalculator.check_lazy_sort(SORTED_REFERENCES_COUNT, 1);
+  int parallel_differences = testedErrorCalculator.check_lazy_sort(SORTED_REFERENCES_COUNT, 4);
+
+#ifdef CUSTOM_DEBUG
+  std::cout << "Lazy sort differences serial: " << serial_differences << ", parallel: " << parallel_differences << std::endl;
+#endif
+
+  if (serial_differences || parallel_differences)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
   std::cout << "Success!";
   return 0;
 }
\ No newline at end of file
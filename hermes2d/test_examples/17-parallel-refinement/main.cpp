@@ -0,0 +1,254 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test compares the parallel uniform refinement (Mesh::refine_all_elements() on meshes with at least
+//  H2D_PARALLEL_REFINEMENT_MIN_ELEMENTS active elements) with the serial one on a triangular, a quadrilateral
+//  and a mixed mesh, the meshes have a few elements refined beforehand (hanging nodes).
+//
+//  The element ids of both refinements are the same, the node ids may differ - the nodes are compared
+//  by their coordinates, the edges by the coordinates of their vertices.
+//
+//  The DOFs of the H1 and L2 reference spaces on the refined mesh are numbered serially and in parallel (at least
+//  H2D_PARALLEL_DOF_ASSIGNMENT_MIN_ELEMENTS active elements), the assembly lists of all elements must be the same.
+
+// Number of cells in either direction of the unit square.
+const int N = 72;
+// Every ELEMENT_STEP-th base element is refined before the uniform refinement.
+const int ELEMENT_STEP = 97;
+
+enum MeshType
+{
+  Triangles,
+  Quads,
+  Mixed
+};
+
+// Unit square divided into N x N cells, the cells are split into two triangles (for the mixed mesh every other one).
+// The arrays are flat (int3, int4 cannot be stored in std::vector).
+static MeshSharedPtr create_mesh(MeshType type)
+{
+  std::vector<double> verts;
+  for (int j = 0; j <= N; j++)
+  {
+    for (int i = 0; i <= N; i++)
+    {
+      verts.push_back(i / (double)N);
+      verts.push_back(j / (double)N);
+    }
+  }
+
+  std::vector<int> tris, quads;
+  for (int j = 0; j < N; j++)
+  {
+    for (int i = 0; i < N; i++)
+    {
+      int v0 = j * (N + 1) + i, v1 = v0 + 1, v2 = v1 + N + 1, v3 = v0 + N + 1;
+      if (type == Quads || (type == Mixed && (i + j) % 2 == 0))
+      {
+        int quad[4] = { v0, v1, v2, v3 };
+        quads.insert(quads.end(), quad, quad + 4);
+      }
+      else
+      {
+        int lower_and_upper[6] = { v0, v1, v2, v0, v2, v3 };
+        tris.insert(tris.end(), lower_and_upper, lower_and_upper + 6);
+      }
+    }
+  }
+
+  std::vector<int> mark;
+  std::vector<std::string> boundary_markers;
+  const char* names[4] = { "Bottom", "Right", "Top", "Left" };
+  for (int i = 0; i < N; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (N + 1) + N, (i + 1) * (N + 1) + N }, { N * (N + 1) + i, N * (N + 1) + i + 1 }, { i * (N + 1), (i + 1) * (N + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      mark.insert(mark.end(), edges[k], edges[k] + 2);
+      boundary_markers.push_back(names[k]);
+    }
+  }
+
+  int nt = tris.size() / 3, nq = quads.size() / 4;
+  std::vector<std::string> tri_markers(nt, "Triangles"), quad_markers(nq, "Quads");
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(verts.size() / 2, (double2*)&verts[0], nt, nt ? (int3*)&tris[0] : nullptr, nt ? &tri_markers[0] : nullptr,
+    nq, nq ? (int4*)&quads[0] : nullptr, nq ? &quad_markers[0] : nullptr, boundary_markers.size(), (int2*)&mark[0], &boundary_markers[0]);
+
+  for (int id = 0; id < mesh->get_num_base_elements(); id += ELEMENT_STEP)
+    mesh->refine_element_id(id);
+
+  return mesh;
+}
+
+static bool same_vertex(Node* a, Node* b)
+{
+  return a->x == b->x && a->y == b->y && a->ref == b->ref && a->bnd == b->bnd;
+}
+
+// Edge nodes, also the hash table entries of the edge.
+static bool same_edge(MeshSharedPtr mesh_a, Node* a, MeshSharedPtr mesh_b, Node* b)
+{
+  if (a->ref != b->ref || a->bnd != b->bnd || a->marker != b->marker)
+    return false;
+  if (mesh_a->peek_edge_node(a->p1, a->p2) != a || mesh_b->peek_edge_node(b->p1, b->p2) != b)
+    return false;
+
+  Node* a1 = mesh_a->get_node(a->p1), *a2 = mesh_a->get_node(a->p2), *b1 = mesh_b->get_node(b->p1), *b2 = mesh_b->get_node(b->p2);
+  bool same_ends = (a1->x == b1->x && a1->y == b1->y && a2->x == b2->x && a2->y == b2->y)
+    || (a1->x == b2->x && a1->y == b2->y && a2->x == b1->x && a2->y == b1->y);
+  if (!same_ends)
+    return false;
+
+  // Elements sharing the edge, in any order.
+  int a_ids[2] = { a->elem[0] ? a->elem[0]->id : -1, a->elem[1] ? a->elem[1]->id : -1 };
+  int b_ids[2] = { b->elem[0] ? b->elem[0]->id : -1, b->elem[1] ? b->elem[1]->id : -1 };
+  return (a_ids[0] == b_ids[0] && a_ids[1] == b_ids[1]) || (a_ids[0] == b_ids[1] && a_ids[1] == b_ids[0]);
+}
+
+// Used nodes of the type (get_num_vertex_nodes() / get_num_edge_nodes() do not count the nodes beyond get_num_nodes()).
+static int count_nodes(MeshSharedPtr mesh, int type)
+{
+  int count = 0;
+  for (int id = 0; id < mesh->get_max_node_id(); id++)
+    if (mesh->get_node(id)->used && mesh->get_node(id)->type == type)
+      count++;
+  return count;
+}
+
+// Returns the number of differences between the meshes.
+static int compare_meshes(MeshSharedPtr serial, MeshSharedPtr parallel)
+{
+  int differences = 0;
+  if (serial->get_max_element_id() != parallel->get_max_element_id() || serial->get_num_active_elements() != parallel->get_num_active_elements()
+    || count_nodes(serial, HERMES_TYPE_VERTEX) != count_nodes(parallel, HERMES_TYPE_VERTEX) || count_nodes(serial, HERMES_TYPE_EDGE) != count_nodes(parallel, HERMES_TYPE_EDGE))
+  {
+    std::cout << "Different element or node counts." << std::endl;
+    return 1;
+  }
+
+  Element* e;
+  for_all_used_elements(e, serial)
+  {
+    Element* f = parallel->get_element(e->id);
+    if (!f->used || f->active != e->active || f->nvert != e->nvert || f->marker != e->marker || f->area != e->area
+      || (f->parent ? f->parent->id : -1) != (e->parent ? e->parent->id : -1))
+    {
+      differences++;
+      continue;
+    }
+
+    // Son tables.
+    if (!e->active)
+    {
+      for (int s = 0; s < H2D_MAX_ELEMENT_SONS; s++)
+        if ((e->sons[s] ? e->sons[s]->id : -1) != (f->sons[s] ? f->sons[s]->id : -1))
+          differences++;
+      continue;
+    }
+
+    for (int i = 0; i < e->nvert; i++)
+    {
+      if (!same_vertex(e->vn[i], f->vn[i]))
+        differences++;
+      if (!same_edge(serial, e->en[i], parallel, f->en[i]))
+        differences++;
+    }
+  }
+
+  return differences;
+}
+
+// Returns the number of active elements with different assembly lists.
+static int compare_spaces(SpaceSharedPtr<double> serial, SpaceSharedPtr<double> parallel)
+{
+  if (serial->get_num_dofs() != parallel->get_num_dofs())
+  {
+    std::cout << "Different numbers of DOFs." << std::endl;
+    return 1;
+  }
+
+  int differences = 0;
+  AsmList<double> serial_al, parallel_al;
+  Element* e;
+  for_all_active_elements(e, serial->get_mesh())
+  {
+    serial->get_element_assembly_list(e, &serial_al);
+    parallel->get_element_assembly_list(e, &parallel_al);
+    bool same = serial_al.cnt == parallel_al.cnt;
+    for (int i = 0; same && i < serial_al.cnt; i++)
+      same = serial_al.idx[i] == parallel_al.idx[i] && serial_al.dof[i] == parallel_al.dof[i] && serial_al.coef[i] == parallel_al.coef[i];
+    if (!same)
+      differences++;
+  }
+
+  return differences;
+}
+
+// Returns the number of differences between the reference spaces created serially and in parallel.
+static int compare_reference_spaces(SpaceSharedPtr<double> coarse_space, MeshSharedPtr ref_mesh)
+{
+  Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, 1);
+  Space<double>::ReferenceSpaceCreator serial_creator(coarse_space, ref_mesh);
+  SpaceSharedPtr<double> serial = serial_creator.create_ref_space();
+  Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, 4);
+  Space<double>::ReferenceSpaceCreator parallel_creator(coarse_space, ref_mesh);
+  SpaceSharedPtr<double> parallel = parallel_creator.create_ref_space();
+
+  return compare_spaces(serial, parallel);
+}
+
+int main(int argc, char* argv[])
+{
+  MeshType types[3] = { Triangles, Quads, Mixed };
+  const char* names[3] = { "triangles", "quads", "mixed" };
+
+  for (int type_i = 0; type_i < 3; type_i++)
+  {
+    MeshSharedPtr serial = create_mesh(types[type_i]);
+    MeshSharedPtr parallel = create_mesh(types[type_i]);
+    if (parallel->get_num_active_elements() < H2D_PARALLEL_REFINEMENT_MIN_ELEMENTS)
+    {
+      std::cout << "The " << names[type_i] << " mesh is too small for the parallel refinement." << std::endl;
+      return -1;
+    }
+
+    Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, 1);
+    serial->refine_all_elements();
+    Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, 4);
+    parallel->refine_all_elements();
+
+    int differences = compare_meshes(serial, parallel);
+    std::cout << names[type_i] << ": " << differences << " differences." << std::endl;
+    if (differences)
+    {
+      std::cout << "Failure!";
+      return -1;
+    }
+
+    // Reference spaces on the refined mesh, with an essential BC (constrained vertex and edge DOFs).
+    if (parallel->get_num_active_elements() < H2D_PARALLEL_DOF_ASSIGNMENT_MIN_ELEMENTS)
+    {
+      std::cout << "The " << names[type_i] << " mesh is too small for the parallel DOF assignment." << std::endl;
+      return -1;
+    }
+    MeshSharedPtr coarse = create_mesh(types[type_i]);
+    DefaultEssentialBCConst<double> bc_essential("Bottom", 1.0);
+    EssentialBCs<double> bcs(&bc_essential);
+    SpaceSharedPtr<double> h1_space(new H1Space<double>(coarse, &bcs, 2));
+    SpaceSharedPtr<double> l2_space(new L2Space<double>(coarse, 1));
+    int dof_differences = compare_reference_spaces(h1_space, parallel) + compare_reference_spaces(l2_space, parallel);
+    std::cout << names[type_i] << " reference spaces: " << dof_differences << " differences." << std::endl;
+    if (dof_differences)
+    {
+      std::cout << "Failure!";
+      return -1;
+    }
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,211 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test checks the streaming XML readers and writers (used when the validation is off).
+//
+//  - The XML meshes of the other test examples are loaded streamed and by the XSD (DOM) parser with validation,
+//    the meshes are compared.
+//  - mesh.xml (variables, NURBS curves, refinements) is loaded, saved, and the saved file loaded again - streamed
+//    and with validation.
+//  - An H1 space with various element orders, a real and a complex solution on it are saved and loaded again,
+//    the element orders and the solution values are compared.
+
+const int EXISTING_MESHES = 6;
+const char* existing_meshes[EXISTING_MESHES] = { "../00-quickShow/domain.xml", "../01-poisson/domain.xml", "../03-navier-stokes/domain.xml",
+  "../15-adaptivity-matrix-reuse-simple/domain.xml", "../15-adaptivity-matrix-reuse-simple/quad.xml", "../15-adaptivity-matrix-reuse-simple/triangle.xml" };
+
+// Number of points in either direction the solutions are compared at (inside the domain of mesh.xml).
+const int POINTS = 40;
+
+// The DOM parser and the streaming reader may convert the numbers differently in the last bit.
+static bool same(double a, double b)
+{
+  return std::abs(a - b) <= 1e-14 * (1. + std::abs(a));
+}
+
+static bool same_curve(Curve* a, Curve* b)
+{
+  if (!a || !b)
+    return a == b;
+  if (a->type != b->type)
+    return false;
+  if (a->type == ArcType)
+    return same(((Arc*)a)->angle, ((Arc*)b)->angle);
+
+  Nurbs* nurbs_a = (Nurbs*)a, *nurbs_b = (Nurbs*)b;
+  if (nurbs_a->degree != nurbs_b->degree || nurbs_a->np != nurbs_b->np || nurbs_a->nk != nurbs_b->nk)
+    return false;
+  for (int i = 0; i < nurbs_a->np; i++)
+    for (int j = 0; j < 3; j++)
+      if (!same(nurbs_a->pt[i][j], nurbs_b->pt[i][j]))
+        return false;
+  for (int i = 0; i < nurbs_a->nk; i++)
+    if (!same(nurbs_a->kv[i], nurbs_b->kv[i]))
+      return false;
+  return true;
+}
+
+// Returns the number of differences between the meshes - elements (with their markers and curves), vertices and boundary edges.
+static int compare_meshes(MeshSharedPtr a, MeshSharedPtr b)
+{
+  if (a->get_num_base_elements() != b->get_num_base_elements() || a->get_max_element_id() != b->get_max_element_id()
+    || a->get_num_active_elements() != b->get_num_active_elements())
+  {
+    std::cout << "Different element counts." << std::endl;
+    return 1;
+  }
+
+  int differences = 0;
+  Element* e;
+  for_all_used_elements(e, a)
+  {
+    Element* f = b->get_element(e->id);
+    if (!f->used || f->active != e->active || f->nvert != e->nvert || (e->cm == nullptr) != (f->cm == nullptr)
+      || a->get_element_markers_conversion().get_user_marker(e->marker).marker != b->get_element_markers_conversion().get_user_marker(f->marker).marker)
+    {
+      differences++;
+      continue;
+    }
+
+    // Curves are stored in the base elements.
+    if (e->cm && e->cm->toplevel)
+      for (int i = 0; i < e->nvert; i++)
+        if (!same_curve(e->cm->curves[i], f->cm->curves[i]))
+          differences++;
+
+    if (!e->active)
+      continue;
+
+    for (int i = 0; i < e->nvert; i++)
+    {
+      if (!same(e->vn[i]->x, f->vn[i]->x) || !same(e->vn[i]->y, f->vn[i]->y) || e->en[i]->bnd != f->en[i]->bnd)
+        differences++;
+      else if (e->en[i]->bnd && a->get_boundary_markers_conversion().get_user_marker(e->en[i]->marker).marker != b->get_boundary_markers_conversion().get_user_marker(f->en[i]->marker).marker)
+        differences++;
+    }
+  }
+
+  return differences;
+}
+
+// Loads the mesh streamed and with validation (DOM), compares the meshes.
+static int compare_loading(const char* filename)
+{
+  MeshReaderH2DXML mloader;
+  MeshSharedPtr streamed(new Mesh), parsed(new Mesh);
+  mloader.load(filename, streamed);
+  mloader.set_validation(true);
+  mloader.load(filename, parsed);
+
+  int differences = compare_meshes(streamed, parsed);
+  std::cout << filename << ": " << differences << " differences." << std::endl;
+  return differences;
+}
+
+template<typename Scalar>
+static Scalar coefficient(int i);
+
+template<>
+double coefficient(int i)
+{
+  return std::sin(0.1 * i) * 1e3;
+}
+
+template<>
+std::complex<double> coefficient(int i)
+{
+  return std::complex<double>(std::sin(0.1 * i), std::cos(0.7 * i) * 1e-7);
+}
+
+// Saves a space and a solution on the mesh, loads them on the loaded mesh (of the same file), compares.
+template<typename Scalar>
+static int compare_space_and_solution(MeshSharedPtr mesh, MeshSharedPtr loaded_mesh)
+{
+  SpaceSharedPtr<Scalar> space(new H1Space<Scalar>(mesh, 2));
+  Element* e;
+  int element_i = 0;
+  for_all_active_elements(e, mesh)
+    space->set_element_order(e->id, 1 + (element_i++ % 6));
+  space->assign_dofs();
+
+  int ndof = space->get_num_dofs();
+  Scalar* coeffs = new Scalar[ndof];
+  for (int i = 0; i < ndof; i++)
+    coeffs[i] = coefficient<Scalar>(i);
+  Solution<Scalar> sln;
+  Solution<Scalar>::vector_to_solution(coeffs, space, &sln);
+  delete[] coeffs;
+
+  space->save("space.xml");
+  sln.save("solution.xml");
+
+  SpaceSharedPtr<Scalar> loaded_space = Space<Scalar>::load("space.xml", loaded_mesh);
+  Solution<Scalar> loaded_sln;
+  loaded_sln.load("solution.xml", loaded_space);
+
+  int differences = 0;
+  if (loaded_space->get_num_dofs() != ndof)
+    differences++;
+  for_all_active_elements(e, mesh)
+    if (loaded_space->get_element_order(e->id) != space->get_element_order(e->id))
+      differences++;
+
+  double x[POINTS * POINTS], y[POINTS * POINTS];
+  Scalar values[POINTS * POINTS], loaded_values[POINTS * POINTS];
+  for (int i = 0; i < POINTS; i++)
+  {
+    for (int j = 0; j < POINTS; j++)
+    {
+      x[i * POINTS + j] = 0.05 + 1.9 * i / (POINTS - 1);
+      y[i * POINTS + j] = 0.05 + 0.9 * j / (POINTS - 1);
+    }
+  }
+  if (sln.get_pt_values(POINTS * POINTS, x, y, values) != POINTS * POINTS || loaded_sln.get_pt_values(POINTS * POINTS, x, y, loaded_values) != POINTS * POINTS)
+    differences++;
+  for (int i = 0; i < POINTS * POINTS; i++)
+    if (std::abs(values[i] - loaded_values[i]) > 1e-12 * (1. + std::abs(values[i])))
+      differences++;
+
+  return differences;
+}
+
+int main(int argc, char* argv[])
+{
+  int differences = 0;
+
+  // Streamed vs. DOM loading.
+  for (int i = 0; i < EXISTING_MESHES; i++)
+    differences += compare_loading(existing_meshes[i]);
+  differences += compare_loading("mesh.xml");
+
+  // Save - load.
+  MeshReaderH2DXML mloader;
+  MeshSharedPtr mesh(new Mesh);
+  mloader.load("mesh.xml", mesh);
+  mloader.save("saved-mesh.xml", mesh);
+  differences += compare_loading("saved-mesh.xml");
+
+  MeshSharedPtr loaded_mesh(new Mesh);
+  mloader.load("saved-mesh.xml", loaded_mesh);
+  int mesh_differences = compare_meshes(mesh, loaded_mesh);
+  std::cout << "Saved mesh: " << mesh_differences << " differences." << std::endl;
+  differences += mesh_differences;
+
+  // Space & solutions.
+  int real_differences = compare_space_and_solution<double>(mesh, loaded_mesh);
+  std::cout << "Real space & solution: " << real_differences << " differences." << std::endl;
+  int complex_differences = compare_space_and_solution<std::complex<double> >(mesh, loaded_mesh);
+  std::cout << "Complex space & solution: " << complex_differences << " differences." << std::endl;
+  differences += real_differences + complex_differences;
+
+  if (differences)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
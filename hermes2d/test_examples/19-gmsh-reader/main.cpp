@@ -0,0 +1,213 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test compares the meshes created by Mesh::create_bulk() with the ones created by Mesh::create().
+//
+//  - mesh.msh (binary MSH 4.1) is loaded by MeshReaderGmsh. The file has sparse node tags, two node blocks,
+//    triangles (left half of the unit square) and quads (right half), some of them clockwise, named physical
+//    groups and a boundary curve without a physical group (marker "2").
+//  - A large mesh of the same layout is created by create_bulk() in parallel (at least
+//    H2D_PARALLEL_BULK_CREATION_MIN_ELEMENTS elements).
+//
+//  The vertex and element ids of both meshes are the same, the edge node ids may differ - the edges are compared
+//  by their vertices.
+
+// Number of cells in either direction of the unit square in mesh.msh.
+const int FILE_N = 4;
+// Number of cells in either direction of the unit square of the large mesh.
+const int BULK_N = 96;
+
+// Unit square divided into n x n cells, the left half split into two triangles, the right half quads.
+// The arrays are flat (int3, int4 cannot be stored in std::vector).
+struct Grid
+{
+  std::vector<double> verts;
+  std::vector<int> tris, quads, mark;
+  std::vector<std::string> boundary_markers;
+};
+
+static void create_grid(int n, Grid& grid)
+{
+  for (int j = 0; j <= n; j++)
+  {
+    for (int i = 0; i <= n; i++)
+    {
+      grid.verts.push_back(i / (double)n);
+      grid.verts.push_back(j / (double)n);
+    }
+  }
+
+  for (int j = 0; j < n; j++)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      int v0 = j * (n + 1) + i, v1 = v0 + 1, v2 = v1 + n + 1, v3 = v0 + n + 1;
+      if (i < n / 2)
+      {
+        int lower_and_upper[6] = { v0, v1, v2, v0, v2, v3 };
+        grid.tris.insert(grid.tris.end(), lower_and_upper, lower_and_upper + 6);
+      }
+      else
+      {
+        int quad[4] = { v0, v1, v2, v3 };
+        grid.quads.insert(grid.quads.end(), quad, quad + 4);
+      }
+    }
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (n + 1) + n, (i + 1) * (n + 1) + n }, { n * (n + 1) + i, n * (n + 1) + i + 1 }, { i * (n + 1), (i + 1) * (n + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      grid.mark.insert(grid.mark.end(), edges[k], edges[k] + 2);
+      grid.boundary_markers.push_back(k == 0 ? "Bottom" : "2");
+    }
+  }
+}
+
+static MeshSharedPtr create_mesh(Grid& grid)
+{
+  int nt = grid.tris.size() / 3, nq = grid.quads.size() / 4;
+  std::vector<std::string> tri_markers(nt, "Triangles"), quad_markers(nq, "Quads");
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(grid.verts.size() / 2, (double2*)&grid.verts[0], nt, (int3*)&grid.tris[0], &tri_markers[0],
+    nq, (int4*)&grid.quads[0], &quad_markers[0], grid.boundary_markers.size(), (int2*)&grid.mark[0], &grid.boundary_markers[0]);
+  return mesh;
+}
+
+// The triangles first, then the quads (as in create()).
+static MeshSharedPtr create_bulk_mesh(Grid& grid)
+{
+  MeshSharedPtr mesh(new Mesh);
+  int triangle_marker = mesh->get_element_markers_conversion().insert_marker("Triangles");
+  int quad_marker = mesh->get_element_markers_conversion().insert_marker("Quads");
+
+  std::vector<int> elems, elem_markers;
+  for (size_t i = 0; i < grid.tris.size(); i += 3)
+  {
+    int elem[4] = { grid.tris[i], grid.tris[i + 1], grid.tris[i + 2], -1 };
+    elems.insert(elems.end(), elem, elem + 4);
+    elem_markers.push_back(triangle_marker);
+  }
+  for (size_t i = 0; i < grid.quads.size(); i += 4)
+  {
+    elems.insert(elems.end(), grid.quads.begin() + i, grid.quads.begin() + i + 4);
+    elem_markers.push_back(quad_marker);
+  }
+
+  std::vector<int> boundary_markers;
+  for (size_t i = 0; i < grid.boundary_markers.size(); i++)
+    boundary_markers.push_back(mesh->get_boundary_markers_conversion().insert_marker(grid.boundary_markers[i]));
+
+  mesh->create_bulk(grid.verts.size() / 2, (double2*)&grid.verts[0], elem_markers.size(), (int4*)&elems[0], &elem_markers[0],
+    boundary_markers.size(), (int2*)&grid.mark[0], &boundary_markers[0]);
+  return mesh;
+}
+
+static bool same_vertex(Node* a, Node* b)
+{
+  return a->id == b->id && a->x == b->x && a->y == b->y && a->ref == b->ref && a->bnd == b->bnd;
+}
+
+// Edge nodes, also the hash table entries of the edge.
+static bool same_edge(MeshSharedPtr mesh_a, Node* a, MeshSharedPtr mesh_b, Node* b)
+{
+  if (a->ref != b->ref || a->bnd != b->bnd || (a->marker == 0) != (b->marker == 0))
+    return false;
+  if (a->marker && mesh_a->get_boundary_markers_conversion().get_user_marker(a->marker).marker != mesh_b->get_boundary_markers_conversion().get_user_marker(b->marker).marker)
+    return false;
+  if (mesh_a->peek_edge_node(a->p1, a->p2) != a || mesh_b->peek_edge_node(b->p1, b->p2) != b)
+    return false;
+  if (std::min(a->p1, a->p2) != std::min(b->p1, b->p2) || std::max(a->p1, a->p2) != std::max(b->p1, b->p2))
+    return false;
+
+  // Elements sharing the edge, in any order.
+  int a_ids[2] = { a->elem[0] ? a->elem[0]->id : -1, a->elem[1] ? a->elem[1]->id : -1 };
+  int b_ids[2] = { b->elem[0] ? b->elem[0]->id : -1, b->elem[1] ? b->elem[1]->id : -1 };
+  return (a_ids[0] == b_ids[0] && a_ids[1] == b_ids[1]) || (a_ids[0] == b_ids[1] && a_ids[1] == b_ids[0]);
+}
+
+// Used nodes of the type.
+static int count_nodes(MeshSharedPtr mesh, int type)
+{
+  int count = 0;
+  for (int id = 0; id < mesh->get_max_node_id(); id++)
+    if (mesh->get_node(id)->used && mesh->get_node(id)->type == type)
+      count++;
+  return count;
+}
+
+// Returns the number of differences between the meshes.
+static int compare_meshes(MeshSharedPtr created, MeshSharedPtr bulk)
+{
+  if (created->get_max_element_id() != bulk->get_max_element_id() || created->get_num_active_elements() != bulk->get_num_active_elements()
+    || count_nodes(created, HERMES_TYPE_VERTEX) != count_nodes(bulk, HERMES_TYPE_VERTEX) || count_nodes(created, HERMES_TYPE_EDGE) != count_nodes(bulk, HERMES_TYPE_EDGE))
+  {
+    std::cout << "Different element or node counts." << std::endl;
+    return 1;
+  }
+
+  int differences = 0;
+  Element* e;
+  for_all_used_elements(e, created)
+  {
+    Element* f = bulk->get_element(e->id);
+    if (!f->used || !f->active || f->nvert != e->nvert || f->area != e->area || f->diameter != e->diameter
+      || created->get_element_markers_conversion().get_user_marker(e->marker).marker != bulk->get_element_markers_conversion().get_user_marker(f->marker).marker)
+    {
+      differences++;
+      continue;
+    }
+
+    for (int i = 0; i < e->nvert; i++)
+    {
+      if (!same_vertex(e->vn[i], f->vn[i]))
+        differences++;
+      if (!same_edge(created, e->en[i], bulk, f->en[i]))
+        differences++;
+    }
+  }
+
+  return differences;
+}
+
+int main(int argc, char* argv[])
+{
+  int differences = 0;
+
+  // Gmsh file.
+  Grid file_grid;
+  create_grid(FILE_N, file_grid);
+  MeshSharedPtr loaded(new Mesh);
+  MeshReaderGmsh mloader;
+  mloader.load("mesh.msh", loaded);
+  int file_differences = compare_meshes(create_mesh(file_grid), loaded);
+  std::cout << "mesh.msh: " << file_differences << " differences." << std::endl;
+  differences += file_differences;
+
+  // Parallel create_bulk().
+  Grid bulk_grid;
+  create_grid(BULK_N, bulk_grid);
+  if ((int)(bulk_grid.tris.size() / 3 + bulk_grid.quads.size() / 4) < H2D_PARALLEL_BULK_CREATION_MIN_ELEMENTS)
+  {
+    std::cout << "The mesh is too small for the parallel creation." << std::endl;
+    return -1;
+  }
+  Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, 4);
+  int bulk_differences = compare_meshes(create_mesh(bulk_grid), create_bulk_mesh(bulk_grid));
+  std::cout << "create_bulk(): " << bulk_differences << " differences." << std::endl;
+  differences += bulk_differences;
+
+  if (differences)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,148 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsElasticity;
+
+//  This test solves the linear elasticity (Lame equations) on the unit square, once with the default CSCMatrix
+//  and once with the BSRMatrix (Hermes::matrixBlockSize = 2, UMFPACK gets the matrix converted to CSC).
+//
+//  - The solutions must be the same.
+//  - The blocked product of the BSRMatrix with a vector must be the same as the one of the CSCMatrix.
+//
+//  Both displacement components have the same space (mesh, order, boundary conditions), so the basis function k
+//  of both components lies in the block k.
+
+// Number of cells in either direction.
+const int N = 8;
+// Polynomial degree.
+const int P_INIT = 2;
+// Lame constants.
+const double LAMBDA = 1.0;
+const double MU = 0.5;
+// Volume force.
+const double F_X = 0.3;
+const double F_Y = -1.0;
+
+class CustomWeakFormElasticity : public WeakForm < double >
+{
+public:
+  CustomWeakFormElasticity() : WeakForm<double>(2)
+  {
+    this->add_matrix_form(new DefaultJacobianElasticity_0_0<double>(0, 0, LAMBDA, MU));
+    this->add_matrix_form(new DefaultJacobianElasticity_0_1<double>(0, 1, LAMBDA, MU));
+    this->add_matrix_form(new DefaultJacobianElasticity_1_1<double>(1, 1, LAMBDA, MU));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(F_X)));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(1, HERMES_ANY, new Hermes2DFunction<double>(F_Y)));
+  }
+};
+
+// Unit square divided into N x N quads.
+static MeshSharedPtr create_mesh()
+{
+  std::vector<double> verts;
+  for (int j = 0; j <= N; j++)
+  {
+    for (int i = 0; i <= N; i++)
+    {
+      verts.push_back(i / (double)N);
+      verts.push_back(j / (double)N);
+    }
+  }
+
+  std::vector<int> quads;
+  for (int j = 0; j < N; j++)
+  {
+    for (int i = 0; i < N; i++)
+    {
+      int quad[4] = { j * (N + 1) + i, j * (N + 1) + i + 1, (j + 1) * (N + 1) + i + 1, (j + 1) * (N + 1) + i };
+      quads.insert(quads.end(), quad, quad + 4);
+    }
+  }
+  std::vector<std::string> quad_markers(N * N, "Domain");
+
+  std::vector<int> mark;
+  std::vector<std::string> boundary_markers;
+  for (int i = 0; i < N; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (N + 1) + N, (i + 1) * (N + 1) + N }, { N * (N + 1) + i, N * (N + 1) + i + 1 }, { i * (N + 1), (i + 1) * (N + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      mark.insert(mark.end(), edges[k], edges[k] + 2);
+      boundary_markers.push_back(k == 0 ? "Bottom" : "Free");
+    }
+  }
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(verts.size() / 2, (double2*)&verts[0], 0, nullptr, nullptr, N * N, (int4*)&quads[0], &quad_markers[0],
+    boundary_markers.size(), (int2*)&mark[0], &boundary_markers[0]);
+  return mesh;
+}
+
+// Solves the problem, returns the solution vector and the product of the matrix with the vector x.
+static void solve(MeshSharedPtr mesh, int block_size, std::vector<double>& sln, std::vector<double>& product, bool& is_bsr)
+{
+  Hermes::HermesCommonApi.set_integral_param_value(Hermes::matrixBlockSize, block_size);
+
+  DefaultEssentialBCConst<double> bc_essential("Bottom", 0.0);
+  EssentialBCs<double> bcs(&bc_essential);
+  SpaceSharedPtr<double> space_x(new H1Space<double>(mesh, &bcs, P_INIT));
+  SpaceSharedPtr<double> space_y(new H1Space<double>(mesh, &bcs, P_INIT));
+
+  WeakFormSharedPtr<double> wf(new CustomWeakFormElasticity);
+  LinearSolver<double> solver(wf, { space_x, space_y });
+  solver.solve();
+
+  int ndof = Space<double>::get_num_dofs({ space_x, space_y });
+  sln.assign(solver.get_sln_vector(), solver.get_sln_vector() + ndof);
+
+  SparseMatrix<double>* matrix = solver.get_jacobian();
+  is_bsr = dynamic_cast<BSRMatrix<double>*>(matrix) != nullptr;
+  std::vector<double> x(ndof);
+  for (int i = 0; i < ndof; i++)
+    x[i] = std::sin(i + 1.0);
+  double* result = new double[ndof];
+  matrix->multiply_with_vector(&x[0], result);
+  product.assign(result, result + ndof);
+  delete[] result;
+}
+
+static double max_difference(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double difference = 0.;
+  for (size_t i = 0; i < a.size(); i++)
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  return difference;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr mesh = create_mesh();
+
+  std::vector<double> csc_sln, csc_product, bsr_sln, bsr_product;
+  bool csc_is_bsr, bsr_is_bsr;
+  solve(mesh, 1, csc_sln, csc_product, csc_is_bsr);
+  solve(mesh, 2, bsr_sln, bsr_product, bsr_is_bsr);
+  Hermes::HermesCommonApi.set_integral_param_value(Hermes::matrixBlockSize, 1);
+
+  if (csc_is_bsr || !bsr_is_bsr || csc_sln.size() != bsr_sln.size())
+  {
+    std::cout << "Wrong matrix type." << std::endl;
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  double sln_difference = max_difference(csc_sln, bsr_sln);
+  double product_difference = max_difference(csc_product, bsr_product);
+  std::cout << "Ndofs: " << csc_sln.size() << ", solution difference: " << sln_difference << ", product difference: " << product_difference << std::endl;
+
+  if (sln_difference > 1e-10 || product_difference > 1e-10)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
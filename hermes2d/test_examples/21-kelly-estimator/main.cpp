@@ -0,0 +1,186 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test compares the element indicators of BasicKellyErrorCalculator with a serial reference evaluation
+//  of the Kelly estimator, as done by the former KellyTypeAdapt:
+//
+//    eta_K = sum over the inner edges E of K: 0.5 * 0.5 * h_K * res_E,  res_E = sum_i w_i |tan_i| [du/dn]^2(x_i) / 24,
+//
+//  (half of the value of the edge for either element, the value halved for the edge parametrization). The edge
+//  quadrature weights w_i |tan_i| sum to twice the length of the edge, so eta_K = sum 0.5 * h_K * int_E [du/dn]^2 / 24.
+//  The jumps are evaluated by Solution::get_pt_values() just inside both elements sharing the edge,
+//  the edges are split at their midpoints to integrate exactly over the hanging nodes.
+//
+//  The calculator runs with 1 and N threads, the indicators must be the same in both runs.
+
+// Number of cells in either direction of the unit square.
+const int N = 4;
+// Polynomial degree.
+const int P_INIT = 2;
+// Number of threads of the parallel run.
+const int THREAD_COUNT = 4;
+// Distance of the evaluation points from the edge.
+const double EPS = 1e-9;
+
+static MeshSharedPtr create_mesh()
+{
+  std::vector<double> verts;
+  for (int j = 0; j <= N; j++)
+  {
+    for (int i = 0; i <= N; i++)
+    {
+      verts.push_back(i / (double)N);
+      verts.push_back(j / (double)N);
+    }
+  }
+
+  std::vector<int> quads;
+  for (int j = 0; j < N; j++)
+  {
+    for (int i = 0; i < N; i++)
+    {
+      int quad[4] = { j * (N + 1) + i, j * (N + 1) + i + 1, (j + 1) * (N + 1) + i + 1, (j + 1) * (N + 1) + i };
+      quads.insert(quads.end(), quad, quad + 4);
+    }
+  }
+  std::vector<std::string> quad_markers(N * N, "Domain");
+
+  std::vector<int> mark;
+  std::vector<std::string> boundary_markers;
+  for (int i = 0; i < N; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (N + 1) + N, (i + 1) * (N + 1) + N }, { N * (N + 1) + i, N * (N + 1) + i + 1 }, { i * (N + 1), (i + 1) * (N + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      mark.insert(mark.end(), edges[k], edges[k] + 2);
+      boundary_markers.push_back("Boundary");
+    }
+  }
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(verts.size() / 2, (double2*)&verts[0], 0, nullptr, nullptr, N * N, (int4*)&quads[0], &quad_markers[0],
+    boundary_markers.size(), (int2*)&mark[0], &boundary_markers[0]);
+
+  // Hanging nodes of isotropic and anisotropic refinements.
+  mesh->refine_element_id(5);
+  mesh->refine_element_id(10, 2);
+  mesh->refine_element_id(13, 0);
+  return mesh;
+}
+
+// Reference indicators, indexed by element id.
+static std::vector<double> reference_indicators(MeshSharedPtr mesh, MeshFunctionSharedPtr<double> sln)
+{
+  static const double gauss_points[5] = { -0.9061798459386640, -0.5384693101056831, 0., 0.5384693101056831, 0.9061798459386640 };
+  static const double gauss_weights[5] = { 0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891 };
+  Solution<double>* solution = static_cast<Solution<double>*>(sln.get());
+
+  std::vector<double> indicators(mesh->get_max_element_id(), 0.);
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    double center_x = 0., center_y = 0.;
+    for (int i = 0; i < e->get_nvert(); i++)
+    {
+      center_x += e->vn[i]->x / e->get_nvert();
+      center_y += e->vn[i]->y / e->get_nvert();
+    }
+
+    for (int edge = 0; edge < e->get_nvert(); edge++)
+    {
+      if (e->en[edge]->bnd)
+        continue;
+
+      Node* a = e->vn[edge];
+      Node* b = e->vn[e->next_vert(edge)];
+      double length = std::sqrt(sqr(b->x - a->x) + sqr(b->y - a->y));
+      double nx = (b->y - a->y) / length, ny = -(b->x - a->x) / length;
+      if ((center_x - a->x) * nx + (center_y - a->y) * ny > 0.)
+      {
+        nx = -nx;
+        ny = -ny;
+      }
+
+      // Both halves of the edge, points inside (0 - 9) and outside (10 - 19).
+      double x[20], y[20], values[20], dx[20], dy[20];
+      for (int half = 0; half < 2; half++)
+      {
+        for (int i = 0; i < 5; i++)
+        {
+          double t = 0.25 * (gauss_points[i] + 1.) + 0.5 * half;
+          x[half * 5 + i] = a->x + t * (b->x - a->x) - EPS * nx;
+          y[half * 5 + i] = a->y + t * (b->y - a->y) - EPS * ny;
+          x[10 + half * 5 + i] = x[half * 5 + i] + 2. * EPS * nx;
+          y[10 + half * 5 + i] = y[half * 5 + i] + 2. * EPS * ny;
+        }
+      }
+      solution->get_pt_values(20, x, y, values, dx, dy);
+
+      double integral = 0.;
+      for (int i = 0; i < 10; i++)
+      {
+        double jump = nx * (dx[i] - dx[10 + i]) + ny * (dy[i] - dy[10 + i]);
+        integral += gauss_weights[i % 5] * 0.25 * length * jump * jump;
+      }
+
+      indicators[e->id] += 0.5 * e->diameter * integral / 24.;
+    }
+  }
+
+  return indicators;
+}
+
+static std::vector<double> calculated_indicators(MeshSharedPtr mesh, MeshFunctionSharedPtr<double> sln, int num_threads)
+{
+  Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, num_threads);
+  BasicKellyErrorCalculator<double> error_calculator(AbsoluteError, 1);
+  error_calculator.calculate_errors(sln);
+
+  std::vector<double> indicators(mesh->get_max_element_id(), 0.);
+  Element* e;
+  for_all_active_elements(e, mesh)
+    indicators[e->id] = error_calculator.get_element_error_squared(0, e->id);
+  return indicators;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr mesh = create_mesh();
+  SpaceSharedPtr<double> space(new H1Space<double>(mesh, P_INIT));
+
+  // A piecewise polynomial with jumps of the gradient everywhere.
+  int ndof = space->get_num_dofs();
+  std::vector<double> coeffs(ndof);
+  for (int i = 0; i < ndof; i++)
+    coeffs[i] = std::sin(i + 1.);
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(&coeffs[0], space, sln);
+
+  std::vector<double> reference = reference_indicators(mesh, sln);
+  std::vector<double> serial = calculated_indicators(mesh, sln, 1);
+  std::vector<double> parallel = calculated_indicators(mesh, sln, THREAD_COUNT);
+
+  double max_indicator = *std::max_element(reference.begin(), reference.end());
+  double reference_difference = 0.;
+  int thread_differences = 0;
+  for (size_t i = 0; i < reference.size(); i++)
+  {
+    reference_difference = std::max(reference_difference, std::abs(reference[i] - serial[i]));
+    if (serial[i] != parallel[i])
+      thread_differences++;
+  }
+
+  std::cout << "Max. indicator: " << max_indicator << ", max. difference from the reference: " << reference_difference
+    << ", differences between 1 and " << THREAD_COUNT << " threads: " << thread_differences << std::endl;
+
+  if (max_indicator <= 0. || reference_difference > 1e-6 * max_indicator || thread_differences)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsElasticity;
+
+//  This test checks the Dirichlet lift of the linear problems (LinearSolver) for the forms with the symmetry flag
+//  between different components - their transposed block is inserted by the assembler.
+//
+//  - The linear elasticity (Lame equations) on the unit square is solved with a nonzero displacement on the bottom,
+//    once with the symmetric form 0_1, once with the nonsymmetric forms 0_1 and 1_0.
+//  - The solutions must be the same, on 1 and 2 threads.
+
+// Number of cells in either direction.
+const int N = 8;
+// Polynomial degree.
+const int P_INIT = 2;
+// Lame constants.
+const double LAMBDA = 1.0;
+const double MU = 0.5;
+// Volume force.
+const double F_X = 0.3;
+const double F_Y = -1.0;
+// Displacement on the bottom.
+const double BOTTOM_DISPLACEMENT = 0.1;
+
+// The form 0_1 without the symmetry flag, or its transposition (the form 1_0).
+class NonsymmetricElasticity_0_1 : public DefaultJacobianElasticity_0_1<double>
+{
+public:
+  NonsymmetricElasticity_0_1(bool transposed) : DefaultJacobianElasticity_0_1<double>(transposed ? 1 : 0, transposed ? 0 : 1, LAMBDA, MU), transposed(transposed)
+  {
+    this->setSymFlag(HERMES_NONSYM);
+  }
+
+  virtual double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, GeomVol<double> *e, Func<double> **ext) const
+  {
+    if (transposed)
+      return DefaultJacobianElasticity_0_1<double>::value(n, wt, u_ext, v, u, e, ext);
+    return DefaultJacobianElasticity_0_1<double>::value(n, wt, u_ext, u, v, e, ext);
+  }
+
+  virtual MatrixFormVol<double>* clone() const
+  {
+    return new NonsymmetricElasticity_0_1(transposed);
+  }
+
+  bool transposed;
+};
+
+class CustomWeakFormElasticity : public WeakForm < double >
+{
+public:
+  CustomWeakFormElasticity(bool symmetric) : WeakForm<double>(2)
+  {
+    this->add_matrix_form(new DefaultJacobianElasticity_0_0<double>(0, 0, LAMBDA, MU));
+    if (symmetric)
+      this->add_matrix_form(new DefaultJacobianElasticity_0_1<double>(0, 1, LAMBDA, MU));
+    else
+    {
+      this->add_matrix_form(new NonsymmetricElasticity_0_1(false));
+      this->add_matrix_form(new NonsymmetricElasticity_0_1(true));
+    }
+    this->add_matrix_form(new DefaultJacobianElasticity_1_1<double>(1, 1, LAMBDA, MU));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(F_X)));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(1, HERMES_ANY, new Hermes2DFunction<double>(F_Y)));
+  }
+};
+
+// Unit square divided into N x N quads.
+static MeshSharedPtr create_mesh()
+{
+  std::vector<double> verts;
+  for (int j = 0; j <= N; j++)
+  {
+    for (int i = 0; i <= N; i++)
+    {
+      verts.push_back(i / (double)N);
+      verts.push_back(j / (double)N);
+    }
+  }
+
+  std::vector<int> quads;
+  for (int j = 0; j < N; j++)
+  {
+    for (int i = 0; i < N; i++)
+    {
+      int quad[4] = { j * (N + 1) + i, j * (N + 1) + i + 1, (j + 1) * (N + 1) + i + 1, (j + 1) * (N + 1) + i };
+      quads.insert(quads.end(), quad, quad + 4);
+    }
+  }
+  std::vector<std::string> quad_markers(N * N, "Domain");
+
+  std::vector<int> mark;
+  std::vector<std::string> boundary_markers;
+  for (int i = 0; i < N; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (N + 1) + N, (i + 1) * (N + 1) + N }, { N * (N + 1) + i, N * (N + 1) + i + 1 }, { i * (N + 1), (i + 1) * (N + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      mark.insert(mark.end(), edges[k], edges[k] + 2);
+      boundary_markers.push_back(k == 0 ? "Bottom" : "Free");
+    }
+  }
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(verts.size() / 2, (double2*)&verts[0], 0, nullptr, nullptr, N * N, (int4*)&quads[0], &quad_markers[0],
+    boundary_markers.size(), (int2*)&mark[0], &boundary_markers[0]);
+  return mesh;
+}
+
+static std::vector<double> solve(MeshSharedPtr mesh, bool symmetric)
+{
+  DefaultEssentialBCConst<double> bc_essential("Bottom", BOTTOM_DISPLACEMENT);
+  EssentialBCs<double> bcs(&bc_essential);
+  SpaceSharedPtr<double> space_x(new H1Space<double>(mesh, &bcs, P_INIT));
+  SpaceSharedPtr<double> space_y(new H1Space<double>(mesh, &bcs, P_INIT));
+
+  WeakFormSharedPtr<double> wf(new CustomWeakFormElasticity(symmetric));
+  LinearSolver<double> solver(wf, { space_x, space_y });
+  solver.solve();
+
+  int ndof = Space<double>::get_num_dofs({ space_x, space_y });
+  return std::vector<double>(solver.get_sln_vector(), solver.get_sln_vector() + ndof);
+}
+
+static double max_difference(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double difference = 0.;
+  for (size_t i = 0; i < a.size(); i++)
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  return difference;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr mesh = create_mesh();
+
+  double max_sln_difference = 0.;
+  std::vector<double> reference;
+  for (int threads = 1; threads <= 2; threads++)
+  {
+    Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, threads);
+    std::vector<double> symmetric = solve(mesh, true);
+    std::vector<double> nonsymmetric = solve(mesh, false);
+    if (reference.empty())
+      reference = nonsymmetric;
+
+    double sln_difference = std::max(max_difference(symmetric, reference), max_difference(nonsymmetric, reference));
+    std::cout << "Threads: " << threads << ", Ndofs: " << reference.size() << ", solution difference: " << sln_difference << std::endl;
+    max_sln_difference = std::max(max_sln_difference, sln_difference);
+  }
+
+  if (max_sln_difference > 1e-10)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
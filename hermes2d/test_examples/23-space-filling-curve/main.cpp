@@ -0,0 +1,181 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsElasticity;
+
+//  This test assembles the linear elasticity (Lame equations) with the base elements traversed in the order of their
+//  ids and along the space-filling curve (Hermes2D::spaceFillingCurveOrdering), on 1 and 4 threads.
+//
+//  - The ids of the base elements are shuffled, so that the two orders differ.
+//  - The components have different meshes (multi-mesh traversal), the second one is refined.
+//  - The matrices must have the same structure, the matrices and the right-hand sides the same values
+//    (up to the rounding of the different summation order).
+//  - The assembly times are printed.
+
+// Number of cells in either direction.
+const int N = 48;
+// Polynomial degree.
+const int P_INIT = 2;
+// Lame constants.
+const double LAMBDA = 1.0;
+const double MU = 0.5;
+// Volume force.
+const double F_X = 0.3;
+const double F_Y = -1.0;
+// Number of threads of the parallel assembly.
+const int THREAD_COUNT = 4;
+
+class CustomWeakFormElasticity : public WeakForm < double >
+{
+public:
+  CustomWeakFormElasticity() : WeakForm<double>(2)
+  {
+    this->add_matrix_form(new DefaultJacobianElasticity_0_0<double>(0, 0, LAMBDA, MU));
+    this->add_matrix_form(new DefaultJacobianElasticity_0_1<double>(0, 1, LAMBDA, MU));
+    this->add_matrix_form(new DefaultJacobianElasticity_1_1<double>(1, 1, LAMBDA, MU));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(F_X)));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(1, HERMES_ANY, new Hermes2DFunction<double>(F_Y)));
+  }
+};
+
+// Unit square divided into N x N quads, the quads are in a pseudo-random order.
+static MeshSharedPtr create_mesh()
+{
+  std::vector<double> verts;
+  for (int j = 0; j <= N; j++)
+  {
+    for (int i = 0; i <= N; i++)
+    {
+      verts.push_back(i / (double)N);
+      verts.push_back(j / (double)N);
+    }
+  }
+
+  std::vector<int> cells(N * N);
+  for (int i = 0; i < N * N; i++)
+    cells[i] = i;
+  unsigned int seed = 12345;
+  for (int i = N * N - 1; i > 0; i--)
+  {
+    seed = seed * 1103515245 + 12345;
+    std::swap(cells[i], cells[(seed >> 8) % (i + 1)]);
+  }
+
+  std::vector<int> quads;
+  for (int k = 0; k < N * N; k++)
+  {
+    int i = cells[k] % N, j = cells[k] / N;
+    int quad[4] = { j * (N + 1) + i, j * (N + 1) + i + 1, (j + 1) * (N + 1) + i + 1, (j + 1) * (N + 1) + i };
+    quads.insert(quads.end(), quad, quad + 4);
+  }
+  std::vector<std::string> quad_markers(N * N, "Domain");
+
+  std::vector<int> mark;
+  std::vector<std::string> boundary_markers;
+  for (int i = 0; i < N; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (N + 1) + N, (i + 1) * (N + 1) + N }, { N * (N + 1) + i, N * (N + 1) + i + 1 }, { i * (N + 1), (i + 1) * (N + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      mark.insert(mark.end(), edges[k], edges[k] + 2);
+      boundary_markers.push_back(k == 0 ? "Bottom" : "Free");
+    }
+  }
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(verts.size() / 2, (double2*)&verts[0], 0, nullptr, nullptr, N * N, (int4*)&quads[0], &quad_markers[0],
+    boundary_markers.size(), (int2*)&mark[0], &boundary_markers[0]);
+  return mesh;
+}
+
+struct Assembled
+{
+  std::vector<int> Ap, Ai;
+  std::vector<double> Ax, rhs;
+  double time;
+};
+
+static void assemble(MeshSharedPtr mesh_x, MeshSharedPtr mesh_y, int threads, int ordering, Assembled& assembled)
+{
+  Hermes::HermesCommonApi.set_integral_param_value(Hermes::numThreads, threads);
+  Hermes2DApi.set_integral_param_value(spaceFillingCurveOrdering, ordering);
+
+  DefaultEssentialBCConst<double> bc_essential("Bottom", 0.0);
+  EssentialBCs<double> bcs(&bc_essential);
+  SpaceSharedPtr<double> space_x(new H1Space<double>(mesh_x, &bcs, P_INIT));
+  SpaceSharedPtr<double> space_y(new H1Space<double>(mesh_y, &bcs, P_INIT));
+
+  WeakFormSharedPtr<double> wf(new CustomWeakFormElasticity);
+  DiscreteProblem<double> dp(wf, { space_x, space_y });
+  CSCMatrix<double> matrix;
+  SimpleVector<double> rhs;
+
+  Hermes::Mixins::TimeMeasurable cpu_time;
+  cpu_time.tick();
+  dp.assemble(&matrix, &rhs);
+  cpu_time.tick();
+  assembled.time = cpu_time.last();
+
+  unsigned int size = matrix.get_size();
+  assembled.Ap.assign(matrix.get_Ap(), matrix.get_Ap() + size + 1);
+  assembled.Ai.assign(matrix.get_Ai(), matrix.get_Ai() + matrix.get_nnz());
+  assembled.Ax.assign(matrix.get_Ax(), matrix.get_Ax() + matrix.get_nnz());
+  assembled.rhs.assign(rhs.v, rhs.v + size);
+}
+
+// Relative difference of the values.
+static double difference(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double difference = 0., max_value = 0.;
+  for (size_t i = 0; i < a.size(); i++)
+  {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+    max_value = std::max(max_value, std::abs(a[i]));
+  }
+  return difference / max_value;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr mesh_x = create_mesh();
+  MeshSharedPtr mesh_y(new Mesh);
+  mesh_y->copy(mesh_x);
+  mesh_y->refine_all_elements();
+  for (int id = 0; id < N * N; id += 7)
+    mesh_y->refine_element_id(mesh_y->get_element(id)->sons[0]->id);
+
+  bool success = true;
+  Assembled reference;
+  assemble(mesh_x, mesh_y, 1, 0, reference);
+  std::cout << "Ndofs: " << reference.rhs.size() << ", nnz: " << reference.Ax.size() << std::endl;
+
+  for (int threads = 1; threads <= THREAD_COUNT; threads += THREAD_COUNT - 1)
+  {
+    for (int ordering = 0; ordering <= 1; ordering++)
+    {
+      Assembled assembled;
+      assemble(mesh_x, mesh_y, threads, ordering, assembled);
+
+      bool same_structure = assembled.Ap == reference.Ap && assembled.Ai == reference.Ai;
+      double matrix_difference = same_structure ? difference(reference.Ax, assembled.Ax) : 1.;
+      double rhs_difference = difference(reference.rhs, assembled.rhs);
+      std::cout << "Threads: " << threads << ", ordering: " << (ordering ? "space-filling curve" : "ids") << ", assembly time: " << assembled.time << " s"
+        << ", matrix difference: " << matrix_difference << ", rhs difference: " << rhs_difference << std::endl;
+
+      if (!same_structure || matrix_difference > 1e-12 || rhs_difference > 1e-12)
+        success = false;
+    }
+  }
+  Hermes2DApi.set_integral_param_value(spaceFillingCurveOrdering, 0);
+
+  if (!success)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,295 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test checks the round trip of a mesh, spaces and a solution through a Checkpoint, and the refusal
+//  of corrupted files.
+//
+//  - domain.mesh (triangles and quads, curved edges) is refined, some elements are unrefined again, so that
+//    the mesh has unused node and element ids.
+//  - An H1 space (Dirichlet condition on "Bottom", varying orders), an L2 space and a solution of the H1 space
+//    are saved and loaded.
+//  - The loaded mesh must have the same nodes and elements, and it must hand out the same ids as the original
+//    one when refined further. The loaded spaces must have the same assembly lists, the loaded solution the same
+//    values as the original one.
+//  - Truncated and corrupted files, and a space loaded with different boundary conditions, must be refused
+//    by an exception.
+
+const char* FILENAME = "checkpoint.h2d";
+const char* CORRUPTED_FILENAME = "corrupted.h2d";
+
+// Layout of the version 1 format (checkpoint.cpp): the header, then the section of the first mesh starting
+// by the mesh record, the node records and the unused node ids, then the element records.
+const size_t HEADER_SIZE = 40;
+const size_t MESH_RECORD_SIZE = 60;
+const size_t NODE_RECORD_SIZE = 48;
+
+// Number of the evaluation points in either direction of the bounding box [-1, 1]^2, the points outside
+// the domain are skipped.
+const int POINTS_N = 40;
+
+static bool same_node(Node* a, Node* b)
+{
+  if (a->used != b->used)
+    return false;
+  if (!a->used)
+    return true;
+  if (a->type != b->type || a->ref != b->ref || a->bnd != b->bnd || a->p1 != b->p1 || a->p2 != b->p2)
+    return false;
+  if (a->type == HERMES_TYPE_VERTEX)
+    return a->x == b->x && a->y == b->y;
+  for (int j = 0; j < 2; j++)
+    if ((a->elem[j] ? a->elem[j]->id : -1) != (b->elem[j] ? b->elem[j]->id : -1))
+      return false;
+  return a->marker == b->marker;
+}
+
+static bool same_element(Element* a, Element* b)
+{
+  if (a->used != b->used)
+    return false;
+  if (!a->used)
+    return true;
+  if (a->active != b->active || a->nvert != b->nvert || a->marker != b->marker || a->area != b->area || a->diameter != b->diameter
+    || (a->parent ? a->parent->id : -1) != (b->parent ? b->parent->id : -1) || (a->cm == nullptr) != (b->cm == nullptr))
+    return false;
+  for (int j = 0; j < a->nvert; j++)
+  {
+    if (a->vn[j]->id != b->vn[j]->id)
+      return false;
+    if (a->active && a->en[j]->id != b->en[j]->id)
+      return false;
+    if (!a->active && (a->sons[j] ? a->sons[j]->id : -1) != (b->sons[j] ? b->sons[j]->id : -1))
+      return false;
+  }
+  return true;
+}
+
+// Returns the number of differences between the meshes.
+static int compare_meshes(MeshSharedPtr original, MeshSharedPtr loaded)
+{
+  if (original->get_max_node_id() != loaded->get_max_node_id() || original->get_max_element_id() != loaded->get_max_element_id()
+    || original->get_num_active_elements() != loaded->get_num_active_elements() || original->get_num_used_base_elements() != loaded->get_num_used_base_elements())
+  {
+    std::cout << "Different node or element counts." << std::endl;
+    return 1;
+  }
+
+  int differences = 0;
+  for (int id = 0; id < original->get_max_node_id(); id++)
+    if (!same_node(original->get_node(id), loaded->get_node(id)))
+      differences++;
+  for (int id = 0; id < original->get_max_element_id(); id++)
+  {
+    Element* a = original->get_element_fast(id);
+    Element* b = loaded->get_element_fast(id);
+    if (!same_element(a, b) || (a->used && original->get_element_markers_conversion().get_user_marker(a->marker).marker != loaded->get_element_markers_conversion().get_user_marker(b->marker).marker))
+      differences++;
+  }
+  return differences;
+}
+
+// Returns the number of differences between the assembly lists of the spaces.
+static int compare_spaces(SpaceSharedPtr<double> original, SpaceSharedPtr<double> loaded)
+{
+  if (original->get_num_dofs() != loaded->get_num_dofs() || original->get_type() != loaded->get_type())
+  {
+    std::cout << "Different number of DOFs or space types." << std::endl;
+    return 1;
+  }
+
+  int differences = 0;
+  AsmList<double> al_original, al_loaded;
+  Element* e;
+  for_all_active_elements(e, original->get_mesh())
+  {
+    original->get_element_assembly_list(e, &al_original);
+    loaded->get_element_assembly_list(loaded->get_mesh()->get_element(e->id), &al_loaded);
+    if (original->get_element_order(e->id) != loaded->get_element_order(e->id) || al_original.cnt != al_loaded.cnt)
+    {
+      differences++;
+      continue;
+    }
+    for (unsigned int i = 0; i < al_original.cnt; i++)
+      if (al_original.idx[i] != al_loaded.idx[i] || al_original.dof[i] != al_loaded.dof[i] || al_original.coef[i] != al_loaded.coef[i])
+        differences++;
+  }
+  return differences;
+}
+
+// Returns the maximum difference of the values at a grid of points.
+static double compare_solutions(MeshFunctionSharedPtr<double> a, MeshFunctionSharedPtr<double> b)
+{
+  std::vector<double> x, y;
+  for (int i = 0; i < POINTS_N; i++)
+  {
+    for (int j = 0; j < POINTS_N; j++)
+    {
+      double point_x = -1. + (i + 0.5) * 2. / POINTS_N, point_y = -1. + (j + 0.5) * 2. / POINTS_N;
+      if ((point_x < 0. && point_y < 0.) || (point_x > 0. && point_y > 0. && point_x * point_x + point_y * point_y > 0.95))
+        continue;
+      x.push_back(point_x);
+      y.push_back(point_y);
+    }
+  }
+  std::vector<double> values_a(x.size()), values_b(x.size());
+  int found_a = dynamic_cast<Solution<double>*>(a.get())->get_pt_values(x.size(), &x[0], &y[0], &values_a[0]);
+  int found_b = dynamic_cast<Solution<double>*>(b.get())->get_pt_values(x.size(), &x[0], &y[0], &values_b[0]);
+  if (found_a != (int)x.size() || found_b != (int)x.size())
+    return std::numeric_limits<double>::infinity();
+
+  double difference = 0.;
+  for (unsigned int i = 0; i < x.size(); i++)
+    difference = std::max(difference, std::abs(values_a[i] - values_b[i]));
+  return difference;
+}
+
+static std::vector<char> read_file(const char* filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const char* filename, const std::vector<char>& data, size_t size)
+{
+  std::ofstream file(filename, std::ios::binary);
+  file.write(&data[0], size);
+}
+
+// Whether loading the mesh of the file fails by an exception.
+static bool refused(const std::vector<char>& data, size_t size, bool verify_checksums)
+{
+  write_file(CORRUPTED_FILENAME, data, size);
+  Checkpoint<double> checkpoint;
+  try
+  {
+    checkpoint.open(CORRUPTED_FILENAME, verify_checksums);
+    checkpoint.load_mesh(0);
+  }
+  catch (Hermes::Exceptions::Exception&)
+  {
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char* argv[])
+{
+  int differences = 0;
+
+  MeshSharedPtr mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", mesh);
+  mesh->refine_all_elements();
+  mesh->refine_all_elements();
+  mesh->refine_element_id(mesh->get_max_element_id() - 1);
+  mesh->refine_element_id(mesh->get_max_element_id() - 6);
+  mesh->unrefine_element_id(1);
+  mesh->unrefine_element_id(7);
+
+  DefaultEssentialBCConst<double> bc_essential("Bottom", 1.0);
+  EssentialBCs<double> bcs(&bc_essential);
+  SpaceSharedPtr<double> h1_space(new H1Space<double>(mesh, &bcs, 2));
+  SpaceSharedPtr<double> l2_space(new L2Space<double>(mesh, 1));
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    h1_space->set_element_order(e->id, 1 + e->id % 4);
+    l2_space->set_element_order(e->id, e->id % 3);
+  }
+  h1_space->assign_dofs();
+  l2_space->assign_dofs();
+
+  std::vector<double> coeffs(h1_space->get_num_dofs());
+  for (unsigned int i = 0; i < coeffs.size(); i++)
+    coeffs[i] = std::sin(0.37 * i);
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(&coeffs[0], h1_space, sln);
+
+  Checkpoint<double> checkpoint;
+  checkpoint.save(FILENAME, { mesh }, { h1_space, l2_space }, { sln });
+
+  // Round trip.
+  checkpoint.open(FILENAME);
+  MeshSharedPtr loaded_mesh = checkpoint.load_mesh(0);
+  int mesh_differences = compare_meshes(mesh, loaded_mesh);
+  std::cout << "Mesh: " << mesh_differences << " differences." << std::endl;
+  differences += mesh_differences;
+
+  SpaceSharedPtr<double> loaded_h1_space = checkpoint.load_space(0, &bcs);
+  SpaceSharedPtr<double> loaded_l2_space = checkpoint.load_space(1);
+  int space_differences = compare_spaces(h1_space, loaded_h1_space) + compare_spaces(l2_space, loaded_l2_space);
+  std::cout << "Spaces: " << space_differences << " differences." << std::endl;
+  differences += space_differences;
+  if (loaded_h1_space->get_mesh() != loaded_mesh)
+  {
+    std::cout << "The loaded space does not share the loaded mesh." << std::endl;
+    differences++;
+  }
+
+  // The loaded space has to give the same solution for the same coefficients.
+  MeshFunctionSharedPtr<double> loaded_sln = checkpoint.load_solution(0);
+  MeshFunctionSharedPtr<double> sln_of_loaded_space(new Solution<double>);
+  Solution<double>::vector_to_solution(&coeffs[0], loaded_h1_space, sln_of_loaded_space);
+  double solution_difference = std::max(compare_solutions(sln, loaded_sln), compare_solutions(sln, sln_of_loaded_space));
+  std::cout << "Solutions: maximum difference " << solution_difference << "." << std::endl;
+  if (solution_difference > 0.)
+    differences++;
+
+  // Further refinements reuse the unused ids in the same order.
+  mesh->refine_element_id(mesh->get_max_element_id() - 1);
+  loaded_mesh->refine_element_id(loaded_mesh->get_max_element_id() - 1);
+  mesh->refine_all_elements();
+  loaded_mesh->refine_all_elements();
+  int refinement_differences = compare_meshes(mesh, loaded_mesh);
+  std::cout << "Refined further: " << refinement_differences << " differences." << std::endl;
+  differences += refinement_differences;
+
+  // Different boundary conditions.
+  bool space_refused = false;
+  try
+  {
+    checkpoint.load_space(0);
+  }
+  catch (Hermes::Exceptions::Exception&)
+  {
+    space_refused = true;
+  }
+  checkpoint.close();
+
+  // Corrupted files.
+  std::vector<char> data = read_file(FILENAME);
+  int max_node_id;
+  unsigned int unused_node_count;
+  memcpy(&max_node_id, &data[HEADER_SIZE], sizeof(int));
+  memcpy(&unused_node_count, &data[HEADER_SIZE + 9 * sizeof(int)], sizeof(int));
+  size_t first_vertex_position = HEADER_SIZE + MESH_RECORD_SIZE + max_node_id * NODE_RECORD_SIZE + unused_node_count * sizeof(int) + 2 * sizeof(int);
+
+  std::vector<char> corrupted = data;
+  bool truncated_refused = refused(data, data.size() / 2, true);
+  int huge_count = 0x7fffffff;
+  memcpy(&corrupted[HEADER_SIZE], &huge_count, sizeof(int));
+  bool count_refused = refused(corrupted, corrupted.size(), false);
+  corrupted = data;
+  int invalid_vertex = max_node_id + 5;
+  memcpy(&corrupted[first_vertex_position], &invalid_vertex, sizeof(int));
+  bool vertex_refused = refused(corrupted, corrupted.size(), false);
+  bool checksum_refused = refused(corrupted, corrupted.size(), true);
+  remove(FILENAME);
+  remove(CORRUPTED_FILENAME);
+
+  std::cout << "Refused: space " << space_refused << ", truncated file " << truncated_refused << ", node count " << count_refused
+    << ", vertex id " << vertex_refused << ", checksum " << checksum_refused << "." << std::endl;
+  if (!space_refused || !truncated_refused || !count_refused || !vertex_refused || !checksum_refused)
+    differences++;
+
+  if (differences)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test compares the fused evaluation of trees of simple filters with the evaluation of the same trees
+//  where every filter precalculates its own values.
+//
+//  - Three solutions on domain.mesh (triangles and quads, curved edges), of different orders.
+//  - Trees: MagFilter of two DiffFilters sharing a solution, and a DiffFilter of a DiffFilter (two levels).
+//  - The values of the fused and of the unfused trees are compared in all active elements and in their first
+//    sons (sub-element transformations), for several quadrature orders. They must be the same.
+
+// Number of initial refinements of domain.mesh.
+const int INIT_REF_NUM = 2;
+// Quadrature orders of the comparison.
+const int ORDERS[] = { 1, 4, 9 };
+
+// DiffFilter precalculated into its own tables, not as a part of the tree of its parent filter.
+class UnfusedDiffFilter : public DiffFilter<double>
+{
+public:
+  UnfusedDiffFilter(std::vector<MeshFunctionSharedPtr<double> > solutions) : DiffFilter<double>(solutions)
+  {
+  }
+
+protected:
+  virtual bool is_fusable() const
+  {
+    return false;
+  }
+};
+
+static MeshFunctionSharedPtr<double> create_solution(SpaceSharedPtr<double> space, double frequency)
+{
+  std::vector<double> coeffs(space->get_num_dofs());
+  for (unsigned int i = 0; i < coeffs.size(); i++)
+    coeffs[i] = std::sin(frequency * (i + 1));
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(&coeffs[0], space, sln);
+  return sln;
+}
+
+// Returns the maximum difference of the values of the filters in the current element (and transformation).
+static double compare_values(MeshFunction<double>* fused, MeshFunction<double>* unfused, Element* e)
+{
+  double difference = 0.;
+  for (unsigned int i = 0; i < sizeof(ORDERS) / sizeof(int); i++)
+  {
+    fused->set_quad_order(ORDERS[i], H2D_FN_VAL);
+    unfused->set_quad_order(ORDERS[i], H2D_FN_VAL);
+    const double* fused_values = fused->get_fn_values();
+    const double* unfused_values = unfused->get_fn_values();
+    int np = fused->get_quad_2d()->get_num_points(ORDERS[i], e->get_mode());
+    for (int j = 0; j < np; j++)
+      difference = std::max(difference, std::abs(fused_values[j] - unfused_values[j]));
+  }
+  return difference;
+}
+
+// Returns the maximum difference of the values of the filters on the mesh.
+static double compare_filters(MeshSharedPtr mesh, MeshFunction<double>* fused, MeshFunction<double>* unfused)
+{
+  double difference = 0.;
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    fused->set_active_element(e);
+    unfused->set_active_element(e);
+    difference = std::max(difference, compare_values(fused, unfused, e));
+
+    fused->push_transform(0);
+    unfused->push_transform(0);
+    difference = std::max(difference, compare_values(fused, unfused, e));
+    fused->pop_transform();
+    unfused->pop_transform();
+  }
+  return difference;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh->refine_all_elements();
+
+  SpaceSharedPtr<double> space(new H1Space<double>(mesh, 3));
+  SpaceSharedPtr<double> space_4(new H1Space<double>(mesh, 4));
+  MeshFunctionSharedPtr<double> u1 = create_solution(space, 0.37);
+  MeshFunctionSharedPtr<double> u2 = create_solution(space_4, 0.71);
+  MeshFunctionSharedPtr<double> u3 = create_solution(space, 1.13);
+
+  // MagFilter of DiffFilters.
+  MeshFunctionSharedPtr<double> fused_diff_12(new DiffFilter<double>({ u1, u2 }));
+  MeshFunctionSharedPtr<double> fused_diff_23(new DiffFilter<double>({ u2, u3 }));
+  MagFilter<double> fused_mag({ fused_diff_12, fused_diff_23 }, { H2D_FN_VAL, H2D_FN_VAL });
+  MeshFunctionSharedPtr<double> unfused_diff_12(new UnfusedDiffFilter({ u1, u2 }));
+  MeshFunctionSharedPtr<double> unfused_diff_23(new UnfusedDiffFilter({ u2, u3 }));
+  MagFilter<double> unfused_mag({ unfused_diff_12, unfused_diff_23 }, { H2D_FN_VAL, H2D_FN_VAL });
+  double mag_difference = compare_filters(mesh, &fused_mag, &unfused_mag);
+  std::cout << "MagFilter of DiffFilters: maximum difference " << mag_difference << "." << std::endl;
+
+  // DiffFilter of a DiffFilter.
+  DiffFilter<double> fused_diff({ fused_diff_12, u3 });
+  UnfusedDiffFilter unfused_diff({ unfused_diff_12, u3 });
+  double diff_difference = compare_filters(mesh, &fused_diff, &unfused_diff);
+  std::cout << "DiffFilter of a DiffFilter: maximum difference " << diff_difference << "." << std::endl;
+
+  if (mag_difference > 0. || diff_difference > 0.)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,225 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D;
+
+//  This test checks DualWeightedResidualErrorCalculator on the Poisson problem -Laplace u = f in the unit square,
+//  u = 0 on the boundary, with the known solution u = sin(pi x) sin(pi y), and the goal functional J(v) = int v,
+//  J(u) = 4 / pi^2.
+//
+//  - The coarse space is contained in the reference one, so the estimate (the sum of the signed indicators) has to
+//    be J(u_ref) - J(u_coarse) up to the round-off.
+//  - The reference solution is much more accurate than the coarse one, so the estimate has to be close to the true
+//    error J(u) - J(u_coarse).
+//  - The adjoint vector from the transposed solve reusing the factorization (LinearMatrixSolver::solve_transposed())
+//    has to solve A^T z = j, and it has to be the same as the solution with the explicitly transposed matrix.
+//  - The solution vector of the reference solver has to be left untouched.
+
+// Number of cells in either direction.
+const int N = 4;
+// Polynomial degree of the coarse space.
+const int P_INIT = 2;
+// Tolerated relative round-off.
+const double TOLERANCE = 1e-10;
+// Tolerated deviation of the effectivity index (estimate / true error) from 1.
+const double EFFECTIVITY_TOLERANCE = 0.1;
+
+// Right-hand side for u = sin(pi x) sin(pi y).
+class CustomRightHandSide : public Hermes2DFunction<double>
+{
+public:
+  CustomRightHandSide() : Hermes2DFunction<double>()
+  {
+  }
+
+  virtual double value(double x, double y) const
+  {
+    return 2. * M_PI * M_PI * std::sin(M_PI * x) * std::sin(M_PI * y);
+  }
+
+  virtual Ord value(Ord x, Ord y) const
+  {
+    return Ord(10);
+  }
+};
+
+class CustomWeakFormPoisson : public WeakForm < double >
+{
+public:
+  CustomWeakFormPoisson() : WeakForm<double>(1)
+  {
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormDiffusion<double>(0, 0));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(0, HERMES_ANY, new CustomRightHandSide));
+  }
+};
+
+// J(v) = int v.
+class CustomGoal : public WeakForm < double >
+{
+public:
+  CustomGoal() : WeakForm<double>(1)
+  {
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(1.0)));
+  }
+};
+
+// Access to the adjoint vector.
+class TestedErrorCalculator : public DualWeightedResidualErrorCalculator < double >
+{
+public:
+  TestedErrorCalculator(WeakFormSharedPtr<double> goal_wf) : DualWeightedResidualErrorCalculator<double>(goal_wf)
+  {
+  }
+
+  const double* get_adjoint_vector() const
+  {
+    return this->adjoint_vector;
+  }
+};
+
+static MeshSharedPtr create_mesh()
+{
+  std::vector<double> verts;
+  for (int j = 0; j <= N; j++)
+  {
+    for (int i = 0; i <= N; i++)
+    {
+      verts.push_back(i / (double)N);
+      verts.push_back(j / (double)N);
+    }
+  }
+
+  std::vector<int> quads;
+  for (int j = 0; j < N; j++)
+  {
+    for (int i = 0; i < N; i++)
+    {
+      int quad[4] = { j * (N + 1) + i, j * (N + 1) + i + 1, (j + 1) * (N + 1) + i + 1, (j + 1) * (N + 1) + i };
+      quads.insert(quads.end(), quad, quad + 4);
+    }
+  }
+  std::vector<std::string> quad_markers(N * N, "Domain");
+
+  std::vector<int> mark;
+  std::vector<std::string> boundary_markers;
+  for (int i = 0; i < N; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (N + 1) + N, (i + 1) * (N + 1) + N }, { N * (N + 1) + i, N * (N + 1) + i + 1 }, { i * (N + 1), (i + 1) * (N + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      mark.insert(mark.end(), edges[k], edges[k] + 2);
+      boundary_markers.push_back("Boundary");
+    }
+  }
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(verts.size() / 2, (double2*)&verts[0], 0, nullptr, nullptr, N * N, (int4*)&quads[0], &quad_markers[0],
+    boundary_markers.size(), (int2*)&mark[0], &boundary_markers[0]);
+  return mesh;
+}
+
+// The goal vector j on the space.
+static std::vector<double> assemble_goal(SpaceSharedPtr<double> space)
+{
+  SimpleVector<double> goal_rhs;
+  DiscreteProblem<double> dp(WeakFormSharedPtr<double>(new CustomGoal), space, true);
+  dp.assemble(&goal_rhs);
+  return std::vector<double>(goal_rhs.v, goal_rhs.v + space->get_num_dofs());
+}
+
+static double dot(const std::vector<double>& a, const double* b)
+{
+  double result = 0.;
+  for (size_t i = 0; i < a.size(); i++)
+    result += a[i] * b[i];
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr mesh = create_mesh();
+  DefaultEssentialBCConst<double> bc_essential("Boundary", 0.0);
+  EssentialBCs<double> bcs(&bc_essential);
+  SpaceSharedPtr<double> space(new H1Space<double>(mesh, &bcs, P_INIT));
+  WeakFormSharedPtr<double> wf(new CustomWeakFormPoisson);
+
+  LinearSolver<double> coarse_solver(wf, space);
+  coarse_solver.solve();
+  MeshFunctionSharedPtr<double> coarse_sln(new Solution<double>);
+  Solution<double>::vector_to_solution(coarse_solver.get_sln_vector(), space, coarse_sln);
+  double coarse_goal = dot(assemble_goal(space), coarse_solver.get_sln_vector());
+
+  Mesh::ReferenceMeshCreator ref_mesh_creator(mesh);
+  MeshSharedPtr ref_mesh = ref_mesh_creator.create_ref_mesh();
+  Space<double>::ReferenceSpaceCreator ref_space_creator(space, ref_mesh);
+  SpaceSharedPtr<double> ref_space = ref_space_creator.create_ref_space();
+  int ndof = ref_space->get_num_dofs();
+
+  LinearSolver<double> ref_solver(wf, ref_space);
+  ref_solver.solve();
+  MeshFunctionSharedPtr<double> ref_sln(new Solution<double>);
+  Solution<double>::vector_to_solution(ref_solver.get_sln_vector(), ref_space, ref_sln);
+  std::vector<double> ref_sln_vector(ref_solver.get_sln_vector(), ref_solver.get_sln_vector() + ndof);
+  std::vector<double> goal = assemble_goal(ref_space);
+  double ref_goal = dot(goal, ref_solver.get_sln_vector());
+
+  TestedErrorCalculator error_calculator(WeakFormSharedPtr<double>(new CustomGoal));
+  error_calculator.calculate_errors(coarse_sln, ref_sln, &ref_solver);
+  double estimate = error_calculator.get_goal_error_estimate();
+  double true_error = 4. / (M_PI * M_PI) - coarse_goal;
+  double estimate_difference = std::abs(estimate - (ref_goal - coarse_goal)) / std::abs(ref_goal);
+  double effectivity = estimate / true_error;
+  std::cout << "Ndofs: " << space->get_num_dofs() << " / " << ndof << ", J(u) - J(u_coarse): " << true_error << ", estimate: " << estimate
+    << ", effectivity: " << effectivity << ", relative difference from J(u_ref) - J(u_coarse): " << estimate_difference << std::endl;
+
+  // The adjoint vector solves A^T z = j.
+  CSCMatrix<double>* matrix = dynamic_cast<CSCMatrix<double>*>(ref_solver.get_jacobian());
+  const double* adjoint = error_calculator.get_adjoint_vector();
+  double adjoint_residual = 0., goal_norm = 0.;
+  for (int j = 0; j < ndof; j++)
+  {
+    // Column j of A is the row j of A^T.
+    double value = 0.;
+    for (int k = matrix->get_Ap()[j]; k < matrix->get_Ap()[j + 1]; k++)
+      value += matrix->get_Ax()[k] * adjoint[matrix->get_Ai()[k]];
+    adjoint_residual = std::max(adjoint_residual, std::abs(value - goal[j]));
+    goal_norm = std::max(goal_norm, std::abs(goal[j]));
+  }
+  adjoint_residual /= goal_norm;
+
+  // The same system with the explicitly transposed matrix.
+  CSCMatrix<double>* transposed_matrix = static_cast<CSCMatrix<double>*>(matrix->duplicate());
+  transposed_matrix->switch_orientation();
+  SimpleVector<double> transposed_rhs(ndof);
+  transposed_rhs.set_vector(&goal[0]);
+  Solvers::LinearMatrixSolver<double>* transposed_solver = Solvers::create_linear_solver<double>(transposed_matrix, &transposed_rhs, true);
+  transposed_solver->solve();
+  double adjoint_difference = 0., adjoint_norm = 0.;
+  for (int i = 0; i < ndof; i++)
+  {
+    adjoint_difference = std::max(adjoint_difference, std::abs(adjoint[i] - transposed_solver->get_sln_vector()[i]));
+    adjoint_norm = std::max(adjoint_norm, std::abs(adjoint[i]));
+  }
+  adjoint_difference /= adjoint_norm;
+  delete transposed_solver;
+  delete transposed_matrix;
+
+  int changed_entries = 0;
+  for (int i = 0; i < ndof; i++)
+    if (ref_solver.get_sln_vector()[i] != ref_sln_vector[i])
+      changed_entries++;
+
+  std::cout << "Adjoint: relative residual " << adjoint_residual << ", relative difference from the transposed matrix solve " << adjoint_difference
+    << ", changed entries of the reference solution: " << changed_entries << std::endl;
+
+  if (estimate_difference > TOLERANCE || std::abs(effectivity - 1.) > EFFECTIVITY_TOLERANCE || adjoint_residual > TOLERANCE
+    || adjoint_difference > TOLERANCE || changed_entries)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
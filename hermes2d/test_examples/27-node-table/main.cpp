@@ -0,0 +1,220 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test checks the open-addressing node tables of HashTable (the base class of Mesh).
+//
+//  - NodeTable alone: random insertions and removals (removals shift the following keys back) starting from a small
+//    table, so that it has to grow several times. Every key has to be found with its id, removed keys must not be found.
+//  - Mesh: refinements and unrefinements of domain.mesh (triangles and quads, curved edges). Every node has to be
+//    found by its parents (also in a copy of the mesh), the node ids have to be the ones assigned with the previous
+//    chained hash lists, and unrefining everything has to restore the initial nodes (some of them with new ids).
+
+// Number of operations of the NodeTable check.
+const int OPERATION_COUNT = 200000;
+// Initial size of the NodeTable.
+const int INITIAL_SIZE = 16;
+
+// Checksums of the nodes (see nodes_checksum()) after the steps of the mesh check, obtained with the previous
+// chained hash lists.
+const unsigned long long EXPECTED_CHECKSUMS[4] = { 13489210437282513054ULL, 585723800816740633ULL, 7271241488966262228ULL, 2451698429453384542ULL };
+
+// Access to the node tables.
+class TestedHashTable : public HashTable
+{
+public:
+  typedef HashTable::NodeTable Table;
+};
+
+// Deterministic pseudo-random numbers.
+static unsigned int random_number(unsigned int& seed)
+{
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7fff;
+}
+
+// Returns the number of keys of the reference with a different (or missing) id in the table.
+static int compare_table(const TestedHashTable::Table& table, const std::map<std::pair<int, int>, int>& reference)
+{
+  int differences = 0;
+  for (std::map<std::pair<int, int>, int>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+    if (table.find(it->first.first, it->first.second) != it->second)
+      differences++;
+  return differences;
+}
+
+// Returns the number of failed checks.
+static int check_node_table()
+{
+  TestedHashTable::Table table;
+  table.init(INITIAL_SIZE);
+  std::map<std::pair<int, int>, int> reference;
+
+  int failures = 0;
+  unsigned int seed = 1;
+  for (int i = 0; i < OPERATION_COUNT; i++)
+  {
+    // Narrow key range - long probe sequences and many removals of present keys.
+    int p1 = random_number(seed) % 512;
+    int p2 = p1 + 1 + random_number(seed) % 64;
+    std::pair<int, int> key(p1, p2);
+    bool present = reference.find(key) != reference.end();
+
+    if (random_number(seed) % 3 && !present)
+    {
+      table.insert(p1, p2, i);
+      reference[key] = i;
+    }
+    else if (present)
+    {
+      table.remove(p1, p2, reference[key]);
+      reference.erase(key);
+      if (table.find(p1, p2) != -1)
+        failures++;
+    }
+
+    if (4 * (int)reference.size() > 3 * table.get_size())
+      failures++;
+
+    if (i % 10000 == 0)
+      failures += compare_table(table, reference);
+  }
+  failures += compare_table(table, reference);
+
+  // The table has grown.
+  if (table.get_size() <= INITIAL_SIZE)
+    failures++;
+
+  // A copy, then removal of everything.
+  TestedHashTable::Table copied_table;
+  copied_table.copy(table);
+  failures += compare_table(copied_table, reference);
+  for (std::map<std::pair<int, int>, int>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+    copied_table.remove(it->first.first, it->first.second, it->second);
+  for (std::map<std::pair<int, int>, int>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+    if (copied_table.find(it->first.first, it->first.second) != -1)
+      failures++;
+
+  std::cout << "NodeTable: " << reference.size() << " keys, size " << table.get_size() << ", failed checks: " << failures << std::endl;
+  return failures;
+}
+
+// FNV-1a over the ids, types and parents of the used nodes.
+static unsigned long long nodes_checksum(MeshSharedPtr mesh)
+{
+  unsigned long long checksum = 14695981039346656037ULL;
+  for (int i = 0; i < mesh->get_max_node_id(); i++)
+  {
+    Node* node = mesh->get_node(i);
+    if (!node->used)
+      continue;
+    int values[4] = { node->id, (int)node->type, node->p1, node->p2 };
+    for (int j = 0; j < 4; j++)
+    {
+      checksum ^= (unsigned int)values[j];
+      checksum *= 1099511628211ULL;
+    }
+  }
+  return checksum;
+}
+
+// Sorted types and parents of the used nodes.
+static std::vector<std::pair<int, std::pair<int, int> > > node_keys(MeshSharedPtr mesh)
+{
+  std::vector<std::pair<int, std::pair<int, int> > > keys;
+  for (int i = 0; i < mesh->get_max_node_id(); i++)
+  {
+    Node* node = mesh->get_node(i);
+    if (node->used)
+      keys.push_back(std::make_pair((int)node->type, std::make_pair(node->p1, node->p2)));
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+// Returns the number of nodes with parents which are not found by them.
+static int check_node_search(MeshSharedPtr mesh)
+{
+  int failures = 0;
+  for (int i = 0; i < mesh->get_max_node_id(); i++)
+  {
+    Node* node = mesh->get_node(i);
+    if (!node->used || node->p1 < 0)
+      continue;
+    Node* found = (node->type == HERMES_TYPE_VERTEX) ? mesh->peek_vertex_node(node->p1, node->p2) : mesh->peek_edge_node(node->p1, node->p2);
+    if (found != node)
+      failures++;
+  }
+  return failures;
+}
+
+// Returns the number of failed checks.
+static int check_mesh()
+{
+  MeshSharedPtr mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", mesh);
+  std::vector<std::pair<int, std::pair<int, int> > > initial_keys = node_keys(mesh);
+
+  int failures = 0;
+  unsigned long long checksums[4];
+
+  // Three levels, anisotropic refinements of quads on the last one.
+  mesh->refine_all_elements();
+  mesh->refine_all_elements();
+  mesh->refine_all_elements(1);
+  failures += check_node_search(mesh);
+  checksums[0] = nodes_checksum(mesh);
+
+  // Unrefinement of one level and a different refinement of it, the freed node ids are reused.
+  mesh->unrefine_all_elements();
+  failures += check_node_search(mesh);
+  mesh->refine_all_elements(2);
+  mesh->refine_element_id(mesh->get_max_element_id() - 1);
+  failures += check_node_search(mesh);
+  checksums[1] = nodes_checksum(mesh);
+
+  // A copy.
+  MeshSharedPtr copied_mesh(new Mesh);
+  copied_mesh->copy(mesh);
+  failures += check_node_search(copied_mesh);
+  if (nodes_checksum(copied_mesh) != checksums[1])
+    failures++;
+  copied_mesh->refine_all_elements();
+  failures += check_node_search(copied_mesh);
+  checksums[2] = nodes_checksum(copied_mesh);
+
+  // Back to the initial mesh.
+  mesh->unrefine_all_elements(false);
+  mesh->unrefine_all_elements(false);
+  mesh->unrefine_all_elements(false);
+  mesh->unrefine_all_elements(false);
+  failures += check_node_search(mesh);
+  if (node_keys(mesh) != initial_keys)
+    failures++;
+  checksums[3] = nodes_checksum(mesh);
+
+  for (int i = 0; i < 4; i++)
+  {
+    std::cout << "Mesh: checksum " << i << ": " << checksums[i] << (checksums[i] == EXPECTED_CHECKSUMS[i] ? "" : " (unexpected)") << std::endl;
+    if (checksums[i] != EXPECTED_CHECKSUMS[i])
+      failures++;
+  }
+  std::cout << "Mesh: failed checks: " << failures << std::endl;
+  return failures;
+}
+
+int main(int argc, char* argv[])
+{
+  int failures = check_node_table() + check_mesh();
+
+  if (failures)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
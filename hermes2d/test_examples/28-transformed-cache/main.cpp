@@ -0,0 +1,145 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D;
+
+//  This test checks the cache of shape function values on sub-elements (PrecalcShapesetTransformedCache) shared by
+//  the threads of multi-mesh assembling.
+//
+//  - The sub-element transformations of the multi-mesh traversal of a coarse and a fine mesh (domain.mesh - triangles
+//    and quads, curved edges) are replayed by several threads at once, each starting at a different state. Every
+//    value and derivative obtained through PrecalcShapesetAssembling (from the cache, or computed and stored) has to be
+//    the same as the one computed by a plain PrecalcShapeset. The number of the combinations of shape functions,
+//    orders and transformations is far above the capacity of the cache, so that the entries are constantly replaced.
+//  - A coupled system with the two components on the two meshes is assembled with one and with several threads,
+//    the matrices have to be the same up to the round-off.
+
+// Number of threads.
+const int THREAD_COUNT = 4;
+// Number of passes over the states - the first one mostly fills the cache, the other ones mostly read it.
+const int PASS_COUNT = 2;
+// Quadrature orders of the comparison.
+const unsigned short ORDERS[] = { 2, 5, 10 };
+// Tolerated relative round-off in the assembled matrices.
+const double TOLERANCE = 1e-12;
+
+class CustomWeakFormCoupled : public WeakForm < double >
+{
+public:
+  CustomWeakFormCoupled() : WeakForm<double>(2)
+  {
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormDiffusion<double>(0, 0));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormDiffusion<double>(1, 1));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(0, 1));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(1, 0));
+  }
+};
+
+// Returns the number of values of the shape functions different from the plain PrecalcShapeset ones.
+static int compare_states(Shapeset* shapeset, Traverse::State** states, unsigned int states_count)
+{
+  int differences = 0;
+
+#pragma omp parallel num_threads(THREAD_COUNT) reduction(+:differences)
+  {
+    PrecalcShapesetAssembling cached(shapeset);
+    PrecalcShapeset fresh(shapeset);
+    unsigned int first_state = (states_count / THREAD_COUNT) * omp_get_thread_num();
+
+    for (int pass = 0; pass < PASS_COUNT; pass++)
+    {
+      for (unsigned int i = 0; i < states_count; i++)
+      {
+        Traverse::State* state = states[(first_state + i) % states_count];
+        Element* e = state->e[0];
+        for (int index = 0; index <= shapeset->get_max_index(e->get_mode()); index++)
+        {
+          for (unsigned int order_i = 0; order_i < sizeof(ORDERS) / sizeof(unsigned short); order_i++)
+          {
+            cached.set_active_element(e);
+            cached.set_transform(state->sub_idx[0]);
+            cached.set_active_shape(index);
+            cached.set_quad_order(ORDERS[order_i]);
+            fresh.set_active_element(e);
+            fresh.set_transform(state->sub_idx[0]);
+            fresh.set_active_shape(index);
+            fresh.set_quad_order(ORDERS[order_i]);
+
+            int np = g_quad_2d_std.get_num_points(ORDERS[order_i], e->get_mode());
+            for (unsigned short value = 0; value < 3; value++)
+            {
+              const double* cached_values = cached.get_values(0, value);
+              const double* fresh_values = fresh.get_values(0, value);
+              for (int j = 0; j < np; j++)
+                if (cached_values[j] != fresh_values[j])
+                  differences++;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return differences;
+}
+
+// Returns the maximum relative difference of the matrices assembled with one and with THREAD_COUNT threads.
+static double compare_assembling(std::vector<SpaceSharedPtr<double> > spaces)
+{
+  WeakFormSharedPtr<double> wf(new CustomWeakFormCoupled);
+  CSCMatrix<double> matrices[2];
+  for (int i = 0; i < 2; i++)
+  {
+    HermesCommonApi.set_integral_param_value(numThreads, i == 0 ? 1 : THREAD_COUNT);
+    DiscreteProblem<double> dp(wf, spaces);
+    dp.assemble(&matrices[i]);
+  }
+
+  if (matrices[0].get_nnz() != matrices[1].get_nnz())
+    return 1.;
+  double difference = 0., norm = 0.;
+  for (unsigned int i = 0; i < matrices[0].get_nnz(); i++)
+  {
+    difference = std::max(difference, std::abs(matrices[0].get_Ax()[i] - matrices[1].get_Ax()[i]));
+    norm = std::max(norm, std::abs(matrices[0].get_Ax()[i]));
+  }
+  return difference / norm;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr coarse_mesh(new Mesh), fine_mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", coarse_mesh);
+  coarse_mesh->refine_all_elements();
+  fine_mesh->copy(coarse_mesh);
+  fine_mesh->refine_all_elements();
+  fine_mesh->refine_all_elements(1);
+  fine_mesh->refine_all_elements(2);
+
+  // Sub-element transformations of the coarse elements.
+  MeshSharedPtr meshes[2] = { coarse_mesh, fine_mesh };
+  unsigned int states_count;
+  Traverse trav(2);
+  Traverse::State** states = trav.get_states(meshes, 2, states_count);
+
+  H1ShapesetJacobi shapeset;
+  int differences = compare_states(&shapeset, states, states_count);
+  Traverse::free_states(states);
+  std::cout << "States: " << states_count << ", values different from the plain PrecalcShapeset: " << differences << std::endl;
+
+  SpaceSharedPtr<double> coarse_space(new H1Space<double>(coarse_mesh, 4));
+  SpaceSharedPtr<double> fine_space(new H1Space<double>(fine_mesh, 2));
+  double assembling_difference = compare_assembling({ coarse_space, fine_space });
+  std::cout << "Assembling with " << THREAD_COUNT << " threads: relative difference " << assembling_difference << std::endl;
+
+  if (differences || assembling_difference > TOLERANCE)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
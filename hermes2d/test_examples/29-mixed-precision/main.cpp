@@ -0,0 +1,200 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+using namespace Hermes::Hermes2D;
+
+//  This test checks the mixed-precision solution of MumpsSolver (single precision factorization, iterative refinement
+//  with the residual in double precision) against the double precision solution.
+//
+//  - A well conditioned system (-Laplace u + u = 1 on domain.mesh, cubic elements): the mixed-precision solution has
+//    to satisfy the backward error bound of a double precision solution and the mixed precision has to stay on.
+//  - The Hilbert matrix: the single precision factors are too inaccurate, the refinement stagnates, the system has to
+//    be solved in double precision (the mixed precision stays on for other matrices).
+//  - A matrix with entries below the single precision range: the single precision factorization fails, the system has
+//    to be solved in double precision and the mixed precision has to be switched off.
+//  All the solutions have to satisfy the backward error bound, in the fallback cases they have to be the ones of the
+//  double precision solver.
+//  Without the single precision MUMPS libraries, use_mixed_precision() is ignored and the solutions have to be the
+//  double precision ones.
+
+// Number of initial refinements of domain.mesh.
+const int INIT_REF_NUM = 2;
+// Polynomial degree of the well conditioned system.
+const int P_INIT = 3;
+// Size of the Hilbert matrix.
+const int HILBERT_SIZE = 8;
+// Size of the matrix with tiny entries, and their scale.
+const int TINY_SIZE = 20;
+const double TINY_SCALE = 1e-50;
+// Multiple of the backward error bound sqrt(n) eps (|A| |x| + |b|) tolerated.
+const double BACKWARD_ERROR_FACTOR = 10.;
+// Tolerated relative difference from the double precision solution.
+const double TOLERANCE = 1e-10;
+
+// Access to the mixed-precision setting.
+class TestedMumpsSolver : public MumpsSolver < double >
+{
+public:
+  TestedMumpsSolver(MumpsMatrix<double>* m, SimpleVector<double>* rhs) : MumpsSolver<double>(m, rhs)
+  {
+  }
+
+  bool is_mixed_precision_used() const
+  {
+    return this->mixed_precision;
+  }
+};
+
+class CustomWeakForm : public WeakForm < double >
+{
+public:
+  CustomWeakForm() : WeakForm<double>(1)
+  {
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormDiffusion<double>(0, 0));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(0, 0));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(1.0)));
+  }
+};
+
+// Dense matrix (all entries) with the entries value(i, j).
+static void create_matrix(MumpsMatrix<double>& matrix, SimpleVector<double>& rhs, int size, double(*value)(int, int))
+{
+  matrix.prealloc(size);
+  for (int i = 0; i < size; i++)
+    for (int j = 0; j < size; j++)
+      matrix.pre_add_ij(i, j);
+  matrix.alloc();
+  for (int i = 0; i < size; i++)
+    for (int j = 0; j < size; j++)
+      matrix.add(i, j, value(i, j));
+  matrix.finish();
+
+  // The solution is all ones.
+  rhs.alloc(size);
+  for (int i = 0; i < size; i++)
+  {
+    double row_sum = 0.;
+    for (int j = 0; j < size; j++)
+      row_sum += value(i, j);
+    rhs.set(i, row_sum);
+  }
+}
+
+static double hilbert(int i, int j)
+{
+  return 1. / (i + j + 1);
+}
+
+static double tiny_tridiagonal(int i, int j)
+{
+  if (i == j)
+    return 4. * TINY_SCALE;
+  return (std::abs(i - j) == 1) ? -TINY_SCALE : 0.;
+}
+
+// Returns the backward error ||b - A x|| / (sqrt(n) eps (||A|| ||x|| + ||b||)), in the maximum norms.
+static double backward_error(MumpsMatrix<double>& matrix, SimpleVector<double>& rhs, const double* x)
+{
+  int size = matrix.get_size();
+  std::vector<double> residual(rhs.v, rhs.v + size), row_sums(size, 0.);
+  for (int col = 0; col < size; col++)
+  {
+    for (int k = matrix.get_Ap()[col]; k < matrix.get_Ap()[col + 1]; k++)
+    {
+      double value = matrix.get(matrix.get_Ai()[k], col);
+      residual[matrix.get_Ai()[k]] -= value * x[col];
+      row_sums[matrix.get_Ai()[k]] += std::abs(value);
+    }
+  }
+
+  double residual_norm = 0., matrix_norm = 0., x_norm = 0., rhs_norm = 0.;
+  for (int i = 0; i < size; i++)
+  {
+    residual_norm = std::max(residual_norm, std::abs(residual[i]));
+    matrix_norm = std::max(matrix_norm, row_sums[i]);
+    x_norm = std::max(x_norm, std::abs(x[i]));
+    rhs_norm = std::max(rhs_norm, std::abs(rhs.v[i]));
+  }
+  return residual_norm / (std::sqrt((double)size) * std::numeric_limits<double>::epsilon() * (matrix_norm * x_norm + rhs_norm));
+}
+
+// Solves the system in double precision and with the mixed precision, returns the number of failed checks.
+// \param[in] mixed_precision_kept Whether the mixed precision has to stay on after the solution.
+static int check_solution(const char* name, MumpsMatrix<double>& matrix, SimpleVector<double>& rhs, bool mixed_precision_kept)
+{
+  int size = matrix.get_size();
+  MumpsSolver<double> double_solver(&matrix, &rhs);
+  double_solver.solve();
+  std::vector<double> double_sln(double_solver.get_sln_vector(), double_solver.get_sln_vector() + size);
+
+  TestedMumpsSolver mixed_solver(&matrix, &rhs);
+  mixed_solver.use_mixed_precision();
+  bool supported = mixed_solver.supports_mixed_precision();
+  int failures = 0;
+  // Twice - the second solution reuses the factorization (and the knowledge whether the refinement converges).
+  for (int solution = 0; solution < 2; solution++)
+  {
+    if (solution == 1)
+      mixed_solver.set_reuse_scheme(HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY);
+    mixed_solver.solve();
+
+    double difference = 0., norm = 0.;
+    for (int i = 0; i < size; i++)
+    {
+      difference = std::max(difference, std::abs(mixed_solver.get_sln_vector()[i] - double_sln[i]));
+      norm = std::max(norm, std::abs(double_sln[i]));
+    }
+    double error = backward_error(matrix, rhs, mixed_solver.get_sln_vector());
+    std::cout << name << " (" << size << " unknowns), solution " << solution << ": relative difference from double precision " << difference / norm
+      << ", backward error " << error << ", mixed precision " << (mixed_solver.is_mixed_precision_used() ? "on" : "off") << std::endl;
+
+    if (difference > TOLERANCE * norm)
+      failures++;
+    if (error > BACKWARD_ERROR_FACTOR)
+      failures++;
+    if (mixed_solver.is_mixed_precision_used() != (supported && mixed_precision_kept))
+      failures++;
+  }
+  return failures;
+}
+
+int main(int argc, char* argv[])
+{
+  int failures = 0;
+
+  // Well conditioned system.
+  MeshSharedPtr mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh->refine_all_elements();
+  SpaceSharedPtr<double> space(new H1Space<double>(mesh, P_INIT));
+  MumpsMatrix<double> fem_matrix;
+  SimpleVector<double> fem_rhs;
+  DiscreteProblem<double> dp(WeakFormSharedPtr<double>(new CustomWeakForm), space);
+  dp.assemble(&fem_matrix, &fem_rhs);
+  failures += check_solution("FEM system", fem_matrix, fem_rhs, true);
+
+  // Refinement stagnates.
+  MumpsMatrix<double> hilbert_matrix;
+  SimpleVector<double> hilbert_rhs;
+  create_matrix(hilbert_matrix, hilbert_rhs, HILBERT_SIZE, hilbert);
+  failures += check_solution("Hilbert matrix", hilbert_matrix, hilbert_rhs, true);
+
+  // Single precision factorization fails.
+  MumpsMatrix<double> tiny_matrix;
+  SimpleVector<double> tiny_rhs;
+  create_matrix(tiny_matrix, tiny_rhs, TINY_SIZE, tiny_tridiagonal);
+  failures += check_solution("Tiny entries", tiny_matrix, tiny_rhs, false);
+
+  if (failures)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,319 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+using namespace Hermes::Hermes2D;
+
+//  This test checks the inexact Newton method (NewtonMatrixSolver::use_inexact_newton()) with the Eisenstat-Walker
+//  forcing terms on the nonlinear problem -Laplace u + u^3 = f on domain.mesh (triangles and quads, curved edges),
+//  u = 0 on a part of the boundary, starting from u = 0 (the first steps are damped).
+//
+//  - The linear systems (symmetric positive definite) are solved by the conjugate gradient method of this test,
+//    which stops at the tolerance set to it by the nonlinear solver.
+//  - With both EisenstatWalkerChoice1 and EisenstatWalkerChoice2, the solution has to converge to the one of
+//    the exact Newton method (direct solver), the first forcing term has to be the initial one, the forcing terms
+//    have to decrease as the nonlinear solver converges, and fewer conjugate gradient iterations have to be needed
+//    than with the exact Newton method with the same iterative solver.
+//  - The tolerance of the iterative solver has to be restored when the solving finishes.
+
+// Number of initial refinements of domain.mesh.
+const int INIT_REF_NUM = 2;
+// Polynomial degree of the space.
+const int P_INIT = 3;
+// Right-hand side - large enough for the cubic term to dominate.
+const double F = 50.0;
+// Tolerance of the nonlinear solver (absolute residual norm).
+const double NEWTON_TOLERANCE = 1e-10;
+// Tolerance of the iterative solver for the exact Newton method (relative residual norm).
+const double LINEAR_TOLERANCE = 1e-12;
+// Tolerated relative difference from the solution of the exact Newton method.
+const double TOLERANCE = 1e-8;
+
+// Jacobian of the cubic term: int 3 u^2 w v.
+class CustomJacobianCubic : public MatrixFormVol < double >
+{
+public:
+  CustomJacobianCubic(int i, int j) : MatrixFormVol<double>(i, j)
+  {
+    this->setSymFlag(HERMES_SYM);
+  }
+
+  virtual double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, GeomVol<double> *e, Func<double> **ext) const
+  {
+    double result = 0.;
+    for (int i = 0; i < n; i++)
+      result += wt[i] * 3. * u_ext[0]->val[i] * u_ext[0]->val[i] * u->val[i] * v->val[i];
+    return result;
+  }
+
+  virtual Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, GeomVol<Ord> *e, Func<Ord> **ext) const
+  {
+    return u_ext[0]->val[0] * u_ext[0]->val[0] * u->val[0] * v->val[0];
+  }
+
+  virtual MatrixFormVol<double>* clone() const
+  {
+    return new CustomJacobianCubic(*this);
+  }
+};
+
+// Residual of the cubic term: int u^3 v.
+class CustomResidualCubic : public VectorFormVol < double >
+{
+public:
+  CustomResidualCubic(int i) : VectorFormVol<double>(i)
+  {
+  }
+
+  virtual double value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, GeomVol<double> *e, Func<double> **ext) const
+  {
+    double result = 0.;
+    for (int i = 0; i < n; i++)
+      result += wt[i] * u_ext[0]->val[i] * u_ext[0]->val[i] * u_ext[0]->val[i] * v->val[i];
+    return result;
+  }
+
+  virtual Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, GeomVol<Ord> *e, Func<Ord> **ext) const
+  {
+    return u_ext[0]->val[0] * u_ext[0]->val[0] * u_ext[0]->val[0] * v->val[0];
+  }
+
+  virtual VectorFormVol<double>* clone() const
+  {
+    return new CustomResidualCubic(*this);
+  }
+};
+
+class CustomWeakForm : public WeakForm < double >
+{
+public:
+  CustomWeakForm() : WeakForm<double>(1)
+  {
+    this->add_matrix_form(new WeakFormsH1::DefaultJacobianDiffusion<double>(0, 0));
+    this->add_matrix_form(new CustomJacobianCubic(0, 0));
+    this->add_vector_form(new WeakFormsH1::DefaultResidualDiffusion<double>(0));
+    this->add_vector_form(new CustomResidualCubic(0));
+    this->add_vector_form(new WeakFormsH1::DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(-F)));
+  }
+};
+
+// Jacobi preconditioned conjugate gradient method, records the relative tolerances it is given.
+class CGSolver : public LoopSolver < double >
+{
+public:
+  CGSolver(SparseMatrix<double>* matrix, Vector<double>* rhs) : LoopSolver<double>(matrix, rhs), total_iters(0), num_iters(0), residual_norm(0.)
+  {
+  }
+
+  virtual ~CGSolver()
+  {
+    free();
+  }
+
+  virtual void free()
+  {
+    free_with_check(this->sln);
+  }
+
+  virtual void solve()
+  {
+    solve(nullptr);
+  }
+
+  virtual void solve(double* initial_guess)
+  {
+    CSCMatrix<double>* matrix = dynamic_cast<CSCMatrix<double>*>(this->general_matrix);
+    int size = matrix->get_size();
+    std::vector<double> b(size), diagonal(size, 1.), r(size), z(size), p(size);
+    double* q = malloc_with_check<double>(size);
+    this->general_rhs->extract(&b[0]);
+    for (int col = 0; col < size; col++)
+      for (int k = matrix->get_Ap()[col]; k < matrix->get_Ap()[col + 1]; k++)
+        if (matrix->get_Ai()[k] == col)
+          diagonal[col] = matrix->get_Ax()[k];
+
+    free_with_check(this->sln);
+    this->sln = calloc_with_check<double>(size);
+    if (initial_guess)
+      memcpy(this->sln, initial_guess, size * sizeof(double));
+
+    matrix->multiply_with_vector(this->sln, q, true);
+    double rhs_norm = 0., rz = 0.;
+    for (int i = 0; i < size; i++)
+    {
+      r[i] = b[i] - q[i];
+      z[i] = p[i] = r[i] / diagonal[i];
+      rhs_norm += b[i] * b[i];
+      rz += r[i] * z[i];
+    }
+    rhs_norm = std::sqrt(rhs_norm);
+    double stop = (this->toleranceType == RelativeTolerance) ? this->tolerance * rhs_norm : this->tolerance;
+    if (this->toleranceType == RelativeTolerance)
+      used_tolerances.push_back(this->tolerance);
+
+    this->num_iters = 0;
+    this->residual_norm = norm(r);
+    while (this->residual_norm > stop)
+    {
+      if (this->num_iters++ == this->max_iters)
+      {
+        free_with_check(q);
+        throw Exceptions::LinearMatrixSolverException("CGSolver: no convergence.");
+      }
+      matrix->multiply_with_vector(&p[0], q, true);
+      double pq = 0.;
+      for (int i = 0; i < size; i++)
+        pq += p[i] * q[i];
+      double alpha = rz / pq, rz_new = 0.;
+      for (int i = 0; i < size; i++)
+      {
+        this->sln[i] += alpha * p[i];
+        r[i] -= alpha * q[i];
+        z[i] = r[i] / diagonal[i];
+        rz_new += r[i] * z[i];
+      }
+      for (int i = 0; i < size; i++)
+        p[i] = z[i] + (rz_new / rz) * p[i];
+      rz = rz_new;
+      this->residual_norm = norm(r);
+    }
+    this->total_iters += this->num_iters;
+    free_with_check(q);
+  }
+
+  virtual int get_matrix_size()
+  {
+    return this->general_matrix->get_size();
+  }
+
+  virtual int get_num_iters()
+  {
+    return this->num_iters;
+  }
+
+  virtual double get_residual_norm()
+  {
+    return this->residual_norm;
+  }
+
+  // Relative tolerances of the solves.
+  std::vector<double> used_tolerances;
+  // Iterations of all the solves.
+  int total_iters;
+
+protected:
+  static double norm(const std::vector<double>& v)
+  {
+    double result = 0.;
+    for (size_t i = 0; i < v.size(); i++)
+      result += v[i] * v[i];
+    return std::sqrt(result);
+  }
+
+  int num_iters;
+  double residual_norm;
+};
+
+// Newton solver with the linear systems solved by CGSolver.
+class CGNewtonSolver : public NewtonSolver < double >
+{
+public:
+  CGNewtonSolver(WeakFormSharedPtr<double> wf, SpaceSharedPtr<double> space) : NewtonSolver<double>(wf, space)
+  {
+    CGSolver* cg_solver = new CGSolver(this->linear_matrix_solver->get_matrix(), this->linear_matrix_solver->get_rhs());
+    delete this->linear_matrix_solver;
+    this->linear_matrix_solver = cg_solver;
+    cg_solver->set_tolerance(LINEAR_TOLERANCE, RelativeTolerance);
+  }
+
+  CGSolver* get_cg_solver()
+  {
+    return static_cast<CGSolver*>(this->linear_matrix_solver);
+  }
+};
+
+static double relative_difference(const double* sln, const std::vector<double>& reference)
+{
+  double difference = 0., norm = 0.;
+  for (size_t i = 0; i < reference.size(); i++)
+  {
+    difference = std::max(difference, std::abs(sln[i] - reference[i]));
+    norm = std::max(norm, std::abs(reference[i]));
+  }
+  return difference / norm;
+}
+
+// Solves the problem with the iterative solver, returns the number of failed checks.
+// \param[in] exact_cg_iters The iterations of the iterative solver in the exact Newton method (with InexactNewtonOff).
+// \param[out] cg_iters The iterations of the iterative solver.
+static int check_solution(const char* name, WeakFormSharedPtr<double> wf, SpaceSharedPtr<double> space, InexactNewtonForcingTerm forcing_term,
+  const std::vector<double>& exact_sln, int exact_cg_iters, int& cg_iters)
+{
+  CGNewtonSolver newton(wf, space);
+  newton.set_verbose_output(false);
+  newton.set_tolerance(NEWTON_TOLERANCE, ResidualNormAbsolute);
+  if (forcing_term != InexactNewtonOff)
+    newton.use_inexact_newton(forcing_term);
+  newton.solve();
+
+  CGSolver* cg_solver = newton.get_cg_solver();
+  double difference = relative_difference(newton.get_sln_vector(), exact_sln);
+  const std::vector<double>& tolerances = cg_solver->used_tolerances;
+  std::cout << name << ": Newton iterations " << newton.get_num_iters() << ", CG iterations " << cg_solver->total_iters
+    << ", relative difference from the exact Newton method " << difference << ", linear tolerances";
+  for (size_t i = 0; i < tolerances.size(); i++)
+    std::cout << " " << tolerances[i];
+  std::cout << std::endl;
+
+  int failures = 0;
+  if (difference > TOLERANCE)
+    failures++;
+  if (cg_solver->get_tolerance() != LINEAR_TOLERANCE || cg_solver->get_tolerance_type() != RelativeTolerance)
+    failures++;
+  if (forcing_term != InexactNewtonOff)
+  {
+    if (tolerances.front() != 0.5 || tolerances.back() >= tolerances.front())
+      failures++;
+    if (cg_solver->total_iters >= exact_cg_iters)
+      failures++;
+  }
+  cg_iters = cg_solver->total_iters;
+  return failures;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh->refine_all_elements();
+
+  DefaultEssentialBCConst<double> bc_essential({ "Bottom", "Inner", "Left" }, 0.0);
+  EssentialBCs<double> bcs(&bc_essential);
+  SpaceSharedPtr<double> space(new H1Space<double>(mesh, &bcs, P_INIT));
+  WeakFormSharedPtr<double> wf(new CustomWeakForm);
+
+  // Exact Newton method.
+  NewtonSolver<double> newton(wf, space);
+  newton.set_verbose_output(false);
+  newton.set_tolerance(NEWTON_TOLERANCE, ResidualNormAbsolute);
+  newton.solve();
+  std::vector<double> exact_sln(newton.get_sln_vector(), newton.get_sln_vector() + space->get_num_dofs());
+  std::cout << "Ndofs: " << space->get_num_dofs() << ", exact Newton method: Newton iterations " << newton.get_num_iters() << std::endl;
+
+  int exact_cg_iters, cg_iters;
+  int failures = check_solution("Exact Newton, CG", wf, space, InexactNewtonOff, exact_sln, 0, exact_cg_iters);
+  failures += check_solution("Eisenstat-Walker choice 1", wf, space, EisenstatWalkerChoice1, exact_sln, exact_cg_iters, cg_iters);
+  failures += check_solution("Eisenstat-Walker choice 2", wf, space, EisenstatWalkerChoice2, exact_sln, exact_cg_iters, cg_iters);
+
+  if (failures)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
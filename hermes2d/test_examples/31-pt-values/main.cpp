@@ -0,0 +1,218 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+//  This test compares the batched evaluation of a solution at physical points (Solution::get_pt_values()) with
+//  the evaluation point by point (Solution::get_pt_value()).
+//
+//  - Meshes: domain.mesh (squares, triangles with curved edges), and a mesh of general straight quads and straight
+//    triangles, both refined. All the ways of mapping the points to the reference domain are used (constant map of
+//    triangles and parallelograms, Newton's method for the bilinear map of quads, RefMap for curved elements).
+//  - Random H1 solutions with different orders in the elements.
+//  - Random points in the mesh and a few points outside of it. The values and derivatives have to be those of
+//    get_pt_value() in the element containing the point, the points outside have to be reported and have zero values.
+//    The results with one and with several threads have to be the same.
+
+// Number of the points in the mesh - enough for the batch to be split among the threads.
+const int POINT_COUNT = 4000;
+// Number of the points outside the mesh.
+const int OUTSIDE_POINT_COUNT = 8;
+// Number of threads.
+const int THREAD_COUNT = 4;
+// Number of cells of the created mesh in either direction.
+const int N = 4;
+// Tolerated relative difference from get_pt_value().
+const double TOLERANCE = 1e-10;
+
+// Deterministic pseudo-random numbers in [0, 1).
+static double random_number(unsigned int& seed)
+{
+  seed = seed * 1103515245u + 12345u;
+  return ((seed >> 16) & 0x7fff) / 32768.;
+}
+
+// Perturbed N x N grid in the unit square, quads in the left half, pairs of triangles in the right half.
+static MeshSharedPtr create_mesh()
+{
+  std::vector<double> verts;
+  for (int j = 0; j <= N; j++)
+  {
+    for (int i = 0; i <= N; i++)
+    {
+      verts.push_back(i / (double)N + 0.06 * std::sin(1.7 * i + 2.3 * j));
+      verts.push_back(j / (double)N + 0.06 * std::cos(2.9 * i + 1.1 * j));
+    }
+  }
+
+  std::vector<int> tris, quads;
+  for (int j = 0; j < N; j++)
+  {
+    for (int i = 0; i < N; i++)
+    {
+      int quad[4] = { j * (N + 1) + i, j * (N + 1) + i + 1, (j + 1) * (N + 1) + i + 1, (j + 1) * (N + 1) + i };
+      if (i < N / 2)
+        quads.insert(quads.end(), quad, quad + 4);
+      else
+      {
+        int tri[6] = { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] };
+        tris.insert(tris.end(), tri, tri + 6);
+      }
+    }
+  }
+  std::vector<std::string> tri_markers(tris.size() / 3, "Domain"), quad_markers(quads.size() / 4, "Domain");
+
+  std::vector<int> mark;
+  std::vector<std::string> boundary_markers;
+  for (int i = 0; i < N; i++)
+  {
+    int edges[4][2] = { { i, i + 1 }, { i * (N + 1) + N, (i + 1) * (N + 1) + N }, { N * (N + 1) + i, N * (N + 1) + i + 1 }, { i * (N + 1), (i + 1) * (N + 1) } };
+    for (int k = 0; k < 4; k++)
+    {
+      mark.insert(mark.end(), edges[k], edges[k] + 2);
+      boundary_markers.push_back("Boundary");
+    }
+  }
+
+  MeshSharedPtr mesh(new Mesh);
+  mesh->create(verts.size() / 2, (double2*)&verts[0], tris.size() / 3, (int3*)&tris[0], &tri_markers[0], quads.size() / 4, (int4*)&quads[0],
+    &quad_markers[0], boundary_markers.size(), (int2*)&mark[0], &boundary_markers[0]);
+  return mesh;
+}
+
+// Solution with random coefficients, orders 2 to 5 in the elements.
+static MeshFunctionSharedPtr<double> create_solution(MeshSharedPtr mesh)
+{
+  SpaceSharedPtr<double> space(new H1Space<double>(mesh, 2));
+  Element* e;
+  for_all_active_elements(e, mesh)
+    space->set_element_order(e->id, 2 + e->id % 4);
+  space->assign_dofs();
+
+  unsigned int seed = 7;
+  std::vector<double> coeffs(space->get_num_dofs());
+  for (unsigned int i = 0; i < coeffs.size(); i++)
+    coeffs[i] = random_number(seed) - 0.5;
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(&coeffs[0], space, sln);
+  return sln;
+}
+
+// The active element containing the point (x, y), nullptr if there is none.
+static Element* find_element(MeshSharedPtr mesh, double x, double y)
+{
+  Element* e;
+  for_all_active_elements(e, mesh)
+    if (RefMap::is_element_on_physical_coordinates(e, x, y))
+      return e;
+  return nullptr;
+}
+
+// Returns the number of failed checks.
+static int check_solution(const char* name, MeshSharedPtr mesh)
+{
+  MeshFunctionSharedPtr<double> sln_function = create_solution(mesh);
+  Solution<double>* sln = static_cast<Solution<double>*>(sln_function.get());
+
+  // Random points of the bounding box lying in the mesh, then points to the right of the bounding box.
+  double x_min, y_min, x_max, y_max;
+  mesh->get_bounding_box(x_min, y_min, x_max, y_max);
+  unsigned int seed = 1;
+  std::vector<double> x, y;
+  std::vector<Element*> elements;
+  while ((int)x.size() < POINT_COUNT)
+  {
+    double point_x = x_min + (x_max - x_min) * random_number(seed);
+    double point_y = y_min + (y_max - y_min) * random_number(seed);
+    Element* e = find_element(mesh, point_x, point_y);
+    if (e)
+    {
+      x.push_back(point_x);
+      y.push_back(point_y);
+      elements.push_back(e);
+    }
+  }
+  for (int i = 0; i < OUTSIDE_POINT_COUNT; i++)
+  {
+    x.push_back(x_max + 0.1 * (i + 1));
+    y.push_back(y_min + (y_max - y_min) * random_number(seed));
+    elements.push_back(nullptr);
+  }
+  int count = x.size();
+
+  // One and several threads.
+  std::vector<double> values[2], dx[2], dy[2];
+  std::vector<char> found[2];
+  int found_count[2];
+  for (int i = 0; i < 2; i++)
+  {
+    values[i].resize(count);
+    dx[i].resize(count);
+    dy[i].resize(count);
+    found[i].resize(count);
+    HermesCommonApi.set_integral_param_value(numThreads, i == 0 ? 1 : THREAD_COUNT);
+    found_count[i] = sln->get_pt_values(count, &x[0], &y[0], &values[i][0], &dx[i][0], &dy[i][0], &found[i][0]);
+  }
+
+  int failures = 0;
+  if (found_count[0] != found_count[1] || values[0] != values[1] || dx[0] != dx[1] || dy[0] != dy[1] || found[0] != found[1])
+    failures++;
+
+  if (found_count[1] != POINT_COUNT)
+    failures++;
+
+  double difference = 0., norm = 0.;
+  for (int i = 0; i < count; i++)
+  {
+    Element* e = elements[i];
+    if (!e)
+    {
+      if (found[1][i] || values[1][i] != 0. || dx[1][i] != 0. || dy[1][i] != 0.)
+        failures++;
+      continue;
+    }
+    if (!found[1][i])
+      failures++;
+
+    // get_pt_value() takes the derivatives of the reference mapping from the active element.
+    sln->set_active_element(e);
+    Func<double>* reference = sln->get_pt_value(x[i], y[i], false, e);
+    double point_values[3] = { values[1][i], dx[1][i], dy[1][i] };
+    double reference_values[3] = { reference->val[0], reference->dx[0], reference->dy[0] };
+    for (int k = 0; k < 3; k++)
+    {
+      difference = std::max(difference, std::abs(point_values[k] - reference_values[k]));
+      norm = std::max(norm, std::abs(reference_values[k]));
+    }
+    delete reference;
+  }
+  if (difference > TOLERANCE * norm)
+    failures++;
+
+  std::cout << name << ": " << mesh->get_num_active_elements() << " elements, " << found_count[1] << " of " << count
+    << " points in the mesh, relative difference from get_pt_value() " << difference / norm << ", failed checks: " << failures << std::endl;
+  return failures;
+}
+
+int main(int argc, char* argv[])
+{
+  MeshSharedPtr curved_mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", curved_mesh);
+  curved_mesh->refine_all_elements();
+  curved_mesh->refine_all_elements();
+
+  MeshSharedPtr straight_mesh = create_mesh();
+  straight_mesh->refine_all_elements();
+
+  int failures = check_solution("domain.mesh", curved_mesh) + check_solution("General quads and triangles", straight_mesh);
+
+  if (failures)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
@@ -0,0 +1,227 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D;
+
+//  This test checks the sparse structure (Ap, Ai) built from the added indices by SparseMatrix::compress_structure().
+//
+//  - Random indices (with many duplicities, some columns and rows empty) added one by one and in bulk, few (serial
+//    compression) and many (parallel compression). The structure of CSCMatrix and CSRMatrix has to be the one of
+//    the previous per-column page lists: every column (row) sorted, without duplicities.
+//  - Multi-space problems assembled by DiscreteProblem with one and with several threads (the pairs are generated
+//    by the threads):
+//    - three spaces (H1, H1, L2) on two different meshes with non-symmetric couplings of the spaces,
+//    - two spaces (L2, H1) with a DG form.
+//    The CSC structure has to be the one built with the previous page lists, the CSR structure has to be its transpose
+//    (the same numbers of nonzeros per row).
+
+// Number of threads.
+const int THREAD_COUNT = 4;
+
+// Checksums of the CSC structures of the problems (see structure_checksum()), obtained with the previous page lists.
+const unsigned long long EXPECTED_CHECKSUMS[2] = { 5896664358199340731ULL, 13961500487897786634ULL };
+
+// Deterministic pseudo-random numbers.
+static unsigned int random_number(unsigned int& seed)
+{
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7fff;
+}
+
+// FNV-1a over the size, Ap and Ai.
+static unsigned long long structure_checksum(const CSMatrix<double>& matrix)
+{
+  unsigned long long checksum = 14695981039346656037ULL;
+  std::vector<int> values(1, matrix.get_size());
+  values.insert(values.end(), matrix.get_Ap(), matrix.get_Ap() + matrix.get_size() + 1);
+  values.insert(values.end(), matrix.get_Ai(), matrix.get_Ai() + matrix.get_Ap()[matrix.get_size()]);
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    checksum ^= (unsigned int)values[i];
+    checksum *= 1099511628211ULL;
+  }
+  return checksum;
+}
+
+// Returns the number of segments (columns of CSC, rows of CSR) different from the reference (sorted sets of the indices).
+static int compare_structure(const CSMatrix<double>& matrix, const std::vector<std::set<int> >& reference)
+{
+  int differences = 0;
+  if (matrix.get_size() != reference.size())
+    return 1;
+  for (unsigned int outer = 0; outer < reference.size(); outer++)
+  {
+    std::vector<int> segment(matrix.get_Ai() + matrix.get_Ap()[outer], matrix.get_Ai() + matrix.get_Ap()[outer + 1]);
+    if (segment != std::vector<int>(reference[outer].begin(), reference[outer].end()))
+      differences++;
+  }
+  if (matrix.get_nnz() != (unsigned int)matrix.get_Ap()[matrix.get_size()])
+    differences++;
+  return differences;
+}
+
+// Returns the number of failed checks.
+template<typename MatrixType>
+static int check_random_structure(const char* name, bool by_rows, int size, int count)
+{
+  int failures = 0;
+  for (int threads = 1; threads <= THREAD_COUNT; threads += THREAD_COUNT - 1)
+  {
+    HermesCommonApi.set_integral_param_value(numThreads, threads);
+    MatrixType matrix;
+    matrix.prealloc(size);
+    std::vector<std::set<int> > reference(size);
+
+    // Every tenth row and column stays empty.
+    unsigned int seed = 1;
+    std::vector<uint64_t> bulk;
+    for (int i = 0; i < count; i++)
+    {
+      int row = random_number(seed) % size, col = (row + random_number(seed) % 64) % size;
+      if (row % 10 == 0 || col % 10 == 0)
+        continue;
+      if (i % 2)
+        matrix.pre_add_ij(row, col);
+      else
+        bulk.push_back(SparseMatrix<double>::pack_ij(row, col));
+      reference[by_rows ? row : col].insert(by_rows ? col : row);
+    }
+    matrix.pre_add_ij(bulk.empty() ? nullptr : &bulk[0], bulk.size());
+    matrix.alloc();
+
+    int differences = compare_structure(matrix, reference);
+    std::cout << name << ": size " << size << ", " << count << " random pairs, nnz " << matrix.get_nnz() << ", " << threads
+      << " thread(s), different segments: " << differences << std::endl;
+    failures += differences;
+  }
+  return failures;
+}
+
+class CustomWeakFormMultiMesh : public WeakForm < double >
+{
+public:
+  CustomWeakFormMultiMesh() : WeakForm<double>(3)
+  {
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormDiffusion<double>(0, 0));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormDiffusion<double>(1, 1));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(2, 2));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(0, 1));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(2, 0));
+  }
+};
+
+// Penalty of the jumps across the inner edges.
+class CustomMatrixFormJump : public MatrixFormDG < double >
+{
+public:
+  CustomMatrixFormJump(int i, int j) : MatrixFormDG<double>(i, j)
+  {
+  }
+
+  template<typename Real>
+  Real jump_product(int n, double *wt, DiscontinuousFunc<Real> *u, DiscontinuousFunc<Real> *v) const
+  {
+    Real result = Real(0);
+    for (int i = 0; i < n; i++)
+      result += wt[i] * (u->fn_central ? u->val[i] : -u->val_neighbor[i]) * (v->fn_central ? v->val[i] : -v->val_neighbor[i]);
+    return result;
+  }
+
+  virtual double value(int n, double *wt, DiscontinuousFunc<double> **u_ext, DiscontinuousFunc<double> *u, DiscontinuousFunc<double> *v,
+    InterfaceGeom<double> *e, DiscontinuousFunc<double> **ext) const
+  {
+    return jump_product<double>(n, wt, u, v);
+  }
+
+  virtual Ord ord(int n, double *wt, DiscontinuousFunc<Ord> **u_ext, DiscontinuousFunc<Ord> *u, DiscontinuousFunc<Ord> *v,
+    InterfaceGeom<Ord> *e, DiscontinuousFunc<Ord> **ext) const
+  {
+    return jump_product<Ord>(n, wt, u, v);
+  }
+
+  virtual MatrixFormDG<double>* clone() const
+  {
+    return new CustomMatrixFormJump(*this);
+  }
+};
+
+class CustomWeakFormDG : public WeakForm < double >
+{
+public:
+  CustomWeakFormDG() : WeakForm<double>(2)
+  {
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(0, 0));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormDiffusion<double>(1, 1));
+    this->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(1, 0));
+    this->add_matrix_form_DG(new CustomMatrixFormJump(0, 0));
+  }
+};
+
+// Returns the number of failed checks.
+static int check_problem(const char* name, WeakFormSharedPtr<double> wf, std::vector<SpaceSharedPtr<double> > spaces, unsigned long long expected_checksum)
+{
+  int failures = 0;
+  for (int threads = 1; threads <= THREAD_COUNT; threads += THREAD_COUNT - 1)
+  {
+    HermesCommonApi.set_integral_param_value(numThreads, threads);
+    CSCMatrix<double> csc_matrix;
+    CSRMatrix<double> csr_matrix;
+    DiscreteProblem<double> csc_dp(wf, spaces);
+    csc_dp.assemble(&csc_matrix);
+    DiscreteProblem<double> csr_dp(wf, spaces);
+    csr_dp.assemble(&csr_matrix);
+
+    unsigned long long checksum = structure_checksum(csc_matrix);
+    if (checksum != expected_checksum)
+      failures++;
+
+    // The rows of the CSC structure.
+    std::vector<std::set<int> > rows(csc_matrix.get_size());
+    for (unsigned int col = 0; col < csc_matrix.get_size(); col++)
+      for (int k = csc_matrix.get_Ap()[col]; k < csc_matrix.get_Ap()[col + 1]; k++)
+        rows[csc_matrix.get_Ai()[k]].insert(col);
+    int differences = compare_structure(csr_matrix, rows);
+    failures += differences;
+
+    std::cout << name << ": " << Space<double>::get_num_dofs(spaces) << " dofs, nnz " << csc_matrix.get_nnz() << ", " << threads << " thread(s), checksum "
+      << checksum << (checksum == expected_checksum ? "" : " (unexpected)") << ", CSR rows different from the CSC ones: " << differences << std::endl;
+  }
+  return failures;
+}
+
+int main(int argc, char* argv[])
+{
+  int failures = 0;
+  failures += check_random_structure<CSCMatrix<double> >("CSC, serial", false, 500, 20000);
+  failures += check_random_structure<CSRMatrix<double> >("CSR, serial", true, 500, 20000);
+  failures += check_random_structure<CSCMatrix<double> >("CSC, parallel", false, 5000, 400000);
+  failures += check_random_structure<CSRMatrix<double> >("CSR, parallel", true, 5000, 400000);
+
+  MeshSharedPtr mesh(new Mesh), fine_mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", mesh);
+  mesh->refine_all_elements();
+  mesh->refine_all_elements();
+  fine_mesh->copy(mesh);
+  fine_mesh->refine_all_elements();
+  fine_mesh->refine_all_elements(1);
+
+  SpaceSharedPtr<double> h1_space(new H1Space<double>(mesh, 3));
+  SpaceSharedPtr<double> fine_h1_space(new H1Space<double>(fine_mesh, 2));
+  SpaceSharedPtr<double> l2_space(new L2Space<double>(mesh, 1));
+  failures += check_problem("Multi-mesh", WeakFormSharedPtr<double>(new CustomWeakFormMultiMesh), { h1_space, fine_h1_space, l2_space }, EXPECTED_CHECKSUMS[0]);
+
+  SpaceSharedPtr<double> dg_space(new L2Space<double>(fine_mesh, 2));
+  SpaceSharedPtr<double> dg_h1_space(new H1Space<double>(fine_mesh, 1));
+  failures += check_problem("DG", WeakFormSharedPtr<double>(new CustomWeakFormDG), { dg_space, dg_h1_space }, EXPECTED_CHECKSUMS[1]);
+
+  if (failures)
+  {
+    std::cout << "Failure!";
+    return -1;
+  }
+
+  std::cout << "Success!";
+  return 0;
+}
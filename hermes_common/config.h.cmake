@@ -14,6 +14,7 @@
 #cmakedefine WITH_UMFPACK
 #cmakedefine WITH_PARALUTION
 #cmakedefine WITH_MUMPS
+#cmakedefine HAVE_MUMPS_SINGLE
 #cmakedefine WITH_SUPERLU
 #cmakedefine WITH_PETSC
 #cmakedefine WITH_MATIO
@@ -24,6 +25,7 @@
 #cmakedefine WITH_PJLIB
 #cmakedefine WITH_BSON
 #cmakedefine WITH_MATIO
+#cmakedefine WITH_ZLIB
 #cmakedefine MONGO_STATIC_BUILD
 #cmakedefine UMFPACK_LONG_INT
 
@@ -23,6 +23,7 @@
 #define __HERMES_COMMON_ALGEBRA_UTILITIES_H
 
 #include "config.h"
+#include <complex>
 
 namespace Hermes
 {
@@ -80,6 +81,25 @@ namespace Hermes
 #endif
       EXPORT_FORMAT_MATLAB_SIMPLE = 5
     };
+
+    /// Thread-safe addition to an entry of a matrix / vector (used in the parallel assembling).
+    inline void add_atomic(double& target, double value)
+    {
+#pragma omp atomic
+      target += value;
+    }
+
+    /// Thread-safe addition to an entry of a matrix / vector (used in the parallel assembling).
+    /// std::complex<double> is stored as double[2] (real, imaginary), the parts are added by two atomic
+    /// additions - no lock is needed and the interleaved layout the solvers take as is stays.
+    inline void add_atomic(std::complex<double>& target, std::complex<double> value)
+    {
+      double* parts = reinterpret_cast<double*>(&target);
+#pragma omp atomic
+      parts[0] += value.real();
+#pragma omp atomic
+      parts[1] += value.imag();
+    }
   }
 }
 #endif
@@ -0,0 +1,114 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file bsr_matrix.h
+\brief Block sparse row matrix with small dense blocks.
+*/
+#ifndef __HERMES_COMMON_BSR_MATRIX_H
+#define __HERMES_COMMON_BSR_MATRIX_H
+
+#include "algebra/cs_matrix.h"
+
+namespace Hermes
+{
+  /// \brief Namespace containing classes for vector / matrix operations.
+  namespace Algebra
+  {
+    /// \brief Block sparse row (BSR) matrix with dense square blocks.
+    ///
+    /// Intended for systems of block_size components (elasticity, velocities in Navier-Stokes...)
+    /// whose spaces share the mesh and the DOF layout. The DOFs of such spaces are numbered one space
+    /// after another, so the global index i is the component (i / block_count) in the block (i % block_count),
+    /// where block_count = size / block_size - the same basis function of all the components lies in one block.
+    /// The numbering of the vectors is not changed.
+    ///
+    /// Only one column index per block is stored, the blocks are dense (row-major), the product
+    /// with a vector is blocked. For external direct solvers, the matrix is converted to CSC (convert_to_csc()).
+    /// Any numbering gives a correct matrix, a different layout of the spaces only leads to more fill-in of the blocks.
+    template <typename Scalar>
+    class HERMES_API BSRMatrix : public SparseMatrix < Scalar >
+    {
+    public:
+      /// \brief Constructor.
+      /// @param[in] block_size size of the blocks (number of components)
+      BSRMatrix(unsigned int block_size = 2);
+
+      virtual ~BSRMatrix();
+
+      /// Allocates the blocks from the indices added by pre_add_ij().
+      virtual void alloc();
+      virtual void free();
+      virtual void zero();
+      virtual void set_row_zero(unsigned int n);
+
+      virtual Scalar get(unsigned int m, unsigned int n) const;
+
+      virtual void add(unsigned int m, unsigned int n, Scalar v);
+
+      /// Scatter of a local matrix (as in assembling), every entry needs one search among the blocks of its block row.
+      virtual void add(unsigned int m, unsigned int n, Scalar *mat, int *rows, int *cols, const int size);
+
+      /// Blocked product with a vector.
+      virtual void multiply_with_vector(Scalar* vector_in, Scalar*& vector_out, bool vector_out_initialized = false) const;
+
+      virtual void multiply_with_Scalar(Scalar value);
+
+      /// Number of stored entries (including the zeros in the blocks).
+      virtual unsigned int get_nnz() const;
+      virtual double get_fill_in() const;
+
+      /// Duplicates a matrix (including allocation).
+      virtual SparseMatrix<Scalar>* duplicate() const;
+
+      /// Exports the CSC form of the matrix.
+      virtual void export_to_file(const char *filename, const char *var_name, MatrixExportFormat fmt, char* number_format = "%lf");
+
+      /// Converts the matrix to CSC (e.g. for external direct solvers), the target is reallocated.
+      void convert_to_csc(CSCMatrix<Scalar>* target) const;
+
+      unsigned int get_block_size() const;
+      unsigned int get_block_count() const;
+
+      /// Exposes pointers to the BSR arrays.
+      /// @return pointer to #Bp
+      int *get_Bp() const;
+      /// @return pointer to #Bj
+      int *get_Bj() const;
+      /// @return pointer to #Bx
+      Scalar *get_Bx() const;
+
+    protected:
+      /// Position of the block (block_row, block_col) in Bj, -1 if it is not present.
+      int find_block(unsigned int block_row, unsigned int block_col) const;
+
+      /// Size of the blocks.
+      unsigned int block_size;
+      /// Number of block rows ( = size / block_size).
+      unsigned int block_count;
+      /// Index to Bj, where each block row starts.
+      int *Bp;
+      /// Block column indices of the blocks.
+      int *Bj;
+      /// Blocks (block_size * block_size each, row-major).
+      Scalar *Bx;
+      /// Number of blocks ( = Bp[block_count]).
+      unsigned int block_nnz;
+    };
+  }
+}
+#endif
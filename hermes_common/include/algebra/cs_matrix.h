@@ -121,6 +121,8 @@ namespace Hermes
       int *Ap;
       /// Number of non-zero entries ( =  Ap[size]).
       unsigned int nnz;
+      /// True if Ap indexes the rows (CSR), false for the columns (CSC).
+      virtual bool compresses_rows() const;
       template<typename T> friend SparseMatrix<T>*  create_matrix();
     };
 
@@ -181,13 +183,8 @@ namespace Hermes
       /// Duplicates a matrix (including allocation).
       SparseMatrix<Scalar>* duplicate() const;
 
-      /// Important - normal SparseMatrix has the pages structure suitable for CSC matrix, so we need
-      /// to override the structure creation here.
-      /// add indices of nonzero matrix element
-      ///
-      /// @param[in] row  - row index
-      /// @param[in] col  - column index
-      virtual void pre_add_ij(unsigned int row, unsigned int col);
+    protected:
+      virtual bool compresses_rows() const;
     };
   }
 }
@@ -26,6 +26,9 @@
 #include "algebra_mixins.h"
 #include "mixins.h"
 
+/// Minimal number of added indices for the sparse structure to be compressed in parallel.
+#define HERMES_PARALLEL_STRUCTURE_MIN_ENTRIES 65536
+
 namespace Hermes
 {
   /// \brief Namespace containing classes for vector / matrix operations.
@@ -121,6 +124,15 @@ namespace Hermes
       /// @param[in] col  - column index
       virtual void pre_add_ij(unsigned int row, unsigned int col);
 
+      /// add indices of nonzero matrix elements collected elsewhere (e.g. by several threads)
+      ///
+      /// @param[in] ij - pairs (row, col) packed by pack_ij(), duplicities are allowed
+      /// @param[in] count - number of the pairs
+      virtual void pre_add_ij(const uint64_t* ij, unsigned int count);
+
+      /// Packs the pair (row, col) for pre_add_ij().
+      static inline uint64_t pack_ij(unsigned int row, unsigned int col) { return (((uint64_t)row) << 32) | col; }
+
       /// Finish manipulation with matrix (called before solving)
       virtual void finish();
 
@@ -183,38 +195,18 @@ namespace Hermes
       virtual unsigned int get_nnz() const;
 
     protected:
-      /// Size of page (max number of indices stored in one page).
-      /// DO NOT CHANGE, otherwise the data types in Page struct needs to be revisited.
-      static const int PAGE_SIZE = 100;
-
-      /// Structure for storing indices in sparse matrix
-      struct Page {
-        Page(bool dyn_stored_ = false) : dyn_stored(dyn_stored_), next(nullptr), count(0) {
-        };
-        /// number of indices stored
-        unsigned char count;
-        /// buffer for storing indices
-        int idx[PAGE_SIZE];
-        /// pointer to next page
-        Page *next;
-        /// this page is stored in the dynamically allocated part.
-        bool dyn_stored;
-      };
-
-      /// array of pages with indices array. Each field of arra contains pages for one column
-      Page *pages;
-      Page **next_pages;
-
-      /// gather all pages in the buffer, delete them, sort buffer and remove duplicities
-      /// @param[in] page first page with indices
-      /// @param[out] buffer buffer to which indices will be copied
-      /// @param[in] max maximum indices to be stored (probably)
-      /// \todo max parameter does nothing (not implemented)
-      /// @return number of indices
-      int sort_and_store_indices(Page *page, int *buffer, int *max);
-      /// get number of indices in all pages
-      /// @return number of indices
-      int get_num_indices();
+      /// Indices of nonzero matrix elements added by pre_add_ij(), pairs (row, col) packed by pack_ij().
+      std::vector<uint64_t> structure;
+
+      /// Builds the compressed structure from the added indices (in parallel), the added indices are released.
+      /// The entries are counting-sorted by the compressed index, each segment is then sorted and its duplicities removed.
+      /// @param[in] by_rows - compress the rows (CSR), otherwise the columns (CSC)
+      /// @param[out] Ap - size + 1 starts of the segments of Ai (allocated here)
+      /// @param[out] Ai - sorted indices in the segments (allocated here)
+      /// @param[in] block_size - the indices are mapped to the blocks of this size first (index % (size / block_size)),
+      /// Ap, Ai and the returned number are then those of the blocks
+      /// @return number of nonzeros
+      int compress_structure(bool by_rows, int*& Ap, int*& Ai, unsigned int block_size = 1);
     };
 
     /// \brief Function returning a matrix according to the users's choice.
@@ -24,6 +24,7 @@
 
 #include "algebra_utilities.h"
 #include "algebra_mixins.h"
+#include "vector_operations.h"
 #include "mixins.h"
 
 namespace Hermes
@@ -158,6 +159,10 @@ namespace Hermes
   template<typename Scalar>
   double get_l2_norm(Algebra::Vector<Scalar>* vec)
   {
+    Algebra::SimpleVector<Scalar>* simple_vec = dynamic_cast<Algebra::SimpleVector<Scalar>*>(vec);
+    if (simple_vec)
+      return Algebra::VectorOperations::nrm2<Scalar>(simple_vec->get_size(), simple_vec->v);
+
     Scalar val = 0;
     for (unsigned int i = 0; i < vec->get_size(); i++)
     {
@@ -170,13 +175,7 @@ namespace Hermes
   template<typename Scalar>
   double get_l2_norm(Scalar* vec, int count)
   {
-    Scalar val = 0;
-    for (unsigned int i = 0; i < count; i++)
-    {
-      Scalar inc = vec[i];
-      val = val + inc*conj(inc);
-    }
-    return sqrt(std::abs(val));
+    return Algebra::VectorOperations::nrm2<Scalar>(count, vec);
   }
 }
 #endif
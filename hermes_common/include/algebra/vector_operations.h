@@ -0,0 +1,79 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file vector_operations.h
+\brief Dense vector (BLAS level 1) operations.
+*/
+#ifndef __HERMES_COMMON_VECTOR_OPERATIONS_H
+#define __HERMES_COMMON_VECTOR_OPERATIONS_H
+
+#include "common.h"
+#include "util/compat.h"
+
+/// Vectors shorter than this are processed by one thread (the loops are still vectorized).
+#define HERMES_VECTOR_OPERATIONS_MIN_PARALLEL_SIZE 65536
+
+namespace Hermes
+{
+  /// \brief Namespace containing classes for vector / matrix operations.
+  namespace Algebra
+  {
+    /// \brief Operations on dense (simply stored) vectors of length n.
+    ///
+    /// The loops are written so that the compiler vectorizes them, complex numbers are processed as pairs of doubles.
+    /// Vectors of at least HERMES_VECTOR_OPERATIONS_MIN_PARALLEL_SIZE entries are split among the threads (numThreads),
+    /// every thread gets one contiguous range. The partial sums of the reductions are added in the order of the threads,
+    /// so that the results do not change from run to run.
+    namespace VectorOperations
+    {
+      /// y += alpha * x.
+      template<typename Scalar>
+      HERMES_API void axpy(int n, Scalar alpha, const Scalar* x, Scalar* y);
+
+      /// x *= alpha.
+      template<typename Scalar>
+      HERMES_API void scal(int n, Scalar alpha, Scalar* x);
+
+      /// Sum of x[i] * y[i] (without conjugation - as the bilinear forms in the solvers).
+      template<typename Scalar>
+      HERMES_API Scalar dot(int n, const Scalar* x, const Scalar* y);
+
+      /// The l2 norm of x.
+      template<typename Scalar>
+      HERMES_API double nrm2(int n, const Scalar* x);
+
+      /// y += alpha * x, returns the l2 norm of x (one pass over the vectors).
+      template<typename Scalar>
+      HERMES_API double axpy_nrm2(int n, Scalar alpha, const Scalar* x, Scalar* y);
+
+      /// y += alpha * (x - y), returns the l2 norm of (x - y) before the update (one pass over the vectors).
+      template<typename Scalar>
+      HERMES_API double relax_nrm2(int n, Scalar alpha, const Scalar* x, Scalar* y);
+
+      /// y = sum of coeffs[j] * x[j] over the count vectors x[j] (one pass over y).
+      template<typename Scalar>
+      HERMES_API void linear_combination(int n, int count, const Scalar* coeffs, Scalar** x, Scalar* y);
+
+      /// Gram matrix (row-major, count x count) of the differences d_a = x[a + 1] - x[a] of count + 1 successive vectors,
+      /// gram[a * count + b] = sum of d_a[i] * d_b[i]. The differences are formed in short blocks, all the vectors are read once.
+      template<typename Scalar>
+      HERMES_API void difference_gram(int n, int count, Scalar** x, Scalar* gram);
+    }
+  }
+}
+#endif
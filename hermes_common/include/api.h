@@ -37,7 +37,10 @@ namespace Hermes
     directMatrixSolverType,
     showInternalWarnings,
     checkMeshesOnLoad,
-    useAccelerators
+    useAccelerators,
+    /// Block size of the matrices for UMFPACK (BSRMatrix), 1 = CSCMatrix.
+    /// For systems whose spaces share the mesh and the DOF layout, see BSRMatrix.
+    matrixBlockSize
   };
 
   /// API Class containing settings for the whole HermesCommon.
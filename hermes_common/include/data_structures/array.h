@@ -160,6 +160,20 @@ namespace Hermes
       return item;
     }
 
+    /// Appends count new_ items at the end of the array (the unused items are not reused).
+    /// \return The id of the first one, the items have consecutive ids and their used flag is set to 1.
+    /// Only the id and used members are initialized.
+    int add_range(int count)
+    {
+      int first_id = size;
+      bool append_only_stored = this->append_only;
+      this->append_only = true;
+      for (int i = 0; i < count; i++)
+        this->add();
+      this->append_only = append_only_stored;
+      return first_id;
+    }
+
     /// Removes the given item from the array, ie., marks it as unused.
     /// Note that the array is never physically shrinked. This should not
     /// be a problem, since meshes tend to grow rather than become smaller.
@@ -177,6 +191,14 @@ namespace Hermes
       nitems--;
     }
 
+    /// Ids of the unused items, they are reused from the end of the list.
+    /// Removing the items in this order restores the state of the array (used in checkpointing).
+    const int* get_unused(unsigned int& count) const
+    {
+      count = this->nunused;
+      return this->unused;
+    }
+
     // Iterators
 
     /// Get the first index that is present and is equal to or greater than the passed \c idx.
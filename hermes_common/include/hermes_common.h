@@ -23,7 +23,9 @@
 #include "exceptions.h"
 #include "algebra/vector.h"
 #include "algebra/cs_matrix.h"
+#include "algebra/bsr_matrix.h"
 #include "algebra/dense_matrix_operations.h"
+#include "algebra/vector_operations.h"
 #include "solvers/linear_matrix_solver.h"
 #include "solvers/nonlinear_matrix_solver.h"
 #include "solvers/picard_matrix_solver.h"
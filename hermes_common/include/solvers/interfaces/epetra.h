@@ -67,6 +67,7 @@ namespace Hermes
 
       virtual void prealloc(unsigned int n);
       virtual void pre_add_ij(unsigned int row, unsigned int col);
+      virtual void pre_add_ij(const uint64_t* ij, unsigned int count);
       virtual void finish();
 
       virtual void alloc();
@@ -31,6 +31,10 @@ extern "C"
 #include <mumps_c_types.h>
 #include <dmumps_c.h>
 #include <zmumps_c.h>
+#ifdef HAVE_MUMPS_SINGLE
+#include <smumps_c.h>
+#include <cmumps_c.h>
+#endif
 }
 
 #ifdef WITH_MPI
@@ -59,6 +63,12 @@ namespace Hermes
       typedef ZMUMPS_STRUC_C mumps_struct;
       /** Type for storing scalar number in Mumps complex structures */
       typedef ZMUMPS_COMPLEX mumps_Scalar;
+#ifdef HAVE_MUMPS_SINGLE
+      /** Type for storing mumps struct in Mumps single precision complex structures */
+      typedef CMUMPS_STRUC_C mumps_single_struct;
+      /** Type for storing scalar number in Mumps single precision complex structures */
+      typedef CMUMPS_COMPLEX mumps_single_Scalar;
+#endif
     };
 
     /** Type for storing number in Mumps real structures */
@@ -69,6 +79,12 @@ namespace Hermes
       typedef DMUMPS_STRUC_C mumps_struct;
       /** Type for storing scalar number in Mumps real structures */
       typedef double mumps_Scalar;
+#ifdef HAVE_MUMPS_SINGLE
+      /** Type for storing mumps struct in Mumps single precision real structures */
+      typedef SMUMPS_STRUC_C mumps_single_struct;
+      /** Type for storing scalar number in Mumps single precision real structures */
+      typedef float mumps_single_Scalar;
+#endif
     };
 
     /** \brief Matrix used with MUMPS solver */
@@ -140,6 +156,9 @@ namespace Hermes
       virtual void solve();
       virtual int get_matrix_size();
 
+      /// Factorization in single precision (SMUMPS / CMUMPS) is available if MUMPS was found with its single precision libraries.
+      virtual bool supports_mixed_precision() const;
+
       /// Matrix to solve.
       MumpsMatrix<Scalar> *m;
       /// Right hand side.
@@ -158,6 +177,27 @@ namespace Hermes
       /// @return true on succes
       /// \sa #check_status()
       bool reinit();
+
+#ifdef HAVE_MUMPS_SINGLE
+      /// MUMPS structure of the single precision instance (mixed-precision solution).
+      typename mumps_type<Scalar>::mumps_single_struct single_param;
+      /// Single precision copy of the matrix values.
+      typename mumps_type<Scalar>::mumps_single_Scalar* single_Ax;
+      /// Infinity norm of the factorized matrix (backward error of the refinement).
+      double single_matrix_norm;
+
+      /// Mixed-precision solution - single precision factorization & iterative refinement.
+      /// If the single precision factorization fails, the mixed precision is switched off.
+      /// @return false if the system has to be solved in the full precision.
+      bool solve_mixed_precision();
+
+      /// (Re)initialize the single precision MUMPS instance.
+      void reinit_single();
+
+      /// Terminates the single precision MUMPS instance (if any) and frees its data.
+      void free_single();
+#endif
+
     private:
       //wrapper around dmums_c or zmumps_c
       void mumps_c(typename mumps_type<Scalar>::mumps_struct * param);
@@ -165,6 +205,18 @@ namespace Hermes
       /// True if solver is inited.
       bool inited;
 
+#ifdef HAVE_MUMPS_SINGLE
+      //wrapper around smums_c or cmumps_c
+      void mumps_c(typename mumps_type<Scalar>::mumps_single_struct * param);
+
+      /// True if the single precision instance is inited / holds the factorization of the current matrix.
+      bool single_inited, single_factorized;
+      /// True if the refinement with the current single precision factors did not converge.
+      bool single_refinement_failed;
+      /// True if a matrix has been factorized in single precision after the last double precision factorization.
+      bool double_factorization_outdated;
+#endif
+
       /// Internal - control parameter for MUMPS.
       /// See MUMPS doc, page 27, version 4.10.
       int icntl_14;
@@ -25,6 +25,7 @@
 #ifdef WITH_UMFPACK
 #include "solvers/linear_matrix_solver.h"
 #include "algebra/cs_matrix.h"
+#include "algebra/bsr_matrix.h"
 
 extern "C"
 {
@@ -52,13 +53,22 @@ namespace Hermes
       /// @param[in] m pointer to matrix
       /// @param[in] rhs pointer to right hand side vector
       UMFPackLinearMatrixSolver(CSCMatrix<Scalar> *m, SimpleVector<Scalar> *rhs);
+      /// Constructor of UMFPack solver for a block matrix, the matrix is converted to CSC before each solution.
+      /// @param[in] bsr_matrix pointer to matrix
+      /// @param[in] rhs pointer to right hand side vector
+      UMFPackLinearMatrixSolver(BSRMatrix<Scalar> *bsr_matrix, SimpleVector<Scalar> *rhs);
       virtual ~UMFPackLinearMatrixSolver();
       virtual void solve();
+      /// Solves the transposed system reusing the factorization (UMFPACK_At, resp. UMFPACK_Aat for the complex case).
+      virtual void solve_transposed();
+      virtual bool supports_transposed_solve() const { return true; }
       virtual void free();
       virtual int get_matrix_size();
 
       /// Matrix to solve.
       CSCMatrix<Scalar> *m;
+      /// The block matrix converted to m (owned in that case), nullptr if m is passed directly.
+      BSRMatrix<Scalar> *bsr_matrix;
       /// Right hand side vector.
       SimpleVector<Scalar> *rhs;
 
@@ -68,6 +78,9 @@ namespace Hermes
       /// LU factorization of matrix A.
       void *numeric;
 
+      /// Solve the system given by the UMFPACK system flag (UMFPACK_A, UMFPACK_At, ...).
+      void solve_system(int umfpack_system);
+
       /// \todo document
       void free_factorization_data();
       /// \todo document
@@ -117,6 +117,26 @@ namespace Hermes
       /// \param[in] initial guess.
       virtual void solve(Scalar* initial_guess) = 0;
 
+      /// Solve the transposed system (A^T x = rhs), e.g. an adjoint problem.
+      /// Solvers supporting this reuse the factorization of A (see supports_transposed_solve()).
+      virtual void solve_transposed();
+
+      /// Whether solve_transposed() is available.
+      virtual bool supports_transposed_solve() const;
+
+      /// Mixed-precision solution: the matrix is factorized in single precision (half the memory and bandwidth of the
+      /// factorization), the accuracy is recovered by iterative refinement on the residual computed with the original matrix.
+      /// The refinement stops at the tolerance, or when the residual reaches the double precision backward error
+      /// ||rhs - A x|| <= c eps (||A|| ||x|| + ||rhs||). If it stalls above that (matrix too ill-conditioned for single precision),
+      /// this system is solved in the full precision. The mixed precision is switched off only if the single precision factorization fails.
+      /// Only for solvers with supports_mixed_precision(), a warning is issued otherwise.
+      /// @param[in] tolerance relative residual norm ||rhs - A x|| / ||rhs|| the refinement stops at.
+      /// @param[in] max_refinement_steps maximum number of refinement steps before falling back to the full precision.
+      virtual void use_mixed_precision(bool to_set = true, double tolerance = 1e-12, unsigned int max_refinement_steps = 20);
+
+      /// Whether use_mixed_precision() is available.
+      virtual bool supports_mixed_precision() const;
+
       /// Get solution vector.
       /// @return solution vector ( #sln )
       Scalar *get_sln_vector();
@@ -165,6 +185,11 @@ namespace Hermes
       unsigned int n_eq;
 
       bool node_wise_ordering;
+
+      /// Mixed-precision solution settings, see use_mixed_precision().
+      bool mixed_precision;
+      double mixed_precision_tolerance;
+      unsigned int mixed_precision_max_refinement_steps;
     };
 
     /// \brief Special-purpose abstract class for using external solvers.
@@ -256,6 +281,12 @@ namespace Hermes
       /// @param[in] toleranceType - the tolerance to set
       virtual void set_tolerance(double tolerance, LoopSolverToleranceType toleranceType);
 
+      /// Get the convergence tolerance.
+      double get_tolerance() const;
+
+      /// Get the convergence tolerance type.
+      LoopSolverToleranceType get_tolerance_type() const;
+
       /// Set maximum number of iterations to perform.
       /// @param[in] iters - number of iterations
       virtual void set_max_iters(int iters);
@@ -35,6 +35,16 @@ namespace Hermes
       NewtonMatrixSolver();
       virtual ~NewtonMatrixSolver() {};
 
+      /// Inexact Newton method: the relative tolerance of an iterative linear solver is set in every step from the
+      /// reduction of the nonlinear residual, so that the early steps are solved only roughly.
+      /// Ignored with direct solvers. The tolerance set to the linear solver is restored when the solving finishes.
+      /// Default: InexactNewtonOff.
+      /// \param[in] forcing_term The choice of the forcing terms.
+      /// \param[in] initial_forcing_term The relative tolerance of the first linear solve.
+      /// \param[in] max_forcing_term The upper bound of the relative tolerance.
+      /// \param[in] gamma, alpha Parameters of EisenstatWalkerChoice2 (the defaults are those recommended by Eisenstat and Walker).
+      void use_inexact_newton(InexactNewtonForcingTerm forcing_term, double initial_forcing_term = 0.5, double max_forcing_term = 0.9, double gamma = 0.9, double alpha = 1.618);
+
     protected:
       virtual double update_solution_return_change_norm(Scalar* linear_system_solution);
 
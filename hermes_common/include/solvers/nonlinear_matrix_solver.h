@@ -61,6 +61,18 @@ namespace Hermes
       Error
     };
 
+    /// Choice of the forcing terms (tolerances of the linear solver relative to the residual norm) of the inexact Newton method.
+    /// See Eisenstat, Walker: Choosing the forcing terms in an inexact Newton method, SIAM J. Sci. Comput. 17 (1996).
+    enum InexactNewtonForcingTerm
+    {
+      /// Linear systems solved to the tolerance set to the linear solver.
+      InexactNewtonOff = 0,
+      /// eta_k = | ||F_k|| - ||F_k-1 + J_k-1 s_k-1|| | / ||F_k-1|| (agreement of the linear model in the previous step).
+      EisenstatWalkerChoice1 = 1,
+      /// eta_k = gamma * (||F_k|| / ||F_k-1||)^alpha (rate of the residual reduction).
+      EisenstatWalkerChoice2 = 2
+    };
+
     template<typename Scalar> class HERMES_API NonlinearConvergenceMeasurement;
 
     /// \brief Base class for defining interface for nonlinear solvers.
@@ -188,6 +200,40 @@ namespace Hermes
       Vector<Scalar>* residual_back;
 #pragma endregion
 
+#pragma region inexact_newton-private
+      /// Sets the relative tolerance of the (iterative) linear solver for the current step.
+      /// The tolerance of the linear solver set by the user is stored on the first call, see restore_linear_solver_tolerance().
+      void set_inexact_newton_forcing_term();
+      /// Stores the right-hand side and the product of the matrix with the linear solution of the current step (for EisenstatWalkerChoice1).
+      void store_inexact_newton_linear_residual();
+      /// Norm of the linear residual of the step actually taken - the linear solution times the damping factor:
+      /// || rhs - damping_factor * J x || = || (1 - damping_factor) rhs + damping_factor (rhs - J x) ||.
+      /// Called again whenever the damping loop changes the step.
+      void update_inexact_newton_linear_residual_norm(double damping_factor);
+      /// Restores the tolerance of the linear solver set by the user (when the solving finishes).
+      void restore_linear_solver_tolerance();
+
+      InexactNewtonForcingTerm inexact_newton_forcing_term;
+      double inexact_newton_initial_forcing_term;
+      double inexact_newton_max_forcing_term;
+      double inexact_newton_gamma;
+      double inexact_newton_alpha;
+
+      /// The forcing term, the norm of the nonlinear residual and of the linear residual of the previous step (negative before the first step).
+      double inexact_newton_state[3];
+      /// Backup of inexact_newton_state for unsuccessful reuse of Jacobian.
+      double inexact_newton_state_back[3];
+
+      /// The right-hand side and the product J x of the current step.
+      Scalar* inexact_newton_linear_rhs;
+      Scalar* inexact_newton_linear_product;
+
+      /// The tolerance of the linear solver set by the user.
+      bool linear_solver_tolerance_stored;
+      double linear_solver_tolerance;
+      LoopSolverToleranceType linear_solver_tolerance_type;
+#pragma endregion
+
       virtual void assemble_residual(bool store_previous_residual) = 0;
       virtual bool assemble_jacobian(bool store_previous_jacobian) = 0;
       virtual bool assemble(bool store_previous_jacobian, bool store_previous_residual) = 0;
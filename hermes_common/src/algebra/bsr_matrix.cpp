@@ -0,0 +1,334 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file bsr_matrix.cpp
+\brief Block sparse row matrix with small dense blocks.
+*/
+#include "bsr_matrix.h"
+#include "util/memory_handling.h"
+#include "api.h"
+
+namespace Hermes
+{
+  namespace Algebra
+  {
+    /// Product of the block row with the vector, the block size known at compile time (unrolled loops).
+    template<typename Scalar, int block_size>
+    static inline void multiply_block_row(const int* Bj, const Scalar* Bx, int begin, int end, unsigned int block_count, const Scalar* vector_in, Scalar* result)
+    {
+      Scalar sum[block_size];
+      for (int ci = 0; ci < block_size; ci++)
+        sum[ci] = Scalar(0);
+      for (int k = begin; k < end; k++)
+      {
+        const Scalar* block = Bx + k * block_size * block_size;
+        Scalar x[block_size];
+        for (int cj = 0; cj < block_size; cj++)
+          x[cj] = vector_in[cj * block_count + Bj[k]];
+        for (int ci = 0; ci < block_size; ci++)
+          for (int cj = 0; cj < block_size; cj++)
+            sum[ci] += block[ci * block_size + cj] * x[cj];
+      }
+      for (int ci = 0; ci < block_size; ci++)
+        result[ci] = sum[ci];
+    }
+
+    template<typename Scalar>
+    BSRMatrix<Scalar>::BSRMatrix(unsigned int block_size) : SparseMatrix<Scalar>(), block_size(block_size), block_count(0), Bp(nullptr), Bj(nullptr), Bx(nullptr), block_nnz(0)
+    {
+      if (block_size == 0)
+        throw Hermes::Exceptions::ValueException("block_size", block_size, 1);
+    }
+
+    template<typename Scalar>
+    BSRMatrix<Scalar>::~BSRMatrix()
+    {
+      free();
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::alloc()
+    {
+      if (this->size % block_size)
+        throw Hermes::Exceptions::Exception("BSRMatrix: size %i is not divisible by the block size %i.", this->size, block_size);
+
+      block_count = this->size / block_size;
+      block_nnz = this->compress_structure(true, Bp, Bj, block_size);
+      Bx = calloc_with_check<BSRMatrix<Scalar>, Scalar>(block_nnz * block_size * block_size, this);
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::free()
+    {
+      SparseMatrix<Scalar>::free();
+      block_nnz = 0;
+      free_with_check(Bp);
+      free_with_check(Bj);
+      free_with_check(Bx);
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::zero()
+    {
+      memset(Bx, 0, sizeof(Scalar)* block_nnz * block_size * block_size);
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::set_row_zero(unsigned int n)
+    {
+      unsigned int block_row = n % block_count, ci = n / block_count;
+      for (int k = Bp[block_row]; k < Bp[block_row + 1]; k++)
+        memset(Bx + (k * block_size + ci) * block_size, 0, sizeof(Scalar)* block_size);
+    }
+
+    template<typename Scalar>
+    int BSRMatrix<Scalar>::find_block(unsigned int block_row, unsigned int block_col) const
+    {
+      const int* begin = Bj + Bp[block_row];
+      const int* end = Bj + Bp[block_row + 1];
+      const int* position = std::lower_bound(begin, end, (int)block_col);
+      if (position == end || *position != (int)block_col)
+        return -1;
+      return position - Bj;
+    }
+
+    template<typename Scalar>
+    Scalar BSRMatrix<Scalar>::get(unsigned int m, unsigned int n) const
+    {
+      int k = find_block(m % block_count, n % block_count);
+      if (k < 0)
+        return Scalar(0);
+      return Bx[(k * block_size + m / block_count) * block_size + n / block_count];
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::add(unsigned int m, unsigned int n, Scalar v)
+    {
+      if (v == Scalar(0))
+        return;
+
+      int k = find_block(m % block_count, n % block_count);
+      if (k < 0)
+      {
+        this->info("BSRMatrix<Scalar>::add(): i = %d, j = %d.", m, n);
+        throw Hermes::Exceptions::Exception("Sparse matrix entry not found: [%i, %i]", m, n);
+      }
+
+      add_atomic(Bx[(k * block_size + m / block_count) * block_size + n / block_count], v);
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::add(unsigned int m, unsigned int n, Scalar *mat, int *rows, int *cols, const int size)
+    {
+      for (unsigned int i = 0; i < m; i++)
+      {
+        if (rows[i] < 0)
+          continue;
+
+        unsigned int block_row = rows[i] % block_count;
+        unsigned int ci = rows[i] / block_count;
+        const int* row_begin = Bj + Bp[block_row];
+        const int* row_end = Bj + Bp[block_row + 1];
+
+        for (unsigned int j = 0; j < n; j++)
+        {
+          Scalar entry = mat[i * size + j];
+          if (cols[j] < 0 || entry == Scalar(0))
+            continue;
+
+          int block_col = cols[j] % block_count;
+          const int* position = std::lower_bound(row_begin, row_end, block_col);
+          if (position == row_end || *position != block_col)
+          {
+            this->info("BSRMatrix<Scalar>::add(): i = %d, j = %d.", rows[i], cols[j]);
+            throw Hermes::Exceptions::Exception("Sparse matrix entry not found: [%i, %i]", rows[i], cols[j]);
+          }
+
+          add_atomic(Bx[((position - Bj) * block_size + ci) * block_size + cols[j] / block_count], entry);
+        }
+      }
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::multiply_with_vector(Scalar* vector_in, Scalar*& vector_out, bool vector_out_initialized) const
+    {
+      if (!vector_out_initialized)
+        vector_out = malloc_with_check<Scalar>(this->size);
+
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel())
+        num_threads = 1;
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1024)
+      for (int block_row = 0; block_row < (int)block_count; block_row++)
+      {
+        Scalar result[16];
+        Scalar* row_result = block_size <= 16 ? result : malloc_with_check<Scalar>(block_size);
+        switch (block_size)
+        {
+        case 1:
+          multiply_block_row<Scalar, 1>(Bj, Bx, Bp[block_row], Bp[block_row + 1], block_count, vector_in, row_result);
+          break;
+        case 2:
+          multiply_block_row<Scalar, 2>(Bj, Bx, Bp[block_row], Bp[block_row + 1], block_count, vector_in, row_result);
+          break;
+        case 3:
+          multiply_block_row<Scalar, 3>(Bj, Bx, Bp[block_row], Bp[block_row + 1], block_count, vector_in, row_result);
+          break;
+        default:
+          for (unsigned int ci = 0; ci < block_size; ci++)
+            row_result[ci] = Scalar(0);
+          for (int k = Bp[block_row]; k < Bp[block_row + 1]; k++)
+          {
+            const Scalar* block = Bx + k * block_size * block_size;
+            for (unsigned int ci = 0; ci < block_size; ci++)
+              for (unsigned int cj = 0; cj < block_size; cj++)
+                row_result[ci] += block[ci * block_size + cj] * vector_in[cj * block_count + Bj[k]];
+          }
+        }
+
+        for (unsigned int ci = 0; ci < block_size; ci++)
+          vector_out[ci * block_count + block_row] = row_result[ci];
+
+        if (row_result != result)
+          free_with_check(row_result);
+      }
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::multiply_with_Scalar(Scalar value)
+    {
+      unsigned int count = block_nnz * block_size * block_size;
+      for (unsigned int i = 0; i < count; i++)
+        Bx[i] *= value;
+    }
+
+    template<typename Scalar>
+    unsigned int BSRMatrix<Scalar>::get_nnz() const
+    {
+      return block_nnz * block_size * block_size;
+    }
+
+    template<typename Scalar>
+    double BSRMatrix<Scalar>::get_fill_in() const
+    {
+      return this->get_nnz() / (double)(this->size * this->size);
+    }
+
+    template<typename Scalar>
+    SparseMatrix<Scalar>* BSRMatrix<Scalar>::duplicate() const
+    {
+      BSRMatrix<Scalar>* new_matrix = new BSRMatrix<Scalar>(block_size);
+      new_matrix->size = this->size;
+      new_matrix->block_count = block_count;
+      new_matrix->block_nnz = block_nnz;
+      new_matrix->Bp = malloc_with_check<BSRMatrix<Scalar>, int>(block_count + 1, new_matrix);
+      new_matrix->Bj = malloc_with_check<BSRMatrix<Scalar>, int>(block_nnz, new_matrix);
+      new_matrix->Bx = malloc_with_check<BSRMatrix<Scalar>, Scalar>(block_nnz * block_size * block_size, new_matrix);
+      memcpy(new_matrix->Bp, Bp, sizeof(int)* (block_count + 1));
+      memcpy(new_matrix->Bj, Bj, sizeof(int)* block_nnz);
+      memcpy(new_matrix->Bx, Bx, sizeof(Scalar)* block_nnz * block_size * block_size);
+      return new_matrix;
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::convert_to_csc(CSCMatrix<Scalar>* target) const
+    {
+      unsigned int nnz = this->get_nnz();
+      int* Ap = calloc_with_check<int>(this->size + 1);
+      int* Ai = malloc_with_check<int>(nnz);
+      Scalar* Ax = malloc_with_check<Scalar>(nnz);
+
+      // Every block in the block column J gives block_size entries to each of the columns cj * block_count + J.
+      for (unsigned int k = 0; k < block_nnz; k++)
+        for (unsigned int cj = 0; cj < block_size; cj++)
+          Ap[cj * block_count + Bj[k] + 1] += block_size;
+      for (unsigned int col = 0; col < this->size; col++)
+        Ap[col + 1] += Ap[col];
+
+      // Rows ci * block_count + I visited in the ascending order - the columns come out sorted.
+      int* position = malloc_with_check<int>(this->size);
+      memcpy(position, Ap, sizeof(int)* this->size);
+      for (unsigned int ci = 0; ci < block_size; ci++)
+      {
+        for (unsigned int block_row = 0; block_row < block_count; block_row++)
+        {
+          for (int k = Bp[block_row]; k < Bp[block_row + 1]; k++)
+          {
+            const Scalar* block_values = Bx + (k * block_size + ci) * block_size;
+            for (unsigned int cj = 0; cj < block_size; cj++)
+            {
+              int& col_position = position[cj * block_count + Bj[k]];
+              Ai[col_position] = ci * block_count + block_row;
+              Ax[col_position++] = block_values[cj];
+            }
+          }
+        }
+      }
+
+      target->free();
+      target->create(this->size, nnz, Ap, Ai, Ax);
+
+      free_with_check(position);
+      free_with_check(Ap);
+      free_with_check(Ai);
+      free_with_check(Ax);
+    }
+
+    template<typename Scalar>
+    void BSRMatrix<Scalar>::export_to_file(const char *filename, const char *var_name, MatrixExportFormat fmt, char* number_format)
+    {
+      CSCMatrix<Scalar> csc_matrix;
+      this->convert_to_csc(&csc_matrix);
+      csc_matrix.export_to_file(filename, var_name, fmt, number_format);
+    }
+
+    template<typename Scalar>
+    unsigned int BSRMatrix<Scalar>::get_block_size() const
+    {
+      return block_size;
+    }
+
+    template<typename Scalar>
+    unsigned int BSRMatrix<Scalar>::get_block_count() const
+    {
+      return block_count;
+    }
+
+    template<typename Scalar>
+    int *BSRMatrix<Scalar>::get_Bp() const
+    {
+      return Bp;
+    }
+
+    template<typename Scalar>
+    int *BSRMatrix<Scalar>::get_Bj() const
+    {
+      return Bj;
+    }
+
+    template<typename Scalar>
+    Scalar *BSRMatrix<Scalar>::get_Bx() const
+    {
+      return Bx;
+    }
+  }
+}
+
+template class HERMES_API Hermes::Algebra::BSRMatrix < double > ;
+template class HERMES_API Hermes::Algebra::BSRMatrix < std::complex<double> > ;
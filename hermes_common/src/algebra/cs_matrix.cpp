@@ -100,29 +100,20 @@ namespace Hermes
     template<typename Scalar>
     void CSMatrix<Scalar>::alloc()
     {
-      // initialize the arrays Ap and Ai
-      Ap = malloc_with_check<CSMatrix<Scalar>, int>(this->size + 1, this);
-      int aisize = this->get_num_indices();
-      Ai = malloc_with_check<CSMatrix<Scalar>, int>(aisize, this);
-
-      // sort the indices and remove duplicities, insert into Ai
-      unsigned int i;
-      int pos = 0;
-      for (i = 0; i < this->size; i++)
-      {
-        Ap[i] = pos;
-        pos += this->sort_and_store_indices(&this->pages[i], Ai + pos, Ai + aisize);
-      }
-      Ap[this->size] = pos;
-
-      free_with_check(this->pages);
-      free_with_check(this->next_pages);
+      // build the arrays Ap and Ai from the added indices
+      this->compress_structure(this->compresses_rows(), Ap, Ai);
 
       nnz = Ap[this->size];
 
       this->alloc_data();
     }
 
+    template<typename Scalar>
+    bool CSMatrix<Scalar>::compresses_rows() const
+    {
+      return false;
+    }
+
     template<typename Scalar>
     void CSMatrix<Scalar>::alloc_data()
     {
@@ -185,22 +176,25 @@ namespace Hermes
       int* tempAi = malloc_with_check<CSMatrix<Scalar>, int>(nnz, this);
       Scalar* tempAx = malloc_with_check<CSMatrix<Scalar>, Scalar>(nnz, this);
 
-      int run_i = 0;
-      for (int target_row = 0; target_row < this->size; target_row++)
+      // Counting sort by the target row - O(nnz), keeps the source columns ascending within each target row.
+      memset(tempAp, 0, sizeof(int)* (this->size + 1));
+      for (unsigned int i = 0; i < this->nnz; i++)
+        tempAp[this->Ai[i] + 1]++;
+      for (unsigned int target_row = 0; target_row < this->size; target_row++)
+        tempAp[target_row + 1] += tempAp[target_row];
+
+      int* run_i = malloc_with_check<CSMatrix<Scalar>, int>(this->size, this);
+      memcpy(run_i, tempAp, sizeof(int)* this->size);
+      for (int src_column = 0; src_column < this->size; src_column++)
       {
-        tempAp[target_row] = run_i;
-        for (int src_column = 0; src_column < this->size; src_column++)
+        for (int src_row = this->Ap[src_column]; src_row < this->Ap[src_column + 1]; src_row++)
         {
-          for (int src_row = this->Ap[src_column]; src_row < this->Ap[src_column + 1]; src_row++)
-          {
-            if (this->Ai[src_row] == target_row)
-            {
-              tempAi[run_i] = src_column;
-              tempAx[run_i++] = this->Ax[src_row];
-            }
-          }
+          int position = run_i[this->Ai[src_row]]++;
+          tempAi[position] = src_column;
+          tempAx[position] = this->Ax[src_row];
         }
       }
+      free_with_check(run_i);
 
       tempAp[this->size] = this->nnz;
       memcpy(this->Ai, tempAi, sizeof(int)* nnz);
@@ -253,27 +247,8 @@ namespace Hermes
       }
     }
 
-    template<>
-    void CSMatrix<double>::add(unsigned int m, unsigned int n, double v)
-    {
-      if (v != 0.0)   // ignore zero values.
-      {
-        // Find m-th row in the n-th column.
-        int pos = find_position(Ai + Ap[n], Ap[n + 1] - Ap[n], m);
-        // Make sure we are adding to an existing non-zero entry.
-        if (pos < 0)
-        {
-          this->info("CSMatrix<Scalar>::add(): i = %d, j = %d.", m, n);
-          throw Hermes::Exceptions::Exception("Sparse matrix entry not found: [%i, %i]", m, n);
-        }
-
-#pragma omp atomic
-        Ax[Ap[n] + pos] += v;
-      }
-    }
-
-    template<>
-    void CSMatrix<std::complex<double> >::add(unsigned int m, unsigned int n, std::complex<double> v)
+    template<typename Scalar>
+    void CSMatrix<Scalar>::add(unsigned int m, unsigned int n, Scalar v)
     {
       if (v != 0.0)   // ignore zero values.
       {
@@ -286,8 +261,7 @@ namespace Hermes
           throw Hermes::Exceptions::Exception("Sparse matrix entry not found: [%i, %i]", m, n);
         }
 
-#pragma omp critical (CSMatrixAdd)
-        Ax[Ap[n] + pos] += v;
+        add_atomic(Ax[Ap[n] + pos], v);
       }
     }
 
@@ -778,23 +752,9 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    void CSRMatrix<Scalar>::pre_add_ij(unsigned int row, unsigned int col)
+    bool CSRMatrix<Scalar>::compresses_rows() const
     {
-      if (this->pages[row].count >= SparseMatrix<Scalar>::PAGE_SIZE)
-      {
-        typename SparseMatrix<Scalar>::Page* final_page = &(this->pages[row]);
-        while (final_page->next != nullptr && final_page->count >= SparseMatrix<Scalar>::PAGE_SIZE)
-          final_page = final_page->next;
-
-        if (final_page->next == nullptr && final_page->count >= SparseMatrix<Scalar>::PAGE_SIZE)
-        {
-          final_page->next = new typename SparseMatrix<Scalar>::Page(true);
-          final_page = final_page->next;
-        }
-        final_page->idx[final_page->count++] = col;
-      }
-      else
-        this->pages[row].idx[this->pages[row].count++] = col;
+      return true;
     }
 
     template<typename Scalar>
@@ -21,6 +21,7 @@
 */
 #include "common.h"
 #include "matrix.h"
+#include "algebra/bsr_matrix.h"
 #include "callstack.h"
 #include "util/memory_handling.h"
 
@@ -32,7 +33,6 @@
 #include "solvers/interfaces/mumps_solver.h"
 #include "solvers/interfaces/aztecoo_solver.h"
 #include "solvers/interfaces/paralution_solver.h"
-#include "qsort.h"
 #include "api.h"
 
 namespace Hermes
@@ -121,16 +121,12 @@ namespace Hermes
     template<typename Scalar>
     SparseMatrix<Scalar>::SparseMatrix() : Matrix<Scalar>()
     {
-      pages = nullptr;
-      next_pages = nullptr;
     }
 
     template<typename Scalar>
     SparseMatrix<Scalar>::SparseMatrix(unsigned int size)
     {
       this->size = size;
-      pages = nullptr;
-      next_pages = nullptr;
     }
 
     template<typename Scalar>
@@ -142,17 +138,7 @@ namespace Hermes
     template<typename Scalar>
     void SparseMatrix<Scalar>::free()
     {
-      if (pages)
-      {
-        free_with_check(pages);
-      }
-
-      if (next_pages)
-      {
-        for (unsigned int i = 0; i < this->size; i++)
-          delete next_pages[i];
-        free_with_check(next_pages);
-      }
+      std::vector<uint64_t>().swap(structure);
     }
 
     template<typename Scalar>
@@ -235,63 +221,107 @@ namespace Hermes
     void SparseMatrix<Scalar>::prealloc(unsigned int n)
     {
       this->size = n;
-      pages = malloc_with_check<SparseMatrix<Scalar>, Page>(n, this);
+      std::vector<uint64_t>().swap(structure);
     }
 
     template<typename Scalar>
     void SparseMatrix<Scalar>::pre_add_ij(unsigned int row, unsigned int col)
     {
-      if (pages[col].count >= PAGE_SIZE)
+      structure.push_back(pack_ij(row, col));
+    }
+
+    template<typename Scalar>
+    void SparseMatrix<Scalar>::pre_add_ij(const uint64_t* ij, unsigned int count)
+    {
+      structure.insert(structure.end(), ij, ij + count);
+    }
+
+    template<typename Scalar>
+    int SparseMatrix<Scalar>::compress_structure(bool by_rows, int*& Ap, int*& Ai, unsigned int block_size)
+    {
+      unsigned int count = structure.size();
+      const int outer_shift = by_rows ? 32 : 0;
+      const int inner_shift = by_rows ? 0 : 32;
+      const unsigned int size = this->size / block_size;
+
+      int num_threads = HermesCommonApi.get_integral_param_value(numThreads);
+      if (omp_in_parallel() || count < HERMES_PARALLEL_STRUCTURE_MIN_ENTRIES)
+        num_threads = 1;
+
+      if (block_size > 1)
       {
-        Page* final_page = &(pages[col]);
-        while (final_page->next != nullptr && final_page->count >= PAGE_SIZE)
-          final_page = final_page->next;
+#pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < (int)count; i++)
+          structure[i] = pack_ij((unsigned int)(structure[i] >> 32) % size, (unsigned int)structure[i] % size);
+      }
+
+      // Counting sort by the compressed index, every thread counts its own range of the entries.
+      unsigned int* counts = calloc_with_check<SparseMatrix<Scalar>, unsigned int>(num_threads * size, this);
+#pragma omp parallel num_threads(num_threads)
+      {
+        int thread_number = omp_get_thread_num();
+        unsigned int start = (count / num_threads) * thread_number;
+        unsigned int end = (thread_number == num_threads - 1) ? count : (count / num_threads) * (thread_number + 1);
+        unsigned int* thread_counts = counts + thread_number * size;
+        for (unsigned int i = start; i < end; i++)
+          thread_counts[(unsigned int)(structure[i] >> outer_shift)]++;
+      }
 
-        if (final_page->next == nullptr && final_page->count >= PAGE_SIZE)
+      // Positions of the threads in the segments - the entries of a segment are stored in the order of the threads.
+      unsigned int* segment_start = malloc_with_check<SparseMatrix<Scalar>, unsigned int>(size + 1, this);
+      unsigned int position = 0;
+      for (unsigned int outer = 0; outer < size; outer++)
+      {
+        segment_start[outer] = position;
+        for (int thread_i = 0; thread_i < num_threads; thread_i++)
         {
-          final_page->next = new Page(true);
-          final_page = final_page->next;
+          unsigned int thread_count = counts[thread_i * size + outer];
+          counts[thread_i * size + outer] = position;
+          position += thread_count;
         }
-        final_page->idx[final_page->count++] = row;
       }
-      else
-        pages[col].idx[pages[col].count++] = row;
-    }
+      segment_start[size] = count;
 
-    template<typename Scalar>
-    int SparseMatrix<Scalar>::sort_and_store_indices(Page *page, int *buffer, int *max)
-    {
-      // gather all pages in the buffer, deleting them along the way
-      int *end = buffer;
-      while (page != nullptr)
+      unsigned int* inner = malloc_with_check<SparseMatrix<Scalar>, unsigned int>(count, this);
+#pragma omp parallel num_threads(num_threads)
       {
-        memcpy(end, page->idx, sizeof(int)* page->count);
-        end += page->count;
-        Page *tmp = page;
-        page = page->next;
-        if (tmp->dyn_stored)
-          delete tmp;
+        int thread_number = omp_get_thread_num();
+        unsigned int start = (count / num_threads) * thread_number;
+        unsigned int end = (thread_number == num_threads - 1) ? count : (count / num_threads) * (thread_number + 1);
+        unsigned int* thread_positions = counts + thread_number * size;
+        for (unsigned int i = start; i < end; i++)
+          inner[thread_positions[(unsigned int)(structure[i] >> outer_shift)]++] = (unsigned int)(structure[i] >> inner_shift);
       }
+      free_with_check(counts);
+      std::vector<uint64_t>().swap(structure);
 
-      // sort the indices and remove duplicities
-      qsort_int(buffer, end - buffer);
-      int *q = buffer;
-      for (int *p = buffer, last = -1; p < end; p++)
-        if (*p != last)
-          *q++ = last = *p;
+      // Sort the segments (short) and remove duplicities.
+      int* segment_nnz = malloc_with_check<SparseMatrix<Scalar>, int>(size, this);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1024)
+      for (int outer = 0; outer < (int)size; outer++)
+      {
+        unsigned int* segment_begin = inner + segment_start[outer];
+        unsigned int* segment_end = inner + segment_start[outer + 1];
+        std::sort(segment_begin, segment_end);
+        segment_nnz[outer] = std::unique(segment_begin, segment_end) - segment_begin;
+      }
 
-      return q - buffer;
-    }
+      // Emit the compressed structure.
+      Ap = malloc_with_check<SparseMatrix<Scalar>, int>(size + 1, this);
+      Ap[0] = 0;
+      for (unsigned int outer = 0; outer < size; outer++)
+        Ap[outer + 1] = Ap[outer] + segment_nnz[outer];
 
-    template<typename Scalar>
-    int SparseMatrix<Scalar>::get_num_indices()
-    {
-      int total = 0;
-      for (unsigned int i = 0; i < this->size; i++)
-        for (Page *page = &pages[i]; page != nullptr; page = page->next)
-          total += page->count;
+      Ai = malloc_with_check<SparseMatrix<Scalar>, int>(Ap[size], this);
+#pragma omp parallel for num_threads(num_threads)
+      for (int outer = 0; outer < (int)size; outer++)
+        memcpy(Ai + Ap[outer], inner + segment_start[outer], segment_nnz[outer] * sizeof(int));
+
+      free_with_check(segment_nnz);
+      free_with_check(segment_start);
+      free_with_check(inner);
 
-      return total;
+      return Ap[size];
     }
 
     template<>
@@ -347,6 +377,8 @@ namespace Hermes
       case Hermes::SOLVER_UMFPACK:
       {
 #ifdef WITH_UMFPACK
+        if (Hermes::HermesCommonApi.get_integral_param_value(Hermes::matrixBlockSize) > 1)
+          return new BSRMatrix < double >(Hermes::HermesCommonApi.get_integral_param_value(Hermes::matrixBlockSize));
         return new CSCMatrix < double > ;
 #else
         throw Hermes::Exceptions::Exception("UMFPACK was not installed.");
@@ -432,6 +464,8 @@ namespace Hermes
       case Hermes::SOLVER_UMFPACK:
       {
 #ifdef WITH_UMFPACK
+        if (Hermes::HermesCommonApi.get_integral_param_value(Hermes::matrixBlockSize) > 1)
+          return new BSRMatrix < std::complex<double> >(Hermes::HermesCommonApi.get_integral_param_value(Hermes::matrixBlockSize));
         return new CSCMatrix < std::complex<double> > ;
 #else
         throw Hermes::Exceptions::Exception("UMFPACK was not installed.");
@@ -398,7 +398,7 @@ namespace Hermes
     Vector<Scalar>* SimpleVector<Scalar>::set_vector(Hermes::Algebra::Vector<Scalar>* vec)
     {
       assert(this->get_size() == vec->get_size());
-      SimpleVector<Scalar>* simple_vec = (SimpleVector<Scalar>*)vec;
+      SimpleVector<Scalar>* simple_vec = dynamic_cast<SimpleVector<Scalar>*>(vec);
       if (simple_vec)
         memcpy(this->v, simple_vec->v, sizeof(Scalar)*this->size);
       else
@@ -425,8 +425,7 @@ namespace Hermes
     template<typename Scalar>
     Vector<Scalar>* SimpleVector<Scalar>::change_sign()
     {
-      for (unsigned int i = 0; i < this->size; i++)
-        v[i] *= -1.;
+      VectorOperations::scal<Scalar>(this->size, Scalar(-1.), this->v);
       return this;
     }
 
@@ -448,21 +447,11 @@ namespace Hermes
     {
       this->v[idx] = y;
     }
-    template<>
-    void SimpleVector<double>::add(unsigned int idx, double y)
-    {
-        if(y != 0.0)
-        {
-#pragma omp atomic
-            this->v[idx] += y;
-        }
-    }
-
-    template<>
-    void SimpleVector<std::complex<double> >::add(unsigned int idx, std::complex<double> y)
+    template<typename Scalar>
+    void SimpleVector<Scalar>::add(unsigned int idx, Scalar y)
     {
-#pragma omp critical (SimpleVector_add)
-      this->v[idx] += y;
+      if (y != 0.0)
+        add_atomic(this->v[idx], y);
     }
 
     template<typename Scalar>
@@ -496,6 +485,9 @@ namespace Hermes
     Vector<Scalar>* SimpleVector<Scalar>::subtract_vector(Vector<Scalar>* vec)
     {
       assert(this->get_size() == vec->get_size());
+      SimpleVector<Scalar>* simple_vec = dynamic_cast<SimpleVector<Scalar>*>(vec);
+      if (simple_vec)
+        return this->subtract_vector(simple_vec->v);
       for (unsigned int i = 0; i < this->size; i++)
         this->v[i] -= vec->get(i);
       return this;
@@ -504,8 +496,7 @@ namespace Hermes
     template<typename Scalar>
     Vector<Scalar>* SimpleVector<Scalar>::subtract_vector(Scalar* vec)
     {
-      for (unsigned int i = 0; i < this->size; i++)
-        this->v[i] -= vec[i];
+      VectorOperations::axpy<Scalar>(this->size, Scalar(-1.), vec, this->v);
       return this;
     }
 
@@ -513,6 +504,9 @@ namespace Hermes
     Vector<Scalar>* SimpleVector<Scalar>::add_vector(Vector<Scalar>* vec)
     {
       assert(this->get_size() == vec->get_size());
+      SimpleVector<Scalar>* simple_vec = dynamic_cast<SimpleVector<Scalar>*>(vec);
+      if (simple_vec)
+        return this->add_vector(simple_vec->v);
       for (unsigned int i = 0; i < this->size; i++)
         this->v[i] += vec->get(i);
       return this;
@@ -521,8 +515,7 @@ namespace Hermes
     template<typename Scalar>
     Vector<Scalar>* SimpleVector<Scalar>::add_vector(Scalar* vec)
     {
-      for (unsigned int i = 0; i < this->get_size(); i++)
-        this->v[i] += vec[i];
+      VectorOperations::axpy<Scalar>(this->size, Scalar(1.), vec, this->v);
       return this;
     }
 
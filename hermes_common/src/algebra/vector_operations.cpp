@@ -0,0 +1,412 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file vector_operations.cpp
+\brief Dense vector (BLAS level 1) operations.
+*/
+#include "vector_operations.h"
+#include "util/memory_handling.h"
+#include "api.h"
+
+// The reductions are vectorized only if the compiler is told that their order may change.
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define HERMES_VECTOR_OPERATIONS_PRAGMA(...) _Pragma(#__VA_ARGS__)
+#define HERMES_VECTOR_OPERATIONS_SIMD(...) HERMES_VECTOR_OPERATIONS_PRAGMA(omp simd __VA_ARGS__)
+#else
+#define HERMES_VECTOR_OPERATIONS_SIMD(...)
+#endif
+
+/// Length of the blocks of the differences in difference_gram() and of the result in linear_combination().
+#define HERMES_VECTOR_OPERATIONS_BLOCK_SIZE 512
+
+namespace Hermes
+{
+  namespace Algebra
+  {
+    namespace VectorOperations
+    {
+      static int get_num_threads(int n)
+      {
+        if (n < HERMES_VECTOR_OPERATIONS_MIN_PARALLEL_SIZE || omp_in_parallel())
+          return 1;
+        return HermesCommonApi.get_integral_param_value(numThreads);
+      }
+
+      static void get_thread_range(int n, int num_threads, int thread_number, int& start, int& end)
+      {
+        start = (n / num_threads) * thread_number;
+        end = (thread_number == num_threads - 1) ? n : (n / num_threads) * (thread_number + 1);
+      }
+
+      // Kernels on the range [start, end), complex numbers are processed as (real, imaginary) pairs of doubles.
+      static void axpy_range(double alpha, const double* x, double* y, int start, int end)
+      {
+        HERMES_VECTOR_OPERATIONS_SIMD()
+        for (int i = start; i < end; i++)
+          y[i] += alpha * x[i];
+      }
+
+      static void axpy_range(std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y, int start, int end)
+      {
+        const double ar = alpha.real(), ai = alpha.imag();
+        const double* xd = reinterpret_cast<const double*>(x);
+        double* yd = reinterpret_cast<double*>(y);
+        HERMES_VECTOR_OPERATIONS_SIMD()
+        for (int i = start; i < end; i++)
+        {
+          double xr = xd[2 * i], xi = xd[2 * i + 1];
+          yd[2 * i] += ar * xr - ai * xi;
+          yd[2 * i + 1] += ar * xi + ai * xr;
+        }
+      }
+
+      static void scal_range(double alpha, double* x, int start, int end)
+      {
+        HERMES_VECTOR_OPERATIONS_SIMD()
+        for (int i = start; i < end; i++)
+          x[i] *= alpha;
+      }
+
+      static void scal_range(std::complex<double> alpha, std::complex<double>* x, int start, int end)
+      {
+        const double ar = alpha.real(), ai = alpha.imag();
+        double* xd = reinterpret_cast<double*>(x);
+        HERMES_VECTOR_OPERATIONS_SIMD()
+        for (int i = start; i < end; i++)
+        {
+          double xr = xd[2 * i], xi = xd[2 * i + 1];
+          xd[2 * i] = ar * xr - ai * xi;
+          xd[2 * i + 1] = ar * xi + ai * xr;
+        }
+      }
+
+      static double dot_range(const double* x, const double* y, int start, int end)
+      {
+        double sum = 0.;
+        HERMES_VECTOR_OPERATIONS_SIMD(reduction(+:sum))
+        for (int i = start; i < end; i++)
+          sum += x[i] * y[i];
+        return sum;
+      }
+
+      static std::complex<double> dot_range(const std::complex<double>* x, const std::complex<double>* y, int start, int end)
+      {
+        const double* xd = reinterpret_cast<const double*>(x);
+        const double* yd = reinterpret_cast<const double*>(y);
+        double sum_real = 0., sum_imag = 0.;
+        HERMES_VECTOR_OPERATIONS_SIMD(reduction(+:sum_real, sum_imag))
+        for (int i = start; i < end; i++)
+        {
+          double xr = xd[2 * i], xi = xd[2 * i + 1], yr = yd[2 * i], yi = yd[2 * i + 1];
+          sum_real += xr * yr - xi * yi;
+          sum_imag += xr * yi + xi * yr;
+        }
+        return std::complex<double>(sum_real, sum_imag);
+      }
+
+      static double sum_squares_range(const double* x, int start, int end)
+      {
+        double sum = 0.;
+        HERMES_VECTOR_OPERATIONS_SIMD(reduction(+:sum))
+        for (int i = start; i < end; i++)
+          sum += x[i] * x[i];
+        return sum;
+      }
+
+      static double sum_squares_range(const std::complex<double>* x, int start, int end)
+      {
+        return sum_squares_range(reinterpret_cast<const double*>(x), 2 * start, 2 * end);
+      }
+
+      static double axpy_sum_squares_range(double alpha, const double* x, double* y, int start, int end)
+      {
+        double sum = 0.;
+        HERMES_VECTOR_OPERATIONS_SIMD(reduction(+:sum))
+        for (int i = start; i < end; i++)
+        {
+          double xi = x[i];
+          sum += xi * xi;
+          y[i] += alpha * xi;
+        }
+        return sum;
+      }
+
+      static double axpy_sum_squares_range(std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y, int start, int end)
+      {
+        const double ar = alpha.real(), ai = alpha.imag();
+        const double* xd = reinterpret_cast<const double*>(x);
+        double* yd = reinterpret_cast<double*>(y);
+        double sum = 0.;
+        HERMES_VECTOR_OPERATIONS_SIMD(reduction(+:sum))
+        for (int i = start; i < end; i++)
+        {
+          double xr = xd[2 * i], xi = xd[2 * i + 1];
+          sum += xr * xr + xi * xi;
+          yd[2 * i] += ar * xr - ai * xi;
+          yd[2 * i + 1] += ar * xi + ai * xr;
+        }
+        return sum;
+      }
+
+      static double relax_sum_squares_range(double alpha, const double* x, double* y, int start, int end)
+      {
+        double sum = 0.;
+        HERMES_VECTOR_OPERATIONS_SIMD(reduction(+:sum))
+        for (int i = start; i < end; i++)
+        {
+          double difference = x[i] - y[i];
+          sum += difference * difference;
+          y[i] += alpha * difference;
+        }
+        return sum;
+      }
+
+      static double relax_sum_squares_range(std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y, int start, int end)
+      {
+        const double ar = alpha.real(), ai = alpha.imag();
+        const double* xd = reinterpret_cast<const double*>(x);
+        double* yd = reinterpret_cast<double*>(y);
+        double sum = 0.;
+        HERMES_VECTOR_OPERATIONS_SIMD(reduction(+:sum))
+        for (int i = start; i < end; i++)
+        {
+          double dr = xd[2 * i] - yd[2 * i], di = xd[2 * i + 1] - yd[2 * i + 1];
+          sum += dr * dr + di * di;
+          yd[2 * i] += ar * dr - ai * di;
+          yd[2 * i + 1] += ar * di + ai * dr;
+        }
+        return sum;
+      }
+
+      template<typename Scalar>
+      static void linear_combination_range(int count, const Scalar* coeffs, Scalar** x, Scalar* y, int start, int end)
+      {
+        // Blocks of y stay in the cache while all the vectors are added.
+        for (int block_start = start; block_start < end; block_start += HERMES_VECTOR_OPERATIONS_BLOCK_SIZE)
+        {
+          int block_end = std::min(block_start + HERMES_VECTOR_OPERATIONS_BLOCK_SIZE, end);
+          std::fill(y + block_start, y + block_end, Scalar(0));
+          for (int j = 0; j < count; j++)
+            axpy_range(coeffs[j], x[j], y, block_start, block_end);
+        }
+      }
+
+      template<typename Scalar>
+      static void difference_gram_range(int count, Scalar** x, Scalar* gram, Scalar* differences, int start, int end)
+      {
+        std::fill(gram, gram + count * count, Scalar(0));
+        for (int block_start = start; block_start < end; block_start += HERMES_VECTOR_OPERATIONS_BLOCK_SIZE)
+        {
+          int block_length = std::min(HERMES_VECTOR_OPERATIONS_BLOCK_SIZE, end - block_start);
+          for (int a = 0; a < count; a++)
+          {
+            Scalar* difference = differences + a * HERMES_VECTOR_OPERATIONS_BLOCK_SIZE;
+            const Scalar* newer = x[a + 1] + block_start;
+            const Scalar* older = x[a] + block_start;
+            for (int i = 0; i < block_length; i++)
+              difference[i] = newer[i] - older[i];
+          }
+          for (int a = 0; a < count; a++)
+            for (int b = a; b < count; b++)
+              gram[a * count + b] += dot_range(differences + a * HERMES_VECTOR_OPERATIONS_BLOCK_SIZE, differences + b * HERMES_VECTOR_OPERATIONS_BLOCK_SIZE, 0, block_length);
+        }
+      }
+
+      template<typename Scalar>
+      void axpy(int n, Scalar alpha, const Scalar* x, Scalar* y)
+      {
+        int num_threads = get_num_threads(n);
+        if (num_threads == 1)
+        {
+          axpy_range(alpha, x, y, 0, n);
+          return;
+        }
+#pragma omp parallel num_threads(num_threads)
+        {
+          int start, end;
+          get_thread_range(n, num_threads, omp_get_thread_num(), start, end);
+          axpy_range(alpha, x, y, start, end);
+        }
+      }
+
+      template<typename Scalar>
+      void scal(int n, Scalar alpha, Scalar* x)
+      {
+        int num_threads = get_num_threads(n);
+        if (num_threads == 1)
+        {
+          scal_range(alpha, x, 0, n);
+          return;
+        }
+#pragma omp parallel num_threads(num_threads)
+        {
+          int start, end;
+          get_thread_range(n, num_threads, omp_get_thread_num(), start, end);
+          scal_range(alpha, x, start, end);
+        }
+      }
+
+      template<typename Scalar>
+      Scalar dot(int n, const Scalar* x, const Scalar* y)
+      {
+        int num_threads = get_num_threads(n);
+        if (num_threads == 1)
+          return dot_range(x, y, 0, n);
+
+        Scalar* partial_sums = malloc_with_check<Scalar>(num_threads);
+#pragma omp parallel num_threads(num_threads)
+        {
+          int thread_number = omp_get_thread_num(), start, end;
+          get_thread_range(n, num_threads, thread_number, start, end);
+          partial_sums[thread_number] = dot_range(x, y, start, end);
+        }
+        Scalar sum = 0.;
+        for (int thread_i = 0; thread_i < num_threads; thread_i++)
+          sum += partial_sums[thread_i];
+        free_with_check(partial_sums);
+        return sum;
+      }
+
+      template<typename Scalar>
+      double nrm2(int n, const Scalar* x)
+      {
+        int num_threads = get_num_threads(n);
+        if (num_threads == 1)
+          return std::sqrt(sum_squares_range(x, 0, n));
+
+        double* partial_sums = malloc_with_check<double>(num_threads);
+#pragma omp parallel num_threads(num_threads)
+        {
+          int thread_number = omp_get_thread_num(), start, end;
+          get_thread_range(n, num_threads, thread_number, start, end);
+          partial_sums[thread_number] = sum_squares_range(x, start, end);
+        }
+        double sum = 0.;
+        for (int thread_i = 0; thread_i < num_threads; thread_i++)
+          sum += partial_sums[thread_i];
+        free_with_check(partial_sums);
+        return std::sqrt(sum);
+      }
+
+      template<typename Scalar>
+      double axpy_nrm2(int n, Scalar alpha, const Scalar* x, Scalar* y)
+      {
+        int num_threads = get_num_threads(n);
+        if (num_threads == 1)
+          return std::sqrt(axpy_sum_squares_range(alpha, x, y, 0, n));
+
+        double* partial_sums = malloc_with_check<double>(num_threads);
+#pragma omp parallel num_threads(num_threads)
+        {
+          int thread_number = omp_get_thread_num(), start, end;
+          get_thread_range(n, num_threads, thread_number, start, end);
+          partial_sums[thread_number] = axpy_sum_squares_range(alpha, x, y, start, end);
+        }
+        double sum = 0.;
+        for (int thread_i = 0; thread_i < num_threads; thread_i++)
+          sum += partial_sums[thread_i];
+        free_with_check(partial_sums);
+        return std::sqrt(sum);
+      }
+
+      template<typename Scalar>
+      double relax_nrm2(int n, Scalar alpha, const Scalar* x, Scalar* y)
+      {
+        int num_threads = get_num_threads(n);
+        if (num_threads == 1)
+          return std::sqrt(relax_sum_squares_range(alpha, x, y, 0, n));
+
+        double* partial_sums = malloc_with_check<double>(num_threads);
+#pragma omp parallel num_threads(num_threads)
+        {
+          int thread_number = omp_get_thread_num(), start, end;
+          get_thread_range(n, num_threads, thread_number, start, end);
+          partial_sums[thread_number] = relax_sum_squares_range(alpha, x, y, start, end);
+        }
+        double sum = 0.;
+        for (int thread_i = 0; thread_i < num_threads; thread_i++)
+          sum += partial_sums[thread_i];
+        free_with_check(partial_sums);
+        return std::sqrt(sum);
+      }
+
+      template<typename Scalar>
+      void linear_combination(int n, int count, const Scalar* coeffs, Scalar** x, Scalar* y)
+      {
+        int num_threads = get_num_threads(n);
+        if (num_threads == 1)
+        {
+          linear_combination_range(count, coeffs, x, y, 0, n);
+          return;
+        }
+#pragma omp parallel num_threads(num_threads)
+        {
+          int start, end;
+          get_thread_range(n, num_threads, omp_get_thread_num(), start, end);
+          linear_combination_range(count, coeffs, x, y, start, end);
+        }
+      }
+
+      template<typename Scalar>
+      void difference_gram(int n, int count, Scalar** x, Scalar* gram)
+      {
+        int num_threads = get_num_threads(n);
+
+        // Every thread sums its range into its own matrix (upper triangle), the matrices are added in the order of the threads.
+        Scalar* partial_grams = malloc_with_check<Scalar>(num_threads * count * count);
+        Scalar* differences = malloc_with_check<Scalar>(num_threads * count * HERMES_VECTOR_OPERATIONS_BLOCK_SIZE);
+#pragma omp parallel num_threads(num_threads)
+        {
+          int thread_number = omp_get_thread_num(), start, end;
+          get_thread_range(n, num_threads, thread_number, start, end);
+          difference_gram_range(count, x, partial_grams + thread_number * count * count, differences + thread_number * count * HERMES_VECTOR_OPERATIONS_BLOCK_SIZE, start, end);
+        }
+
+        for (int a = 0; a < count; a++)
+        {
+          for (int b = a; b < count; b++)
+          {
+            Scalar sum = 0.;
+            for (int thread_i = 0; thread_i < num_threads; thread_i++)
+              sum += partial_grams[thread_i * count * count + a * count + b];
+            gram[a * count + b] = gram[b * count + a] = sum;
+          }
+        }
+        free_with_check(partial_grams);
+        free_with_check(differences);
+      }
+
+      template HERMES_API void axpy<double>(int n, double alpha, const double* x, double* y);
+      template HERMES_API void axpy<std::complex<double> >(int n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y);
+      template HERMES_API void scal<double>(int n, double alpha, double* x);
+      template HERMES_API void scal<std::complex<double> >(int n, std::complex<double> alpha, std::complex<double>* x);
+      template HERMES_API double dot<double>(int n, const double* x, const double* y);
+      template HERMES_API std::complex<double> dot<std::complex<double> >(int n, const std::complex<double>* x, const std::complex<double>* y);
+      template HERMES_API double nrm2<double>(int n, const double* x);
+      template HERMES_API double nrm2<std::complex<double> >(int n, const std::complex<double>* x);
+      template HERMES_API double axpy_nrm2<double>(int n, double alpha, const double* x, double* y);
+      template HERMES_API double axpy_nrm2<std::complex<double> >(int n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y);
+      template HERMES_API double relax_nrm2<double>(int n, double alpha, const double* x, double* y);
+      template HERMES_API double relax_nrm2<std::complex<double> >(int n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y);
+      template HERMES_API void linear_combination<double>(int n, int count, const double* coeffs, double** x, double* y);
+      template HERMES_API void linear_combination<std::complex<double> >(int n, int count, const std::complex<double>* coeffs, std::complex<double>** x, std::complex<double>* y);
+      template HERMES_API void difference_gram<double>(int n, int count, double** x, double* gram);
+      template HERMES_API void difference_gram<std::complex<double> >(int n, int count, std::complex<double>** x, std::complex<double>* gram);
+    }
+  }
+}
@@ -74,6 +74,7 @@ namespace Hermes
 #endif
     this->parameters.insert(std::pair<HermesCommonApiParam, Parameter*>(Hermes::useAccelerators, new Parameter(1)));
     this->parameters.insert(std::pair<HermesCommonApiParam, Parameter*>(Hermes::checkMeshesOnLoad, new Parameter(1)));
+    this->parameters.insert(std::pair<HermesCommonApiParam, Parameter*>(Hermes::matrixBlockSize, new Parameter(1)));
 
     // Set handlers.
 #ifdef WITH_PARALUTION
@@ -93,6 +93,13 @@ namespace Hermes
       grph->InsertGlobalIndices(row, 1, &col_to_pass);
     }
 
+    template<typename Scalar>
+    void EpetraMatrix<Scalar>::pre_add_ij(const uint64_t* ij, unsigned int count)
+    {
+      for (unsigned int i = 0; i < count; i++)
+        this->pre_add_ij((unsigned int)(ij[i] >> 32), (unsigned int)ij[i]);
+    }
+
     template<>
     void EpetraMatrix<double>::finish()
     {
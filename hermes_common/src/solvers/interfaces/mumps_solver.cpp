@@ -24,6 +24,7 @@
 #include "mumps_solver.h"
 #include "callstack.h"
 #include "util/memory_handling.h"
+#include <limits>
 
 namespace Hermes
 {
@@ -64,6 +65,10 @@ namespace Hermes
 #ifndef _WINDOWS
       extern void dmumps_c(DMUMPS_STRUC_C *mumps_param_ptr);
       extern void zmumps_c(ZMUMPS_STRUC_C *mumps_param_ptr);
+#ifdef HAVE_MUMPS_SINGLE
+      extern void smumps_c(SMUMPS_STRUC_C *mumps_param_ptr);
+      extern void cmumps_c(CMUMPS_STRUC_C *mumps_param_ptr);
+#endif
 #endif
     }
 
@@ -109,6 +114,35 @@ namespace Hermes
       a = b;
     }
 
+#ifdef HAVE_MUMPS_SINGLE
+    inline void mumps_assign_single(float & a, double b)
+    {
+      a = (float)b;
+    }
+
+    inline void mumps_assign_single(CMUMPS_COMPLEX & a, ZMUMPS_COMPLEX b)
+    {
+      a.r = (float)b.r;
+      a.i = (float)b.i;
+    }
+
+    inline void mumps_assign_single(CMUMPS_COMPLEX & a, std::complex<double> b)
+    {
+      a.r = (float)b.real();
+      a.i = (float)b.imag();
+    }
+
+    inline double mumps_single_to_Scalar(float x)
+    {
+      return x;
+    }
+
+    inline std::complex<double> mumps_single_to_Scalar(CMUMPS_COMPLEX x)
+    {
+      return std::complex<double>(x.r, x.i);
+    }
+#endif
+
     template<typename Scalar>
     MumpsMatrix<Scalar>::MumpsMatrix() : CSCMatrix<Scalar>(), irn(nullptr), jcn(nullptr), Ax(nullptr)
     {
@@ -190,8 +224,10 @@ namespace Hermes
         throw Hermes::Exceptions::Exception("Sparse matrix entry not found");
       // Add offset to the n-th column.
       pos += this->Ap[n];
-#pragma omp critical (MumpsMatrix_add)
-      Ax[pos] += v;
+#pragma omp atomic
+      Ax[pos].r += v.real();
+#pragma omp atomic
+      Ax[pos].i += v.imag();
       // MUMPS is indexing from 1
       irn[pos] = m + 1;
       jcn[pos] = n + 1;
@@ -635,13 +671,19 @@ namespace Hermes
 #define JOB_END                     -2
 #define JOB_ANALYZE_FACTORIZE_SOLVE  6
 #define JOB_FACTORIZE_SOLVE          5
+#define JOB_ANALYZE_FACTORIZE        4
 #define JOB_SOLVE                    3
+#define JOB_FACTORIZE                2
 
     template<typename Scalar>
     MumpsSolver<Scalar>::MumpsSolver(MumpsMatrix<Scalar> *m, SimpleVector<Scalar> *rhs) :
       DirectSolver<Scalar>(m, rhs), m(m), rhs(rhs), icntl_14(init_icntl_14)
     {
       inited = false;
+#ifdef HAVE_MUMPS_SINGLE
+      single_Ax = nullptr;
+      single_inited = single_factorized = single_refinement_failed = double_factorization_outdated = false;
+#endif
 
       // Initial values for some fields of the MUMPS_STRUC structure that may be accessed
       // before MUMPS has been initialized.
@@ -669,7 +711,35 @@ namespace Hermes
 
       if (param.rhs != nullptr)
         free_with_check(param.rhs);
+
+#ifdef HAVE_MUMPS_SINGLE
+      free_single();
+#endif
+    }
+
+    template<typename Scalar>
+    bool MumpsSolver<Scalar>::supports_mixed_precision() const
+    {
+#ifdef HAVE_MUMPS_SINGLE
+      return true;
+#else
+      return false;
+#endif
+    }
+
+#ifdef HAVE_MUMPS_SINGLE
+    template<typename Scalar>
+    void MumpsSolver<Scalar>::free_single()
+    {
+      if (single_inited)
+      {
+        single_param.job = JOB_END;
+        mumps_c(&single_param);
+        single_inited = single_factorized = false;
+      }
+      free_with_check(single_Ax);
     }
+#endif
 
     template<>
     void MumpsSolver<double>::mumps_c(mumps_type<double>::mumps_struct * param)
@@ -683,6 +753,20 @@ namespace Hermes
       zmumps_c(param);
     }
 
+#ifdef HAVE_MUMPS_SINGLE
+    template<>
+    void MumpsSolver<double>::mumps_c(mumps_type<double>::mumps_single_struct * param)
+    {
+      smumps_c(param);
+    }
+
+    template<>
+    void MumpsSolver<std::complex<double> >::mumps_c(mumps_type<std::complex<double> >::mumps_single_struct * param)
+    {
+      cmumps_c(param);
+    }
+#endif
+
     template<typename Scalar>
     bool MumpsSolver<Scalar>::check_status()
     {
@@ -776,10 +860,36 @@ namespace Hermes
 
       this->tick();
 
+#ifdef HAVE_MUMPS_SINGLE
+      if (this->mixed_precision)
+      {
+        if (solve_mixed_precision())
+        {
+          this->tick();
+          this->time = this->accumulated();
+          return;
+        }
+
+        // The single precision factorization failed, the mode is off.
+        if (!this->mixed_precision)
+          free_single();
+      }
+
+      // The double precision factors belong to another matrix - they can not be reused.
+      MatrixStructureReuseScheme reuse_scheme = this->reuse_scheme;
+      if (double_factorization_outdated)
+        this->reuse_scheme = HERMES_CREATE_STRUCTURE_FROM_SCRATCH;
+      double_factorization_outdated = false;
+#endif
+
       // Prepare the MUMPS data structure with input for the solver driver
       // (according to the chosen factorization reuse strategy), as well as
       // the system matrix.
-      if (!setup_factorization())
+      bool factorization_set_up = setup_factorization();
+#ifdef HAVE_MUMPS_SINGLE
+      this->reuse_scheme = reuse_scheme;
+#endif
+      if (!factorization_set_up)
         throw Hermes::Exceptions::LinearMatrixSolverException("LU factorization could not be completed.");
 
       // Specify the right-hand side (will be replaced by the solution).
@@ -884,6 +994,191 @@ namespace Hermes
       return true;
     }
 
+#ifdef HAVE_MUMPS_SINGLE
+    template<typename Scalar>
+    void MumpsSolver<Scalar>::reinit_single()
+    {
+      if (single_inited)
+      {
+        single_param.job = JOB_END;
+        mumps_c(&single_param);
+      }
+
+      single_param.job = JOB_INIT;
+      single_param.par = 1;
+      single_param.sym = 0;
+      single_param.comm_fortran = USE_COMM_WORLD;
+      mumps_c(&single_param);
+      if (single_param.INFOG(1) != 0)
+        throw Hermes::Exceptions::LinearMatrixSolverException("Single precision MUMPS could not be initialized: INFOG(1) = %d", single_param.INFOG(1));
+      single_inited = true;
+      single_factorized = false;
+
+      // The same settings as the double precision instance (see reinit()).
+      single_param.ICNTL(1) = -1;
+      single_param.ICNTL(2) = -1;
+      single_param.ICNTL(3) = -1;
+      single_param.ICNTL(4) = 0;
+      single_param.ICNTL(5) = 0;
+      single_param.ICNTL(18) = 0;
+      single_param.ICNTL(20) = 0;
+      single_param.ICNTL(21) = 0;
+      single_param.ICNTL(14) = 100 * this->icntl_14;
+      single_param.ICNTL(6) = 7;
+      single_param.ICNTL(8) = 77;
+
+      single_param.n = m->size;
+      single_param.nz = m->nnz;
+      single_param.irn = m->irn;
+      single_param.jcn = m->jcn;
+      single_param.a = single_Ax;
+    }
+
+    template<typename Scalar>
+    bool MumpsSolver<Scalar>::solve_mixed_precision()
+    {
+      int size = m->size;
+
+      // Factorization - reuse of the structures as in setup_factorization(), only the analysis is kept whenever possible.
+      if (!single_factorized || this->reuse_scheme != HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY)
+      {
+        bool analyze = !single_inited || single_param.n != size || single_param.nz != (int)m->nnz || this->reuse_scheme == HERMES_CREATE_STRUCTURE_FROM_SCRATCH;
+        if (analyze)
+        {
+          free_with_check(single_Ax);
+          single_Ax = malloc_with_check<MumpsSolver<Scalar>, typename mumps_type<Scalar>::mumps_single_Scalar>(m->nnz, this);
+        }
+        for (unsigned int i = 0; i < m->nnz; i++)
+          mumps_assign_single(single_Ax[i], m->Ax[i]);
+
+        // Infinity norm of the matrix (for the backward error of the solution).
+        double* row_sums = calloc_with_check<MumpsSolver<Scalar>, double>(size, this);
+        for (unsigned int i = 0; i < m->nnz; i++)
+          row_sums[m->Ai[i]] += std::abs(mumps_to_Scalar(m->Ax[i]));
+        single_matrix_norm = 0.;
+        for (int i = 0; i < size; i++)
+          single_matrix_norm = std::max(single_matrix_norm, row_sums[i]);
+        free_with_check(row_sums);
+
+        if (analyze)
+          reinit_single();
+        single_param.a = single_Ax;
+        single_param.irn = m->irn;
+        single_param.jcn = m->jcn;
+        single_param.job = analyze ? JOB_ANALYZE_FACTORIZE : JOB_FACTORIZE;
+        mumps_c(&single_param);
+
+        // Workspace too small (more fill-in than predicted by the analysis) - enlarged as in solve().
+        while ((single_param.INFOG(1) == -8 || single_param.INFOG(1) == -9) && single_param.ICNTL(14) < 100 * max_icntl_14)
+        {
+          single_param.ICNTL(14) *= 2;
+          single_param.job = JOB_FACTORIZE;
+          mumps_c(&single_param);
+        }
+
+        // The double precision factors (if any) belong to another matrix now.
+        double_factorization_outdated = true;
+        single_factorized = single_refinement_failed = false;
+
+        // Singular in single precision, or out of memory - the mixed precision is not used anymore.
+        if (single_param.INFOG(1) != 0)
+        {
+          this->warn("MumpsSolver: single precision factorization failed (INFOG(1) = %d), mixed precision switched off.", single_param.INFOG(1));
+          this->mixed_precision = false;
+          return false;
+        }
+        single_factorized = true;
+      }
+      // The refinement is known not to converge with these factors.
+      else if (single_refinement_failed)
+        return false;
+
+      // Iterative refinement: x += A_single^-1 (b - A x), the residual in the full precision.
+      Scalar* x = calloc_with_check<MumpsSolver<Scalar>, Scalar>(size, this);
+      Scalar* residual = malloc_with_check<MumpsSolver<Scalar>, Scalar>(size, this);
+      typename mumps_type<Scalar>::mumps_single_Scalar* correction = malloc_with_check<MumpsSolver<Scalar>, typename mumps_type<Scalar>::mumps_single_Scalar>(size, this);
+      memcpy(residual, rhs->v, size * sizeof(Scalar));
+
+      double rhs_norm = 0., rhs_max_norm = 0.;
+      for (int i = 0; i < size; i++)
+      {
+        rhs_norm += std::norm(rhs->v[i]);
+        rhs_max_norm = std::max(rhs_max_norm, std::abs(rhs->v[i]));
+      }
+      rhs_norm = std::sqrt(rhs_norm);
+
+      bool converged = (rhs_norm == 0.), solve_failed = false;
+      double previous_residual_norm = rhs_norm;
+      for (unsigned int step = 0; !converged && step < this->mixed_precision_max_refinement_steps; step++)
+      {
+        for (int i = 0; i < size; i++)
+          mumps_assign_single(correction[i], residual[i]);
+        single_param.rhs = correction;
+        single_param.job = JOB_SOLVE;
+        mumps_c(&single_param);
+        single_param.rhs = nullptr;
+        if (single_param.INFOG(1) != 0)
+        {
+          solve_failed = true;
+          break;
+        }
+
+        for (int i = 0; i < size; i++)
+          x[i] += mumps_single_to_Scalar(correction[i]);
+
+        // residual = b - A x (A in CSC).
+        memcpy(residual, rhs->v, size * sizeof(Scalar));
+        for (int col = 0; col < size; col++)
+          for (int k = m->Ap[col]; k < m->Ap[col + 1]; k++)
+            residual[m->Ai[k]] -= mumps_to_Scalar(m->Ax[k]) * x[col];
+
+        double residual_norm = 0., residual_max_norm = 0., x_max_norm = 0.;
+        for (int i = 0; i < size; i++)
+        {
+          residual_norm += std::norm(residual[i]);
+          residual_max_norm = std::max(residual_max_norm, std::abs(residual[i]));
+          x_max_norm = std::max(x_max_norm, std::abs(x[i]));
+        }
+        residual_norm = std::sqrt(residual_norm);
+
+        this->info("\tMumpsSolver: mixed-precision refinement step %i, relative residual %g.", step + 1, residual_norm / rhs_norm);
+
+        // Either the requested tolerance, or the backward error of a double precision solution
+        // ||b - A x|| <= c eps (||A|| ||x|| + ||b||) - the residual does not decrease below that.
+        if (residual_norm <= this->mixed_precision_tolerance * rhs_norm
+          || residual_max_norm <= std::sqrt((double)size) * std::numeric_limits<double>::epsilon() * (single_matrix_norm * x_max_norm + rhs_max_norm))
+          converged = true;
+        // Each step has to reduce the residual substantially, otherwise the single precision factors are too inaccurate for this matrix.
+        else if (residual_norm > 0.5 * previous_residual_norm)
+          break;
+        previous_residual_norm = residual_norm;
+      }
+
+      if (converged)
+      {
+        free_with_check(this->sln);
+        this->sln = x;
+      }
+      else
+        free_with_check(x);
+      free_with_check(residual);
+      free_with_check(correction);
+
+      if (solve_failed)
+      {
+        this->warn("MumpsSolver: single precision solution failed (INFOG(1) = %d), mixed precision switched off.", single_param.INFOG(1));
+        this->mixed_precision = false;
+      }
+      else if (!converged)
+      {
+        this->warn("MumpsSolver: iterative refinement of the single precision solution did not converge, solving in double precision.");
+        single_refinement_failed = true;
+      }
+
+      return converged;
+    }
+#endif
+
     template class HERMES_API MumpsSolver < double > ;
     template class HERMES_API MumpsSolver < std::complex<double> > ;
   }
@@ -112,25 +112,13 @@ namespace Hermes
     template<typename Scalar>
     void PetscMatrix<Scalar>::alloc()
     {
-      assert(this->pages != nullptr);
-
-      // calc nnz
+      // calc nnz of the rows
+      int *ap, *ai;
+      nnz = this->compress_structure(true, ap, ai);
       int *nnz_array = malloc_with_check<int>(this->size);
-
-      // fill in nnz_array
-      int aisize = this->get_num_indices();
-      int *ai = malloc_with_check<int>(aisize);
-
-      // sort the indices and remove duplicities, insert into ai
-      int pos = 0;
       for (unsigned int i = 0; i < this->size; i++)
-      {
-        nnz_array[i] = this->sort_and_store_indices(this->pages[i], ai + pos, ai + aisize);
-        pos += nnz_array[i];
-      }
-      // stote the number of nonzeros
-      nnz = pos;
-      free_with_check(this->pages);
+        nnz_array[i] = ap[i + 1] - ap[i];
+      free_with_check(ap);
       free_with_check(ai);
 
       //
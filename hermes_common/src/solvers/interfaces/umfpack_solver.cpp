@@ -45,7 +45,14 @@ namespace Hermes
 
     template<typename Scalar>
     UMFPackLinearMatrixSolver<Scalar>::UMFPackLinearMatrixSolver(CSCMatrix<Scalar> *m, SimpleVector<Scalar> *rhs)
-      : DirectSolver<Scalar>(m, rhs), m(m), rhs(rhs), symbolic(nullptr), numeric(nullptr)
+      : DirectSolver<Scalar>(m, rhs), m(m), bsr_matrix(nullptr), rhs(rhs), symbolic(nullptr), numeric(nullptr)
+    {
+      umfpack_di_defaults(Control);
+    }
+
+    template<typename Scalar>
+    UMFPackLinearMatrixSolver<Scalar>::UMFPackLinearMatrixSolver(BSRMatrix<Scalar> *bsr_matrix, SimpleVector<Scalar> *rhs)
+      : DirectSolver<Scalar>(bsr_matrix, rhs), m(new CSCMatrix<Scalar>), bsr_matrix(bsr_matrix), rhs(rhs), symbolic(nullptr), numeric(nullptr)
     {
       umfpack_di_defaults(Control);
     }
@@ -54,6 +61,8 @@ namespace Hermes
     UMFPackLinearMatrixSolver<Scalar>::~UMFPackLinearMatrixSolver()
     {
       free();
+      if (bsr_matrix)
+        delete m;
     }
 
     template<typename Scalar>
@@ -65,7 +74,7 @@ namespace Hermes
     template<typename Scalar>
     int UMFPackLinearMatrixSolver<Scalar>::get_matrix_size()
     {
-      return m->get_size();
+      return bsr_matrix ? bsr_matrix->get_size() : m->get_size();
     }
 
     template<>
@@ -178,8 +187,12 @@ namespace Hermes
     }
 
     template<>
-    void UMFPackLinearMatrixSolver<double>::solve()
+    void UMFPackLinearMatrixSolver<double>::solve_system(int umfpack_system)
     {
+      // The pattern of the converted matrix is the same as long as the block structure is, the factorization reuse holds.
+      if (bsr_matrix)
+        bsr_matrix->convert_to_csc(m);
+
       assert(m != nullptr);
       assert(rhs != nullptr);
       assert(m->get_size() == rhs->get_size());
@@ -192,7 +205,7 @@ namespace Hermes
       free_with_check(sln);
 
       sln = calloc_with_check<UMFPackLinearMatrixSolver<double>, double>(m->get_size(), this);
-      int status = umfpack_real_solve(UMFPACK_A, m->get_Ap(), m->get_Ai(), m->get_Ax(), sln, rhs->v, numeric, nullptr, nullptr);
+      int status = umfpack_real_solve(umfpack_system, m->get_Ap(), m->get_Ai(), m->get_Ax(), sln, rhs->v, numeric, nullptr, nullptr);
       if (status != UMFPACK_OK)
       {
         this->free_factorization_data();
@@ -203,8 +216,24 @@ namespace Hermes
     }
 
     template<>
-    void UMFPackLinearMatrixSolver<std::complex<double> >::solve()
+    void UMFPackLinearMatrixSolver<double>::solve()
     {
+      this->solve_system(UMFPACK_A);
+    }
+
+    template<>
+    void UMFPackLinearMatrixSolver<double>::solve_transposed()
+    {
+      this->solve_system(UMFPACK_At);
+    }
+
+    template<>
+    void UMFPackLinearMatrixSolver<std::complex<double> >::solve_system(int umfpack_system)
+    {
+      // The pattern of the converted matrix is the same as long as the block structure is, the factorization reuse holds.
+      if (bsr_matrix)
+        bsr_matrix->convert_to_csc(m);
+
       assert(m != nullptr);
       assert(rhs != nullptr);
       assert(m->get_size() == rhs->get_size());
@@ -217,7 +246,7 @@ namespace Hermes
       sln = malloc_with_check<UMFPackLinearMatrixSolver<std::complex<double> >, std::complex<double> >(m->get_size(), this);
 
       memset(sln, 0, m->get_size() * sizeof(std::complex<double>));
-      int status = umfpack_complex_solve(UMFPACK_A, m->get_Ap(), m->get_Ai(), (double *)m->get_Ax(), nullptr, (double*)sln, nullptr, (double *)rhs->v, nullptr, numeric, nullptr, nullptr);
+      int status = umfpack_complex_solve(umfpack_system, m->get_Ap(), m->get_Ai(), (double *)m->get_Ax(), nullptr, (double*)sln, nullptr, (double *)rhs->v, nullptr, numeric, nullptr, nullptr);
       if (status != UMFPACK_OK)
       {
         this->free_factorization_data();
@@ -228,6 +257,19 @@ namespace Hermes
       time = this->accumulated();
     }
 
+    template<>
+    void UMFPackLinearMatrixSolver<std::complex<double> >::solve()
+    {
+      this->solve_system(UMFPACK_A);
+    }
+
+    template<>
+    void UMFPackLinearMatrixSolver<std::complex<double> >::solve_transposed()
+    {
+      // Array (not conjugate) transpose.
+      this->solve_system(UMFPACK_Aat);
+    }
+
     template<typename Scalar>
     char* UMFPackLinearMatrixSolver<Scalar>::check_status(const char *fn_name, int status)
     {
@@ -44,6 +44,9 @@ namespace Hermes
       time = -1.0;
       n_eq = 1;
       node_wise_ordering = false;
+      mixed_precision = false;
+      mixed_precision_tolerance = 1e-12;
+      mixed_precision_max_refinement_steps = 20;
     }
 
     template<typename Scalar>
@@ -109,6 +112,37 @@ namespace Hermes
       this->node_wise_ordering = false;
     }
 
+    template<typename Scalar>
+    void LinearMatrixSolver<Scalar>::solve_transposed()
+    {
+      throw Exceptions::MethodNotOverridenException("LinearMatrixSolver<Scalar>::solve_transposed");
+    }
+
+    template<typename Scalar>
+    bool LinearMatrixSolver<Scalar>::supports_transposed_solve() const
+    {
+      return false;
+    }
+
+    template<typename Scalar>
+    void LinearMatrixSolver<Scalar>::use_mixed_precision(bool to_set, double tolerance, unsigned int max_refinement_steps)
+    {
+      if (to_set && !this->supports_mixed_precision())
+      {
+        this->warn("LinearMatrixSolver: mixed precision is not supported by this solver, ignored.");
+        return;
+      }
+      this->mixed_precision = to_set;
+      this->mixed_precision_tolerance = tolerance;
+      this->mixed_precision_max_refinement_steps = max_refinement_steps;
+    }
+
+    template<typename Scalar>
+    bool LinearMatrixSolver<Scalar>::supports_mixed_precision() const
+    {
+      return false;
+    }
+
     template<typename Scalar>
     double LinearMatrixSolver<Scalar>::get_residual_norm()
     {
@@ -236,6 +270,11 @@ namespace Hermes
       case Hermes::SOLVER_UMFPACK:
       {
 #ifdef WITH_UMFPACK
+        if (dynamic_cast<BSRMatrix<double>*>(matrix))
+        {
+          if (rhs != nullptr) return new UMFPackLinearMatrixSolver<double>(static_cast<BSRMatrix<double>*>(matrix), static_cast<SimpleVector<double>*>(rhs));
+          else return new UMFPackLinearMatrixSolver<double>(static_cast<BSRMatrix<double>*>(matrix), static_cast<SimpleVector<double>*>(rhs_dummy));
+        }
         if (rhs != nullptr) return new UMFPackLinearMatrixSolver<double>(static_cast<CSCMatrix<double>*>(matrix), static_cast<SimpleVector<double>*>(rhs));
         else return new UMFPackLinearMatrixSolver<double>(static_cast<CSCMatrix<double>*>(matrix), static_cast<SimpleVector<double>*>(rhs_dummy));
 #else
@@ -341,6 +380,11 @@ namespace Hermes
       case Hermes::SOLVER_UMFPACK:
       {
 #ifdef WITH_UMFPACK
+        if (dynamic_cast<BSRMatrix<std::complex<double> >*>(matrix))
+        {
+          if (rhs != nullptr) return new UMFPackLinearMatrixSolver<std::complex<double> >(static_cast<BSRMatrix<std::complex<double> >*>(matrix), static_cast<SimpleVector<std::complex<double> >*>(rhs));
+          else return new UMFPackLinearMatrixSolver<std::complex<double> >(static_cast<BSRMatrix<std::complex<double> >*>(matrix), static_cast<SimpleVector<std::complex<double> >*>(rhs_dummy));
+        }
         if (rhs != nullptr) return new UMFPackLinearMatrixSolver<std::complex<double> >(static_cast<CSCMatrix<std::complex<double> >*>(matrix), static_cast<SimpleVector<std::complex<double> >*>(rhs));
         else return new UMFPackLinearMatrixSolver<std::complex<double> >(static_cast<CSCMatrix<std::complex<double> >*>(matrix), static_cast<SimpleVector<std::complex<double> >*>(rhs_dummy));
 #else
@@ -440,6 +484,18 @@ namespace Hermes
       this->toleranceType = toleranceType;
     }
 
+    template<typename Scalar>
+    double LoopSolver<Scalar>::get_tolerance() const
+    {
+      return this->tolerance;
+    }
+
+    template<typename Scalar>
+    LoopSolverToleranceType LoopSolver<Scalar>::get_tolerance_type() const
+    {
+      return this->toleranceType;
+    }
+
     template<typename Scalar>
     void LoopSolver<Scalar>::set_max_iters(int iters)
     {
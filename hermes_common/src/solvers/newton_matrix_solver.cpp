@@ -47,6 +47,25 @@ namespace Hermes
       this->set_tolerance(1e-8, ResidualNormAbsolute);
     }
 
+    template<typename Scalar>
+    void NewtonMatrixSolver<Scalar>::use_inexact_newton(InexactNewtonForcingTerm forcing_term, double initial_forcing_term, double max_forcing_term, double gamma, double alpha)
+    {
+      if (initial_forcing_term <= 0.0 || initial_forcing_term >= 1.0)
+        throw Exceptions::ValueException("initial_forcing_term", initial_forcing_term, 0.0, 1.0);
+      if (max_forcing_term <= 0.0 || max_forcing_term >= 1.0)
+        throw Exceptions::ValueException("max_forcing_term", max_forcing_term, 0.0, 1.0);
+      if (gamma <= 0.0 || gamma > 1.0)
+        throw Exceptions::ValueException("gamma", gamma, 0.0, 1.0);
+      if (alpha <= 1.0 || alpha > 2.0)
+        throw Exceptions::ValueException("alpha", alpha, 1.0, 2.0);
+
+      this->inexact_newton_forcing_term = forcing_term;
+      this->inexact_newton_initial_forcing_term = initial_forcing_term;
+      this->inexact_newton_max_forcing_term = max_forcing_term;
+      this->inexact_newton_gamma = gamma;
+      this->inexact_newton_alpha = alpha;
+    }
+
     template<typename Scalar>
     NonlinearConvergenceState NewtonMatrixSolver<Scalar>::get_convergence_state()
     {
@@ -63,13 +82,8 @@ namespace Hermes
     {
       double current_damping_factor = this->get_parameter_value(this->p_damping_factors).back();
 
-      double solution_change_norm = 0.;
-      for (int i = 0; i < this->problem_size; i++)
-      {
-        solution_change_norm += std::pow(std::abs(linear_system_solution[i]), 2.);
-        this->sln_vector[i] += current_damping_factor * linear_system_solution[i];
-      }
-      return std::sqrt(solution_change_norm) * current_damping_factor;
+      double solution_change_norm = VectorOperations::axpy_nrm2<Scalar>(this->problem_size, current_damping_factor, linear_system_solution, this->sln_vector);
+      return solution_change_norm * current_damping_factor;
     }
 
     template class HERMES_API NewtonMatrixSolver < double > ;
@@ -45,6 +45,10 @@ namespace Hermes
       this->previous_sln_vector = nullptr;
       this->use_initial_guess_for_iterative_solvers = false;
       this->clear_tolerances();
+      this->inexact_newton_forcing_term = InexactNewtonOff;
+      this->inexact_newton_linear_rhs = nullptr;
+      this->inexact_newton_linear_product = nullptr;
+      this->linear_solver_tolerance_stored = false;
     }
 
     template<typename Scalar>
@@ -115,6 +119,13 @@ namespace Hermes
       this->previous_jacobian = nullptr;
       this->previous_residual = nullptr;
 
+      for (int i = 0; i < 3; i++)
+        this->inexact_newton_state[i] = this->inexact_newton_state_back[i] = -1.;
+      // Left over by a previous solve() that ended by an exception.
+      free_with_check(this->inexact_newton_linear_rhs);
+      free_with_check(this->inexact_newton_linear_product);
+      this->restore_linear_solver_tolerance();
+
       this->on_initialization();
     }
 
@@ -219,6 +230,98 @@ namespace Hermes
       this->max_steps_with_reused_jacobian = steps;
     }
 
+    template<typename Scalar>
+    void NonlinearMatrixSolver<Scalar>::set_inexact_newton_forcing_term()
+    {
+      LoopSolver<Scalar>* loop_solver = dynamic_cast<LoopSolver<Scalar>*>(this->linear_matrix_solver);
+      if (!loop_solver)
+        return;
+
+      memcpy(this->inexact_newton_state_back, this->inexact_newton_state, 3 * sizeof(double));
+      double previous_forcing_term = this->inexact_newton_state[0];
+      double previous_residual_norm = this->inexact_newton_state[1];
+      double previous_linear_residual_norm = this->inexact_newton_state[2];
+      double residual_norm = get_l2_norm(this->get_residual());
+
+      double forcing_term = this->inexact_newton_initial_forcing_term;
+      if (previous_residual_norm > 0.)
+      {
+        double safeguard;
+        if (this->inexact_newton_forcing_term == EisenstatWalkerChoice1)
+        {
+          forcing_term = std::abs(residual_norm - previous_linear_residual_norm) / previous_residual_norm;
+          safeguard = std::pow(previous_forcing_term, (1. + std::sqrt(5.)) / 2.);
+        }
+        else
+        {
+          forcing_term = this->inexact_newton_gamma * std::pow(residual_norm / previous_residual_norm, this->inexact_newton_alpha);
+          safeguard = this->inexact_newton_gamma * std::pow(previous_forcing_term, this->inexact_newton_alpha);
+        }
+        // The forcing terms must not decrease too fast while the convergence is not fast yet.
+        if (safeguard > 0.1)
+          forcing_term = std::max(forcing_term, safeguard);
+      }
+
+      // No oversolving when close to the (absolute) nonlinear tolerance.
+      if (this->tolerance_set[3] && residual_norm > 0.)
+        forcing_term = std::max(forcing_term, 0.5 * this->tolerance[3] / residual_norm);
+      forcing_term = std::min(forcing_term, this->inexact_newton_max_forcing_term);
+
+      this->info("\tNonlinearSolver: inexact Newton forcing term: %g.", forcing_term);
+      if (!this->linear_solver_tolerance_stored)
+      {
+        this->linear_solver_tolerance = loop_solver->get_tolerance();
+        this->linear_solver_tolerance_type = loop_solver->get_tolerance_type();
+        this->linear_solver_tolerance_stored = true;
+      }
+      loop_solver->set_tolerance(forcing_term, RelativeTolerance);
+
+      this->inexact_newton_state[0] = forcing_term;
+      this->inexact_newton_state[1] = residual_norm;
+    }
+
+    template<typename Scalar>
+    void NonlinearMatrixSolver<Scalar>::store_inexact_newton_linear_residual()
+    {
+      if (this->inexact_newton_forcing_term != EisenstatWalkerChoice1 || !dynamic_cast<LoopSolver<Scalar>*>(this->linear_matrix_solver))
+        return;
+
+      if (!this->inexact_newton_linear_rhs)
+      {
+        this->inexact_newton_linear_rhs = malloc_with_check<NonlinearMatrixSolver<Scalar>, Scalar>(this->problem_size, this);
+        this->inexact_newton_linear_product = malloc_with_check<NonlinearMatrixSolver<Scalar>, Scalar>(this->problem_size, this);
+      }
+      this->get_residual()->extract(this->inexact_newton_linear_rhs);
+      this->get_jacobian()->multiply_with_vector(this->linear_matrix_solver->get_sln_vector(), this->inexact_newton_linear_product, true);
+
+      this->update_inexact_newton_linear_residual_norm(this->get_parameter_value(this->p_damping_factors).back());
+    }
+
+    template<typename Scalar>
+    void NonlinearMatrixSolver<Scalar>::update_inexact_newton_linear_residual_norm(double damping_factor)
+    {
+      if (!this->inexact_newton_linear_rhs)
+        return;
+
+      double norm = 0.;
+      for (int i = 0; i < this->problem_size; i++)
+        norm += std::norm(this->inexact_newton_linear_rhs[i] - damping_factor * this->inexact_newton_linear_product[i]);
+
+      this->inexact_newton_state[2] = std::sqrt(norm);
+    }
+
+    template<typename Scalar>
+    void NonlinearMatrixSolver<Scalar>::restore_linear_solver_tolerance()
+    {
+      if (!this->linear_solver_tolerance_stored)
+        return;
+
+      LoopSolver<Scalar>* loop_solver = dynamic_cast<LoopSolver<Scalar>*>(this->linear_matrix_solver);
+      if (loop_solver)
+        loop_solver->set_tolerance(this->linear_solver_tolerance, this->linear_solver_tolerance_type);
+      this->linear_solver_tolerance_stored = false;
+    }
+
     template<typename Scalar>
     void NonlinearMatrixSolver<Scalar>::set_min_allowed_damping_coeff(double min_allowed_damping_coeff_to_set)
     {
@@ -289,6 +392,9 @@ namespace Hermes
       if (state == NotConverged)
         return false;
 
+      // Finishing (also by an exception).
+      this->restore_linear_solver_tolerance();
+
       // Act upon the state.
       switch (state)
       {
@@ -372,6 +478,9 @@ namespace Hermes
     void NonlinearMatrixSolver<Scalar>::deinit_solving()
     {
       free_with_check(this->previous_sln_vector, true);
+      free_with_check(this->inexact_newton_linear_rhs);
+      free_with_check(this->inexact_newton_linear_product);
+      this->restore_linear_solver_tolerance();
       delete residual_back;
       this->problem_size = -1;
       if (this->previous_jacobian)
@@ -449,9 +558,15 @@ namespace Hermes
       // store the previous solution to previous_sln_vector.
       memcpy(this->previous_sln_vector, this->sln_vector, sizeof(Scalar)*this->problem_size);
 
+      if (this->inexact_newton_forcing_term != InexactNewtonOff)
+        this->set_inexact_newton_forcing_term();
+
       // Solve, if the solver is iterative, give him the initial guess.
       this->linear_matrix_solver->solve(this->use_initial_guess_for_iterative_solvers ? this->sln_vector : nullptr);
 
+      if (this->inexact_newton_forcing_term != InexactNewtonOff)
+        this->store_inexact_newton_linear_residual();
+
       // 1. store the solution.
       double solution_change_norm = this->update_solution_return_change_norm(this->linear_matrix_solver->get_sln_vector());
 
@@ -569,6 +684,9 @@ namespace Hermes
             for (int i = 0; i < this->problem_size; i++)
               this->sln_vector[i] = this->previous_sln_vector[i] + (this->sln_vector[i] - this->previous_sln_vector[i]) / this->auto_damping_ratio;
 
+            // The linear model of the (shorter) step.
+            this->update_inexact_newton_linear_residual_norm(damping_factors.back());
+
             // Add new_ solution norm.
             solution_norms.push_back(get_l2_norm(this->sln_vector, this->problem_size));
           }
@@ -608,6 +726,7 @@ namespace Hermes
             this->get_parameter_value(this->p_solution_change_norms).pop_back();
             memcpy(this->sln_vector, this->previous_sln_vector, sizeof(Scalar)*this->problem_size);
             this->get_residual()->set_vector(residual_back);
+            memcpy(this->inexact_newton_state, this->inexact_newton_state_back, 3 * sizeof(double));
             break;
           }
 
@@ -70,14 +70,9 @@ namespace Hermes
     {
       double current_damping_factor = this->get_parameter_value(this->p_damping_factors).back();
 
-      double solution_change_norm = 0.;
-      for (int i = 0; i < this->problem_size; i++)
-      {
-        solution_change_norm += std::pow(std::abs(linear_system_solution[i] - this->sln_vector[i]), 2.);
-        this->sln_vector[i] += current_damping_factor * (linear_system_solution[i] - this->sln_vector[i]);
-      }
+      double solution_change_norm = VectorOperations::relax_nrm2<Scalar>(this->problem_size, current_damping_factor, linear_system_solution, this->sln_vector);
 
-      return std::sqrt(solution_change_norm) * current_damping_factor;
+      return solution_change_norm * current_damping_factor;
     }
 
     template<typename Scalar>
@@ -88,9 +83,14 @@ namespace Hermes
         this->previous_jacobian->multiply_with_vector(this->sln_vector, temp, true);
       else
         this->get_jacobian()->multiply_with_vector(this->sln_vector, temp, true);
-      Vector<Scalar>* residual = this->get_residual();
-      for (int i = 0; i < this->problem_size; i++)
-        temp[i] = temp[i] - residual->get(i);
+      SimpleVector<Scalar>* residual = dynamic_cast<SimpleVector<Scalar>*>(this->get_residual());
+      if (residual)
+        VectorOperations::axpy<Scalar>(this->problem_size, Scalar(-1.), residual->v, temp);
+      else
+      {
+        for (int i = 0; i < this->problem_size; i++)
+          temp[i] = temp[i] - this->get_residual()->get(i);
+      }
 
       double residual_norm = get_l2_norm(temp, this->problem_size);
       free_with_check(temp);
@@ -210,12 +210,15 @@ namespace Hermes
           this->calculate_anderson_coeffs();
 
           // Calculate new_ vector and store it in this->Picard.
-          for (int i = 0; i < this->problem_size; i++)
+          // The sum over j of (beta * c_{j-1} * v_j + (1 - beta) * c_{j-1} * v_{j-1}) is one linear combination of the stored vectors.
+          Scalar* weights = calloc_with_check<PicardMatrixSolver<Scalar>, Scalar>(num_last_vectors_used, this);
+          for (int j = 1; j < num_last_vectors_used; j++)
           {
-            this->previous_Anderson_sln_vector[i] = 0.;
-            for (int j = 1; j < num_last_vectors_used; j++)
-              this->previous_Anderson_sln_vector[i] += anderson_coeffs[j - 1] * previous_vectors[j][i] - (1.0 - anderson_beta) * anderson_coeffs[j - 1] * (previous_vectors[j][i] - previous_vectors[j - 1][i]);
+            weights[j] += anderson_beta * anderson_coeffs[j - 1];
+            weights[j - 1] += (1.0 - anderson_beta) * anderson_coeffs[j - 1];
           }
+          VectorOperations::linear_combination<Scalar>(this->problem_size, num_last_vectors_used, weights, previous_vectors, this->previous_Anderson_sln_vector);
+          free_with_check(weights);
         }
       }
     }
@@ -237,31 +240,20 @@ namespace Hermes
       // Allocate the matrix system for the Anderson coefficients.
       Scalar** mat = new_matrix<Scalar>(n, n);
       Scalar* rhs = malloc_with_check<PicardMatrixSolver<Scalar>, Scalar>(n, this);
-      // Set up the matrix and rhs vector.
+
+      // Products of all the residuals r_i = v_{i+1} - v_i (one pass over the stored vectors).
+      Scalar* residual_products = malloc_with_check<PicardMatrixSolver<Scalar>, Scalar>((n + 1) * (n + 1), this);
+      VectorOperations::difference_gram<Scalar>(this->problem_size, n + 1, previous_vectors, residual_products);
+      Scalar r_n_r_n = residual_products[n * (n + 1) + n];
+
+      // Set up the matrix and rhs vector: rhs_i = r_n . (r_n - r_i), mat_ij = (r_n - r_i) . (r_n - r_j).
       for (int i = 0; i < n; i++)
       {
-        // Calculate i-th entry of the rhs vector.
-        rhs[i] = 0;
-        for (int k = 0; k < this->problem_size; k++)
-        {
-          Scalar residual_n_k = previous_vectors[n + 1][k] - previous_vectors[n][k];
-          Scalar residual_i_k = previous_vectors[i + 1][k] - previous_vectors[i][k];
-          rhs[i] += residual_n_k * (residual_n_k - residual_i_k);
-        }
+        rhs[i] = r_n_r_n - residual_products[n * (n + 1) + i];
         for (int j = 0; j < n; j++)
-        {
-          Scalar val = 0;
-          for (int k = 0; k < this->problem_size; k++)
-          {
-            Scalar residual_n_k = previous_vectors[n + 1][k] - previous_vectors[n][k];
-            Scalar residual_i_k = previous_vectors[i + 1][k] - previous_vectors[i][k];
-            Scalar residual_j_k = previous_vectors[j + 1][k] - previous_vectors[j][k];
-            val += (residual_n_k - residual_i_k) * (residual_n_k - residual_j_k);
-          }
-
-          mat[i][j] = val;
-        }
+          mat[i][j] = r_n_r_n - residual_products[n * (n + 1) + j] - residual_products[i * (n + 1) + n] + residual_products[i * (n + 1) + j];
       }
+      free_with_check(residual_products);
       // Solve the matrix system.
       double d;
       int* perm = malloc_with_check<PicardMatrixSolver<Scalar>, int>(n, this);